@@ -4,5 +4,8 @@
 #define DEFAULT_UDUNITS2_XML_PATH "@DEFAULT_UDUNITS2_XML_PATH@"
 #cmakedefine DLL_UDUNITS2
 #cmakedefine DLL_EXPORT
+#cmakedefine HAVE_PTHREAD_H
+#cmakedefine HAVE_SYS_MMAN_H
 #cmakedefine HAVE_UNISTD_H 
+#cmakedefine UT_ENABLE_STATS
 #cmakedefine YY_NO_UNISTD_H 
\ No newline at end of file
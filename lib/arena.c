@@ -0,0 +1,301 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Per-thread arena for the bump-allocation of transient units.
+ *
+ * While an arena is active, new units are carved out of a thread-local buffer
+ * (extended by heap chunks as necessary) instead of being individually
+ * allocated by malloc().  Freeing such a unit releases its resources but not
+ * its memory, which is reclaimed all at once when the outermost
+ * ut_arena_end() is called.  Because the arena belongs to the thread, no
+ * locking is necessary.
+ */
+
+/*LINTLIBRARY*/
+
+#include "config.h"
+
+#include "arena.h"
+#include "threadSupport.h"
+#include "udunits2.h"
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Type with the strictest alignment requirement of a unit's members.
+ */
+typedef union {
+    double	d;
+    long	l;
+    void*	p;
+    void	(*f)(void);
+} Align;
+
+#define ARENA_ROUND(nbytes) \
+    ((((nbytes) + sizeof(Align) - 1) / sizeof(Align)) * sizeof(Align))
+
+/*
+ * Size of the thread-local buffer that's used first.  It's enough for the
+ * intermediate units of a typical ut_parse().
+ */
+#define ARENA_BUFFER_SIZE	4096
+
+/*
+ * Minimum size of a chunk that extends the arena.
+ */
+#define ARENA_CHUNK_SIZE	16384
+
+typedef struct Chunk {
+    struct Chunk*	next;
+    size_t		size;		/* size of "data" in bytes */
+    Align		data[1];
+} Chunk;
+
+typedef struct Finalizer {
+    struct Finalizer*	next;
+    void		(*finalize)(void*);
+} Finalizer;
+
+typedef struct {
+    char*		next;		/* next free byte */
+    char*		end;		/* end of the current chunk */
+    Chunk*		chunks;		/* heap chunks, newest first */
+    Finalizer*		finalizers;	/* newest first */
+    int			depth;		/* ut_arena_begin() nesting depth */
+    int			suspended;	/* arenaSuspend() nesting depth */
+} Arena;
+
+static UT_THREAD_LOCAL Align	buffer[ARENA_BUFFER_SIZE/sizeof(Align)];
+static UT_THREAD_LOCAL Arena	arena;
+
+
+void*
+arenaAlloc(
+    const size_t	nbytes,
+    void		(*finalize)(void*))
+{
+    void*	ptr = NULL;
+
+    if (arena.depth > 0 && arena.suspended == 0) {
+	const size_t	size = ARENA_ROUND(nbytes) +
+	    (finalize == NULL ? 0 : ARENA_ROUND(sizeof(Finalizer)));
+
+	if ((size_t)(arena.end - arena.next) < size) {
+	    const size_t	chunkSize =
+		size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+	    Chunk* const	chunk =
+		malloc(offsetof(Chunk, data) + chunkSize);
+
+	    if (chunk != NULL) {
+		chunk->next = arena.chunks;
+		chunk->size = chunkSize;
+		arena.chunks = chunk;
+		arena.next = (char*)chunk->data;
+		arena.end = arena.next + chunkSize;
+	    }
+	}
+
+	if ((size_t)(arena.end - arena.next) >= size) {
+	    ptr = arena.next;
+	    arena.next += size;
+
+	    if (finalize != NULL) {
+		Finalizer* const	finalizer = ptr;
+
+		finalizer->next = arena.finalizers;
+		finalizer->finalize = finalize;
+		arena.finalizers = finalizer;
+		ptr = (char*)ptr + ARENA_ROUND(sizeof(Finalizer));
+	    }
+	}
+    }					/* arena active */
+
+    return ptr;
+}
+
+
+int
+arenaContains(
+    const void* const	ptr)
+{
+    int	contains = 0;
+
+    if (arena.depth > 0) {
+	const char* const	p = ptr;
+
+	if (p >= (const char*)buffer && p < (const char*)buffer + sizeof(buffer)) {
+	    contains = 1;
+	}
+	else {
+	    const Chunk*	chunk;
+
+	    for (chunk = arena.chunks; chunk != NULL; chunk = chunk->next) {
+		if (p >= (const char*)chunk->data &&
+			p < (const char*)chunk->data + chunk->size) {
+		    contains = 1;
+		    break;
+		}
+	    }
+	}
+    }
+
+    return contains;
+}
+
+
+void
+arenaRelease(
+    void* const	ptr)
+{
+    if (ptr != NULL && !arenaContains(ptr))
+	free(ptr);
+}
+
+
+void
+arenaSuspend(void)
+{
+    arena.suspended++;
+}
+
+
+void
+arenaResume(void)
+{
+    arena.suspended--;
+}
+
+
+ut_unit*
+arenaCloneToHeap(
+    const ut_unit* const	unit)
+{
+    ut_unit*	clone;
+
+    arenaSuspend();
+    clone = ut_clone(unit);
+    arenaResume();
+
+    return clone;
+}
+
+
+/*
+ * Finalizes the objects of the arena of the current thread and frees its
+ * chunks.
+ */
+static void
+arenaReleaseAll(void)
+{
+    Finalizer*	finalizer;
+
+    arenaSuspend();
+
+    for (finalizer = arena.finalizers; finalizer != NULL;
+	    finalizer = finalizer->next)
+	finalizer->finalize((char*)finalizer +
+	    ARENA_ROUND(sizeof(Finalizer)));
+
+    arenaResume();
+
+    while (arena.chunks != NULL) {
+	Chunk* const	next = arena.chunks->next;
+
+	free(arena.chunks);
+	arena.chunks = next;
+    }
+
+    arena.finalizers = NULL;
+    arena.next = NULL;
+    arena.end = NULL;
+}
+
+
+/*
+ * Begins bump-allocation of units in the current thread.  Until the matching
+ * ut_arena_end(), new units are allocated from a per-thread arena rather than
+ * individually from the heap, and freeing them doesn't return their memory.
+ * This makes code that creates and discards many intermediate units (e.g.,
+ * ut_parse(), which uses an arena internally) faster.  Calls may be nested;
+ * only the outermost pair has an effect.
+ *
+ * Units that are stored by the library (e.g., by ut_map_name_to_unit() or in
+ * a cache) are always allocated on the heap.  Units that are created between
+ * ut_arena_begin() and ut_arena_end() must not be used after the outermost
+ * ut_arena_end() unless they are returned by it.
+ */
+void
+ut_arena_begin(void)
+{
+    if (arena.depth++ == 0) {
+	arena.next = (char*)buffer;
+	arena.end = arena.next + sizeof(buffer);
+	arena.chunks = NULL;
+	arena.finalizers = NULL;
+    }
+}
+
+
+/*
+ * Ends bump-allocation of units in the current thread that was begun by
+ * ut_arena_begin().  If this is the outermost call, then all units that were
+ * created since then are released in bulk except for a given one, which is
+ * copied to the heap.
+ *
+ * Arguments:
+ *	result		Pointer to the unit to be kept or NULL.
+ * Returns:
+ *	NULL		"result" is NULL or failure.  "ut_get_status()" will be
+ *			    UT_SUCCESS	"result" is NULL.
+ *			    UT_BAD_ARG	There's no matching ut_arena_begin().
+ *			    UT_OS	Operating-system error.  See "errno".
+ *	else		Pointer to the unit corresponding to "result".  It's
+ *			just "result" unless this is the outermost call, in
+ *			which case it's a heap copy of "result" and "result"
+ *			must no longer be used.  It should be passed to
+ *			ut_free() when it's no longer needed.
+ */
+ut_unit*
+ut_arena_end(
+    ut_unit* const	result)
+{
+    ut_unit*	unit = result;
+
+    ut_set_status(UT_SUCCESS);
+
+    if (arena.depth == 0) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message("ut_arena_end(): No matching ut_arena_begin()");
+    }
+    else if (arena.depth > 1) {
+	arena.depth--;
+    }
+    else {
+	if (result != NULL && arenaContains(result)) {
+	    unit = arenaCloneToHeap(result);
+
+	    if (unit == NULL) {
+		ut_set_status(UT_OS);
+		ut_handle_error_message(strerror(errno));
+		ut_handle_error_message(
+		    "ut_arena_end(): Couldn't copy unit to heap");
+	    }
+	    else {
+		ut_set_status(UT_SUCCESS);
+	    }
+	}
+
+	arenaReleaseAll();
+	arena.depth = 0;
+    }
+
+    return unit;
+}
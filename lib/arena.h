@@ -0,0 +1,107 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Per-thread arena for the bump-allocation of transient units.  See
+ * ut_arena_begin() and ut_arena_end().
+ */
+#ifndef UT_ARENA_H_INCLUDED
+#define UT_ARENA_H_INCLUDED
+
+#include <stddef.h>
+
+#include "udunits2.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Allocates memory from the arena of the current thread.
+ *
+ * Arguments:
+ *	nbytes		The number of bytes to allocate.
+ *	finalize	Pointer to a function to be called on the memory when
+ *			the arena is released or NULL.  The function must
+ *			tolerate memory whose object was already freed.
+ * Returns:
+ *	NULL		The arena isn't active or is exhausted.  The caller
+ *			should use malloc() instead.
+ *	else		Pointer to the memory, suitably aligned for any unit.
+ *			It must not be passed to free().  See arenaRelease().
+ */
+void*
+arenaAlloc(
+    const size_t	nbytes,
+    void		(*finalize)(void*));
+
+
+/*
+ * Releases memory that was obtained from either arenaAlloc() or malloc().
+ * Memory from the arena is reclaimed when the arena is released.
+ *
+ * Arguments:
+ *	ptr		Pointer to the memory or NULL.
+ */
+void
+arenaRelease(
+    void* const	ptr);
+
+
+/*
+ * Indicates whether or not memory was obtained from the arena of the current
+ * thread.
+ *
+ * Arguments:
+ *	ptr		Pointer to the memory.
+ * Returns:
+ *	0		"ptr" isn't in the arena.
+ *	else		"ptr" is in the arena.
+ */
+int
+arenaContains(
+    const void* const	ptr);
+
+
+/*
+ * Suspends the arena of the current thread so that units are allocated on
+ * the heap until the matching arenaResume().  Used for units that outlive the
+ * arena (e.g., those of a unit-system or cache).  Calls may be nested.
+ */
+void
+arenaSuspend(void);
+
+
+/*
+ * Resumes the arena of the current thread after arenaSuspend().
+ */
+void
+arenaResume(void);
+
+
+/*
+ * Returns a clone of a unit that's allocated on the heap even if the arena of
+ * the current thread is active.
+ *
+ * Arguments:
+ *	unit		Pointer to the unit to be cloned.
+ * Returns:
+ *	NULL		Failure.  See ut_clone().
+ *	else		Pointer to the clone.
+ */
+ut_unit*
+arenaCloneToHeap(
+    const ut_unit* const	unit);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,591 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Microbenchmarks of the hot paths of the UDUNITS-2 library: reading the unit
+ * database, parsing, getting converters, converting arrays, decoding times,
+ * and formatting.
+ *
+ * Usage:
+ *	benchUnits [-t seconds] [xmlPath]
+ *
+ * Every benchmark is repeated until it has run for at least "seconds" (default
+ * 0.2).  The results are written to the standard output as tab-separated
+ * values, one benchmark per line, after a header line:
+ *
+ *	benchmark  iterations  seconds  ns_per_op  gb_per_s
+ *
+ * where an iteration is one operation (e.g., one parse or one converted
+ * value) and "gb_per_s" is the number of gigabytes of input plus output that
+ * were processed per second or "-" if that's not applicable.
+ */
+#include "config.h"
+
+#include "udunits2.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Number of values in a conversion array.  It's small enough for the input
+ * and output to stay in the cache.
+ */
+#define NVALUES		4096
+
+static double		minSeconds = 0.2;
+static volatile double	sink;		/* defeats dead-code elimination */
+
+/*
+ * Unit specifications typical of CF-conventions metadata.
+ */
+static const char* const	corpus[] = {
+    "K", "degC", "degrees_north", "degrees_east", "m", "km", "Pa", "hPa",
+    "m s-1", "m/s", "kg m-2 s-1", "kg/m2/s", "W m-2", "W/m^2", "mm/day",
+    "kg kg-1", "1", "%", "ppm", "ppbv", "mol m-3", "mol/mol", "J kg-1",
+    "m2 s-1", "s-1", "Pa s-1", "kg m-3", "g/kg", "N m-2", "dBZ", "sr",
+    "days since 1970-01-01", "hours since 1900-01-01 00:00:0.0",
+    "seconds since 1970-01-01T00:00:00Z", "minutes since 2000-1-1 12:00",
+    "m-2", "W m-2 sr-1 um-1", "mW/(m2.sr.cm-1)", "kg.m2/s3", "0.001 kg m-3"
+};
+
+#define CORPUS_SIZE	(sizeof(corpus)/sizeof(corpus[0]))
+
+/*
+ * Unit specifications that are just the name or symbol of a unit.
+ */
+static const char* const	identifiers[] = {
+    "K", "degC", "degrees_north", "degrees_east", "m", "Pa", "%", "ppm",
+    "sr", "meter", "second", "kelvin", "watt", "percent", "day", "hour"
+};
+
+#define NIDENTIFIERS	(sizeof(identifiers)/sizeof(identifiers[0]))
+
+/*
+ * Pairs of convertible units for ut_get_converter().
+ */
+static const char* const	pairs[][2] = {
+    {"m", "km"}, {"degC", "K"}, {"degF", "degC"}, {"W m-2", "mW/cm2"},
+    {"mm/day", "kg m-2 s-1"}, {"hPa", "Pa"}, {"dBZ", "mm6 m-3"},
+    {"days since 1970-01-01", "hours since 1900-01-01"}
+};
+
+#define NPAIRS		(sizeof(pairs)/sizeof(pairs[0]))
+
+
+/*
+ * Returns the current time in seconds from an arbitrary origin.
+ */
+static double
+now(void)
+{
+#if defined(CLOCK_MONOTONIC)
+    struct timespec	ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+#else
+    return (double)clock() / CLOCKS_PER_SEC;
+#endif
+}
+
+
+/*
+ * Prints the result of a benchmark.
+ *
+ * Arguments:
+ *	name		The name of the benchmark.
+ *	iterations	The number of operations.
+ *	seconds		The elapsed time.
+ *	bytesPerOp	The number of bytes of input plus output per operation
+ *			or 0 if not applicable.
+ */
+static void
+report(
+    const char* const	name,
+    const double	iterations,
+    const double	seconds,
+    const double	bytesPerOp)
+{
+    (void)printf("%s\t%.0f\t%.6f\t%.3f\t", name, iterations, seconds,
+	seconds / iterations * 1e9);
+
+    if (bytesPerOp > 0) {
+	(void)printf("%.3f\n", iterations*bytesPerOp / seconds / 1e9);
+    }
+    else {
+	(void)printf("-\n");
+    }
+
+    (void)fflush(stdout);
+}
+
+
+/*
+ * Runs a benchmark repeatedly, doubling the number of repetitions until the
+ * minimum time is reached, and reports the result.
+ *
+ * Arguments:
+ *	name		The name of the benchmark.
+ *	run		Function that runs the benchmark "reps" times with
+ *			argument "arg" and returns the number of operations.
+ *	arg		Argument for "run".
+ *	bytesPerOp	See report().
+ */
+static void
+measure(
+    const char* const	name,
+    double		(*run)(void* arg, long reps),
+    void* const		arg,
+    const double	bytesPerOp)
+{
+    long	reps = 1;
+
+    for (;;) {
+	const double	start = now();
+	const double	ops = run(arg, reps);
+	const double	seconds = now() - start;
+
+	if (seconds >= minSeconds || reps >= 1L << 30) {
+	    report(name, ops, seconds, bytesPerOp);
+	    break;
+	}
+
+	reps *= 2;
+    }
+}
+
+
+static double
+runReadXml(
+    void* const	arg,
+    const long	reps)
+{
+    long	i;
+
+    for (i = 0; i < reps; i++)
+	ut_free_system(ut_read_xml((const char*)arg));
+
+    return reps;
+}
+
+
+static double
+runReadXmlLazy(
+    void* const	arg,
+    const long	reps)
+{
+    long	i;
+
+    for (i = 0; i < reps; i++)
+	ut_free_system(ut_read_xml_lazy((const char*)arg));
+
+    return reps;
+}
+
+
+static double
+runReadXmlParallel(
+    void* const	arg,
+    const long	reps)
+{
+    long	i;
+
+    for (i = 0; i < reps; i++)
+	ut_free_system(ut_read_xml_parallel((const char*)arg));
+
+    return reps;
+}
+
+
+static double
+runParse(
+    void* const	arg,
+    const long	reps)
+{
+    ut_system* const	system = arg;
+    long		i;
+    size_t		j;
+
+    for (i = 0; i < reps; i++) {
+	for (j = 0; j < CORPUS_SIZE; j++)
+	    ut_free(ut_parse(system, corpus[j], UT_ASCII));
+    }
+
+    return (double)reps * CORPUS_SIZE;
+}
+
+
+static double
+runParseIdentifiers(
+    void* const	arg,
+    const long	reps)
+{
+    ut_system* const	system = arg;
+    long		i;
+    size_t		j;
+
+    for (i = 0; i < reps; i++) {
+	for (j = 0; j < NIDENTIFIERS; j++)
+	    ut_free(ut_parse(system, identifiers[j], UT_ASCII));
+    }
+
+    return (double)reps * NIDENTIFIERS;
+}
+
+
+typedef struct {
+    ut_unit*	from[NPAIRS];
+    ut_unit*	to[NPAIRS];
+} UnitPairs;
+
+
+static double
+runGetConverter(
+    void* const	arg,
+    const long	reps)
+{
+    const UnitPairs* const	units = arg;
+    long			i;
+    size_t			j;
+
+    for (i = 0; i < reps; i++) {
+	for (j = 0; j < NPAIRS; j++)
+	    cv_free(ut_get_converter(units->from[j], units->to[j]));
+    }
+
+    return (double)reps * NPAIRS;
+}
+
+
+typedef struct {
+    cv_converter*	converter;
+    double*		doubles;
+    double*		doubleOut;
+    float*		floats;
+    float*		floatOut;
+} Conversion;
+
+
+static double
+runConvertDoubles(
+    void* const	arg,
+    const long	reps)
+{
+    const Conversion* const	conv = arg;
+    long			i;
+
+    for (i = 0; i < reps; i++)
+	(void)cv_convert_doubles(conv->converter, conv->doubles, NVALUES,
+	    conv->doubleOut);
+
+    sink = conv->doubleOut[NVALUES-1];
+
+    return (double)reps * NVALUES;
+}
+
+
+static double
+runConvertFloats(
+    void* const	arg,
+    const long	reps)
+{
+    const Conversion* const	conv = arg;
+    long			i;
+
+    for (i = 0; i < reps; i++)
+	(void)cv_convert_floats(conv->converter, conv->floats, NVALUES,
+	    conv->floatOut);
+
+    sink = conv->floatOut[NVALUES-1];
+
+    return (double)reps * NVALUES;
+}
+
+
+static double
+runDecodeTime(
+    void* const	arg,
+    const long	reps)
+{
+    long	i;
+    double	sum = 0;
+
+    for (i = 0; i < reps; i++) {
+	int	year, month, day, hour, minute;
+	double	second, resolution;
+
+	ut_decode_time(i * 3607.25 - 1e9, &year, &month, &day, &hour,
+	    &minute, &second, &resolution);
+	sum += year + month + day + hour + minute + second;
+    }
+
+    sink = sum;
+
+    return reps;
+}
+
+
+typedef struct {
+    ut_unit*	units[CORPUS_SIZE];
+    unsigned	opts;
+} Formatting;
+
+
+static double
+runFormat(
+    void* const	arg,
+    const long	reps)
+{
+    const Formatting* const	fmt = arg;
+    long			i;
+    size_t			j;
+    char			buf[256];
+    int				n = 0;
+
+    for (i = 0; i < reps; i++) {
+	for (j = 0; j < CORPUS_SIZE; j++)
+	    n += ut_format(fmt->units[j], buf, sizeof(buf), fmt->opts);
+    }
+
+    sink = n;
+
+    return (double)reps * CORPUS_SIZE;
+}
+
+
+#define NRECORDS	(NVALUES / NPAIRS)
+
+typedef struct {
+    ut_conversion_plan*	plan;
+    cv_converter*	converters[NPAIRS];
+    size_t		count;		/* number of columns */
+    double*		in;
+    double*		out;
+} Records;
+
+
+static double
+runConvertRecords(
+    void* const	arg,
+    const long	reps)
+{
+    const Records* const	recs = arg;
+    long			i;
+
+    for (i = 0; i < reps; i++)
+	(void)ut_convert_records(recs->plan, recs->in, recs->count, NRECORDS,
+	    recs->out, recs->count, 0);
+
+    sink = recs->out[NRECORDS*recs->count-1];
+
+    return (double)reps * NRECORDS * recs->count;
+}
+
+
+/*
+ * Converts the same records as runConvertRecords() a column at a time.
+ */
+static double
+runConvertRecordsByColumn(
+    void* const	arg,
+    const long	reps)
+{
+    const Records* const	recs = arg;
+    long			i;
+    size_t			j;
+
+    for (i = 0; i < reps; i++) {
+	for (j = 0; j < recs->count; j++)
+	    (void)cv_convert_doubles_strided(recs->converters[j], recs->in + j,
+		(ptrdiff_t)recs->count, NRECORDS, recs->out + j,
+		(ptrdiff_t)recs->count);
+    }
+
+    sink = recs->out[NRECORDS*recs->count-1];
+
+    return (double)reps * NRECORDS * recs->count;
+}
+
+
+/*
+ * Benchmarks the conversion of arrays by one type of converter.
+ *
+ * Arguments:
+ *	type		The name of the type of converter.
+ *	converter	The converter.  Freed by this function.
+ *	conv		The conversion arrays.
+ */
+static void
+benchConverter(
+    const char* const		type,
+    cv_converter* const		converter,
+    Conversion* const		conv)
+{
+    char	name[64];
+
+    conv->converter = converter;
+
+    (void)snprintf(name, sizeof(name), "cv_convert_doubles.%s", type);
+    measure(name, runConvertDoubles, conv, 2*sizeof(double));
+
+    (void)snprintf(name, sizeof(name), "cv_convert_floats.%s", type);
+    measure(name, runConvertFloats, conv, 2*sizeof(float));
+
+    cv_free(converter);
+}
+
+
+int
+main(
+    const int		argc,
+    const char* const*	argv)
+{
+    int			status = EXIT_FAILURE;
+    int			iarg = 1;
+    const char*		xmlPath;
+    ut_system*		system;
+
+    if (iarg + 1 < argc && strcmp(argv[iarg], "-t") == 0) {
+	minSeconds = atof(argv[iarg+1]);
+	iarg += 2;
+    }
+
+    xmlPath = iarg < argc ? argv[iarg] : getenv("UDUNITS2_XML_PATH");
+
+    ut_set_error_message_handler(ut_ignore);
+
+    system = ut_read_xml(xmlPath);
+
+    if (system == NULL) {
+	(void)fprintf(stderr, "Couldn't read unit database \"%s\"\n",
+	    xmlPath == NULL ? "(default)" : xmlPath);
+    }
+    else {
+	static Conversion	conv;
+	UnitPairs		units;
+	UnitPairs		columns;
+	Records			recs;
+	Formatting		fmt;
+	size_t			i;
+	cv_converter*		scale;
+	cv_converter*		log;
+	cv_converter*		composite;
+
+	(void)printf("benchmark\titerations\tseconds\tns_per_op\tgb_per_s\n");
+
+	measure("ut_read_xml", runReadXml, (void*)xmlPath, 0);
+	measure("ut_read_xml_lazy", runReadXmlLazy, (void*)xmlPath, 0);
+	measure("ut_read_xml_parallel", runReadXmlParallel, (void*)xmlPath, 0);
+
+	measure("ut_parse", runParse, system, 0);
+	measure("ut_parse.identifiers", runParseIdentifiers, system, 0);
+	(void)ut_set_parse_cache_capacity(system, 2*CORPUS_SIZE);
+	measure("ut_parse.cached", runParse, system, 0);
+	(void)ut_set_parse_cache_capacity(system, 0);
+
+	for (i = 0; i < NPAIRS; i++) {
+	    units.from[i] = ut_parse(system, pairs[i][0], UT_ASCII);
+	    units.to[i] = ut_parse(system, pairs[i][1], UT_ASCII);
+	}
+	measure("ut_get_converter", runGetConverter, &units, 0);
+	(void)ut_set_converter_cache_capacity(system, 2*NPAIRS);
+	measure("ut_get_converter.cached", runGetConverter, &units, 0);
+	(void)ut_set_converter_cache_capacity(system, 0);
+
+	/*
+	 * The columns are the pairs whose units are convertible.
+	 */
+	recs.count = 0;
+	for (i = 0; i < NPAIRS; i++) {
+	    cv_converter* const	converter =
+		ut_get_converter(units.from[i], units.to[i]);
+
+	    if (converter != NULL) {
+		columns.from[recs.count] = units.from[i];
+		columns.to[recs.count] = units.to[i];
+		recs.converters[recs.count++] = converter;
+	    }
+	}
+	recs.plan = ut_new_conversion_plan(columns.from, columns.to,
+	    recs.count);
+	recs.in = malloc(NRECORDS*NPAIRS*sizeof(double));
+	recs.out = malloc(NRECORDS*NPAIRS*sizeof(double));
+	if (recs.plan != NULL && recs.in != NULL && recs.out != NULL) {
+	    for (i = 0; i < NRECORDS*recs.count; i++)
+		recs.in[i] = 1 + i*0.25;
+	    measure("ut_convert_records", runConvertRecords, &recs,
+		2*sizeof(double));
+	    measure("ut_convert_records.by_column", runConvertRecordsByColumn,
+		&recs, 2*sizeof(double));
+	}
+	for (i = 0; i < recs.count; i++)
+	    cv_free(recs.converters[i]);
+	free(recs.out);
+	free(recs.in);
+	ut_free_conversion_plan(recs.plan);
+
+	for (i = 0; i < NPAIRS; i++) {
+	    ut_free(units.from[i]);
+	    ut_free(units.to[i]);
+	}
+
+	conv.doubles = malloc(NVALUES*sizeof(double));
+	conv.doubleOut = malloc(NVALUES*sizeof(double));
+	conv.floats = malloc(NVALUES*sizeof(float));
+	conv.floatOut = malloc(NVALUES*sizeof(float));
+
+	if (conv.doubles != NULL && conv.doubleOut != NULL &&
+		conv.floats != NULL && conv.floatOut != NULL) {
+	    for (i = 0; i < NVALUES; i++) {
+		conv.doubles[i] = 1 + i*0.25;
+		conv.floats[i] = (float)conv.doubles[i];
+	    }
+
+	    benchConverter("trivial", cv_get_trivial(), &conv);
+	    benchConverter("inverse", cv_get_inverse(), &conv);
+	    benchConverter("scale", cv_get_scale(1000), &conv);
+	    benchConverter("offset", cv_get_offset(273.15), &conv);
+	    benchConverter("galilean", cv_get_galilean(1.8, 32), &conv);
+	    benchConverter("log", cv_get_log(10), &conv);
+	    benchConverter("pow", cv_get_pow(10), &conv);
+
+	    scale = cv_get_scale(0.1);
+	    log = cv_get_log(10);
+	    composite = cv_combine(scale, log);
+	    benchConverter("composite.compiled", cv_compile(composite), &conv);
+	    benchConverter("composite", composite, &conv);
+	    cv_free(log);
+	    cv_free(scale);
+	}
+
+	free(conv.floatOut);
+	free(conv.floats);
+	free(conv.doubleOut);
+	free(conv.doubles);
+
+	measure("ut_decode_time", runDecodeTime, NULL, 0);
+
+	for (i = 0; i < CORPUS_SIZE; i++)
+	    fmt.units[i] = ut_parse(system, corpus[i], UT_ASCII);
+	fmt.opts = UT_ASCII;
+	measure("ut_format.symbols", runFormat, &fmt, 0);
+	fmt.opts = UT_UTF8 | UT_NAMES;
+	measure("ut_format.names", runFormat, &fmt, 0);
+	fmt.opts = UT_ASCII | UT_DEFINITION;
+	measure("ut_format.definition", runFormat, &fmt, 0);
+	for (i = 0; i < CORPUS_SIZE; i++)
+	    ut_free(fmt.units[i]);
+
+	ut_free_system(system);
+	status = EXIT_SUCCESS;
+    }
+
+    return status;
+}
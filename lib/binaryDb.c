@@ -0,0 +1,2102 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Binary unit-database.
+ *
+ * A binary unit-database is an image of a fully-built unit-system that can be
+ * used without parsing XML or unit specifications.  It's written from the
+ * frozen maps of a unit-system.  It can be read by replaying its contents into
+ * a new unit-system (ut_read_binary()) or mapped read-only into memory
+ * (ut_mmap_binary()), in which case its identifier, unit, and prefix tables
+ * are searched in place and are shared through the page-cache by all the
+ * processes that map the same file.  Only the units themselves are decoded
+ * into each process.
+ *
+ * The database contains no pointers: every reference is a 4-byte offset from
+ * the beginning of the database or an index.  Integers and doubles are in the
+ * representation of the host, which is verified by a test-value in the
+ * header, and are naturally aligned.  The layout of version 2 is
+ *
+ *	header			A BdbHeader, which locates everything else
+ *	dimensionless flags	One byte per basic-unit, in order of creation
+ *	unit offsets		The offset of every unit-record, by index
+ *	unit-records		A unit only references units that precede it
+ *	hash tables		Name-to-unit and symbol-to-unit; unit-to-name
+ *				and unit-to-symbol for ASCII, Latin-1, UTF-8,
+ *				and Latin-1 converted to UTF-8; name-prefix and
+ *				symbol-prefix paths
+ *	string pool		NUL-terminated identifiers and prefix paths
+ *	checksum		FNV-1a hash of all preceding bytes
+ *
+ * The hash tables use open addressing with linear probing and the hash-codes
+ * of the frozen maps, so they're searched exactly like the frozen maps.
+ */
+
+/*LINTLIBRARY*/
+
+#include "config.h"
+
+#include "arena.h"
+#include "binaryDb.h"
+#include "frozenSystem.h"
+#include "idToUnitMap.h"
+#include "prefix.h"
+#include "udunits2.h"
+#include "unitAndId.h"
+#include "unitToIdMap.h"
+
+#include <errno.h>
+#ifndef _MSC_VER
+#include <inttypes.h>
+#else
+#define int32_t		__int32
+#define uint32_t	unsigned __int32
+#endif
+#ifdef _MSC_VER
+#include "tsearch.h"
+#else
+#include <search.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define BDB_VERSION	2
+#define BDB_TEST_VALUE	1.5
+#define BDB_NONE	0xFFFFFFFFUL	/* no unit or string */
+#define BDB_ALIGN	8		/* alignment of records */
+#define BDB_MAX_SIZE	0xFFFFFFF0UL	/* maximum size of a database */
+
+enum {
+    BDB_PRODUCT = 0,
+    BDB_GALILEAN,
+    BDB_TIMESTAMP,
+    BDB_LOG
+};
+
+/*
+ * Unit-to-identifier tables of an identifier-type.
+ */
+enum {
+    BDB_ASCII = 0,
+    BDB_LATIN1,
+    BDB_UTF8,
+    BDB_LATIN1_AS_UTF8,
+    BDB_NUM_ENCODINGS
+};
+
+static const char	magic[8] = "UDU2BDB";
+
+/*
+ * A hash table.  The number of slots is a power of two that's greater than the
+ * number of entries.
+ */
+typedef struct {
+    uint32_t		slots;		/* offset of the slots */
+    uint32_t		mask;		/* number of slots - 1 */
+    uint32_t		count;		/* number of entries */
+} BdbTable;
+
+typedef struct {
+    char		magic[8];
+    uint32_t		version;
+    uint32_t		size;		/* bytes in database incl. checksum */
+    double		testValue;
+    uint32_t		basicCount;	/* number of basic-units */
+    uint32_t		basicFlags;	/* offset of dimensionless flags */
+    uint32_t		unitCount;	/* number of units */
+    uint32_t		units;		/* offset of unit offsets */
+    uint32_t		second;		/* index of "second" or BDB_NONE */
+    uint32_t		strings;	/* offset of string pool */
+    uint32_t		stringsSize;	/* bytes in string pool */
+    BdbTable		idToUnit[2];	/* by BdbIdType */
+    BdbTable		unitToId[2][BDB_NUM_ENCODINGS];
+    BdbTable		prefixes[2];	/* by BdbIdType */
+} BdbHeader;
+
+/*
+ * A slot of an identifier-to-unit or unit-to-identifier table.
+ */
+typedef struct {
+    uint32_t		hash;
+    uint32_t		id;		/* offset in string pool */
+    uint32_t		unit;		/* index of unit or BDB_NONE if empty */
+} BdbIdSlot;
+
+/*
+ * A slot of a prefix table.  Like a frozen prefix map, there's an entry for
+ * every leading substring of every prefix.
+ */
+typedef struct {
+    double		value;		/* 0 if path isn't a whole prefix */
+    uint32_t		hash;
+    uint32_t		path;		/* offset in string pool or BDB_NONE */
+} BdbPrefixSlot;
+
+/*
+ * A unit-record.  The factors of a product-unit immediately follow it.
+ */
+typedef struct {
+    uint32_t		type;
+    uint32_t		arg;		/* number of factors or unit index */
+    double		value[2];	/* scale & offset, origin, or base */
+} BdbUnit;
+
+typedef struct {
+    uint32_t		index;		/* index of basic-unit */
+    int32_t		power;
+} BdbFactor;
+
+struct BinaryDb {
+    const unsigned char*	data;
+    size_t			size;
+    int				isMapped;	/* "data" from mmap()? */
+    const BdbHeader*		header;
+    ut_unit**			basicUnits;
+    unsigned long		basicCount;	/* number decoded */
+    ut_unit**			units;
+    unsigned long		unitCount;	/* number decoded */
+};
+
+typedef struct {
+    const ut_unit*	unit;
+    unsigned long	index;
+} UnitRef;
+
+/*
+ * A growing database.
+ */
+typedef struct {
+    unsigned char*	data;
+    size_t		size;
+    size_t		capacity;
+    int			failed;		/* an allocation failed? */
+} Image;
+
+typedef struct {
+    Image		image;		/* database without string pool */
+    Image		strings;	/* string pool */
+    size_t		record;		/* offset of last unit-record */
+    void*		tree;		/* UnitRef-s ordered by unit */
+    unsigned long	count;		/* number of units in "tree" */
+    const ut_unit**	units;		/* units in order of index */
+    unsigned long	capacity;	/* number of elements in "units" */
+    int			missing;	/* a unit wasn't collected? */
+} Writer;
+
+
+/******************************************************************************
+ * Writing:
+ ******************************************************************************/
+
+
+/*
+ * Allocates zeroed bytes at the end of an image.
+ *
+ * Arguments:
+ *	image		Pointer to the image.
+ *	nbytes		The number of bytes.
+ *	align		The alignment of the bytes.
+ * Returns:
+ *	The offset of the bytes in the image.  Zero if "image->failed" is
+ *	set.
+ */
+static size_t
+imgAlloc(
+    Image* const	image,
+    const size_t	nbytes,
+    const size_t	align)
+{
+    size_t	offset = 0;
+
+    if (!image->failed) {
+	const size_t	start = (image->size + align - 1) / align * align;
+
+	if (nbytes > BDB_MAX_SIZE || start > BDB_MAX_SIZE - nbytes) {
+	    errno = EFBIG;
+	    image->failed = 1;
+	}
+	else {
+	    if (start + nbytes > image->capacity) {
+		size_t		capacity =
+		    image->capacity == 0 ? 4096 : image->capacity;
+		unsigned char*	data;
+
+		while (capacity < start + nbytes)
+		    capacity *= 2;
+
+		data = realloc(image->data, capacity);
+
+		if (data == NULL) {
+		    image->failed = 1;
+		}
+		else {
+		    image->data = data;
+		    image->capacity = capacity;
+		}
+	    }
+
+	    if (!image->failed) {
+		(void)memset(image->data + image->size, 0,
+		    start + nbytes - image->size);
+
+		image->size = start + nbytes;
+		offset = start;
+	    }
+	}
+    }
+
+    return offset;
+}
+
+
+/*
+ * Appends a string to a string pool and returns its offset in the pool.
+ */
+static uint32_t
+imgPutString(
+    Image* const	strings,
+    const char* const	string)
+{
+    const size_t	nbytes = strlen(string) + 1;
+    const size_t	offset = imgAlloc(strings, nbytes, 1);
+
+    if (!strings->failed)
+	(void)memcpy(strings->data + offset, string, nbytes);
+
+    return (uint32_t)offset;
+}
+
+
+static int
+compareRefs(
+    const void* const	ref1,
+    const void* const	ref2)
+{
+    return ut_compare(((const UnitRef*)ref1)->unit,
+	((const UnitRef*)ref2)->unit);
+}
+
+
+/*
+ * Returns the index of a unit that was collected by collectUnit().
+ *
+ * Arguments:
+ *	writer		Pointer to the writer.
+ *	unit		Pointer to the unit.
+ * Returns:
+ *	BDB_NONE	"unit" wasn't collected.  "writer->missing" is set.
+ *	else		The index of "unit".
+ */
+static unsigned long
+getIndex(
+    Writer* const		writer,
+    const ut_unit* const	unit)
+{
+    UnitRef		target;
+    UnitRef**		node;
+    unsigned long	index = BDB_NONE;
+
+    target.unit = unit;
+    node = tfind(&target, &writer->tree, compareRefs);
+
+    if (node == NULL) {
+	writer->missing = 1;
+    }
+    else {
+	index = (*node)->index;
+    }
+
+    return index;
+}
+
+
+static ut_status collectUnit(Writer* const writer, const ut_unit* const unit);
+
+
+static ut_status
+collectNothing(
+    const ut_unit* const	unit,
+    void* const			arg)
+{
+    return UT_SUCCESS;
+}
+
+
+static ut_status
+collectNothingFromProduct(
+    const ut_unit* const		unit,
+    const int				count,
+    const ut_unit* const* const		basicUnits,
+    const int* const			powers,
+    void* const				arg)
+{
+    return UT_SUCCESS;
+}
+
+
+static ut_status
+collectFromGalilean(
+    const ut_unit* const	unit,
+    const double		scale,
+    const ut_unit* const	underlyingUnit,
+    const double		offset,
+    void* const			arg)
+{
+    return collectUnit((Writer*)arg, underlyingUnit);
+}
+
+
+static ut_status
+collectFromTimestamp(
+    const ut_unit* const	unit,
+    const ut_unit* const	timeUnit,
+    const double		origin,
+    void* const			arg)
+{
+    return collectUnit((Writer*)arg, timeUnit);
+}
+
+
+static ut_status
+collectFromLog(
+    const ut_unit* const	unit,
+    const double		base,
+    const ut_unit* const	reference,
+    void* const			arg)
+{
+    return collectUnit((Writer*)arg, reference);
+}
+
+
+static ut_visitor	collector = {
+    collectNothing,
+    collectNothingFromProduct,
+    collectFromGalilean,
+    collectFromTimestamp,
+    collectFromLog
+};
+
+
+/*
+ * Adds a unit and the units that it references to the units to be written if
+ * they're not already there.  The referenced units are added first.
+ *
+ * Arguments:
+ *	writer		Pointer to the writer.
+ *	unit		Pointer to the unit.  Must exist until the writer is
+ *			destroyed.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_OS		Operating-system failure.  See "errno".
+ */
+static ut_status
+collectUnit(
+    Writer* const		writer,
+    const ut_unit* const	unit)
+{
+    ut_status	status = UT_SUCCESS;
+    UnitRef	target;
+
+    target.unit = unit;
+
+    if (tfind(&target, &writer->tree, compareRefs) == NULL) {
+	status = ut_accept_visitor(unit, &collector, writer);
+
+	if (status == UT_SUCCESS) {
+	    if (writer->count == writer->capacity) {
+		unsigned long	capacity =
+		    writer->capacity == 0 ? 256 : 2*writer->capacity;
+		const ut_unit**	units = realloc((void*)writer->units,
+		    capacity*sizeof(ut_unit*));
+
+		if (units == NULL) {
+		    status = UT_OS;
+		}
+		else {
+		    writer->units = units;
+		    writer->capacity = capacity;
+		}
+	    }
+
+	    if (status == UT_SUCCESS) {
+		UnitRef*	ref = malloc(sizeof(UnitRef));
+
+		if (ref == NULL) {
+		    status = UT_OS;
+		}
+		else {
+		    ref->unit = unit;
+		    ref->index = writer->count;
+
+		    if (tsearch(ref, &writer->tree, compareRefs) == NULL) {
+			free(ref);
+			status = UT_OS;
+		    }
+		    else {
+			writer->units[writer->count++] = unit;
+		    }
+		}
+	    }
+	}				/* referenced units collected */
+    }					/* unit not already collected */
+
+    return status;
+}
+
+
+/*
+ * Adds the units of the entries of a frozen table whose values are
+ * UnitAndId-s to the units to be written.
+ */
+static ut_status
+collectTable(
+    Writer* const		writer,
+    const FrozenTable* const	table)
+{
+    ut_status	status = UT_SUCCESS;
+    size_t	i;
+
+    for (i = 0; status == UT_SUCCESS && i <= table->mask; i++) {
+	const FrozenSlot* const	slot = table->slots + i;
+
+	if (slot->key != NULL)
+	    status = collectUnit(writer, ((const UnitAndId*)slot->value)->unit);
+    }
+
+    return status;
+}
+
+
+/*
+ * Returns a table of a frozen unit-to-identifier map by its index in a
+ * database.
+ */
+static const FrozenTable*
+getUnitToIdTable(
+    const FrozenUnitToIdMap* const	frozen,
+    const int				index)
+{
+    return index == BDB_LATIN1_AS_UTF8
+	? utimGetFrozenLatin1AsUtf8Table(frozen)
+	: utimGetFrozenTable(frozen,
+	    index == BDB_LATIN1
+		? UT_LATIN1
+		: index == BDB_UTF8
+		    ? UT_UTF8
+		    : UT_ASCII);
+}
+
+
+/*
+ * Collects all the units of a frozen unit-system that must be written.  The
+ * "second" unit, if it's set, is collected first.
+ */
+static ut_status
+collectUnits(
+    Writer* const		writer,
+    const ut_system* const	system,
+    const FrozenSystem* const	frozen)
+{
+    ut_status		status = UT_SUCCESS;
+    const ut_unit*	second = coreGetSecond(system);
+    int			i;
+
+    if (second != NULL)
+	status = collectUnit(writer, second);
+
+    if (status == UT_SUCCESS)
+	status = collectTable(writer, itumGetFrozenTable(frozen->nameToUnit));
+    if (status == UT_SUCCESS)
+	status = collectTable(writer, itumGetFrozenTable(frozen->symbolToUnit));
+
+    for (i = 0; status == UT_SUCCESS && i < BDB_LATIN1_AS_UTF8; i++) {
+	status = collectTable(writer, getUnitToIdTable(frozen->unitToName, i));
+
+	if (status == UT_SUCCESS)
+	    status = collectTable(writer,
+		getUnitToIdTable(frozen->unitToSymbol, i));
+    }
+
+    return status;
+}
+
+
+/*
+ * Appends a unit-record to the database of a writer.  Its offset is
+ * "writer->record".
+ *
+ * Arguments:
+ *	writer		Pointer to the writer.
+ *	type		The type of the unit.
+ *	arg		The number of factors or the index of the referenced
+ *			unit.
+ *	value0		The first value.
+ *	value1		The second value.
+ * Returns:
+ *	NULL		Failure.  "writer->image.failed" is set.
+ *	else		Pointer to the record.  Valid until the next
+ *			allocation.
+ */
+static BdbUnit*
+putUnit(
+    Writer* const		writer,
+    const unsigned		type,
+    const unsigned long		arg,
+    const double		value0,
+    const double		value1)
+{
+    BdbUnit*		record = NULL;
+    const size_t	nbytes = sizeof(BdbUnit) +
+	(type == BDB_PRODUCT ? arg*sizeof(BdbFactor) : 0);
+
+    writer->record = imgAlloc(&writer->image, nbytes, BDB_ALIGN);
+
+    if (!writer->image.failed) {
+	record = (BdbUnit*)(writer->image.data + writer->record);
+	record->type = type;
+	record->arg = (uint32_t)arg;
+	record->value[0] = value0;
+	record->value[1] = value1;
+    }
+
+    return record;
+}
+
+
+static ut_status
+writeBasic(
+    const ut_unit* const	unit,
+    void* const			arg)
+{
+    BdbUnit* const	record = putUnit((Writer*)arg, BDB_PRODUCT, 1, 0, 0);
+
+    if (record != NULL) {
+	BdbFactor* const	factor = (BdbFactor*)(record + 1);
+
+	factor->index = (uint32_t)coreGetBasicIndex(unit);
+	factor->power = 1;
+    }
+
+    return UT_SUCCESS;
+}
+
+
+static ut_status
+writeProduct(
+    const ut_unit* const		unit,
+    const int				count,
+    const ut_unit* const* const		basicUnits,
+    const int* const			powers,
+    void* const				arg)
+{
+    BdbUnit* const	record =
+	putUnit((Writer*)arg, BDB_PRODUCT, (unsigned long)count, 0, 0);
+
+    if (record != NULL) {
+	BdbFactor* const	factors = (BdbFactor*)(record + 1);
+	int			i;
+
+	for (i = 0; i < count; i++) {
+	    factors[i].index = (uint32_t)coreGetBasicIndex(basicUnits[i]);
+	    factors[i].power = powers[i];
+	}
+    }
+
+    return UT_SUCCESS;
+}
+
+
+static ut_status
+writeGalilean(
+    const ut_unit* const	unit,
+    const double		scale,
+    const ut_unit* const	underlyingUnit,
+    const double		offset,
+    void* const			arg)
+{
+    Writer* const	writer = (Writer*)arg;
+
+    (void)putUnit(writer, BDB_GALILEAN, getIndex(writer, underlyingUnit),
+	scale, offset);
+
+    return UT_SUCCESS;
+}
+
+
+static ut_status
+writeTimestamp(
+    const ut_unit* const	unit,
+    const ut_unit* const	timeUnit,
+    const double		origin,
+    void* const			arg)
+{
+    Writer* const	writer = (Writer*)arg;
+
+    (void)putUnit(writer, BDB_TIMESTAMP, getIndex(writer, timeUnit), origin,
+	0);
+
+    return UT_SUCCESS;
+}
+
+
+static ut_status
+writeLog(
+    const ut_unit* const	unit,
+    const double		base,
+    const ut_unit* const	reference,
+    void* const			arg)
+{
+    Writer* const	writer = (Writer*)arg;
+
+    (void)putUnit(writer, BDB_LOG, getIndex(writer, reference), base, 0);
+
+    return UT_SUCCESS;
+}
+
+
+static ut_visitor	unitWriter = {
+    writeBasic,
+    writeProduct,
+    writeGalilean,
+    writeTimestamp,
+    writeLog
+};
+
+
+/*
+ * Returns the number of slots of a hash table for a given number of entries.
+ */
+static size_t
+slotCount(
+    const size_t	count)
+{
+    size_t	nslots = 1;
+
+    while (nslots < 2*count)
+	nslots <<= 1;
+
+    return nslots;
+}
+
+
+/*
+ * Appends an identifier table to the database of a writer.
+ *
+ * Arguments:
+ *	writer		Pointer to the writer.
+ *	table		Pointer to the table in the header to be set.
+ *	frozen		Pointer to the frozen table whose values are
+ *			UnitAndId-s.
+ */
+static void
+putIdTable(
+    Writer* const		writer,
+    BdbTable* const		table,
+    const FrozenTable* const	frozen)
+{
+    const size_t	nslots = slotCount(frozen->count);
+    const size_t	offset = imgAlloc(&writer->image,
+	nslots*sizeof(BdbIdSlot), BDB_ALIGN);
+
+    if (!writer->image.failed) {
+	BdbIdSlot* const	slots = (BdbIdSlot*)(writer->image.data + offset);
+	size_t			i;
+
+	table->slots = (uint32_t)offset;
+	table->mask = (uint32_t)(nslots - 1);
+	table->count = (uint32_t)frozen->count;
+
+	for (i = 0; i < nslots; i++)
+	    slots[i].unit = (uint32_t)BDB_NONE;
+
+	for (i = 0; i <= frozen->mask; i++) {
+	    const FrozenSlot* const	slot = frozen->slots + i;
+
+	    if (slot->key != NULL) {
+		const UnitAndId* const	uai = (const UnitAndId*)slot->value;
+		const uint32_t		hash = (uint32_t)slot->hash;
+		size_t			j = hash & table->mask;
+
+		while (slots[j].unit != BDB_NONE)
+		    j = (j + 1) & table->mask;
+
+		slots[j].hash = hash;
+		slots[j].id = imgPutString(&writer->strings, uai->id);
+		slots[j].unit = (uint32_t)getIndex(writer, uai->unit);
+	    }
+	}
+    }
+}
+
+
+/*
+ * Appends a prefix table to the database of a writer.
+ *
+ * Arguments:
+ *	writer		Pointer to the writer.
+ *	table		Pointer to the table in the header to be set.
+ *	frozen		Pointer to the frozen table whose keys are paths and
+ *			whose values are pointers to doubles.
+ */
+static void
+putPrefixTable(
+    Writer* const		writer,
+    BdbTable* const		table,
+    const FrozenTable* const	frozen)
+{
+    const size_t	nslots = slotCount(frozen->count);
+    const size_t	offset = imgAlloc(&writer->image,
+	nslots*sizeof(BdbPrefixSlot), BDB_ALIGN);
+
+    if (!writer->image.failed) {
+	BdbPrefixSlot* const	slots =
+	    (BdbPrefixSlot*)(writer->image.data + offset);
+	size_t			i;
+
+	table->slots = (uint32_t)offset;
+	table->mask = (uint32_t)(nslots - 1);
+	table->count = (uint32_t)frozen->count;
+
+	for (i = 0; i < nslots; i++)
+	    slots[i].path = (uint32_t)BDB_NONE;
+
+	for (i = 0; i <= frozen->mask; i++) {
+	    const FrozenSlot* const	slot = frozen->slots + i;
+
+	    if (slot->key != NULL) {
+		const uint32_t	hash = (uint32_t)slot->hash;
+		size_t		j = hash & table->mask;
+
+		while (slots[j].path != BDB_NONE)
+		    j = (j + 1) & table->mask;
+
+		slots[j].value = *(const double*)slot->value;
+		slots[j].hash = hash;
+		slots[j].path = imgPutString(&writer->strings,
+		    (const char*)slot->key);
+	    }
+	}
+    }
+}
+
+
+/*
+ * Builds the database of a frozen unit-system whose units have been collected.
+ * On failure, "writer->image.failed" or "writer->strings.failed" is set.
+ */
+static void
+putSystem(
+    Writer* const		writer,
+    const ut_system* const	system,
+    const FrozenSystem* const	frozen)
+{
+    Image* const	image = &writer->image;
+    BdbHeader		header;
+    size_t		offset;
+    unsigned long	i;
+    int			type;
+
+    (void)memset(&header, 0, sizeof(header));
+    (void)memcpy(header.magic, magic, sizeof(magic));
+    header.version = BDB_VERSION;
+    header.testValue = BDB_TEST_VALUE;
+
+    (void)imgAlloc(image, sizeof(BdbHeader), BDB_ALIGN);
+
+    header.basicCount = (uint32_t)coreGetBasicCount(system);
+    offset = imgAlloc(image, header.basicCount, 1);
+    header.basicFlags = (uint32_t)offset;
+    for (i = 0; !image->failed && i < header.basicCount; i++)
+	image->data[offset+i] = (unsigned char)
+	    (ut_is_dimensionless(coreGetBasicUnit(system, (int)i)) != 0);
+
+    header.unitCount = (uint32_t)writer->count;
+    header.units = (uint32_t)imgAlloc(image,
+	writer->count*sizeof(uint32_t), BDB_ALIGN);
+    header.second = coreGetSecond(system) == NULL ? BDB_NONE : 0;
+    for (i = 0; !image->failed && i < writer->count; i++) {
+	(void)ut_accept_visitor(writer->units[i], &unitWriter, writer);
+
+	if (!image->failed)
+	    ((uint32_t*)(image->data + header.units))[i] =
+		(uint32_t)writer->record;
+    }
+
+    putIdTable(writer, &header.idToUnit[BDB_NAME],
+	itumGetFrozenTable(frozen->nameToUnit));
+    putIdTable(writer, &header.idToUnit[BDB_SYMBOL],
+	itumGetFrozenTable(frozen->symbolToUnit));
+
+    for (type = 0; type < BDB_NUM_ENCODINGS; type++) {
+	putIdTable(writer, &header.unitToId[BDB_NAME][type],
+	    getUnitToIdTable(frozen->unitToName, type));
+	putIdTable(writer, &header.unitToId[BDB_SYMBOL][type],
+	    getUnitToIdTable(frozen->unitToSymbol, type));
+    }
+
+    putPrefixTable(writer, &header.prefixes[BDB_NAME],
+	ptvmGetFrozenTable(frozen->nameToPrefix));
+    putPrefixTable(writer, &header.prefixes[BDB_SYMBOL],
+	ptvmGetFrozenTable(frozen->symbolToPrefix));
+
+    if (writer->strings.failed) {
+	image->failed = 1;
+    }
+    else {
+	header.stringsSize = (uint32_t)writer->strings.size;
+	offset = imgAlloc(image, writer->strings.size, 1);
+	header.strings = (uint32_t)offset;
+
+	if (!image->failed)
+	    (void)memcpy(image->data + offset, writer->strings.data,
+		writer->strings.size);
+    }
+
+    offset = imgAlloc(image, sizeof(uint32_t), sizeof(uint32_t));
+
+    if (!image->failed) {
+	uint32_t	checksum = FS_HASH_INIT;
+
+	header.size = (uint32_t)image->size;
+	(void)memcpy(image->data, &header, sizeof(header));
+
+	for (i = 0; i < offset; i++)
+	    checksum = (uint32_t)FS_HASH_STEP(checksum, image->data[i]);
+
+	(void)memcpy(image->data + offset, &checksum, sizeof(checksum));
+    }
+}
+
+
+static void
+writerDestroy(
+    Writer* const	writer)
+{
+    while (writer->tree != NULL) {
+	UnitRef* const	ref = *(UnitRef**)writer->tree;
+
+	(void)tdelete(ref, &writer->tree, compareRefs);
+	free(ref);
+    }
+
+    free((void*)writer->units);
+    free(writer->image.data);
+    free(writer->strings.data);
+}
+
+
+/*
+ * Writes a database to a file.
+ *
+ * Arguments:
+ *	path		Pathname of the file to be created.
+ *	data		Pointer to the database.
+ *	size		Number of bytes in the database.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_OPEN_ARG	The file couldn't be created.  See "errno".
+ *	UT_OS		Operating-system error.  See "errno".
+ */
+static ut_status
+writeFile(
+    const char* const	path,
+    const void* const	data,
+    const size_t	size)
+{
+    FILE* const	file = fopen(path, "wb");
+
+    if (file == NULL) {
+	ut_set_status(UT_OPEN_ARG);
+	ut_handle_error_message(strerror(errno));
+	ut_handle_error_message(
+	    "ut_write_binary(): Couldn't create file \"%s\"", path);
+    }
+    else {
+	int	failed = fwrite(data, 1, size, file) != size;
+
+	if (fclose(file) != 0)
+	    failed = 1;
+
+	if (failed) {
+	    ut_set_status(UT_OS);
+	    ut_handle_error_message(strerror(errno));
+	    ut_handle_error_message(
+		"ut_write_binary(): Couldn't write file \"%s\"", path);
+	    (void)remove(path);
+	}
+    }
+
+    return ut_get_status();
+}
+
+
+/*
+ * Writes a unit-system to a binary unit-database file.  The unit-system isn't
+ * frozen.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	path		Pathname of the file to be created.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" or "path" is NULL.
+ *	UT_OPEN_ARG	The file couldn't be created.  See "errno".
+ *	UT_PARSE	A unit of the unit-system couldn't be indexed.  No file
+ *			is created.
+ *	UT_OS		Operating-system error.  See "errno".
+ */
+ut_status
+ut_write_binary(
+    ut_system* const	system,
+    const char* const	path)
+{
+    ut_set_status(UT_SUCCESS);
+
+    if (system == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message("ut_write_binary(): NULL unit-system argument");
+    }
+    else if (path == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message("ut_write_binary(): NULL pathname argument");
+    }
+    else {
+	/*
+	 * The frozen maps of an unfrozen unit-system are built privately so
+	 * that the unit-system can still be modified.
+	 */
+	FrozenSystem* const		copy =
+	    coreGetFrozen(system) == NULL ? fsCopy(system) : NULL;
+	const FrozenSystem* const	frozen =
+	    copy != NULL ? copy : coreGetFrozen(system);
+
+	if (frozen == NULL) {
+	    ut_handle_error_message(
+		"ut_write_binary(): Couldn't build frozen maps of unit-system");
+	}
+	else if (frozen->binaryDb != NULL) {
+	    (void)writeFile(path, frozen->binaryDb->data,
+		frozen->binaryDb->size);
+	}
+	else {
+	    Writer		writer;
+	    ut_status		status;
+
+	    (void)memset(&writer, 0, sizeof(writer));
+
+	    /*
+	     * The string pool starts with an empty string so that it's never
+	     * empty.
+	     */
+	    (void)imgPutString(&writer.strings, "");
+
+	    if (collectUnits(&writer, system, frozen) != UT_SUCCESS) {
+		ut_set_status(UT_OS);
+		ut_handle_error_message(strerror(errno));
+		ut_handle_error_message(
+		    "ut_write_binary(): Couldn't collect units of unit-system");
+	    }
+	    else {
+		putSystem(&writer, system, frozen);
+
+		if (writer.image.failed) {
+		    ut_set_status(UT_OS);
+		    ut_handle_error_message(strerror(errno));
+		    ut_handle_error_message(
+			"ut_write_binary(): Couldn't build binary database");
+		}
+		else if (writer.missing) {
+		    ut_set_status(UT_PARSE);
+		    ut_handle_error_message(
+			"ut_write_binary(): A unit of the unit-system wasn't "
+			"collected");
+		}
+		else {
+		    (void)writeFile(path, writer.image.data, writer.image.size);
+		}
+	    }
+
+	    /*
+	     * Destroying the writer calls ut_compare(), which resets the
+	     * status.
+	     */
+	    status = ut_get_status();
+	    writerDestroy(&writer);
+	    ut_set_status(status);
+	}
+
+	if (copy != NULL) {
+	    const ut_status	status = ut_get_status();
+
+	    fsFree(copy);
+	    ut_set_status(status);
+	}
+    }					/* valid arguments */
+
+    return ut_get_status();
+}
+
+
+/******************************************************************************
+ * Opening:
+ ******************************************************************************/
+
+
+/*
+ * Indicates whether or not a range of bytes lies within the database (before
+ * the checksum) and is aligned.
+ */
+static int
+inRange(
+    const BinaryDb* const	db,
+    const size_t		offset,
+    const size_t		nbytes,
+    const size_t		align)
+{
+    const size_t	end = db->size - sizeof(uint32_t);
+
+    return offset % align == 0 && offset <= end && nbytes <= end - offset;
+}
+
+
+/*
+ * Returns a string of the string pool of a database.
+ */
+static const char*
+getString(
+    const BinaryDb* const	db,
+    const uint32_t		offset)
+{
+    return (const char*)db->data + db->header->strings + offset;
+}
+
+
+static int
+isValidIdTable(
+    const BinaryDb* const	db,
+    const BdbTable* const	table)
+{
+    const size_t	nslots = (size_t)table->mask + 1;
+    int			isValid = nslots != 0 &&
+	(nslots & table->mask) == 0 &&
+	nslots <= db->size / sizeof(BdbIdSlot) &&
+	inRange(db, table->slots, nslots*sizeof(BdbIdSlot), sizeof(uint32_t)) &&
+	table->count < nslots;
+
+    if (isValid) {
+	const BdbIdSlot* const	slots =
+	    (const BdbIdSlot*)(db->data + table->slots);
+	size_t			count = 0;
+	size_t			i;
+
+	for (i = 0; isValid && i < nslots; i++) {
+	    if (slots[i].unit != BDB_NONE) {
+		isValid = slots[i].unit < db->header->unitCount &&
+		    slots[i].id < db->header->stringsSize;
+		count++;
+	    }
+	}
+
+	isValid = isValid && count == table->count;
+    }
+
+    return isValid;
+}
+
+
+static int
+isValidPrefixTable(
+    const BinaryDb* const	db,
+    const BdbTable* const	table)
+{
+    const size_t	nslots = (size_t)table->mask + 1;
+    int			isValid = nslots != 0 &&
+	(nslots & table->mask) == 0 &&
+	nslots <= db->size / sizeof(BdbPrefixSlot) &&
+	inRange(db, table->slots, nslots*sizeof(BdbPrefixSlot), BDB_ALIGN) &&
+	table->count < nslots;
+
+    if (isValid) {
+	const BdbPrefixSlot* const	slots =
+	    (const BdbPrefixSlot*)(db->data + table->slots);
+	size_t				count = 0;
+	size_t				i;
+
+	for (i = 0; isValid && i < nslots; i++) {
+	    if (slots[i].path != BDB_NONE) {
+		isValid = slots[i].path < db->header->stringsSize;
+		count++;
+	    }
+	}
+
+	isValid = isValid && count == table->count;
+    }
+
+    return isValid;
+}
+
+
+/*
+ * Indicates whether or not everything that the header of a database references
+ * lies within the database.  The unit-records are checked when they're
+ * decoded.
+ */
+static int
+isValidStructure(
+    const BinaryDb* const	db)
+{
+    const BdbHeader* const	header = db->header;
+    int				isValid =
+	header->size == db->size &&
+	db->size % sizeof(uint32_t) == 0 &&
+	inRange(db, header->basicFlags, header->basicCount, 1) &&
+	header->unitCount <= db->size / sizeof(uint32_t) &&
+	inRange(db, header->units, header->unitCount*sizeof(uint32_t),
+	    sizeof(uint32_t)) &&
+	(header->second == BDB_NONE || header->second < header->unitCount) &&
+	header->stringsSize > 0 &&
+	inRange(db, header->strings, header->stringsSize, 1) &&
+	db->data[header->strings + header->stringsSize - 1] == 0;
+    int				type;
+    int				i;
+
+    for (type = 0; isValid && type < 2; type++) {
+	isValid = isValidIdTable(db, &header->idToUnit[type]) &&
+	    isValidPrefixTable(db, &header->prefixes[type]);
+
+	for (i = 0; isValid && i < BDB_NUM_ENCODINGS; i++)
+	    isValid = isValidIdTable(db, &header->unitToId[type][i]);
+    }
+
+    return isValid;
+}
+
+
+/*
+ * Frees the data of a database.
+ */
+static void
+freeData(
+    const unsigned char* const	data,
+    const size_t		size,
+    const int			isMapped)
+{
+#ifdef HAVE_SYS_MMAN_H
+    if (isMapped) {
+	(void)munmap((void*)data, size);
+    }
+    else
+#endif
+    {
+	free((void*)data);
+    }
+}
+
+
+/*
+ * Returns a new database for the contents of a binary unit-database file.  The
+ * header, checksum, and tables of the contents are verified.
+ *
+ * Arguments:
+ *	data		Pointer to the contents of the file.  The database
+ *			takes ownership of them: they're freed by bdbFree() or
+ *			on failure.
+ *	size		The number of bytes in the file.
+ *	isMapped	Whether or not "data" was obtained from mmap().
+ *	caller		Name of the calling function for error-messages.
+ *	path		The pathname of the file.
+ * Returns:
+ *	NULL		Failure.  "ut_get_status()" will be
+ *			    UT_PARSE	The data isn't a binary unit-database
+ *					of a supported version or is corrupt.
+ *			    UT_OS	Operating-system failure.
+ *	else		Pointer to the database.  The client should pass it to
+ *			bdbFree() when it's no longer needed.
+ */
+static BinaryDb*
+bdbNew(
+    const unsigned char* const	data,
+    const size_t		size,
+    const int			isMapped,
+    const char* const		caller,
+    const char* const		path)
+{
+    const BdbHeader* const	header = (const BdbHeader*)data;
+    BinaryDb*			db = NULL;
+
+    if (size < sizeof(BdbHeader) + sizeof(uint32_t) ||
+	    memcmp(header->magic, magic, sizeof(magic)) != 0) {
+	ut_set_status(UT_PARSE);
+	ut_handle_error_message(
+	    "%s(): \"%s\" isn't a binary unit-database", caller, path);
+    }
+    else if (header->version != BDB_VERSION) {
+	ut_set_status(UT_PARSE);
+	ut_handle_error_message("%s(): \"%s\" has unsupported version %lu",
+	    caller, path, (unsigned long)header->version);
+    }
+    else if (header->testValue != BDB_TEST_VALUE) {
+	ut_set_status(UT_PARSE);
+	ut_handle_error_message("%s(): \"%s\" was written on a host with a "
+	    "different byte-order", caller, path);
+    }
+    else {
+	uint32_t	checksum = FS_HASH_INIT;
+	uint32_t	expected;
+	size_t		i;
+
+	for (i = 0; i < size - sizeof(uint32_t); i++)
+	    checksum = (uint32_t)FS_HASH_STEP(checksum, data[i]);
+
+	(void)memcpy(&expected, data + size - sizeof(uint32_t),
+	    sizeof(expected));
+
+	if (checksum != expected) {
+	    ut_set_status(UT_PARSE);
+	    ut_handle_error_message("%s(): \"%s\" is corrupt", caller, path);
+	}
+	else {
+	    db = calloc(1, sizeof(BinaryDb));
+
+	    if (db == NULL) {
+		ut_set_status(UT_OS);
+		ut_handle_error_message(strerror(errno));
+		ut_handle_error_message("%s(): Couldn't allocate %lu-byte "
+		    "database", caller, (unsigned long)sizeof(BinaryDb));
+	    }
+	    else {
+		db->data = data;
+		db->size = size;
+		db->isMapped = isMapped;
+		db->header = header;
+
+		if (!isValidStructure(db)) {
+		    ut_set_status(UT_PARSE);
+		    ut_handle_error_message("%s(): \"%s\" is corrupt", caller,
+			path);
+		    free(db);
+		    db = NULL;
+		}
+	    }
+	}
+    }
+
+    if (db == NULL)
+	freeData(data, size, isMapped);
+
+    return db;
+}
+
+
+/*
+ * Decodes a product-unit.
+ *
+ * Arguments:
+ *	db		Pointer to the database.
+ *	system		Pointer to the unit-system of the unit.
+ *	record		Pointer to the unit-record.
+ *	corrupt		Pointer to the corruption flag.  Set if the record is
+ *			invalid.
+ */
+static ut_unit*
+decodeProduct(
+    const BinaryDb* const	db,
+    const ut_system* const	system,
+    const BdbUnit* const	record,
+    int* const			corrupt)
+{
+    const uint32_t		count = record->arg;
+    const BdbFactor* const	factors = (const BdbFactor*)(record + 1);
+    ut_unit*			product = NULL;
+
+    if (count > db->size / sizeof(BdbFactor) ||
+	    !inRange(db, (const unsigned char*)factors - db->data,
+		count*sizeof(BdbFactor), sizeof(uint32_t))) {
+	*corrupt = 1;
+    }
+    else {
+	uint32_t	i;
+
+	if (count == 0)
+	    product = ut_clone(ut_get_dimensionless_unit_one(system));
+
+	for (i = 0; i < count; i++) {
+	    const uint32_t	index = factors[i].index;
+	    const int32_t	power = factors[i].power;
+	    ut_unit*		factor;
+
+	    if (index >= db->basicCount || power == 0 || power < -255 ||
+		    power > 255) {
+		*corrupt = 1;
+		break;
+	    }
+
+	    factor = ut_raise(db->basicUnits[index], (int)power);
+
+	    if (factor == NULL)
+		break;
+
+	    if (product == NULL) {
+		product = factor;
+	    }
+	    else {
+		ut_unit* const	result = ut_multiply(product, factor);
+
+		ut_free(factor);
+		ut_free(product);
+
+		product = result;
+
+		if (product == NULL)
+		    break;
+	    }
+	}
+
+	if (i < count) {
+	    ut_free(product);
+	    product = NULL;
+	}
+    }
+
+    return product;
+}
+
+
+/*
+ * Decodes a unit.  The units that it references must have been decoded.
+ *
+ * Arguments:
+ *	db		Pointer to the database.
+ *	system		Pointer to the unit-system of the unit.
+ *	index		The index of the unit.
+ *	corrupt		Pointer to the corruption flag.  Set if the record is
+ *			invalid.
+ * Returns:
+ *	NULL		Failure.
+ *	else		Pointer to the unit.
+ */
+static ut_unit*
+decodeUnit(
+    const BinaryDb* const	db,
+    const ut_system* const	system,
+    const unsigned long		index,
+    int* const			corrupt)
+{
+    ut_unit*		unit = NULL;
+    const uint32_t	offset =
+	((const uint32_t*)(db->data + db->header->units))[index];
+
+    if (!inRange(db, offset, sizeof(BdbUnit), BDB_ALIGN)) {
+	*corrupt = 1;
+    }
+    else {
+	const BdbUnit* const	record = (const BdbUnit*)(db->data + offset);
+
+	if (record->type == BDB_PRODUCT) {
+	    unit = decodeProduct(db, system, record, corrupt);
+	}
+	else if (record->arg >= index) {
+	    *corrupt = 1;
+	}
+	else if (record->type == BDB_GALILEAN) {
+	    unit = coreNewGalilean(record->value[0], db->units[record->arg],
+		record->value[1]);
+	}
+	else if (record->type == BDB_TIMESTAMP) {
+	    unit = ut_offset_by_time(db->units[record->arg], record->value[0]);
+	}
+	else if (record->type == BDB_LOG) {
+	    unit = ut_log(record->value[0], db->units[record->arg]);
+	}
+	else {
+	    *corrupt = 1;
+	}
+    }
+
+    return unit;
+}
+
+
+/*
+ * Creates the basic-units and decodes the units of a database in a unit-system
+ * and sets the "second" unit of the unit-system.
+ *
+ * Arguments:
+ *	db		Pointer to the database.
+ *	system		Pointer to the new unit-system.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_PARSE	A unit-record is corrupt.
+ *	UT_OS		Operating-system failure.
+ */
+static ut_status
+bdbDecodeUnits(
+    BinaryDb* const	db,
+    ut_system* const	system)
+{
+    ut_status			status = UT_SUCCESS;
+    const BdbHeader* const	header = db->header;
+
+    arenaSuspend();			/* the units belong to the database */
+
+    db->basicUnits = malloc((header->basicCount+1) * sizeof(ut_unit*));
+    db->units = malloc((header->unitCount+1) * sizeof(ut_unit*));
+
+    if (db->basicUnits == NULL || db->units == NULL) {
+	status = UT_OS;
+    }
+    else {
+	int	corrupt = 0;
+
+	for (; db->basicCount < header->basicCount; db->basicCount++) {
+	    ut_unit* const	unit =
+		db->data[header->basicFlags + db->basicCount]
+		    ? ut_new_dimensionless_unit(system)
+		    : ut_new_base_unit(system);
+
+	    if (unit == NULL) {
+		status = ut_get_status();
+		break;
+	    }
+
+	    db->basicUnits[db->basicCount] = unit;
+	}
+
+	for (; status == UT_SUCCESS && db->unitCount < header->unitCount;
+		db->unitCount++) {
+	    ut_unit* const	unit =
+		decodeUnit(db, system, db->unitCount, &corrupt);
+
+	    if (unit == NULL) {
+		/*
+		 * A unit that can't be created from a valid record indicates a
+		 * corrupt file unless the cause is the operating-system.
+		 */
+		status = !corrupt && ut_get_status() == UT_OS
+		    ? UT_OS
+		    : UT_PARSE;
+		break;
+	    }
+
+	    db->units[db->unitCount] = unit;
+
+	    /*
+	     * The "second" unit is set as soon as it's decoded because
+	     * timestamp-units need it.
+	     */
+	    if (db->unitCount == header->second)
+		status = ut_set_second(unit);
+	}
+    }
+
+    arenaResume();
+
+    return status;
+}
+
+
+void
+bdbFree(
+    BinaryDb* const	db)
+{
+    if (db != NULL) {
+	unsigned long	i;
+
+	for (i = 0; i < db->unitCount; i++)
+	    ut_free(db->units[i]);
+	for (i = 0; i < db->basicCount; i++)
+	    ut_free(db->basicUnits[i]);
+
+	free(db->units);
+	free(db->basicUnits);
+	freeData(db->data, db->size, db->isMapped);
+	free(db);
+    }
+}
+
+
+/*
+ * Returns the contents of a file.
+ *
+ * Arguments:
+ *	path		The pathname of the file.
+ *	caller		Name of the calling function for error-messages.
+ *	size		Pointer to the number of bytes in the file.
+ * Returns:
+ *	NULL		Failure.  "ut_get_status()" will be
+ *			    UT_OPEN_ARG	The file couldn't be opened.
+ *			    UT_OS	Operating-system error.  See "errno".
+ *	else		Pointer to the contents of the file.  The client should
+ *			free() it when it's no longer needed.
+ */
+static unsigned char*
+readFile(
+    const char* const	path,
+    const char* const	caller,
+    size_t* const	size)
+{
+    unsigned char*	data = NULL;
+    FILE* const		file = fopen(path, "rb");
+
+    if (file == NULL) {
+	ut_set_status(UT_OPEN_ARG);
+	ut_handle_error_message(strerror(errno));
+	ut_handle_error_message("%s(): Couldn't open file \"%s\"", caller,
+	    path);
+    }
+    else {
+	long	len;
+
+	if (fseek(file, 0, SEEK_END) != 0 || (len = ftell(file)) < 0 ||
+		fseek(file, 0, SEEK_SET) != 0) {
+	    ut_set_status(UT_OS);
+	    ut_handle_error_message(strerror(errno));
+	    ut_handle_error_message(
+		"%s(): Couldn't get size of file \"%s\"", caller, path);
+	}
+	else {
+	    data = malloc(len == 0 ? 1 : (size_t)len);
+
+	    if (data == NULL) {
+		ut_set_status(UT_OS);
+		ut_handle_error_message(strerror(errno));
+		ut_handle_error_message(
+		    "%s(): Couldn't allocate %ld-byte buffer", caller, len);
+	    }
+	    else if (fread(data, 1, (size_t)len, file) != (size_t)len) {
+		ut_set_status(UT_OS);
+		ut_handle_error_message(strerror(errno));
+		ut_handle_error_message(
+		    "%s(): Couldn't read file \"%s\"", caller, path);
+		free(data);
+		data = NULL;
+	    }
+	    else {
+		*size = (size_t)len;
+	    }
+	}
+
+	(void)fclose(file);
+    }					/* file opened */
+
+    return data;
+}
+
+
+/*
+ * Maps a file read-only into memory.  If memory-mapping isn't available, then
+ * the file is read instead.
+ *
+ * Arguments:
+ *	path		The pathname of the file.
+ *	size		Pointer to the number of bytes in the file.
+ *	isMapped	Pointer to whether or not the returned data was mapped.
+ * Returns:
+ *	NULL		Failure.  "ut_get_status()" will be
+ *			    UT_OPEN_ARG	The file couldn't be opened.
+ *			    UT_PARSE	The file is too small to be a binary
+ *					unit-database.
+ *			    UT_OS	Operating-system error.  See "errno".
+ *	else		Pointer to the contents of the file.
+ */
+static unsigned char*
+mapFile(
+    const char* const	path,
+    size_t* const	size,
+    int* const		isMapped)
+{
+    unsigned char*	data = NULL;
+#ifdef HAVE_SYS_MMAN_H
+    const int		fd = open(path, O_RDONLY);
+
+    if (fd == -1) {
+	ut_set_status(UT_OPEN_ARG);
+	ut_handle_error_message(strerror(errno));
+	ut_handle_error_message(
+	    "ut_mmap_binary(): Couldn't open file \"%s\"", path);
+    }
+    else {
+	struct stat	info;
+
+	if (fstat(fd, &info) != 0) {
+	    ut_set_status(UT_OS);
+	    ut_handle_error_message(strerror(errno));
+	    ut_handle_error_message(
+		"ut_mmap_binary(): Couldn't get size of file \"%s\"", path);
+	}
+	else if ((size_t)info.st_size < sizeof(BdbHeader)) {
+	    /*
+	     * An empty file can't be mapped.
+	     */
+	    ut_set_status(UT_PARSE);
+	    ut_handle_error_message(
+		"ut_mmap_binary(): \"%s\" isn't a binary unit-database", path);
+	}
+	else {
+	    void* const	addr = mmap(NULL, (size_t)info.st_size, PROT_READ,
+		MAP_SHARED, fd, 0);
+
+	    if (addr == MAP_FAILED) {
+		ut_set_status(UT_OS);
+		ut_handle_error_message(strerror(errno));
+		ut_handle_error_message(
+		    "ut_mmap_binary(): Couldn't map file \"%s\"", path);
+	    }
+	    else {
+		data = (unsigned char*)addr;
+		*size = (size_t)info.st_size;
+		*isMapped = 1;
+	    }
+	}
+
+	(void)close(fd);
+    }					/* file opened */
+#else
+    data = readFile(path, "ut_mmap_binary", size);
+    *isMapped = 0;
+#endif
+
+    return data;
+}
+
+
+/******************************************************************************
+ * Lookups:
+ ******************************************************************************/
+
+
+static int
+foldedEqual(
+    const char*		query,
+    const char*		key)
+{
+    while (*query != 0 && FS_FOLD(*query) == FS_FOLD(*key)) {
+	query++;
+	key++;
+    }
+
+    return *query == 0 && *key == 0;
+}
+
+
+const ut_unit*
+bdbGetUnitById(
+    const BinaryDb* const	db,
+    const BdbIdType		type,
+    const char* const		id)
+{
+    const ut_unit*		unit = NULL;
+    const BdbTable* const	table = &db->header->idToUnit[type];
+    const BdbIdSlot* const	slots = (const BdbIdSlot*)(db->data + table->slots);
+    const int			fold = type == BDB_NAME;
+    const uint32_t		hash = (uint32_t)fsHashString(id, fold);
+    size_t			i;
+
+    for (i = hash & table->mask; slots[i].unit != BDB_NONE;
+	    i = (i + 1) & table->mask) {
+	if (slots[i].hash == hash) {
+	    const char* const	key = getString(db, slots[i].id);
+
+	    if (fold ? foldedEqual(id, key) : strcmp(id, key) == 0) {
+		unit = db->units[slots[i].unit];
+		break;
+	    }
+	}
+    }
+
+    return unit;
+}
+
+
+/*
+ * Returns the identifier of a unit in a unit-to-identifier table of a
+ * database.
+ */
+static const char*
+findId(
+    const BinaryDb* const	db,
+    const BdbTable* const	table,
+    const ut_unit* const	unit,
+    const uint32_t		hash)
+{
+    const char*			id = NULL;
+    const BdbIdSlot* const	slots = (const BdbIdSlot*)(db->data + table->slots);
+    size_t			i;
+
+    for (i = hash & table->mask; slots[i].unit != BDB_NONE;
+	    i = (i + 1) & table->mask) {
+	if (slots[i].hash == hash &&
+		ut_compare(unit, db->units[slots[i].unit]) == 0) {
+	    id = getString(db, slots[i].id);
+	    break;
+	}
+    }
+
+    return id;
+}
+
+
+const char*
+bdbGetId(
+    const BinaryDb* const	db,
+    const BdbIdType		type,
+    const ut_unit* const	unit,
+    const ut_encoding		encoding)
+{
+    const BdbTable* const	tables = db->header->unitToId[type];
+    const uint32_t		hash = (uint32_t)coreHashUnit(unit);
+    const char*			id = NULL;
+
+    if (encoding == UT_UTF8) {
+	id = findId(db, tables + BDB_UTF8, unit, hash);
+
+	if (id == NULL)
+	    id = findId(db, tables + BDB_LATIN1_AS_UTF8, unit, hash);
+    }
+    else if (encoding == UT_LATIN1) {
+	id = findId(db, tables + BDB_LATIN1, unit, hash);
+    }
+
+    if (id == NULL)
+	id = findId(db, tables + BDB_ASCII, unit, hash);
+
+    return id;
+}
+
+
+/*
+ * Indicates whether or not a path of a prefix table equals the first
+ * characters of a string.
+ */
+static int
+pathMatches(
+    const char* const	path,
+    const char* const	string,
+    const size_t	len,
+    const int		fold)
+{
+    size_t	i;
+
+    for (i = 0; i < len; i++) {
+	const int	c = fold
+	    ? FS_FOLD(string[i])
+	    : (unsigned char)string[i];
+
+	if (c != (unsigned char)path[i])
+	    break;
+    }
+
+    return i == len && path[i] == 0;
+}
+
+
+double
+bdbFindPrefix(
+    const BinaryDb* const	db,
+    const BdbIdType		type,
+    const char* const		string,
+    size_t* const		len)
+{
+    const BdbTable* const	table = &db->header->prefixes[type];
+    const BdbPrefixSlot* const	slots =
+	(const BdbPrefixSlot*)(db->data + table->slots);
+    const int			fold = type == BDB_NAME;
+    unsigned long		hash = FS_HASH_INIT;
+    double			value = 0;
+    size_t			n;
+
+    for (n = 1; string[n-1] != 0; n++) {
+	const char		c = string[n-1];
+	const BdbPrefixSlot*	slot = NULL;
+	size_t			i;
+
+	hash = FS_HASH_STEP(hash, fold ? FS_FOLD(c) : c);
+
+	for (i = hash & table->mask; slots[i].path != BDB_NONE;
+		i = (i + 1) & table->mask) {
+	    if (slots[i].hash == hash &&
+		    pathMatches(getString(db, slots[i].path), string, n, fold)) {
+		slot = slots + i;
+		break;
+	    }
+	}
+
+	if (slot == NULL)
+	    break;
+
+	value = slot->value;
+	*len = n;
+    }
+
+    return value;
+}
+
+
+/******************************************************************************
+ * Reading:
+ ******************************************************************************/
+
+
+static ut_status
+replayIdToUnit(
+    const BinaryDb* const	db,
+    const BdbTable* const	table,
+    ut_status			(*map)(const char*, ut_encoding, const ut_unit*))
+{
+    ut_status			status = UT_SUCCESS;
+    const BdbIdSlot* const	slots = (const BdbIdSlot*)(db->data + table->slots);
+    size_t			i;
+
+    for (i = 0; status == UT_SUCCESS && i <= table->mask; i++)
+	if (slots[i].unit != BDB_NONE)
+	    status = map(getString(db, slots[i].id), UT_ASCII,
+		db->units[slots[i].unit]);
+
+    return status;
+}
+
+
+static ut_status
+replayUnitToId(
+    const BinaryDb* const	db,
+    const BdbTable* const	table,
+    ut_status			(*map)(const ut_unit*, const char*, ut_encoding),
+    const ut_encoding		encoding)
+{
+    ut_status			status = UT_SUCCESS;
+    const BdbIdSlot* const	slots = (const BdbIdSlot*)(db->data + table->slots);
+    size_t			i;
+
+    for (i = 0; status == UT_SUCCESS && i <= table->mask; i++)
+	if (slots[i].unit != BDB_NONE)
+	    status = map(db->units[slots[i].unit], getString(db, slots[i].id),
+		encoding);
+
+    return status;
+}
+
+
+/*
+ * Adds the prefixes of a prefix table to a unit-system.  Only the paths that
+ * are whole prefixes (i.e., that have a non-zero value) are added.
+ */
+static ut_status
+replayPrefixes(
+    const BinaryDb* const	db,
+    const BdbTable* const	table,
+    ut_system* const		system,
+    ut_status			(*add)(ut_system*, const char*, double))
+{
+    ut_status			status = UT_SUCCESS;
+    const BdbPrefixSlot* const	slots =
+	(const BdbPrefixSlot*)(db->data + table->slots);
+    size_t			i;
+
+    for (i = 0; status == UT_SUCCESS && i <= table->mask; i++)
+	if (slots[i].path != BDB_NONE && slots[i].value != 0)
+	    status = add(system, getString(db, slots[i].path), slots[i].value);
+
+    return status;
+}
+
+
+/*
+ * Adds the maps and prefixes of a database whose units have been decoded to
+ * the unit-system of the units.
+ */
+static ut_status
+replaySystem(
+    const BinaryDb* const	db,
+    ut_system* const		system)
+{
+    const BdbHeader* const	header = db->header;
+    ut_status			status;
+    int				i;
+
+    status = replayIdToUnit(db, &header->idToUnit[BDB_NAME],
+	ut_map_name_to_unit);
+    if (status == UT_SUCCESS)
+	status = replayIdToUnit(db, &header->idToUnit[BDB_SYMBOL],
+	    ut_map_symbol_to_unit);
+
+    for (i = 0; status == UT_SUCCESS && i < BDB_LATIN1_AS_UTF8; i++) {
+	const ut_encoding	encoding = i == BDB_LATIN1
+	    ? UT_LATIN1
+	    : i == BDB_UTF8
+		? UT_UTF8
+		: UT_ASCII;
+
+	status = replayUnitToId(db, &header->unitToId[BDB_NAME][i],
+	    ut_map_unit_to_name, encoding);
+	if (status == UT_SUCCESS)
+	    status = replayUnitToId(db, &header->unitToId[BDB_SYMBOL][i],
+		ut_map_unit_to_symbol, encoding);
+    }
+
+    if (status == UT_SUCCESS)
+	status = replayPrefixes(db, &header->prefixes[BDB_NAME], system,
+	    ut_add_name_prefix);
+    if (status == UT_SUCCESS)
+	status = replayPrefixes(db, &header->prefixes[BDB_SYMBOL], system,
+	    ut_add_symbol_prefix);
+
+    return status;
+}
+
+
+/*
+ * Returns the unit-system corresponding to a binary unit-database file that
+ * was created by ut_write_binary().  The returned unit-system may be modified.
+ *
+ * Arguments:
+ *	path	The pathname of the file.
+ * Returns:
+ *	NULL	Failure.  "ut_get_status()" will be
+ *		    UT_BAD_ARG		"path" is NULL.
+ *		    UT_OPEN_ARG		The file couldn't be opened.  See
+ *					"errno".
+ *		    UT_PARSE		The file isn't a binary unit-database
+ *					of a supported version or is corrupt.
+ *		    UT_OS		Operating-system error.  See "errno".
+ *	else	Pointer to the unit-system defined by "path".
+ */
+ut_system*
+ut_read_binary(
+    const char* const	path)
+{
+    ut_system*	system = NULL;
+
+    ut_set_status(UT_SUCCESS);
+
+    if (path == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message("ut_read_binary(): NULL pathname argument");
+    }
+    else {
+	size_t			size;
+	unsigned char* const	data = readFile(path, "ut_read_binary", &size);
+	BinaryDb* const		db = data == NULL
+	    ? NULL
+	    : bdbNew(data, size, 0, "ut_read_binary", path);
+
+	if (db != NULL) {
+	    ut_system* const	newSystem = ut_new_system();
+
+	    if (newSystem == NULL) {
+		bdbFree(db);
+	    }
+	    else {
+		ut_status	status = bdbDecodeUnits(db, newSystem);
+
+		if (status == UT_SUCCESS)
+		    status = replaySystem(db, newSystem);
+
+		bdbFree(db);
+
+		if (status == UT_SUCCESS) {
+		    system = newSystem;
+		    ut_set_status(status);
+		}
+		else {
+		    ut_free_system(newSystem);
+		    ut_set_status(status);
+		    ut_handle_error_message("ut_read_binary(): "
+			"Couldn't load binary unit-database \"%s\"", path);
+		}
+	    }
+	}				/* database opened */
+    }					/* non-NULL "path" */
+
+    return system;
+}
+
+
+/*
+ * Returns a frozen unit-system that's mapped read-only from a binary
+ * unit-database file that was created by ut_write_binary().  The identifier,
+ * unit, and prefix tables of the unit-system are used in place and are shared
+ * by every process that maps the same file; only the units are decoded.  The
+ * file must not be modified while it's mapped: replace it by renaming a new
+ * file over it instead.
+ *
+ * Arguments:
+ *	path	The pathname of the file.
+ * Returns:
+ *	NULL	Failure.  "ut_get_status()" will be
+ *		    UT_BAD_ARG		"path" is NULL.
+ *		    UT_OPEN_ARG		The file couldn't be opened.  See
+ *					"errno".
+ *		    UT_PARSE		The file isn't a binary unit-database
+ *					of a supported version or is corrupt.
+ *		    UT_OS		Operating-system error.  See "errno".
+ *	else	Pointer to the frozen unit-system defined by "path".
+ */
+ut_system*
+ut_mmap_binary(
+    const char* const	path)
+{
+    ut_system*	system = NULL;
+
+    ut_set_status(UT_SUCCESS);
+
+    if (path == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message("ut_mmap_binary(): NULL pathname argument");
+    }
+    else {
+	size_t			size;
+	int			isMapped = 0;
+	unsigned char* const	data = mapFile(path, &size, &isMapped);
+	BinaryDb* const		db = data == NULL
+	    ? NULL
+	    : bdbNew(data, size, isMapped, "ut_mmap_binary", path);
+
+	if (db != NULL) {
+	    ut_system* const	newSystem = ut_new_system();
+	    FrozenSystem* const	frozen = calloc(1, sizeof(FrozenSystem));
+
+	    if (newSystem == NULL || frozen == NULL) {
+		ut_set_status(UT_OS);
+		ut_handle_error_message(strerror(errno));
+		ut_handle_error_message(
+		    "ut_mmap_binary(): Couldn't allocate unit-system");
+		bdbFree(db);
+		free(frozen);
+		ut_free_system(newSystem);
+	    }
+	    else {
+		const ut_status	status = bdbDecodeUnits(db, newSystem);
+
+		if (status == UT_SUCCESS) {
+		    frozen->binaryDb = db;
+		    coreSetFrozen(newSystem, frozen);
+
+		    system = newSystem;
+		    ut_set_status(status);
+		}
+		else {
+		    bdbFree(db);
+		    free(frozen);
+		    ut_free_system(newSystem);
+		    ut_set_status(status);
+		    ut_handle_error_message("ut_mmap_binary(): "
+			"Couldn't load binary unit-database \"%s\"", path);
+		}
+	    }
+	}				/* database opened */
+    }					/* non-NULL "path" */
+
+    return system;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Access to the internals of a unit-system that's needed to write and read a
+ * binary unit-database, and lookups in a unit-system that was mapped from a
+ * binary unit-database by ut_mmap_binary().
+ */
+#ifndef UT_BINARY_DB_H_INCLUDED
+#define UT_BINARY_DB_H_INCLUDED
+
+#include "frozenSystem.h"
+#include "udunits2.h"
+
+/*
+ * The type of the identifiers of a lookup in a binary unit-database.
+ */
+typedef enum {
+    BDB_NAME = 0,	/* case-insensitive */
+    BDB_SYMBOL		/* case-sensitive */
+} BdbIdType;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Returns the number of basic-units (i.e., base-units and dimensionless-units)
+ * of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ */
+int
+coreGetBasicCount(
+    const ut_system* const	system);
+
+
+/*
+ * Returns a basic-unit of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	index		The index of the basic-unit in the order in which the
+ *			basic-units were added to "system".  Must be less than
+ *			"coreGetBasicCount(system)".
+ * Returns:
+ *	Pointer to the basic-unit.  The client must not free it.
+ */
+const ut_unit*
+coreGetBasicUnit(
+    const ut_system* const	system,
+    const int			index);
+
+
+/*
+ * Returns the index of a basic-unit.
+ *
+ * Arguments:
+ *	unit		Pointer to the unit.
+ * Returns:
+ *	-1		"unit" isn't a basic-unit.
+ *	else		The index of "unit" as used by coreGetBasicUnit().
+ */
+int
+coreGetBasicIndex(
+    const ut_unit* const	unit);
+
+
+/*
+ * Returns the "second" unit of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	NULL		The "second" unit of "system" isn't set.
+ *	else		Pointer to the "second" unit.  The client must not free
+ *			it.
+ */
+const ut_unit*
+coreGetSecond(
+    const ut_system* const	system);
+
+
+/*
+ * Returns a new Galilean-unit with exactly the given scale-factor and offset
+ * relative to its underlying unit -- unlike ut_scale() and ut_offset(), which
+ * combine their arguments with an existing Galilean-unit.
+ *
+ * Arguments:
+ *	scale		The scale-factor.  Must not be zero.
+ *	unit		Pointer to the underlying unit.  Must not be a
+ *			Galilean-unit.
+ *	offset		The offset.
+ * Returns:
+ *	NULL		Failure.  "ut_get_status()" will be
+ *			    UT_BAD_ARG	"scale" is zero or "unit" is NULL.
+ *			    UT_OS	Operating-system error.  See "errno".
+ *	else		Pointer to the new unit.  The client should pass it to
+ *			ut_free() when it's no longer needed.
+ */
+ut_unit*
+coreNewGalilean(
+    const double		scale,
+    const ut_unit* const	unit,
+    const double		offset);
+
+
+/*
+ * Returns the unit to which an identifier maps in a binary unit-database.
+ *
+ * Arguments:
+ *	db		Pointer to the binary unit-database.
+ *	type		The type of the identifier.
+ *	id		Pointer to the identifier.
+ * Returns:
+ *	NULL		"id" doesn't map to a unit.
+ *	else		Pointer to the unit.  The client must not free it.
+ */
+const ut_unit*
+bdbGetUnitById(
+    const BinaryDb* const	db,
+    const BdbIdType		type,
+    const char* const		id);
+
+
+/*
+ * Returns the identifier in a given encoding to which a unit maps in a binary
+ * unit-database.  Like for a frozen map, a UTF-8 identifier is looked for
+ * first, then a Latin-1 identifier converted to UTF-8, and then an ASCII
+ * identifier; a Latin-1 identifier before an ASCII one.
+ *
+ * Arguments:
+ *	db		Pointer to the binary unit-database.
+ *	type		The type of the identifier.
+ *	unit		Pointer to the unit.
+ *	encoding	The desired encoding of the identifier.
+ * Returns:
+ *	NULL		"unit" doesn't map to an identifier in the encoding.
+ *	else		Pointer to the identifier.  It's in the database.
+ */
+const char*
+bdbGetId(
+    const BinaryDb* const	db,
+    const BdbIdType		type,
+    const ut_unit* const	unit,
+    const ut_encoding		encoding);
+
+
+/*
+ * Returns the value of the longest prefix of a binary unit-database that
+ * matches the beginning of a string.
+ *
+ * Arguments:
+ *	db		Pointer to the binary unit-database.
+ *	type		The type of the prefix.
+ *	string		Pointer to the string to be examined for a prefix.
+ *	len		Pointer to the number of characters in the prefix, if
+ *			one is found.
+ * Returns:
+ *	0		No prefix matches the beginning of "string".
+ *	else		The value of the prefix.
+ */
+double
+bdbFindPrefix(
+    const BinaryDb* const	db,
+    const BdbIdType		type,
+    const char* const		string,
+    size_t* const		len);
+
+
+/*
+ * Frees a binary unit-database and the units that were decoded from it.
+ *
+ * Arguments:
+ *	db		Pointer to the binary unit-database or NULL.
+ */
+void
+bdbFree(
+    BinaryDb* const	db);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,484 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Conversion plans: the converters of a fixed set of columns, each of which
+ * has its own pair of units, for converting blocks of tabular data in one
+ * call.
+ *
+ * The converters are obtained and compiled once, when the plan is created.
+ * Blocks are either a structure of arrays (one array per column) or an array
+ * of records (the values of a record are adjacent and records are a stride
+ * apart).  Records are converted in blocks that fit in the cache so that each
+ * record is brought into the cache only once for all of its columns.
+ */
+
+/*LINTLIBRARY*/
+
+#include "config.h"
+
+#include "udunits2.h"
+#include "threadPool.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Number of records converted column by column before moving on.
+ */
+#define PLAN_BLOCK_SIZE		256
+/*
+ * Number of parallel tasks per thread (for load-balancing).
+ */
+#define PLAN_TASKS_PER_THREAD	4
+
+struct ut_conversion_plan {
+    cv_converter**	converters;
+    size_t		count;		/* number of columns */
+};
+
+
+/*
+ * Returns a new conversion plan for columns of values.  The converter of each
+ * column is obtained from ut_get_converter() and compiled by cv_compile().
+ *
+ * Arguments:
+ *	from		The units from which to convert the values of the
+ *			columns.  "from[i]" is the unit of column "i".
+ *	to		The units to which to convert the values of the
+ *			columns.  "to[i]" is the unit of column "i".
+ *	count		The number of columns.
+ * Returns:
+ *	NULL		Failure.  "ut_get_status()" will be
+ *			    UT_BAD_ARG		"from" or "to" is NULL or
+ *						contains NULL.
+ *			    UT_NOT_SAME_SYSTEM	The units of a column belong to
+ *						different unit-systems.
+ *			    UT_MEANINGLESS	Conversion between the units of
+ *						a column isn't possible.
+ *			    UT_OS		Operating-system failure.  See
+ *						"errno".
+ *	else		Pointer to the plan.  Should be passed to
+ *			ut_free_conversion_plan() when no longer needed.
+ */
+ut_conversion_plan*
+ut_new_conversion_plan(
+    ut_unit* const* const	from,
+    ut_unit* const* const	to,
+    const size_t		count)
+{
+    ut_conversion_plan*	plan = NULL;
+
+    if ((from == NULL || to == NULL) && count > 0) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message("ut_new_conversion_plan(): NULL unit array");
+    }
+    else {
+	plan = malloc(sizeof(ut_conversion_plan));
+
+	if (plan != NULL) {
+	    plan->count = 0;
+	    plan->converters = calloc(count == 0 ? 1 : count,
+		sizeof(cv_converter*));
+
+	    if (plan->converters == NULL) {
+		free(plan);
+		plan = NULL;
+	    }
+	}
+
+	if (plan == NULL) {
+	    ut_set_status(UT_OS);
+	    ut_handle_error_message(strerror(errno));
+	    ut_handle_error_message(
+		"ut_new_conversion_plan(): Couldn't allocate plan");
+	}
+	else {
+	    ut_set_status(UT_SUCCESS);
+
+	    for (; plan->count < count; plan->count++) {
+		cv_converter* const	converter =
+		    ut_get_converter(from[plan->count], to[plan->count]);
+		cv_converter*		compiled;
+
+		if (converter == NULL) {
+		    ut_handle_error_message("ut_new_conversion_plan(): "
+			"Couldn't get converter of column %lu",
+			(unsigned long)plan->count);
+		    break;
+		}
+
+		compiled = cv_compile(converter);
+		cv_free(converter);
+
+		if (compiled == NULL) {
+		    ut_set_status(UT_OS);
+		    ut_handle_error_message(strerror(errno));
+		    ut_handle_error_message("ut_new_conversion_plan(): "
+			"Couldn't compile converter of column %lu",
+			(unsigned long)plan->count);
+		    break;
+		}
+
+		plan->converters[plan->count] = compiled;
+	    }
+
+	    if (plan->count < count) {
+		const ut_status	status = ut_get_status();
+
+		ut_free_conversion_plan(plan);
+		ut_set_status(status);
+		plan = NULL;
+	    }
+	}
+    }
+
+    return plan;
+}
+
+
+/*
+ * Returns the number of columns of a conversion plan.
+ *
+ * Arguments:
+ *	plan		Pointer to the plan.
+ * Returns:
+ *	0		"plan" is NULL or has no columns.  "ut_get_status()" will
+ *			be UT_BAD_ARG or UT_SUCCESS, respectively.
+ *	else		The number of columns.
+ */
+size_t
+ut_get_conversion_plan_size(
+    const ut_conversion_plan* const	plan)
+{
+    size_t	count = 0;
+
+    if (plan == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message("ut_get_conversion_plan_size(): NULL plan");
+    }
+    else {
+	ut_set_status(UT_SUCCESS);
+	count = plan->count;
+    }
+
+    return count;
+}
+
+
+/*
+ * Returns the number of tasks into which the conversion of a block should be
+ * divided.  Returns 1 if the block should be converted serially.
+ *
+ * Arguments:
+ *	plan		Pointer to the conversion plan.
+ *	count		The number of values per column.
+ *	parallel	Whether or not conversion may use multiple threads.
+ *	maxTasks	The maximum number of tasks.
+ */
+static size_t
+getTaskCount(
+    const ut_conversion_plan* const	plan,
+    const size_t			count,
+    const int				parallel,
+    const size_t			maxTasks)
+{
+    size_t	ntasks = 1;
+
+    if (parallel && plan->count > 0 &&
+	    count >= cvGetParallelThreshold() / plan->count) {
+	const unsigned	nthreads = tpGetThreadCount();
+
+	if (nthreads > 1)
+	    ntasks = maxTasks < nthreads * PLAN_TASKS_PER_THREAD
+		? maxTasks
+		: nthreads * PLAN_TASKS_PER_THREAD;
+    }
+
+    return ntasks;
+}
+
+
+typedef struct {
+    const ut_conversion_plan*	plan;
+    const double* const*	in;
+    double* const*		out;
+    size_t			count;		/* values per column */
+} ColumnsJob;
+
+
+static void
+convertColumnTask(
+    void* const		arg,
+    const size_t	index)
+{
+    const ColumnsJob* const	job = (const ColumnsJob*)arg;
+
+    (void)cv_convert_doubles(job->plan->converters[index], job->in[index],
+	job->count, job->out[index]);
+}
+
+
+/*
+ * Converts a block of columns of double-precision values that are stored as
+ * separate arrays (i.e., a structure of arrays).  Different columns may be
+ * converted concurrently.
+ *
+ * Arguments:
+ *	plan		Pointer to the conversion plan.
+ *	in		The input columns.  "in[i]" points to the "count"
+ *			values of column "i".
+ *	count		The number of values per column.
+ *	out		The output columns.  "out[i]" points to the output
+ *			array of column "i", which may be the same as or
+ *			overlap "in[i]" but must not overlap any other column.
+ *	parallel	Whether or not the columns may be divided among the
+ *			threads of the library's thread-pool (see
+ *			cv_set_parallelism()).  They are if the total number of
+ *			values is at least the threshold set by that function.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"plan", "in", or "out" is NULL or "in" or "out"
+ *			contains NULL.  Nothing was converted.
+ */
+ut_status
+ut_convert_columns(
+    const ut_conversion_plan* const	plan,
+    const double* const* const		in,
+    const size_t			count,
+    double* const* const		out,
+    const int				parallel)
+{
+    ut_status	status = UT_SUCCESS;
+
+    if (plan == NULL || in == NULL || out == NULL) {
+	status = UT_BAD_ARG;
+	ut_set_status(status);
+	ut_handle_error_message("ut_convert_columns(): NULL argument");
+    }
+    else {
+	size_t	i;
+
+	for (i = 0; i < plan->count; i++) {
+	    if (in[i] == NULL || out[i] == NULL) {
+		status = UT_BAD_ARG;
+		ut_set_status(status);
+		ut_handle_error_message(
+		    "ut_convert_columns(): NULL array of column %lu",
+		    (unsigned long)i);
+		break;
+	    }
+	}
+
+	if (status == UT_SUCCESS) {
+	    ColumnsJob	job;
+
+	    job.plan = plan;
+	    job.in = in;
+	    job.out = out;
+	    job.count = count;
+
+	    if (plan->count == 1 && parallel) {
+		(void)cv_convert_doubles_parallel(plan->converters[0], in[0],
+		    count, out[0]);
+	    }
+	    else if (getTaskCount(plan, count, parallel, plan->count) > 1) {
+		tpRun(plan->count, convertColumnTask, &job);
+	    }
+	    else {
+		for (i = 0; i < plan->count; i++)
+		    convertColumnTask(&job, i);
+	    }
+
+	    ut_set_status(status);
+	}
+    }
+
+    return status;
+}
+
+
+typedef struct {
+    const ut_conversion_plan*	plan;
+    const double*		in;
+    size_t			inStride;
+    double*			out;
+    size_t			outStride;
+    size_t			count;		/* number of records */
+    size_t			chunk;		/* records per task */
+} RecordsJob;
+
+
+/*
+ * Converts a range of records, a cache-sized block at a time.
+ *
+ * Arguments:
+ *	job		Pointer to the job.
+ *	start		Origin-0 index of the first record.
+ *	count		The number of records.
+ */
+static void
+convertRecords(
+    const RecordsJob* const	job,
+    const size_t		start,
+    const size_t		count)
+{
+    const ut_conversion_plan* const	plan = job->plan;
+    const cv_converter* const		trivial = cv_get_trivial();
+    const int				inPlace = job->in == job->out;
+    size_t				begin;
+
+    for (begin = start; begin < start + count; begin += PLAN_BLOCK_SIZE) {
+	const size_t	n = start + count - begin < PLAN_BLOCK_SIZE
+	    ? start + count - begin
+	    : PLAN_BLOCK_SIZE;
+	const double*	in = job->in + begin * job->inStride;
+	double*		out = job->out + begin * job->outStride;
+	size_t		i;
+
+	for (i = 0; i < plan->count; i++) {
+	    if (!inPlace || plan->converters[i] != trivial)
+		(void)cv_convert_doubles_strided(plan->converters[i], in + i,
+		    (ptrdiff_t)job->inStride, n, out + i,
+		    (ptrdiff_t)job->outStride);
+	}
+    }
+}
+
+
+static void
+convertRecordsTask(
+    void* const		arg,
+    const size_t	index)
+{
+    const RecordsJob* const	job = (const RecordsJob*)arg;
+    const size_t		start = index * job->chunk;
+
+    if (start < job->count)
+	convertRecords(job, start, job->count - start < job->chunk
+	    ? job->count - start
+	    : job->chunk);
+}
+
+
+/*
+ * Converts a block of records of double-precision values (i.e., an array of
+ * structures).  The value of column "j" of record "i" is at
+ * "in[i*inStride+j]".  Different ranges of records may be converted
+ * concurrently.
+ *
+ * Arguments:
+ *	plan		Pointer to the conversion plan.
+ *	in		Pointer to the first input record.
+ *	inStride	The number of doubles from the start of one input
+ *			record to the start of the next.  Must be at least the
+ *			number of columns.  Values between the columns of a
+ *			record are ignored.
+ *	count		The number of records.
+ *	out		Pointer to the first output record.  The output
+ *			records must not overlap the input records unless
+ *			"out" equals "in" and "outStride" equals "inStride".
+ *	outStride	The number of doubles from the start of one output
+ *			record to the start of the next.  Must be at least the
+ *			number of columns.  Values between the columns of a
+ *			record aren't modified.
+ *	parallel	Whether or not the records may be divided among the
+ *			threads of the library's thread-pool (see
+ *			cv_set_parallelism()).  They are if the total number of
+ *			values is at least the threshold set by that function.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"plan", "in", or "out" is NULL, a stride is less than
+ *			the number of columns, or "out" equals "in" but the
+ *			strides differ.  Nothing was converted.
+ */
+ut_status
+ut_convert_records(
+    const ut_conversion_plan* const	plan,
+    const double* const			in,
+    const size_t			inStride,
+    const size_t			count,
+    double* const			out,
+    const size_t			outStride,
+    const int				parallel)
+{
+    ut_status	status = UT_SUCCESS;
+
+    if (plan == NULL || in == NULL || out == NULL) {
+	status = UT_BAD_ARG;
+	ut_set_status(status);
+	ut_handle_error_message("ut_convert_records(): NULL argument");
+    }
+    else if (inStride < plan->count || outStride < plan->count) {
+	status = UT_BAD_ARG;
+	ut_set_status(status);
+	ut_handle_error_message(
+	    "ut_convert_records(): Stride less than number of columns");
+    }
+    else if (in == out && inStride != outStride) {
+	status = UT_BAD_ARG;
+	ut_set_status(status);
+	ut_handle_error_message(
+	    "ut_convert_records(): Different strides for the same records");
+    }
+    else {
+	RecordsJob	job;
+	const size_t	ntasks = getTaskCount(plan, count, parallel,
+	    (count + PLAN_BLOCK_SIZE - 1) / PLAN_BLOCK_SIZE);
+
+	job.plan = plan;
+	job.in = in;
+	job.inStride = inStride;
+	job.out = out;
+	job.outStride = outStride;
+	job.count = count;
+
+	if (ntasks <= 1) {
+	    convertRecords(&job, 0, count);
+	}
+	else {
+	    /*
+	     * Each task converts whole blocks so that no two threads write to
+	     * the same cache line except at the boundaries.
+	     */
+	    const size_t	nblocks = (count + PLAN_BLOCK_SIZE - 1) /
+		PLAN_BLOCK_SIZE;
+
+	    job.chunk = (nblocks + ntasks - 1) / ntasks * PLAN_BLOCK_SIZE;
+
+	    tpRun((count + job.chunk - 1) / job.chunk, convertRecordsTask,
+		&job);
+	}
+
+	ut_set_status(status);
+    }
+
+    return status;
+}
+
+
+/*
+ * Frees a conversion plan.
+ *
+ * Arguments:
+ *	plan		Pointer to the plan or NULL.
+ */
+void
+ut_free_conversion_plan(
+    ut_conversion_plan* const	plan)
+{
+    if (plan != NULL) {
+	size_t	i;
+
+	for (i = 0; i < plan->count; i++)
+	    cv_free(plan->converters[i]);
+
+	free(plan->converters);
+	free(plan);
+    }
+}
@@ -14,7 +14,11 @@
 #include "config.h"
 
 #include "udunits2.h" // Accommodates Windows & includes "converter.h"
+#include "stats.h"
+#include "threadPool.h"
+#include "threadSupport.h"
 
+#include <float.h>
 #include <math.h>
 #include <stddef.h>
 #include <stdio.h>
@@ -64,11 +68,56 @@ typedef struct {
     double		base;
 } ExpConverter;
 
+typedef enum {
+    OP_RECIPROCAL,			/* y = 1/x */
+    OP_SCALE,				/* y = a*x */
+    OP_OFFSET,				/* y = x + a */
+    OP_GALILEAN,			/* y = a*x + b */
+    OP_LOG,				/* y = ln(x)*a */
+    OP_EXP,				/* y = pow(a, x) */
+    OP_CALL				/* y = conv(x) */
+} Opcode;
+
+typedef struct {
+    Opcode		opcode;
+    double		a;
+    double		b;
+    cv_converter*	conv;
+} Instruction;
+
+typedef struct {
+    ConverterOps*	ops;
+    Instruction*	code;
+    size_t		count;
+} ProgramConverter;
+
+typedef struct {
+    ConverterOps*	ops;
+    cv_converter*	target;
+    long		refCount;
+} SharedConverter;
+
+typedef enum {
+    FN_AFFINE,				/* y = p*x + q */
+    FN_LOG,				/* y = r*ln(p*x + q) + s */
+    FN_EXP,				/* y = r*exp(p*x + q) + s */
+    FN_RECIPROCAL			/* y = r/(p*x + q) + s */
+} StageFunction;
+
+typedef struct {
+    StageFunction	function;
+    double		p;
+    double		q;
+    double		r;
+    double		s;
+} Stage;
+
 typedef struct {
     ConverterOps*	ops;
-    cv_converter*	first;
-    cv_converter*	second;
-} CompositeConverter;
+    Stage*		stages;
+    size_t		count;
+    cv_converter*	source;		/* the converter that was compiled */
+} CompiledConverter;
 
 union cv_converter {
     ConverterOps*	ops;
@@ -77,7 +126,9 @@ union cv_converter {
     GalileanConverter	galilean;
     LogConverter	log;
     ExpConverter	exp;
-    CompositeConverter	composite;
+    ProgramConverter	program;
+    SharedConverter	shared;
+    CompiledConverter	compiled;
 };
 
 #define CV_CLONE(conv)		((conv)->ops->clone(conv))
@@ -88,6 +139,15 @@ union cv_converter {
 #define IS_OFFSET(conv)		((conv)->ops == &offsetOps)
 #define IS_GALILEAN(conv)	((conv)->ops == &galileanOps)
 #define IS_LOG(conv)		((conv)->ops == &logOps)
+#define IS_EXP(conv)		((conv)->ops == &expOps)
+#define IS_PROGRAM(conv)	((conv)->ops == &programOps)
+#define IS_SHARED(conv)		((conv)->ops == &sharedOps)
+#define IS_COMPILED(conv)	((conv)->ops == &compiledOps)
+
+
+static ConverterOps	programOps;
+static ConverterOps	sharedOps;
+static ConverterOps	compiledOps;
 
 
 static void
@@ -114,6 +174,139 @@ cvNeedsParentheses(
 }
 
 
+/*******************************************************************************
+ * Array Kernels:
+ *
+ * Element loops used when the input and output arrays are either identical or
+ * disjoint.  With no possible aliasing between the arrays or with the
+ * converter's parameters, these loops can be vectorized by the compiler.  On
+ * x86-64 with GCC and glibc, they're also compiled for AVX2 and AVX-512 and the
+ * best version is selected at load-time.  Floating-point contraction is
+ * disabled so that, e.g., "a * x + b" isn't fused into a multiply-add whose
+ * rounding would differ from that of the individual converters.  Overlapping
+ * arrays that aren't identical use the direction-dependent loops of the
+ * individual converters instead.
+ ******************************************************************************/
+
+#if defined(_MSC_VER)
+#   define CV_RESTRICT	__restrict
+#else
+#   define CV_RESTRICT	restrict
+#endif
+
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 6 && \
+	defined(__x86_64__) && defined(__GLIBC__) && \
+	!defined(__SANITIZE_THREAD__)	/* ThreadSanitizer can't load IFUNCs */
+#   define CV_KERNEL	static __attribute__((optimize("fp-contract=off"), \
+	target_clones("avx512f", "avx2", "default")))
+#elif defined(__GNUC__) && !defined(__clang__)
+#   define CV_KERNEL	static __attribute__((optimize("fp-contract=off")))
+#else
+#   define CV_KERNEL	static
+#   if defined(_MSC_VER)
+#	pragma fp_contract(off)
+#   else
+#	pragma STDC FP_CONTRACT OFF
+#   endif
+#endif
+
+/*
+ * Evaluates to true if two arrays of "count" elements don't overlap.
+ */
+#define CV_DISJOINT(in, out, count) \
+    ((const char*)((in) + (count)) <= (const char*)(out) || \
+	(const char*)((out) + (count)) <= (const char*)(in))
+
+/*
+ * Defines the functions "<name>Disjoint()" and "<name>InPlace()", which set
+ * each output value to "expr", where "x" is the input value and "a" and "b"
+ * are parameters of the conversion.
+ */
+#define CV_DEFINE_KERNELS(name, type, expr) \
+    CV_KERNEL void \
+    name##Disjoint( \
+	const double			a, \
+	const double			b, \
+	const type* CV_RESTRICT const	in, \
+	const size_t			count, \
+	type* CV_RESTRICT const		out) \
+    { \
+	size_t	i; \
+	for (i = 0; i < count; i++) { \
+	    const type	x = in[i]; \
+	    out[i] = (type)(expr); \
+	} \
+    } \
+    CV_KERNEL void \
+    name##InPlace( \
+	const double			a, \
+	const double			b, \
+	type* CV_RESTRICT const		values, \
+	const size_t			count) \
+    { \
+	size_t	i; \
+	for (i = 0; i < count; i++) { \
+	    const type	x = values[i]; \
+	    values[i] = (type)(expr); \
+	} \
+    }
+
+CV_DEFINE_KERNELS(reciprocalFloats, float, 1.0f / x)
+CV_DEFINE_KERNELS(reciprocalDoubles, double, 1.0 / x)
+CV_DEFINE_KERNELS(scaleFloats, float, a * x)
+CV_DEFINE_KERNELS(scaleDoubles, double, a * x)
+CV_DEFINE_KERNELS(offsetFloats, float, a + x)
+CV_DEFINE_KERNELS(offsetDoubles, double, a + x)
+CV_DEFINE_KERNELS(galileanFloats, float, a * x + b)
+CV_DEFINE_KERNELS(galileanDoubles, double, a * x + b)
+CV_DEFINE_KERNELS(logFloats, float, log(x) * a)
+CV_DEFINE_KERNELS(logDoubles, double, log(x) * a)
+CV_DEFINE_KERNELS(expFloats, float, pow(a, x))
+CV_DEFINE_KERNELS(expDoubles, double, pow(a, x))
+
+/*
+ * Defines the functions "<name>Disjoint()" and "<name>InPlace()" of a
+ * non-affine stage of a compiled converter, which set each output value to
+ * "expr", where "x" is the input value and "p", "q", "r", and "s" are
+ * parameters of the stage.  Affine stages use the galilean kernels.
+ */
+#define CV_DEFINE_STAGE_KERNELS(name, type, expr) \
+    CV_KERNEL void \
+    name##Disjoint( \
+	const Stage* const		stage, \
+	const type* CV_RESTRICT const	in, \
+	const size_t			count, \
+	type* CV_RESTRICT const		out) \
+    { \
+	const double	p = stage->p, q = stage->q, r = stage->r, s = stage->s; \
+	size_t		i; \
+	for (i = 0; i < count; i++) { \
+	    const double	x = in[i]; \
+	    out[i] = (type)(expr); \
+	} \
+    } \
+    CV_KERNEL void \
+    name##InPlace( \
+	const Stage* const		stage, \
+	type* CV_RESTRICT const		values, \
+	const size_t			count) \
+    { \
+	const double	p = stage->p, q = stage->q, r = stage->r, s = stage->s; \
+	size_t		i; \
+	for (i = 0; i < count; i++) { \
+	    const double	x = values[i]; \
+	    values[i] = (type)(expr); \
+	} \
+    }
+
+CV_DEFINE_STAGE_KERNELS(logStageFloats, float, r * log(p * x + q) + s)
+CV_DEFINE_STAGE_KERNELS(logStageDoubles, double, r * log(p * x + q) + s)
+CV_DEFINE_STAGE_KERNELS(expStageFloats, float, r * exp(p * x + q) + s)
+CV_DEFINE_STAGE_KERNELS(expStageDoubles, double, r * exp(p * x + q) + s)
+CV_DEFINE_STAGE_KERNELS(reciprocalStageFloats, float, r / (p * x + q) + s)
+CV_DEFINE_STAGE_KERNELS(reciprocalStageDoubles, double, r / (p * x + q) + s)
+
+
 /*******************************************************************************
  * Trivial Converter:
  ******************************************************************************/
@@ -223,6 +416,12 @@ reciprocalConvertFloats(
     if (in == NULL || out == NULL) {
 	out = NULL;
     }
+    else if (in == out) {
+	reciprocalFloatsInPlace(0, 0, out, count);
+    }
+    else if (CV_DISJOINT(in, out, count)) {
+	reciprocalFloatsDisjoint(0, 0, in, count, out);
+    }
     else {
 	size_t	i;
 
@@ -250,6 +449,12 @@ reciprocalConvertDoubles(
     if (in == NULL || out == NULL) {
 	out = NULL;
     }
+    else if (in == out) {
+	reciprocalDoublesInPlace(0, 0, out, count);
+    }
+    else if (CV_DISJOINT(in, out, count)) {
+	reciprocalDoublesDisjoint(0, 0, in, count, out);
+    }
     else {
 	size_t	i;
 
@@ -323,6 +528,12 @@ scaleConvertFloats(
     if (conv == NULL || in == NULL || out == NULL) {
 	out = NULL;
     }
+    else if (in == out) {
+	scaleFloatsInPlace(conv->scale.value, 0, out, count);
+    }
+    else if (CV_DISJOINT(in, out, count)) {
+	scaleFloatsDisjoint(conv->scale.value, 0, in, count, out);
+    }
     else {
 	size_t	i;
 
@@ -350,6 +561,12 @@ scaleConvertDoubles(
     if (conv == NULL || in == NULL || out == NULL) {
 	out = NULL;
     }
+    else if (in == out) {
+	scaleDoublesInPlace(conv->scale.value, 0, out, count);
+    }
+    else if (CV_DISJOINT(in, out, count)) {
+	scaleDoublesDisjoint(conv->scale.value, 0, in, count, out);
+    }
     else {
 	size_t	i;
 
@@ -421,6 +638,12 @@ offsetConvertFloats(
     if (conv == NULL || in == NULL || out == NULL) {
 	out = NULL;
     }
+    else if (in == out) {
+	offsetFloatsInPlace(conv->offset.value, 0, out, count);
+    }
+    else if (CV_DISJOINT(in, out, count)) {
+	offsetFloatsDisjoint(conv->offset.value, 0, in, count, out);
+    }
     else {
 	size_t	i;
 
@@ -448,6 +671,12 @@ offsetConvertDoubles(
     if (conv == NULL || in == NULL || out == NULL) {
 	out = NULL;
     }
+    else if (in == out) {
+	offsetDoublesInPlace(conv->offset.value, 0, out, count);
+    }
+    else if (CV_DISJOINT(in, out, count)) {
+	offsetDoublesDisjoint(conv->offset.value, 0, in, count, out);
+    }
     else {
 	size_t	i;
 
@@ -523,6 +752,14 @@ galileanConvertFloats(
     if (conv == NULL || in == NULL || out == NULL) {
 	out = NULL;
     }
+    else if (in == out) {
+	galileanFloatsInPlace(conv->galilean.slope, conv->galilean.intercept,
+		out, count);
+    }
+    else if (CV_DISJOINT(in, out, count)) {
+	galileanFloatsDisjoint(conv->galilean.slope, conv->galilean.intercept,
+		in, count, out);
+    }
     else {
 	size_t	i;
 
@@ -552,6 +789,14 @@ galileanConvertDoubles(
     if (conv == NULL || in == NULL || out == NULL) {
 	out = NULL;
     }
+    else if (in == out) {
+	galileanDoublesInPlace(conv->galilean.slope, conv->galilean.intercept,
+		out, count);
+    }
+    else if (CV_DISJOINT(in, out, count)) {
+	galileanDoublesDisjoint(conv->galilean.slope, conv->galilean.intercept,
+		in, count, out);
+    }
     else {
 	size_t	i;
 
@@ -637,6 +882,12 @@ logConvertFloats(
     if (conv == NULL || in == NULL || out == NULL) {
 	out = NULL;
     }
+    else if (in == out) {
+	logFloatsInPlace(conv->log.logE, 0, out, count);
+    }
+    else if (CV_DISJOINT(in, out, count)) {
+	logFloatsDisjoint(conv->log.logE, 0, in, count, out);
+    }
     else {
 	size_t	i;
 
@@ -664,6 +915,12 @@ logConvertDoubles(
     if (conv == NULL || in == NULL || out == NULL) {
 	out = NULL;
     }
+    else if (in == out) {
+	logDoublesInPlace(conv->log.logE, 0, out, count);
+    }
+    else if (CV_DISJOINT(in, out, count)) {
+	logDoublesDisjoint(conv->log.logE, 0, in, count, out);
+    }
     else {
 	size_t	i;
 
@@ -738,6 +995,12 @@ expConvertFloats(
     if (conv == NULL || in == NULL || out == NULL) {
 	out = NULL;
     }
+    else if (in == out) {
+	expFloatsInPlace(conv->exp.base, 0, out, count);
+    }
+    else if (CV_DISJOINT(in, out, count)) {
+	expFloatsDisjoint(conv->exp.base, 0, in, count, out);
+    }
     else {
 	size_t	i;
 
@@ -765,6 +1028,12 @@ expConvertDoubles(
     if (conv == NULL || in == NULL || out == NULL) {
 	out = NULL;
     }
+    else if (in == out) {
+	expDoublesInPlace(conv->exp.base, 0, out, count);
+    }
+    else if (CV_DISJOINT(in, out, count)) {
+	expDoublesDisjoint(conv->exp.base, 0, in, count, out);
+    }
     else {
 	size_t	i;
 
@@ -806,30 +1075,145 @@ static ConverterOps	expOps = {
 
 
 /*******************************************************************************
- * Composite Converter:
+ * Program Converter:
+ *
+ * The sequential application of two or more converters, flattened into a
+ * linear list of instructions.  Arrays are converted in blocks small enough to
+ * stay in the data cache, with every instruction applied to a block before the
+ * next block is read, so a chain of conversions costs one pass over memory.
  ******************************************************************************/
 
+#define PROGRAM_BLOCK_SIZE	512	/* number of values per block */
+
 static cv_converter*
-compositeClone(
+programClone(
     cv_converter* const	conv)
 {
-    return cv_combine(conv->composite.first, conv->composite.second);
+    const size_t	nbytes =
+	conv->program.count * sizeof(*conv->program.code);
+    cv_converter*	clone = malloc(sizeof(*clone));
+
+    if (clone != NULL) {
+	clone->program.code = malloc(nbytes);
+
+	if (clone->program.code == NULL) {
+	    free(clone);
+	    clone = NULL;
+	}
+	else {
+	    size_t	i;
+
+	    (void)memcpy(clone->program.code, conv->program.code, nbytes);
+
+	    clone->program.ops = &programOps;
+	    clone->program.count = conv->program.count;
+
+	    for (i = 0; i < clone->program.count; i++) {
+		Instruction* const	inst = clone->program.code + i;
+
+		if (inst->opcode == OP_CALL) {
+		    inst->conv = CV_CLONE(inst->conv);
+
+		    if (inst->conv == NULL) {
+			clone->program.count = i;
+			cv_free(clone);
+			clone = NULL;
+			break;
+		    }
+		}
+	    }
+	}
+    }
+
+    return clone;
+}
+
+
+/*
+ * Applies a program to a block of values in place.
+ */
+static void
+programRun(
+    const cv_converter* const	conv,
+    double* const		values,
+    const size_t		count)
+{
+    const Instruction*		inst = conv->program.code;
+    const Instruction* const	end = inst + conv->program.count;
+
+    for (; inst < end; inst++) {
+	const double	a = inst->a;
+	const double	b = inst->b;
+
+	switch (inst->opcode) {
+	case OP_RECIPROCAL:
+	    reciprocalDoublesInPlace(a, b, values, count);
+	    break;
+	case OP_SCALE:
+	    scaleDoublesInPlace(a, b, values, count);
+	    break;
+	case OP_OFFSET:
+	    offsetDoublesInPlace(a, b, values, count);
+	    break;
+	case OP_GALILEAN:
+	    galileanDoublesInPlace(a, b, values, count);
+	    break;
+	case OP_LOG:
+	    logDoublesInPlace(a, b, values, count);
+	    break;
+	case OP_EXP:
+	    expDoublesInPlace(a, b, values, count);
+	    break;
+	case OP_CALL:
+	    (void)inst->conv->ops->convertDoubles(inst->conv, values, count,
+		values);
+	    break;
+	}
+    }
 }
 
 
 static double
-compositeConvertDouble(
+programConvertDouble(
     const cv_converter* const	conv,
     const double		value)
 {
-    return
-	cv_convert_double(conv->composite.second,
-	    cv_convert_double(((CompositeConverter*)conv)->first, value));
+    const Instruction*		inst = conv->program.code;
+    const Instruction* const	end = inst + conv->program.count;
+    double			x = value;
+
+    for (; inst < end; inst++) {
+	switch (inst->opcode) {
+	case OP_RECIPROCAL:
+	    x = 1.0 / x;
+	    break;
+	case OP_SCALE:
+	    x *= inst->a;
+	    break;
+	case OP_OFFSET:
+	    x += inst->a;
+	    break;
+	case OP_GALILEAN:
+	    x = inst->a * x + inst->b;
+	    break;
+	case OP_LOG:
+	    x = log(x) * inst->a;
+	    break;
+	case OP_EXP:
+	    x = pow(inst->a, x);
+	    break;
+	case OP_CALL:
+	    x = cv_convert_double(inst->conv, x);
+	    break;
+	}
+    }
+
+    return x;
 }
 
 
 static float*
-compositeConvertFloats(
+programConvertFloats(
     const cv_converter* const	conv,
     const float* const		in,
     const size_t		count,
@@ -839,12 +1223,46 @@ compositeConvertFloats(
 	out = NULL;
     }
     else {
-	out =
-	    cv_convert_floats(
-		conv->composite.second,
-		cv_convert_floats(conv->composite.first, in, count, out),
-		count,
-		out);
+	double	buf[PROGRAM_BLOCK_SIZE];
+	size_t	start;
+	size_t	i;
+
+	/*
+	 * Blocks are processed in the same direction as the elements of the
+	 * other converters so that overlapping arrays work.
+	 */
+	if (in < out) {
+	    for (start = count; start > 0;) {
+		const size_t	n = start < PROGRAM_BLOCK_SIZE
+		    ? start
+		    : PROGRAM_BLOCK_SIZE;
+
+		start -= n;
+
+		for (i = 0; i < n; i++)
+		    buf[i] = in[start+i];
+
+		programRun(conv, buf, n);
+
+		for (i = n; i-- > 0;)
+		    out[start+i] = (float)buf[i];
+	    }
+	}
+	else {
+	    for (start = 0; start < count; start += PROGRAM_BLOCK_SIZE) {
+		const size_t	n = count - start < PROGRAM_BLOCK_SIZE
+		    ? count - start
+		    : PROGRAM_BLOCK_SIZE;
+
+		for (i = 0; i < n; i++)
+		    buf[i] = in[start+i];
+
+		programRun(conv, buf, n);
+
+		for (i = 0; i < n; i++)
+		    out[start+i] = (float)buf[i];
+	    }
+	}
     }
 
     return out;
@@ -852,7 +1270,7 @@ compositeConvertFloats(
 
 
 static double*
-compositeConvertDoubles(
+programConvertDoubles(
     const cv_converter* const	conv,
     const double* const		in,
     const size_t		count,
@@ -862,12 +1280,33 @@ compositeConvertDoubles(
 	out = NULL;
     }
     else {
-	out =
-	    cv_convert_doubles(
-		conv->composite.second,
-		cv_convert_doubles(conv->composite.first, in, count, out),
-		count,
-		out);
+	double	buf[PROGRAM_BLOCK_SIZE];
+	size_t	start;
+
+	if (in < out) {
+	    for (start = count; start > 0;) {
+		const size_t	n = start < PROGRAM_BLOCK_SIZE
+		    ? start
+		    : PROGRAM_BLOCK_SIZE;
+
+		start -= n;
+
+		(void)memcpy(buf, in + start, n * sizeof(double));
+		programRun(conv, buf, n);
+		(void)memcpy(out + start, buf, n * sizeof(double));
+	    }
+	}
+	else {
+	    for (start = 0; start < count; start += PROGRAM_BLOCK_SIZE) {
+		const size_t	n = count - start < PROGRAM_BLOCK_SIZE
+		    ? count - start
+		    : PROGRAM_BLOCK_SIZE;
+
+		(void)memcpy(buf, in + start, n * sizeof(double));
+		programRun(conv, buf, n);
+		(void)memcpy(out + start, buf, n * sizeof(double));
+	    }
+	}
     }
 
     return out;
@@ -875,30 +1314,83 @@ compositeConvertDoubles(
 
 
 static void
-compositeFree(
+programFree(
     cv_converter* const	conv)
 {
-    cv_free(conv->composite.first);
-    cv_free(conv->composite.second);
+    size_t	i;
+
+    for (i = 0; i < conv->program.count; i++) {
+	if (conv->program.code[i].opcode == OP_CALL)
+	    cv_free(conv->program.code[i].conv);
+    }
+
+    free(conv->program.code);
     free(conv);
 }
 
 
+/*
+ * Returns the string expression of a single instruction by formatting the
+ * equivalent stand-alone converter.
+ */
+static int
+instructionGetExpression(
+    const Instruction* const	inst,
+    char* const			buf,
+    const size_t		max,
+    const char* const		variable)
+{
+    cv_converter	conv;
+
+    switch (inst->opcode) {
+    case OP_RECIPROCAL:
+	conv.ops = &reciprocalOps;
+	break;
+    case OP_SCALE:
+	conv.scale.ops = &scaleOps;
+	conv.scale.value = inst->a;
+	break;
+    case OP_OFFSET:
+	conv.offset.ops = &offsetOps;
+	conv.offset.value = inst->a;
+	break;
+    case OP_GALILEAN:
+	conv.galilean.ops = &galileanOps;
+	conv.galilean.slope = inst->a;
+	conv.galilean.intercept = inst->b;
+	break;
+    case OP_LOG:
+	conv.log.ops = &logOps;
+	conv.log.logE = inst->a;
+	break;
+    case OP_EXP:
+	conv.exp.ops = &expOps;
+	conv.exp.base = inst->a;
+	break;
+    case OP_CALL:
+	return cv_get_expression(inst->conv, buf, max, variable);
+    }
+
+    return cv_get_expression(&conv, buf, max, variable);
+}
+
+
 static int
-compositeGetExpression(
+programGetExpression(
     const cv_converter* const	conv,
     char* const			buf,
     const size_t		max,
     const char* const		variable)
 {
-    char	tmpBuf[132];
-    int		nchar = cv_get_expression(conv->composite.first, buf, max,
-	variable);
+    int		nchar = snprintf(buf, max, "%s", variable);
+    size_t	i;
+
+    for (i = 0; nchar >= 0 && i < conv->program.count; i++) {
+	char	tmpBuf[132];
 
-    if (nchar >= 0) {
 	buf[max-1] = 0;
 
-	if (cvNeedsParentheses(buf)) {
+	if (i > 0 && cvNeedsParentheses(buf)) {
 	    (void)snprintf(tmpBuf, sizeof(tmpBuf), "(%s)", buf);
 	}
 	else {
@@ -907,115 +1399,162 @@ compositeGetExpression(
 	    tmpBuf[sizeof(tmpBuf)-1] = 0;
 	}
 
-	nchar = cv_get_expression(conv->composite.second, buf, max, tmpBuf);
+	nchar = instructionGetExpression(conv->program.code + i, buf, max,
+	    tmpBuf);
     }
 
     return nchar;
 }
 
 
-static ConverterOps	compositeOps = {
-    compositeClone,
-    compositeConvertDouble,
-    compositeConvertFloats,
-    compositeConvertDoubles,
-    compositeGetExpression,
-    compositeFree};
-
+static ConverterOps	programOps = {
+    programClone,
+    programConvertDouble,
+    programConvertFloats,
+    programConvertDoubles,
+    programGetExpression,
+    programFree};
 
-/*******************************************************************************
- * Public API:
- ******************************************************************************/
 
 /*
- * Returns the trivial converter (i.e., y = x).
- * When finished with the converter, the client should pass the converter to
- * cv_free().
- *
- * Returns:
- *	The trivial converter.
+ * Returns the number of instructions needed to represent a converter.
  */
-cv_converter*
-cv_get_trivial()
+static size_t
+cvInstructionCount(
+    const cv_converter* const	conv)
 {
-    return &trivialConverter;
+    return
+	IS_TRIVIAL(conv)
+	    ? 0
+	    : IS_PROGRAM(conv)
+		? conv->program.count
+		: IS_SHARED(conv)
+		    ? cvInstructionCount(conv->shared.target)
+		    : 1;
 }
 
 
 /*
- * Returns the reciprocal converter (i.e., y = 1/x).
- * When finished with the converter, the client should pass the converter to
- * cv_free().
+ * Appends the instructions of a converter to a program.
  *
+ * Arguments:
+ *	program		Pointer to the program converter.  Its "code" array
+ *			must have room for the instructions of "conv".
+ *	conv		Pointer to the converter to be appended.
  * Returns:
- *	The reciprocal converter.
+ *	0		Success.
+ *	-1		Necessary memory couldn't be allocated.
  */
-cv_converter*
-cv_get_inverse()
+static int
+programAppend(
+    cv_converter* const		program,
+    const cv_converter* const	conv)
 {
-    return &reciprocalConverter;
-}
+    int		status = 0;
 
+    if (IS_PROGRAM(conv)) {
+	size_t	i;
 
-/*
- * Returns a converter that multiplies values by a number (i.e., y = ax).
- * When finished with the converter, the client should pass the converter to
- * cv_free().
- *
- * Arguments:
- *	slope	The number by which to multiply values.
- * Returns:
- *	NULL	Necessary memory couldn't be allocated.
- *	else	A converter that will multiply values by the given number.
- */
-cv_converter*
-cv_get_scale(
-    const double	slope)
-{
-    cv_converter*	conv;
+	for (i = 0; status == 0 && i < conv->program.count; i++) {
+	    Instruction*	inst =
+		program->program.code + program->program.count;
 
-    if (slope == 1) {
-	conv = &trivialConverter;
+	    *inst = conv->program.code[i];
+
+	    if (inst->opcode == OP_CALL) {
+		inst->conv = CV_CLONE(inst->conv);
+
+		if (inst->conv == NULL)
+		    status = -1;
+	    }
+
+	    if (status == 0)
+		program->program.count++;
+	}
     }
-    else {
-	conv = malloc(sizeof(*conv));
+    else if (IS_SHARED(conv)) {
+	status = programAppend(program, conv->shared.target);
+    }
+    else if (!IS_TRIVIAL(conv)) {
+	Instruction*	inst = program->program.code + program->program.count;
 
-	if (conv != NULL) {
-	    conv->ops = &scaleOps;
-	    conv->scale.value = slope;
+	inst->a = inst->b = 0;
+	inst->conv = NULL;
+
+	if (IS_RECIPROCAL(conv)) {
+	    inst->opcode = OP_RECIPROCAL;
+	}
+	else if (IS_SCALE(conv)) {
+	    inst->opcode = OP_SCALE;
+	    inst->a = conv->scale.value;
+	}
+	else if (IS_OFFSET(conv)) {
+	    inst->opcode = OP_OFFSET;
+	    inst->a = conv->offset.value;
 	}
+	else if (IS_GALILEAN(conv)) {
+	    inst->opcode = OP_GALILEAN;
+	    inst->a = conv->galilean.slope;
+	    inst->b = conv->galilean.intercept;
+	}
+	else if (IS_LOG(conv)) {
+	    inst->opcode = OP_LOG;
+	    inst->a = conv->log.logE;
+	}
+	else if (IS_EXP(conv)) {
+	    inst->opcode = OP_EXP;
+	    inst->a = conv->exp.base;
+	}
+	else {
+	    inst->opcode = OP_CALL;
+	    inst->conv = CV_CLONE((cv_converter*)conv);
+
+	    if (inst->conv == NULL)
+		status = -1;
+	}
+
+	if (status == 0)
+	    program->program.count++;
     }
 
-    return conv;
+    return status;
 }
 
 
 /*
- * Returns a converter that adds a number to values (i.e., y = x + b).
- * When finished with the converter, the client should pass the converter to
- * cv_free().
+ * Returns a program converter corresponding to the sequential application of
+ * two converters.
  *
  * Arguments:
- *	offset	The number to be added.
+ *	first	The converter to be applied first.
+ *	second	The converter to be applied second.
  * Returns:
  *	NULL	Necessary memory couldn't be allocated.
- *	else	A converter that adds the given number to values.
+ *	else	The program converter.
  */
-cv_converter*
-cv_get_offset(
-    const double	offset)
+static cv_converter*
+programNew(
+    const cv_converter* const	first,
+    const cv_converter* const	second)
 {
-    cv_converter*	conv;
+    cv_converter*	conv = malloc(sizeof(*conv));
 
-    if (offset == 0) {
-	conv = &trivialConverter;
-    }
-    else {
-	conv = malloc(sizeof(*conv));
+    if (conv != NULL) {
+	const size_t	max =
+	    cvInstructionCount(first) + cvInstructionCount(second);
 
-	if (conv != NULL) {
-	    conv->ops = &offsetOps;
-	    conv->offset.value = offset;
+	conv->program.ops = &programOps;
+	conv->program.count = 0;
+	conv->program.code = malloc(max * sizeof(*conv->program.code));
+
+	if (conv->program.code == NULL) {
+	    free(conv);
+	    conv = NULL;
+	}
+	else if (programAppend(conv, first) != 0 ||
+		programAppend(conv, second) != 0) {
+	    cv_free(conv);
+	    conv = NULL;
 	}
     }
 
@@ -1024,321 +1563,1881 @@ cv_get_offset(
 
 
 /*
- * Returns a Galilean converter (i.e., y = ax + b).
- * When finished with the converter, the client should pass the converter to
- * cv_free().
+ * Indicates whether an instruction is an affine transformation and, if so,
+ * returns its slope and intercept.
+ */
+static int
+instructionIsAffine(
+    const Instruction* const	inst,
+    double* const		slope,
+    double* const		intercept)
+{
+    int		isAffine = 1;
+
+    switch (inst->opcode) {
+    case OP_SCALE:
+	*slope = inst->a;
+	*intercept = 0;
+	break;
+    case OP_OFFSET:
+	*slope = 1;
+	*intercept = inst->a;
+	break;
+    case OP_GALILEAN:
+	*slope = inst->a;
+	*intercept = inst->b;
+	break;
+    default:
+	isAffine = 0;
+    }
+
+    return isAffine;
+}
+
+
+/*
+ * Sets an instruction to the simplest form of an affine transformation.
  *
- * Arguments:
- *	slope	The number by which to multiply values.
- *	offset	The number to be added.
  * Returns:
- *	NULL	Necessary memory couldn't be allocated.
- *	else	A Galilean converter corresponding to the inputs.
+ *	0	The transformation is the identity.  "inst" is unmodified.
+ *	else	Success.
  */
-cv_converter*
-cv_get_galilean(
+static int
+instructionSetAffine(
+    Instruction* const	inst,
     const double	slope,
     const double	intercept)
 {
-    cv_converter*	conv;
+    int		isIdentity = slope == 1 && intercept == 0;
 
-    if (slope == 1) {
-	conv = cv_get_offset(intercept);
-    }
-    else if (intercept == 0) {
-	conv = cv_get_scale(slope);
-    }
-    else {
-	conv = malloc(sizeof(*conv));
+    if (!isIdentity) {
+	inst->b = 0;
 
-	if (conv != NULL) {
-	    conv->ops = &galileanOps;
-	    conv->galilean.slope = slope;
-	    conv->galilean.intercept = intercept;
+	if (intercept == 0) {
+	    inst->opcode = OP_SCALE;
+	    inst->a = slope;
+	}
+	else if (slope == 1) {
+	    inst->opcode = OP_OFFSET;
+	    inst->a = intercept;
+	}
+	else {
+	    inst->opcode = OP_GALILEAN;
+	    inst->a = slope;
+	    inst->b = intercept;
 	}
     }
 
-    return conv;
+    return !isIdentity;
 }
 
 
 /*
- * Returns a logarithmic converter (i.e., y = log(x/x0) in some base).
- * When finished with the converter, the client should pass the converter to
- * cv_free().
- *
- * Arguments:
- *	base		The logarithmic base (e.g., 2, M_E, 10).  Must be
+ * Removes instructions from a program.
+ */
+static void
+programRemove(
+    cv_converter* const	program,
+    const size_t	index,
+    const size_t	count)
+{
+    Instruction* const	code = program->program.code;
+
+    (void)memmove(code + index, code + index + count,
+	(program->program.count - index - count) * sizeof(*code));
+
+    program->program.count -= count;
+}
+
+
+/*
+ * Simplifies a program by applying algebraic identities until none applies:
+ *
+ *	a*x, then b*x + c	    ->	(a*b)*x + c (etc.)
+ *	a*x, then k*ln(x)	    ->	k*ln(x), then x + k*ln(a)	(a > 0)
+ *	pow(b, x), then k*ln(x)	    ->	(k*ln(b))*x	(x if k*ln(b) is 1)
+ *	c*x + d, then pow(b, x),
+ *	    then a*x		    ->	c*x + (d + log_b(a)), then pow(b, x)
+ *					(a > 0, b != 1)
+ *
+ * The second identity moves scalings after logarithms so that they can be
+ * combined with the affine transformations that usually follow.  The results
+ * can differ from those of the original program by rounding, and a result
+ * that would overflow might not.
+ *
+ * Arguments:
+ *	program		Pointer to the program converter.
+ * Returns:
+ *	0		"program" wasn't modified.
+ *	else		"program" was simplified.
+ */
+static int
+programSimplify(
+    cv_converter* const	program)
+{
+    Instruction* const	code = program->program.code;
+    int			simplified = 0;
+    int			changed;
+
+    do {
+	size_t	i;
+
+	changed = 0;
+
+	for (i = 0; i < program->program.count; i++) {
+	    Instruction* const	inst = code + i;
+	    Instruction* const	next = inst + 1;
+	    const int		hasNext = i + 1 < program->program.count;
+	    double		slope, intercept;
+	    double		nextSlope, nextIntercept;
+
+	    if (instructionIsAffine(inst, &slope, &intercept)) {
+		if (hasNext &&
+			instructionIsAffine(next, &nextSlope, &nextIntercept)) {
+		    if (instructionSetAffine(inst, slope * nextSlope,
+			    intercept * nextSlope + nextIntercept)) {
+			programRemove(program, i + 1, 1);
+		    }
+		    else {
+			programRemove(program, i, 2);
+		    }
+		    changed = 1;
+		}
+		else if (slope == 1 && intercept == 0) {
+		    programRemove(program, i, 1);
+		    changed = 1;
+		}
+		else if (hasNext && intercept == 0 && slope > 0 &&
+			next->opcode == OP_LOG) {
+		    const double	logE = next->a;
+
+		    inst->opcode = OP_LOG;
+		    inst->a = logE;
+		    inst->b = 0;
+		    next->opcode = OP_OFFSET;
+		    next->a = logE * log(slope);
+		    next->b = 0;
+		    changed = 1;
+		}
+		else if (i + 2 < program->program.count &&
+			next->opcode == OP_EXP && next->a != 1 &&
+			instructionIsAffine(next + 1, &nextSlope,
+			    &nextIntercept) &&
+			nextIntercept == 0 && nextSlope > 0) {
+		    programRemove(program, i + 2, 1);
+
+		    if (!instructionSetAffine(inst, slope,
+			    intercept + log(nextSlope) / log(next->a)))
+			programRemove(program, i, 1);
+
+		    changed = 1;
+		}
+	    }
+	    else if (hasNext && inst->opcode == OP_EXP &&
+		    next->opcode == OP_LOG) {
+		double	slope = next->a * log(inst->a);
+
+		/*
+		 * A logarithm of the same base leaves only the rounding of its
+		 * reciprocal natural logarithm.
+		 */
+		if (fabs(slope - 1) <= 4*DBL_EPSILON)
+		    slope = 1;
+
+		if (instructionSetAffine(inst, slope, 0)) {
+		    programRemove(program, i + 1, 1);
+		}
+		else {
+		    programRemove(program, i, 2);
+		}
+		changed = 1;
+	    }
+
+	    if (changed)
+		break;
+	}
+
+	simplified |= changed;
+    } while (changed);
+
+    return simplified;
+}
+
+
+/*
+ * Returns the stand-alone converter that's equivalent to a program of at most
+ * one instruction that isn't OP_CALL.
+ *
+ * Returns:
+ *	NULL	Necessary memory couldn't be allocated.
+ *	else	The converter.
+ */
+static cv_converter*
+programReduce(
+    const cv_converter* const	program)
+{
+    cv_converter*	conv;
+
+    if (program->program.count == 0) {
+	conv = cv_get_trivial();
+    }
+    else {
+	const Instruction* const	inst = program->program.code;
+
+	switch (inst->opcode) {
+	case OP_RECIPROCAL:
+	    conv = cv_get_inverse();
+	    break;
+	case OP_SCALE:
+	    conv = cv_get_scale(inst->a);
+	    break;
+	case OP_OFFSET:
+	    conv = cv_get_offset(inst->a);
+	    break;
+	case OP_GALILEAN:
+	    conv = cv_get_galilean(inst->a, inst->b);
+	    break;
+	case OP_LOG:
+	    conv = malloc(sizeof(*conv));
+
+	    if (conv != NULL) {
+		conv->ops = &logOps;
+		conv->log.logE = inst->a;
+	    }
+	    break;
+	case OP_EXP:
+	    conv = cv_get_pow(inst->a);
+	    break;
+	default:
+	    conv = NULL;
+	}
+    }
+
+    return conv;
+}
+
+
+/*******************************************************************************
+ * Shared Converter:
+ *
+ * A reference-counted wrapper around another converter.  Cloning increments
+ * the reference count and freeing decrements it; the underlying converter is
+ * freed when the count reaches zero.
+ ******************************************************************************/
+
+static cv_converter*
+sharedClone(
+    cv_converter* const	conv)
+{
+    (void)UT_ATOMIC_INCREMENT(&conv->shared.refCount);
+
+    return conv;
+}
+
+
+static double
+sharedConvertDouble(
+    const cv_converter* const	conv,
+    const double		value)
+{
+    return cv_convert_double(conv->shared.target, value);
+}
+
+
+static float*
+sharedConvertFloats(
+    const cv_converter* const	conv,
+    const float* const		in,
+    const size_t		count,
+    float* 			out)
+{
+    return conv->shared.target->ops->convertFloats(conv->shared.target, in,
+	count, out);
+}
+
+
+static double*
+sharedConvertDoubles(
+    const cv_converter* const	conv,
+    const double* const		in,
+    const size_t		count,
+    double* 			out)
+{
+    return conv->shared.target->ops->convertDoubles(conv->shared.target, in,
+	count, out);
+}
+
+
+static int
+sharedGetExpression(
+    const cv_converter* const	conv,
+    char* const			buf,
+    const size_t		max,
+    const char* const		variable)
+{
+    return cv_get_expression(conv->shared.target, buf, max, variable);
+}
+
+
+static void
+sharedFree(
+    cv_converter* const	conv)
+{
+    if (UT_ATOMIC_DECREMENT(&conv->shared.refCount) == 0) {
+	cv_free(conv->shared.target);
+	free(conv);
+    }
+}
+
+
+static ConverterOps	sharedOps = {
+    sharedClone,
+    sharedConvertDouble,
+    sharedConvertFloats,
+    sharedConvertDoubles,
+    sharedGetExpression,
+    sharedFree};
+
+
+/*
+ * Returns a reference-counted converter.  Each call to cv_free() on the
+ * returned converter releases one reference.
+ *
+ * Arguments:
+ *	conv	Pointer to the converter.  If it's already reference-counted,
+ *		then another reference to it is returned; otherwise,
+ *		ownership of "conv" is transferred to the returned converter
+ *		on success.
+ * Returns:
+ *	NULL	Necessary memory couldn't be allocated.  "conv" is unchanged.
+ *	else	Pointer to the reference-counted converter.
+ */
+cv_converter*
+cvGetShared(
+    cv_converter* const	conv)
+{
+    cv_converter*	shared;
+
+    if (IS_SHARED(conv)) {
+	shared = sharedClone(conv);
+    }
+    else {
+	shared = malloc(sizeof(*shared));
+
+	if (shared != NULL) {
+	    shared->shared.ops = &sharedOps;
+	    shared->shared.target = conv;
+	    shared->shared.refCount = 1;
+	}
+    }
+
+    return shared;
+}
+
+
+/*
+ * Makes a converter reference-counted if it isn't already.
+ *
+ * Arguments:
+ *	conv	Address of the pointer to the converter.  On success, "*conv"
+ *		is the reference-counted converter.
+ * Returns:
+ *	0	Success.
+ *	-1	Necessary memory couldn't be allocated.  "*conv" is unchanged.
+ */
+int
+cvMakeShared(
+    cv_converter** const	conv)
+{
+    int	status = 0;
+
+    if (!IS_SHARED(*conv)) {
+	cv_converter* const	shared = cvGetShared(*conv);
+
+	if (shared == NULL) {
+	    status = -1;
+	}
+	else {
+	    *conv = shared;
+	}
+    }
+
+    return status;
+}
+
+
+/*
+ * Returns another reference to a converter if it's reference-counted.
+ *
+ * Arguments:
+ *	conv	Pointer to the converter or NULL.
+ * Returns:
+ *	NULL	"conv" is NULL or isn't reference-counted.
+ *	else	Another reference to "conv".  Should be passed to cv_free().
+ */
+cv_converter*
+cvGetReference(
+    const cv_converter* const	conv)
+{
+    return conv == NULL || !IS_SHARED(conv)
+	? NULL
+	: sharedClone((cv_converter*)conv);
+}
+
+
+/*******************************************************************************
+ * Compiled Converter:
+ *
+ * A converter specialized by cv_compile() for converting many values.  The
+ * instructions of a program are reduced to a short list of stages, each of
+ * which is at most one logarithm, exponential, or reciprocal between two
+ * affine transformations that are folded into its parameters, and each stage
+ * is applied by a fused kernel.  A single-stage converter makes one pass over
+ * the values; otherwise, arrays are converted in cache-sized blocks like a
+ * program.  Exponentials are computed by exp() with the logarithm of their
+ * base folded into the preceding affine transformation, which is faster than
+ * pow().
+ ******************************************************************************/
+
+/*
+ * Applies a stage to an array of doubles.  The input and output arrays must be
+ * identical or disjoint.
+ */
+static void
+stageApplyDoubles(
+    const Stage* const		stage,
+    const double* const		in,
+    const size_t		count,
+    double* const		out)
+{
+    if (in == out) {
+	switch (stage->function) {
+	case FN_AFFINE:
+	    galileanDoublesInPlace(stage->p, stage->q, out, count);
+	    break;
+	case FN_LOG:
+	    logStageDoublesInPlace(stage, out, count);
+	    break;
+	case FN_EXP:
+	    expStageDoublesInPlace(stage, out, count);
+	    break;
+	case FN_RECIPROCAL:
+	    reciprocalStageDoublesInPlace(stage, out, count);
+	    break;
+	}
+    }
+    else {
+	switch (stage->function) {
+	case FN_AFFINE:
+	    galileanDoublesDisjoint(stage->p, stage->q, in, count, out);
+	    break;
+	case FN_LOG:
+	    logStageDoublesDisjoint(stage, in, count, out);
+	    break;
+	case FN_EXP:
+	    expStageDoublesDisjoint(stage, in, count, out);
+	    break;
+	case FN_RECIPROCAL:
+	    reciprocalStageDoublesDisjoint(stage, in, count, out);
+	    break;
+	}
+    }
+}
+
+
+/*
+ * Applies a stage to an array of floats.  The input and output arrays must be
+ * identical or disjoint.
+ */
+static void
+stageApplyFloats(
+    const Stage* const		stage,
+    const float* const		in,
+    const size_t		count,
+    float* const		out)
+{
+    if (in == out) {
+	switch (stage->function) {
+	case FN_AFFINE:
+	    galileanFloatsInPlace(stage->p, stage->q, out, count);
+	    break;
+	case FN_LOG:
+	    logStageFloatsInPlace(stage, out, count);
+	    break;
+	case FN_EXP:
+	    expStageFloatsInPlace(stage, out, count);
+	    break;
+	case FN_RECIPROCAL:
+	    reciprocalStageFloatsInPlace(stage, out, count);
+	    break;
+	}
+    }
+    else {
+	switch (stage->function) {
+	case FN_AFFINE:
+	    galileanFloatsDisjoint(stage->p, stage->q, in, count, out);
+	    break;
+	case FN_LOG:
+	    logStageFloatsDisjoint(stage, in, count, out);
+	    break;
+	case FN_EXP:
+	    expStageFloatsDisjoint(stage, in, count, out);
+	    break;
+	case FN_RECIPROCAL:
+	    reciprocalStageFloatsDisjoint(stage, in, count, out);
+	    break;
+	}
+    }
+}
+
+
+static cv_converter*
+compiledClone(
+    cv_converter* const	conv)
+{
+    const size_t	nbytes =
+	conv->compiled.count * sizeof(*conv->compiled.stages);
+    cv_converter*	clone = malloc(sizeof(*clone));
+
+    if (clone != NULL) {
+	clone->compiled.stages = malloc(nbytes);
+	clone->compiled.source = CV_CLONE(conv->compiled.source);
+
+	if (clone->compiled.stages == NULL || clone->compiled.source == NULL) {
+	    cv_free(clone->compiled.source);
+	    free(clone->compiled.stages);
+	    free(clone);
+	    clone = NULL;
+	}
+	else {
+	    (void)memcpy(clone->compiled.stages, conv->compiled.stages,
+		nbytes);
+
+	    clone->compiled.ops = &compiledOps;
+	    clone->compiled.count = conv->compiled.count;
+	}
+    }
+
+    return clone;
+}
+
+
+static double
+compiledConvertDouble(
+    const cv_converter* const	conv,
+    const double		value)
+{
+    const Stage*		stage = conv->compiled.stages;
+    const Stage* const		end = stage + conv->compiled.count;
+    double			x = value;
+
+    for (; stage < end; stage++) {
+	const double	y = stage->p * x + stage->q;
+
+	switch (stage->function) {
+	case FN_AFFINE:
+	    x = y;
+	    break;
+	case FN_LOG:
+	    x = stage->r * log(y) + stage->s;
+	    break;
+	case FN_EXP:
+	    x = stage->r * exp(y) + stage->s;
+	    break;
+	case FN_RECIPROCAL:
+	    x = stage->r / y + stage->s;
+	    break;
+	}
+    }
+
+    return x;
+}
+
+
+/*
+ * Applies all the stages of a compiled converter to a block of values in
+ * place.
+ */
+static void
+compiledRun(
+    const cv_converter* const	conv,
+    double* const		values,
+    const size_t		count)
+{
+    size_t	i;
+
+    for (i = 0; i < conv->compiled.count; i++)
+	stageApplyDoubles(conv->compiled.stages + i, values, count, values);
+}
+
+
+static float*
+compiledConvertFloats(
+    const cv_converter* const	conv,
+    const float* const		in,
+    const size_t		count,
+    float* 			out)
+{
+    if (conv == NULL || in == NULL || out == NULL) {
+	out = NULL;
+    }
+    else if (conv->compiled.count == 1 &&
+	    (in == out || CV_DISJOINT(in, out, count))) {
+	stageApplyFloats(conv->compiled.stages, in, count, out);
+    }
+    else {
+	double	buf[PROGRAM_BLOCK_SIZE];
+	size_t	start;
+	size_t	i;
+
+	if (in < out) {
+	    for (start = count; start > 0;) {
+		const size_t	n = start < PROGRAM_BLOCK_SIZE
+		    ? start
+		    : PROGRAM_BLOCK_SIZE;
+
+		start -= n;
+
+		for (i = 0; i < n; i++)
+		    buf[i] = in[start+i];
+
+		compiledRun(conv, buf, n);
+
+		for (i = n; i-- > 0;)
+		    out[start+i] = (float)buf[i];
+	    }
+	}
+	else {
+	    for (start = 0; start < count; start += PROGRAM_BLOCK_SIZE) {
+		const size_t	n = count - start < PROGRAM_BLOCK_SIZE
+		    ? count - start
+		    : PROGRAM_BLOCK_SIZE;
+
+		for (i = 0; i < n; i++)
+		    buf[i] = in[start+i];
+
+		compiledRun(conv, buf, n);
+
+		for (i = 0; i < n; i++)
+		    out[start+i] = (float)buf[i];
+	    }
+	}
+    }
+
+    return out;
+}
+
+
+static double*
+compiledConvertDoubles(
+    const cv_converter* const	conv,
+    const double* const		in,
+    const size_t		count,
+    double* 			out)
+{
+    if (conv == NULL || in == NULL || out == NULL) {
+	out = NULL;
+    }
+    else if (conv->compiled.count == 1 &&
+	    (in == out || CV_DISJOINT(in, out, count))) {
+	stageApplyDoubles(conv->compiled.stages, in, count, out);
+    }
+    else {
+	double	buf[PROGRAM_BLOCK_SIZE];
+	size_t	start;
+
+	if (in < out) {
+	    for (start = count; start > 0;) {
+		const size_t	n = start < PROGRAM_BLOCK_SIZE
+		    ? start
+		    : PROGRAM_BLOCK_SIZE;
+
+		start -= n;
+
+		(void)memcpy(buf, in + start, n * sizeof(double));
+		compiledRun(conv, buf, n);
+		(void)memcpy(out + start, buf, n * sizeof(double));
+	    }
+	}
+	else {
+	    for (start = 0; start < count; start += PROGRAM_BLOCK_SIZE) {
+		const size_t	n = count - start < PROGRAM_BLOCK_SIZE
+		    ? count - start
+		    : PROGRAM_BLOCK_SIZE;
+
+		(void)memcpy(buf, in + start, n * sizeof(double));
+		compiledRun(conv, buf, n);
+		(void)memcpy(out + start, buf, n * sizeof(double));
+	    }
+	}
+    }
+
+    return out;
+}
+
+
+static int
+compiledGetExpression(
+    const cv_converter* const	conv,
+    char* const			buf,
+    const size_t		max,
+    const char* const		variable)
+{
+    return cv_get_expression(conv->compiled.source, buf, max, variable);
+}
+
+
+static void
+compiledFree(
+    cv_converter* const	conv)
+{
+    cv_free(conv->compiled.source);
+    free(conv->compiled.stages);
+    free(conv);
+}
+
+
+static ConverterOps	compiledOps = {
+    compiledClone,
+    compiledConvertDouble,
+    compiledConvertFloats,
+    compiledConvertDoubles,
+    compiledGetExpression,
+    compiledFree};
+
+
+/*
+ * Reduces the instructions of a program to stages.
+ *
+ * Arguments:
+ *	code		The instructions.  None may be OP_CALL.
+ *	count		The number of instructions.
+ *	stages		The output stages.  Must have room for "count" stages.
+ * Returns:
+ *	The number of stages.  Zero means the identity.
+ */
+static size_t
+compileStages(
+    const Instruction* const	code,
+    const size_t		count,
+    Stage* const		stages)
+{
+    size_t	nstages = 0;
+    Stage	stage = {FN_AFFINE, 1, 0, 1, 0};
+    size_t	i;
+
+    for (i = 0; i < count; i++) {
+	const Instruction* const	inst = code + i;
+
+	if (inst->opcode == OP_SCALE || inst->opcode == OP_OFFSET ||
+		inst->opcode == OP_GALILEAN) {
+	    const double	a = inst->opcode == OP_OFFSET ? 1 : inst->a;
+	    const double	b = inst->opcode == OP_SCALE
+		? 0
+		: inst->opcode == OP_OFFSET
+		    ? inst->a
+		    : inst->b;
+
+	    /*
+	     * Fold the affine transformation into the stage: before its
+	     * function if it doesn't have one yet; otherwise, after.
+	     */
+	    if (stage.function == FN_AFFINE) {
+		stage.p *= a;
+		stage.q = a * stage.q + b;
+	    }
+	    else {
+		stage.r *= a;
+		stage.s = a * stage.s + b;
+	    }
+	}
+	else {
+	    if (stage.function != FN_AFFINE) {
+		stages[nstages++] = stage;
+		stage.function = FN_AFFINE;
+		stage.p = 1;
+		stage.q = 0;
+	    }
+
+	    stage.r = 1;
+	    stage.s = 0;
+
+	    if (inst->opcode == OP_LOG) {
+		stage.function = FN_LOG;
+		stage.r = inst->a;
+	    }
+	    else if (inst->opcode == OP_EXP) {
+		const double	logBase = log(inst->a);
+
+		stage.function = FN_EXP;
+		stage.p *= logBase;
+		stage.q *= logBase;
+	    }
+	    else {
+		stage.function = FN_RECIPROCAL;
+	    }
+	}
+    }
+
+    if (count > 0)
+	stages[nstages++] = stage;
+
+    return nstages;
+}
+
+
+/*******************************************************************************
+ * Public API:
+ ******************************************************************************/
+
+/*
+ * Returns the trivial converter (i.e., y = x).
+ * When finished with the converter, the client should pass the converter to
+ * cv_free().
+ *
+ * Returns:
+ *	The trivial converter.
+ */
+cv_converter*
+cv_get_trivial()
+{
+    return &trivialConverter;
+}
+
+
+/*
+ * Returns the reciprocal converter (i.e., y = 1/x).
+ * When finished with the converter, the client should pass the converter to
+ * cv_free().
+ *
+ * Returns:
+ *	The reciprocal converter.
+ */
+cv_converter*
+cv_get_inverse()
+{
+    return &reciprocalConverter;
+}
+
+
+/*
+ * Returns a converter that multiplies values by a number (i.e., y = ax).
+ * When finished with the converter, the client should pass the converter to
+ * cv_free().
+ *
+ * Arguments:
+ *	slope	The number by which to multiply values.
+ * Returns:
+ *	NULL	Necessary memory couldn't be allocated.
+ *	else	A converter that will multiply values by the given number.
+ */
+cv_converter*
+cv_get_scale(
+    const double	slope)
+{
+    cv_converter*	conv;
+
+    if (slope == 1) {
+	conv = &trivialConverter;
+    }
+    else {
+	conv = malloc(sizeof(*conv));
+
+	if (conv != NULL) {
+	    conv->ops = &scaleOps;
+	    conv->scale.value = slope;
+	}
+    }
+
+    return conv;
+}
+
+
+/*
+ * Returns a converter that adds a number to values (i.e., y = x + b).
+ * When finished with the converter, the client should pass the converter to
+ * cv_free().
+ *
+ * Arguments:
+ *	offset	The number to be added.
+ * Returns:
+ *	NULL	Necessary memory couldn't be allocated.
+ *	else	A converter that adds the given number to values.
+ */
+cv_converter*
+cv_get_offset(
+    const double	offset)
+{
+    cv_converter*	conv;
+
+    if (offset == 0) {
+	conv = &trivialConverter;
+    }
+    else {
+	conv = malloc(sizeof(*conv));
+
+	if (conv != NULL) {
+	    conv->ops = &offsetOps;
+	    conv->offset.value = offset;
+	}
+    }
+
+    return conv;
+}
+
+
+/*
+ * Returns a Galilean converter (i.e., y = ax + b).
+ * When finished with the converter, the client should pass the converter to
+ * cv_free().
+ *
+ * Arguments:
+ *	slope	The number by which to multiply values.
+ *	offset	The number to be added.
+ * Returns:
+ *	NULL	Necessary memory couldn't be allocated.
+ *	else	A Galilean converter corresponding to the inputs.
+ */
+cv_converter*
+cv_get_galilean(
+    const double	slope,
+    const double	intercept)
+{
+    cv_converter*	conv;
+
+    if (slope == 1) {
+	conv = cv_get_offset(intercept);
+    }
+    else if (intercept == 0) {
+	conv = cv_get_scale(slope);
+    }
+    else {
+	conv = malloc(sizeof(*conv));
+
+	if (conv != NULL) {
+	    conv->ops = &galileanOps;
+	    conv->galilean.slope = slope;
+	    conv->galilean.intercept = intercept;
+	}
+    }
+
+    return conv;
+}
+
+
+/*
+ * Returns a logarithmic converter (i.e., y = log(x/x0) in some base).
+ * When finished with the converter, the client should pass the converter to
+ * cv_free().
+ *
+ * Arguments:
+ *	base		The logarithmic base (e.g., 2, M_E, 10).  Must be
  *                      greater than one.
  * Returns:
- *	NULL		"base" is invalid or necessary memory couldn't be
- *			allocated.
- *	else		A logarithmic converter corresponding to the inputs.
+ *	NULL		"base" is invalid or necessary memory couldn't be
+ *			allocated.
+ *	else		A logarithmic converter corresponding to the inputs.
+ */
+cv_converter*
+cv_get_log(
+    const double	base)
+{
+    cv_converter*	conv;
+
+    if (base <= 1) {
+	conv = NULL;
+    }
+    else {
+	conv = malloc(sizeof(*conv));
+
+	if (conv != NULL) {
+	    conv->ops = &logOps;
+	    conv->log.logE =
+                base == 2
+                    ? M_LOG2E
+                    : base == M_E
+                        ? 1
+                        : base == 10
+                            ? M_LOG10E
+                            : 1/log(base);
+	}
+    }
+
+    return conv;
+}
+
+
+/*
+ * Returns an exponential converter (i.e., y = pow(b, x) in some base "b").
+ * When finished with the converter, the client should pass the converter to
+ * cv_free().
+ *
+ * Arguments:
+ *	base		The desired base.  Must be positive.
+ * Returns:
+ *	NULL		"base" is invalid or necessary memory couldn't be
+ *			allocated.
+ *	else		An exponential converter corresponding to the inputs.
+ */
+cv_converter*
+cv_get_pow(
+    const double	base)
+{
+    cv_converter*	conv;
+
+    if (base <= 0) {
+	conv = NULL;
+    }
+    else {
+	conv = malloc(sizeof(*conv));
+
+	if (conv != NULL) {
+	    conv->ops = &expOps;
+	    conv->exp.base = base;
+	}
+    }
+
+    return conv;
+}
+
+
+/*
+ * Returns a converter corresponding to the sequential application of two
+ * other converters.  The returned converter should be passed to cv_free() when
+ * it is no longer needed.  Adjacent affine transformations are combined, and
+ * chains of logarithms, exponentials, and scalings are simplified (e.g.,
+ * pow(10, x) followed by 10*lg(x) becomes 10*x); see programSimplify().
+ *
+ * Arguments:
+ *	first	The converter to be applied first.  May be passed to cv_free()
+ *		upon return.
+ *	second	The converter to be applied second.  May be passed to cv_free()
+ *		upon return.
+ * Returns:
+ *	NULL	Either "first" or "second" is NULL or necessary memory couldn't
+ *		be allocated.
+ *      else    A converter corresponding to the sequential application of the
+ *              given converters.  If one of the input converters is the trivial
+ *              converter, then the returned converter will be the other input
+ *              converter.
+ */
+cv_converter*
+cv_combine(
+    cv_converter* const	first,
+    cv_converter* const	second)
+{
+    cv_converter*	conv;
+
+    if (first == NULL || second == NULL) {
+	conv = NULL;
+    }
+    else if (IS_SHARED(first)) {
+	conv = cv_combine(first->shared.target, second);
+    }
+    else if (IS_SHARED(second)) {
+	conv = cv_combine(first, second->shared.target);
+    }
+    else if (IS_TRIVIAL(first)) {
+	UT_STATS_ADD(combineCalls, 1);
+	conv = CV_CLONE(second);
+    }
+    else if (IS_TRIVIAL(second)) {
+	UT_STATS_ADD(combineCalls, 1);
+	conv = CV_CLONE(first);
+    }
+    else {
+	UT_STATS_ADD(combineCalls, 1);
+	conv = NULL;
+
+	if (IS_RECIPROCAL(first)) {
+	    if (IS_RECIPROCAL(second)) {
+		conv = cv_get_trivial();
+	    }
+	}
+	else if (IS_SCALE(first)) {
+	    if (IS_SCALE(second)) {
+		conv = cv_get_scale(first->scale.value * second->scale.value);
+	    }
+	    else if (IS_OFFSET(second)) {
+		conv = cv_get_galilean(first->scale.value, second->offset.value);
+	    }
+	    else if (IS_GALILEAN(second)) {
+		conv = cv_get_galilean(
+		    first->scale.value * second->galilean.slope,
+		    second->galilean.intercept);
+	    }
+	}
+	else if (IS_OFFSET(first)) {
+	    if (IS_SCALE(second)) {
+		conv = cv_get_galilean(second->scale.value,
+		    first->offset.value * second->scale.value);
+	    }
+	    else if (IS_OFFSET(second)) {
+		conv = cv_get_offset(first->offset.value + second->offset.value);
+	    }
+	    else if (IS_GALILEAN(second)) {
+		conv = cv_get_galilean(second->galilean.slope,
+		    first->offset.value * second->galilean.slope +
+			second->galilean.intercept);
+	    }
+	}
+	else if (IS_GALILEAN(first)) {
+	    if (IS_SCALE(second)) {
+		conv = cv_get_galilean(
+		    second->scale.value * first->galilean.slope,
+		    second->scale.value * first->galilean.intercept);
+	    }
+	    else if (IS_OFFSET(second)) {
+		conv = cv_get_galilean(first->galilean.slope,
+		    first->galilean.intercept + second->offset.value);
+	    }
+	    else if (IS_GALILEAN(second)) {
+		conv = cv_get_galilean(
+		    second->galilean.slope * first->galilean.slope,
+		    second->galilean.slope * first->galilean.intercept +
+			second->galilean.intercept);
+	    }
+	}
+
+	if (conv != NULL) {
+	    UT_STATS_ADD(combineFolds, 1);
+	}
+	else {
+	    /*
+	     * General case: create a program converter and simplify it.
+	     */
+	    conv = programNew(first, second);
+
+	    if (conv != NULL && programSimplify(conv)) {
+		UT_STATS_ADD(combineFolds, 1);
+
+		if (conv->program.count <= 1 &&
+			(conv->program.count == 0 ||
+			 conv->program.code[0].opcode != OP_CALL)) {
+		    cv_converter* const	reduced = programReduce(conv);
+
+		    cv_free(conv);
+		    conv = reduced;
+		}
+	    }
+	}                               /* "conv != NULL" */
+    }                                   /* "first" & "second" not trivial */
+
+    return conv;
+}
+
+
+/*
+ * Returns a converter that's specialized for converting many values.  The
+ * chain of operations of the given converter is reduced to as few fused
+ * kernels as possible -- usually one -- with each logarithm, exponential, or
+ * reciprocal and the scalings and offsets around it evaluated in a single pass
+ * over the values, and with exponentials computed by exp() rather than pow().
+ * The result is used like any other converter (e.g., by cv_convert_doubles())
+ * and has the same expression (see cv_get_expression()).  Compiling takes
+ * longer than cloning, so it's worthwhile for long-lived converters that are
+ * applied to many values.  Converted values can differ from those of the
+ * given converter by rounding.
+ *
+ * Arguments:
+ *	conv	The converter to be compiled.  May be passed to cv_free() upon
+ *		return.
+ * Returns:
+ *	NULL	"conv" is NULL or necessary memory couldn't be allocated.
+ *	else	The compiled converter.  If "conv" can't be improved, then
+ *		this is a clone of it.  It should be passed to cv_free() when
+ *		it's no longer needed.
  */
 cv_converter*
-cv_get_log(
-    const double	base)
+cv_compile(
+    cv_converter* const	conv)
 {
-    cv_converter*	conv;
+    cv_converter*	compiled = NULL;	/* failure */
 
-    if (base <= 1) {
-	conv = NULL;
+    if (conv == NULL) {
+	/* EMPTY */
+    }
+    else if (IS_SHARED(conv)) {
+	compiled = cv_compile(conv->shared.target);
+    }
+    else if (!IS_PROGRAM(conv) && !IS_EXP(conv)) {
+	/*
+	 * The other converters already have fused kernels.
+	 */
+	compiled = CV_CLONE(conv);
     }
     else {
-	conv = malloc(sizeof(*conv));
+	cv_converter* const	program = programNew(conv, &trivialConverter);
 
-	if (conv != NULL) {
-	    conv->ops = &logOps;
-	    conv->log.logE =
-                base == 2
-                    ? M_LOG2E
-                    : base == M_E
-                        ? 1
-                        : base == 10
-                            ? M_LOG10E
-                            : 1/log(base);
+	if (program != NULL) {
+	    const size_t	count = program->program.count;
+	    size_t		i;
+
+	    for (i = 0; i < count; i++)
+		if (program->program.code[i].opcode == OP_CALL)
+		    break;
+
+	    if (i < count) {
+		/*
+		 * An opaque converter can't be compiled.
+		 */
+		compiled = CV_CLONE(conv);
+	    }
+	    else if ((compiled = malloc(sizeof(*compiled))) != NULL) {
+		compiled->compiled.stages =
+		    malloc(count * sizeof(*compiled->compiled.stages));
+		compiled->compiled.source = CV_CLONE(conv);
+
+		if (compiled->compiled.stages == NULL ||
+			compiled->compiled.source == NULL) {
+		    cv_free(compiled->compiled.source);
+		    free(compiled->compiled.stages);
+		    free(compiled);
+		    compiled = NULL;
+		}
+		else {
+		    compiled->compiled.ops = &compiledOps;
+		    compiled->compiled.count = compileStages(
+			program->program.code, count,
+			compiled->compiled.stages);
+		}
+	    }
+
+	    cv_free(program);
+	}
+    }
+
+    return compiled;
+}
+
+
+/*
+ * Frees resources associated with a converter.  Use of the converter argument
+ * subsequent to this function may result in undefined behavior.
+ *
+ * Arguments:
+ *	conv	The converter to have its resources freed or NULL.  The
+ *		converter must have been returned by this module.
+ */
+void
+cv_free(
+    cv_converter* const	conv)
+{
+    if (conv != NULL) {
+	conv->ops->free((cv_converter*)conv);
+    }
+}
+
+
+/*
+ * Converts a float.
+ *
+ * Arguments:
+ *	converter	Pointer to the converter.
+ *	value		The value to be converted.
+ * Returns:
+ *	The converted value.
+ */
+float
+cv_convert_float(
+    const cv_converter*	converter,
+    const float		value)
+{
+    return (float)converter->ops->convertDouble(converter, value);
+}
+
+
+/*
+ * Converts a double.
+ *
+ * Arguments:
+ *	converter	Pointer to the converter.
+ *	value		The value to be converted.
+ * Returns:
+ *	The converted value.
+ */
+double
+cv_convert_double(
+    const cv_converter*	converter,
+    const double	value)
+{
+    return converter->ops->convertDouble(converter, value);
+}
+
+
+/*
+ * Converts an array of floats.
+ *
+ * Arguments:
+ *	converter	Pointer to the converter.
+ *	in		Pointer to the values to be converted.  The array may
+ *			overlap "out".
+ *	count		The number of values to be converted.
+ *	out		Pointer to the output array for the converted values.
+ *			The array may overlap "in".
+ * Returns:
+ *	NULL		"converter", "in", or "out" is NULL.
+ *	else		Pointer to the output array, "out".
+ */
+float*
+cv_convert_floats(
+    const cv_converter*	converter,
+    const float* const	in,
+    const size_t	count,
+    float*		out)
+{
+    if (converter == NULL || in == NULL || out == NULL) {
+	out = NULL;
+    }
+    else {
+	UT_STATS_ADD(arrayCalls, 1);
+	UT_STATS_ADD(floatValues, count);
+        out = converter->ops->convertFloats(converter, in, count, out);
+    }
+
+    return out;
+}
+
+
+/*
+ * Converts an array of doubles.
+ *
+ * Arguments:
+ *	converter	Pointer to the converter.
+ *	in		Pointer to the values to be converted.  The array may
+ *			overlap "out".
+ *	count		The number of values to be converted.
+ *	out		Pointer to the output array for the converted values.
+ *			The array may overlap "in".
+ * Returns:
+ *	NULL		"converter", "in", or "out" is NULL.
+ *	else		Pointer to the output array, "out".
+ */
+double*
+cv_convert_doubles(
+    const cv_converter*	converter,
+    const double* const	in,
+    const size_t	count,
+    double*		out)
+{
+    if (converter == NULL || in == NULL || out == NULL) {
+	out = NULL;
+    }
+    else {
+	UT_STATS_ADD(arrayCalls, 1);
+	UT_STATS_ADD(doubleValues, count);
+    	out = converter->ops->convertDoubles(converter, in, count, out);
+    }
+
+    return out;
+}
+
+
+/*******************************************************************************
+ * Parallel Conversion:
+ ******************************************************************************/
+
+#define CV_PARALLEL_ALIGN	1024	/* chunk sizes are multiples of this */
+#define CV_TASKS_PER_THREAD	4	/* for load-balancing */
+
+static size_t	parallelThreshold = 65536;
+
+typedef struct {
+    const cv_converter*	converter;
+    const void*		in;
+    void*		out;
+    size_t		count;		/* total number of values */
+    size_t		chunk;		/* number of values per task */
+} ParallelJob;
+
+
+static void
+convertFloatsTask(
+    void* const		arg,
+    const size_t	index)
+{
+    const ParallelJob* const	job = (const ParallelJob*)arg;
+    const size_t		start = index * job->chunk;
+    const size_t		n = job->count - start < job->chunk
+	? job->count - start
+	: job->chunk;
+
+    (void)job->converter->ops->convertFloats(job->converter,
+	(const float*)job->in + start, n, (float*)job->out + start);
+}
+
+
+static void
+convertDoublesTask(
+    void* const		arg,
+    const size_t	index)
+{
+    const ParallelJob* const	job = (const ParallelJob*)arg;
+    const size_t		start = index * job->chunk;
+    const size_t		n = job->count - start < job->chunk
+	? job->count - start
+	: job->chunk;
+
+    (void)job->converter->ops->convertDoubles(job->converter,
+	(const double*)job->in + start, n, (double*)job->out + start);
+}
+
+
+/*
+ * Returns the number of tasks into which a conversion should be divided and
+ * sets the number of values per task.  Returns 1 if the conversion should be
+ * done serially.
+ *
+ * Arguments:
+ *	count		The number of values to be converted.
+ *	chunk		Pointer to the number of values per task.
+ */
+static size_t
+getTaskCount(
+    const size_t	count,
+    size_t* const	chunk)
+{
+    size_t	ntasks = 1;
+
+    *chunk = count;
+
+    if (count >= UT_ATOMIC_LOAD(&parallelThreshold) &&
+	    count > CV_PARALLEL_ALIGN) {
+	const unsigned	nthreads = tpGetThreadCount();
+
+	if (nthreads > 1) {
+	    size_t	n = (count + nthreads * CV_TASKS_PER_THREAD - 1) /
+		(nthreads * CV_TASKS_PER_THREAD);
+
+	    n = (n + CV_PARALLEL_ALIGN - 1) / CV_PARALLEL_ALIGN *
+		CV_PARALLEL_ALIGN;
+	    *chunk = n;
+	    ntasks = (count + n - 1) / n;
+	}
+    }
+
+    return ntasks;
+}
+
+
+/*
+ * Sets the parameters of parallel conversion by cv_convert_floats_parallel()
+ * and cv_convert_doubles_parallel().  The worker threads are persistent: they
+ * are created when first needed and reused by subsequent conversions.  This
+ * function shouldn't be called while a parallel conversion is in progress.
+ *
+ * Arguments:
+ *	nthreads	The number of threads to use -- including the calling
+ *			thread.  If zero, then the number of online processors
+ *			is used (the default).  Existing worker threads are
+ *			stopped.  Has no effect if the library was built
+ *			without thread support.
+ *	threshold	The number of values below which conversion is done
+ *			serially by the calling thread.
+ * Returns:
+ *	0		Success.
+ *	-1		Failure.  A parallel conversion is in progress.
+ */
+int
+cv_set_parallelism(
+    const unsigned	nthreads,
+    const size_t	threshold)
+{
+    const int	status = tpSetThreadCount(nthreads);
+
+    if (status == 0)
+	UT_ATOMIC_STORE(&parallelThreshold, threshold);
+
+    return status;
+}
+
+
+/*
+ * Returns the number of values below which conversion is done serially.  See
+ * cv_set_parallelism().
+ */
+size_t
+cvGetParallelThreshold(void)
+{
+    return UT_ATOMIC_LOAD(&parallelThreshold);
+}
+
+
+/*
+ * Converts an array of floats using multiple threads.  Identical to
+ * cv_convert_floats() except that an array with at least the number of values
+ * set by cv_set_parallelism() is divided into chunks that are converted
+ * concurrently.  Arrays that overlap but aren't identical are converted
+ * serially.
+ *
+ * Arguments:
+ *	converter	Pointer to the converter.
+ *	in		Pointer to the values to be converted.  The array may
+ *			overlap "out".
+ *	count		The number of values to be converted.
+ *	out		Pointer to the output array for the converted values.
+ *			The array may overlap "in".
+ * Returns:
+ *	NULL		"converter", "in", or "out" is NULL.
+ *	else		Pointer to the output array, "out".
+ */
+float*
+cv_convert_floats_parallel(
+    const cv_converter*	converter,
+    const float* const	in,
+    const size_t	count,
+    float*		out)
+{
+    if (converter == NULL || in == NULL || out == NULL) {
+	out = NULL;
+    }
+    else {
+	ParallelJob	job;
+	const size_t	ntasks = in == out || CV_DISJOINT(in, out, count)
+	    ? getTaskCount(count, &job.chunk)
+	    : 1;
+
+	UT_STATS_ADD(arrayCalls, 1);
+	UT_STATS_ADD(parallelValues, count);
+
+	if (ntasks <= 1) {
+	    out = converter->ops->convertFloats(converter, in, count, out);
+	}
+	else {
+	    job.converter = converter;
+	    job.in = in;
+	    job.out = out;
+	    job.count = count;
+
+	    tpRun(ntasks, convertFloatsTask, &job);
 	}
     }
 
-    return conv;
+    return out;
 }
 
 
 /*
- * Returns an exponential converter (i.e., y = pow(b, x) in some base "b").
- * When finished with the converter, the client should pass the converter to
- * cv_free().
+ * Converts an array of doubles using multiple threads.  Identical to
+ * cv_convert_doubles() except that an array with at least the number of values
+ * set by cv_set_parallelism() is divided into chunks that are converted
+ * concurrently.  Arrays that overlap but aren't identical are converted
+ * serially.
  *
  * Arguments:
- *	base		The desired base.  Must be positive.
+ *	converter	Pointer to the converter.
+ *	in		Pointer to the values to be converted.  The array may
+ *			overlap "out".
+ *	count		The number of values to be converted.
+ *	out		Pointer to the output array for the converted values.
+ *			The array may overlap "in".
  * Returns:
- *	NULL		"base" is invalid or necessary memory couldn't be
- *			allocated.
- *	else		An exponential converter corresponding to the inputs.
+ *	NULL		"converter", "in", or "out" is NULL.
+ *	else		Pointer to the output array, "out".
  */
-cv_converter*
-cv_get_pow(
-    const double	base)
+double*
+cv_convert_doubles_parallel(
+    const cv_converter*	converter,
+    const double* const	in,
+    const size_t	count,
+    double*		out)
 {
-    cv_converter*	conv;
-
-    if (base <= 0) {
-	conv = NULL;
+    if (converter == NULL || in == NULL || out == NULL) {
+	out = NULL;
     }
     else {
-	conv = malloc(sizeof(*conv));
+	ParallelJob	job;
+	const size_t	ntasks = in == out || CV_DISJOINT(in, out, count)
+	    ? getTaskCount(count, &job.chunk)
+	    : 1;
 
-	if (conv != NULL) {
-	    conv->ops = &expOps;
-	    conv->exp.base = base;
+	UT_STATS_ADD(arrayCalls, 1);
+	UT_STATS_ADD(parallelValues, count);
+
+	if (ntasks <= 1) {
+	    out = converter->ops->convertDoubles(converter, in, count, out);
+	}
+	else {
+	    job.converter = converter;
+	    job.in = in;
+	    job.out = out;
+	    job.count = count;
+
+	    tpRun(ntasks, convertDoublesTask, &job);
 	}
     }
 
-    return conv;
+    return out;
 }
 
 
+/*******************************************************************************
+ * Strided and Mixed-Type Conversion:
+ *
+ * These functions convert values in place in the output array when its type
+ * is double; otherwise, they process the values in blocks through a buffer on
+ * the stack.  Strides are in units of array elements and may be negative or
+ * zero.
+ ******************************************************************************/
+
+#define CV_BLOCK_SIZE	512	/* number of values per block */
+
+
 /*
- * Returns a converter corresponding to the sequential application of two
- * other converters.  The returned converter should be passed to cv_free() when
- * it is no longer needed.
+ * Converts a strided array of floats.
  *
  * Arguments:
- *	first	The converter to be applied first.  May be passed to cv_free()
- *		upon return.
- *	second	The converter to be applied second.  May be passed to cv_free()
- *		upon return.
+ *	converter	Pointer to the converter.
+ *	in		Pointer to the first value to be converted.
+ *	inStride	The number of elements between successive input
+ *			values.
+ *	count		The number of values to be converted.
+ *	out		Pointer to the first output value.  The output values
+ *			must not overlap the input values unless "out" equals
+ *			"in" and "outStride" equals "inStride".
+ *	outStride	The number of elements between successive output
+ *			values.
  * Returns:
- *	NULL	Either "first" or "second" is NULL or necessary memory couldn't
- *		be allocated.
- *      else    A converter corresponding to the sequential application of the
- *              given converters.  If one of the input converters is the trivial
- *              converter, then the returned converter will be the other input
- *              converter.
+ *	NULL		"converter", "in", or "out" is NULL.
+ *	else		Pointer to the output array, "out".
  */
-cv_converter*
-cv_combine(
-    cv_converter* const	first,
-    cv_converter* const	second)
+float*
+cv_convert_floats_strided(
+    const cv_converter*	converter,
+    const float* const	in,
+    const ptrdiff_t	inStride,
+    const size_t	count,
+    float*		out,
+    const ptrdiff_t	outStride)
 {
-    cv_converter*	conv;
-
-    if (first == NULL || second == NULL) {
-	conv = NULL;
-    }
-    else if (IS_TRIVIAL(first)) {
-	conv = CV_CLONE(second);
+    if (converter == NULL || in == NULL || out == NULL) {
+	out = NULL;
     }
-    else if (IS_TRIVIAL(second)) {
-	conv = CV_CLONE(first);
+    else if (inStride == 1 && outStride == 1) {
+	UT_STATS_ADD(arrayCalls, 1);
+	UT_STATS_ADD(stridedValues, count);
+	out = converter->ops->convertFloats(converter, in, count, out);
     }
     else {
-	conv = NULL;
-
-	if (IS_RECIPROCAL(first)) {
-	    if (IS_RECIPROCAL(second)) {
-		conv = cv_get_trivial();
-	    }
-	}
-	else if (IS_SCALE(first)) {
-	    if (IS_SCALE(second)) {
-		conv = cv_get_scale(first->scale.value * second->scale.value);
-	    }
-	    else if (IS_OFFSET(second)) {
-		conv = cv_get_galilean(first->scale.value, second->offset.value);
-	    }
-	    else if (IS_GALILEAN(second)) {
-		conv = cv_get_galilean(
-		    first->scale.value * second->galilean.slope,
-		    second->galilean.intercept);
-	    }
-	}
-	else if (IS_OFFSET(first)) {
-	    if (IS_SCALE(second)) {
-		conv = cv_get_galilean(second->scale.value,
-		    first->offset.value * second->scale.value);
-	    }
-	    else if (IS_OFFSET(second)) {
-		conv = cv_get_offset(first->offset.value + second->offset.value);
-	    }
-	    else if (IS_GALILEAN(second)) {
-		conv = cv_get_galilean(second->galilean.slope,
-		    first->offset.value * second->galilean.slope +
-			second->galilean.intercept);
-	    }
-	}
-	else if (IS_GALILEAN(first)) {
-	    if (IS_SCALE(second)) {
-		conv = cv_get_galilean(
-		    second->scale.value * first->galilean.slope,
-		    second->scale.value * first->galilean.intercept);
-	    }
-	    else if (IS_OFFSET(second)) {
-		conv = cv_get_galilean(first->galilean.slope,
-		    first->galilean.intercept + second->offset.value);
-	    }
-	    else if (IS_GALILEAN(second)) {
-		conv = cv_get_galilean(
-		    second->galilean.slope * first->galilean.slope,
-		    second->galilean.slope * first->galilean.intercept +
-			second->galilean.intercept);
-	    }
-	}
-
-	if (conv == NULL) {
-	    /*
-	     * General case: create a composite converter.
-	     */
-	    cv_converter*	c1 = CV_CLONE(first);
-            int                 error = 1;
+	float	buf[CV_BLOCK_SIZE];
+	size_t	start;
 
-            if (c1 != NULL) {
-                cv_converter*	c2 = CV_CLONE(second);
+	UT_STATS_ADD(arrayCalls, 1);
+	UT_STATS_ADD(stridedValues, count);
 
-                if (c2 != NULL) {
-                    conv = malloc(sizeof(*conv));
+	for (start = 0; start < count; start += CV_BLOCK_SIZE) {
+	    const size_t	n = count - start < CV_BLOCK_SIZE
+		? count - start
+		: CV_BLOCK_SIZE;
+	    const float*	src = in + (ptrdiff_t)start * inStride;
+	    float*		dst = out + (ptrdiff_t)start * outStride;
+	    size_t		i;
 
-                    if (conv != NULL) {
-                        conv->composite.ops = &compositeOps;
-                        conv->composite.first = c1;
-                        conv->composite.second = c2;
-                        error = 0;
-                    }                   /* "conv" allocated */
+	    for (i = 0; i < n; i++, src += inStride)
+		buf[i] = *src;
 
-                    if (error)
-                        cv_free(c2);
-                }                       /* "c2" allocated */
+	    (void)converter->ops->convertFloats(converter, buf, n, buf);
 
-                if (error)
-                    cv_free(c1);
-            }                           /* "c1" allocated */
-	}                               /* "conv != NULL" */
-    }                                   /* "first" & "second" not trivial */
+	    for (i = 0; i < n; i++, dst += outStride)
+		*dst = buf[i];
+	}
+    }
 
-    return conv;
+    return out;
 }
 
 
 /*
- * Frees resources associated with a converter.  Use of the converter argument
- * subsequent to this function may result in undefined behavior.
+ * Converts a strided array of doubles.
  *
  * Arguments:
- *	conv	The converter to have its resources freed or NULL.  The
- *		converter must have been returned by this module.
+ *	converter	Pointer to the converter.
+ *	in		Pointer to the first value to be converted.
+ *	inStride	The number of elements between successive input
+ *			values.
+ *	count		The number of values to be converted.
+ *	out		Pointer to the first output value.  The output values
+ *			must not overlap the input values unless "out" equals
+ *			"in" and "outStride" equals "inStride".
+ *	outStride	The number of elements between successive output
+ *			values.
+ * Returns:
+ *	NULL		"converter", "in", or "out" is NULL.
+ *	else		Pointer to the output array, "out".
  */
-void
-cv_free(
-    cv_converter* const	conv)
+double*
+cv_convert_doubles_strided(
+    const cv_converter*	converter,
+    const double* const	in,
+    const ptrdiff_t	inStride,
+    const size_t	count,
+    double*		out,
+    const ptrdiff_t	outStride)
 {
-    if (conv != NULL) {
-	conv->ops->free((cv_converter*)conv);
+    if (converter == NULL || in == NULL || out == NULL) {
+	out = NULL;
+    }
+    else if (inStride == 1 && outStride == 1) {
+	UT_STATS_ADD(arrayCalls, 1);
+	UT_STATS_ADD(stridedValues, count);
+	out = converter->ops->convertDoubles(converter, in, count, out);
+    }
+    else {
+	double	buf[CV_BLOCK_SIZE];
+	size_t	start;
+
+	UT_STATS_ADD(arrayCalls, 1);
+	UT_STATS_ADD(stridedValues, count);
+
+	for (start = 0; start < count; start += CV_BLOCK_SIZE) {
+	    const size_t	n = count - start < CV_BLOCK_SIZE
+		? count - start
+		: CV_BLOCK_SIZE;
+	    const double*	src = in + (ptrdiff_t)start * inStride;
+	    double*		dst = out + (ptrdiff_t)start * outStride;
+	    size_t		i;
+
+	    for (i = 0; i < n; i++, src += inStride)
+		buf[i] = *src;
+
+	    (void)converter->ops->convertDoubles(converter, buf, n, buf);
+
+	    for (i = 0; i < n; i++, dst += outStride)
+		*dst = buf[i];
+	}
     }
+
+    return out;
 }
 
 
 /*
- * Converts a float.
+ * Converts an array of floats into an array of doubles.
  *
  * Arguments:
  *	converter	Pointer to the converter.
- *	value		The value to be converted.
+ *	in		Pointer to the values to be converted.
+ *	count		The number of values to be converted.
+ *	out		Pointer to the output array for the converted values.
+ *			The array must not overlap "in".
  * Returns:
- *	The converted value.
+ *	NULL		"converter", "in", or "out" is NULL.
+ *	else		Pointer to the output array, "out".
  */
-float
-cv_convert_float(
+double*
+cv_convert_floats_to_doubles(
     const cv_converter*	converter,
-    const float		value)
+    const float* const	in,
+    const size_t	count,
+    double*		out)
 {
-    return (float)converter->ops->convertDouble(converter, value);
+    if (converter == NULL || in == NULL || out == NULL) {
+	out = NULL;
+    }
+    else {
+	size_t	i;
+
+	UT_STATS_ADD(arrayCalls, 1);
+	UT_STATS_ADD(mixedValues, count);
+
+	for (i = 0; i < count; i++)
+	    out[i] = in[i];
+
+	out = converter->ops->convertDoubles(converter, out, count, out);
+    }
+
+    return out;
 }
 
 
 /*
- * Converts a double.
+ * Converts an array of doubles into an array of floats.  The conversion is
+ * done in double precision; only the results are narrowed.
  *
  * Arguments:
  *	converter	Pointer to the converter.
- *	value		The value to be converted.
+ *	in		Pointer to the values to be converted.
+ *	count		The number of values to be converted.
+ *	out		Pointer to the output array for the converted values.
+ *			The array must not overlap "in".
  * Returns:
- *	The converted value.
+ *	NULL		"converter", "in", or "out" is NULL.
+ *	else		Pointer to the output array, "out".
  */
-double
-cv_convert_double(
+float*
+cv_convert_doubles_to_floats(
     const cv_converter*	converter,
-    const double	value)
+    const double* const	in,
+    const size_t	count,
+    float*		out)
 {
-    return converter->ops->convertDouble(converter, value);
+    if (converter == NULL || in == NULL || out == NULL) {
+	out = NULL;
+    }
+    else {
+	double	buf[CV_BLOCK_SIZE];
+	size_t	start;
+
+	UT_STATS_ADD(arrayCalls, 1);
+	UT_STATS_ADD(mixedValues, count);
+
+	for (start = 0; start < count; start += CV_BLOCK_SIZE) {
+	    const size_t	n = count - start < CV_BLOCK_SIZE
+		? count - start
+		: CV_BLOCK_SIZE;
+	    size_t		i;
+
+	    (void)converter->ops->convertDoubles(converter, in + start, n,
+		buf);
+
+	    for (i = 0; i < n; i++)
+		out[start+i] = (float)buf[i];
+	}
+    }
+
+    return out;
 }
 
 
 /*
- * Converts an array of floats.
+ * Unpacks and converts an array of short integers into an array of doubles.
+ * Each input value, "x", is first unpacked as "x*scale + offset" (cf. the
+ * netCDF "scale_factor" and "add_offset" attributes).
  *
  * Arguments:
  *	converter	Pointer to the converter.
- *	in		Pointer to the values to be converted.  The array may
- *			overlap "out".
+ *	in		Pointer to the packed values to be converted.
  *	count		The number of values to be converted.
+ *	scale		The factor by which to multiply the packed values.
+ *	offset		The number to add to the scaled values.
  *	out		Pointer to the output array for the converted values.
- *			The array may overlap "in".
+ *			The array must not overlap "in".
  * Returns:
  *	NULL		"converter", "in", or "out" is NULL.
  *	else		Pointer to the output array, "out".
  */
-float*
-cv_convert_floats(
+double*
+cv_convert_packed_shorts(
     const cv_converter*	converter,
-    const float* const	in,
+    const short* const	in,
     const size_t	count,
-    float*		out)
+    const double	scale,
+    const double	offset,
+    double*		out)
 {
     if (converter == NULL || in == NULL || out == NULL) {
 	out = NULL;
     }
     else {
-        out = converter->ops->convertFloats(converter, in, count, out);
+	size_t	i;
+
+	UT_STATS_ADD(arrayCalls, 1);
+	UT_STATS_ADD(packedValues, count);
+
+	for (i = 0; i < count; i++)
+	    out[i] = in[i] * scale + offset;
+
+	out = converter->ops->convertDoubles(converter, out, count, out);
     }
 
     return out;
@@ -1346,31 +3445,44 @@ cv_convert_floats(
 
 
 /*
- * Converts an array of doubles.
+ * Unpacks and converts an array of integers into an array of doubles.  Each
+ * input value, "x", is first unpacked as "x*scale + offset" (cf. the netCDF
+ * "scale_factor" and "add_offset" attributes).
  *
  * Arguments:
  *	converter	Pointer to the converter.
- *	in		Pointer to the values to be converted.  The array may
- *			overlap "out".
+ *	in		Pointer to the packed values to be converted.
  *	count		The number of values to be converted.
+ *	scale		The factor by which to multiply the packed values.
+ *	offset		The number to add to the scaled values.
  *	out		Pointer to the output array for the converted values.
- *			The array may overlap "in".
+ *			The array must not overlap "in".
  * Returns:
  *	NULL		"converter", "in", or "out" is NULL.
  *	else		Pointer to the output array, "out".
  */
 double*
-cv_convert_doubles(
+cv_convert_packed_ints(
     const cv_converter*	converter,
-    const double* const	in,
+    const int* const	in,
     const size_t	count,
+    const double	scale,
+    const double	offset,
     double*		out)
 {
     if (converter == NULL || in == NULL || out == NULL) {
 	out = NULL;
     }
     else {
-    	out = converter->ops->convertDoubles(converter, in, count, out);
+	size_t	i;
+
+	UT_STATS_ADD(arrayCalls, 1);
+	UT_STATS_ADD(packedValues, count);
+
+	for (i = 0; i < count; i++)
+	    out[i] = in[i] * scale + offset;
+
+	out = converter->ops->convertDoubles(converter, out, count, out);
     }
 
     return out;
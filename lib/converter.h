@@ -119,7 +119,9 @@ cv_get_pow(
 
 /*
  * Returns a converter corresponding to the sequential application of two
- * other converters.
+ * other converters.  Affine transformations, logarithms, and exponentials in
+ * the result are algebraically simplified where possible, so converted values
+ * can differ from those of the sequential application by rounding.
  * ARGUMENTS:
  *	first	The converter to be applied first.
  *	second	The converter to be applied second.
@@ -209,6 +211,227 @@ cv_convert_doubles(
     const size_t	count,
     double*		out);
 
+/*
+ * Returns a converter that's specialized for converting many values.  Chains
+ * of operations are reduced to as few fused kernels as possible.  The result
+ * is used like any other converter.  Converted values can differ from those
+ * of the given converter by rounding.
+ * ARGUMENTS:
+ *	converter	The converter to be compiled.  May be passed to
+ *			cv_free() upon return.
+ * RETURNS:
+ *	NULL	"converter" is NULL or necessary memory couldn't be
+ *		allocated.
+ *	else	The compiled converter, which might be a clone of
+ *		"converter".  The client should pass it to cv_free() when
+ *		it's no longer needed.
+ */
+EXTERNL cv_converter*
+cv_compile(
+    cv_converter* const	converter);
+
+/*
+ * Sets the parameters of parallel conversion by cv_convert_floats_parallel()
+ * and cv_convert_doubles_parallel().  Worker threads are created when first
+ * needed and reused by subsequent conversions.
+ * ARGUMENTS:
+ *	nthreads	The number of threads to use, including the calling
+ *			thread.  If zero, then the number of online processors
+ *			is used (the default).
+ *	threshold	The number of values below which conversion is done
+ *			serially.  The default is 65536.
+ * RETURNS:
+ *	0	Success.
+ *	-1	A parallel conversion is in progress.
+ */
+EXTERNL int
+cv_set_parallelism(
+    const unsigned	nthreads,
+    const size_t	threshold);
+
+/*
+ * Converts an array of floats, dividing large arrays among multiple threads.
+ * ARGUMENTS:
+ *	converter	The converter.
+ *	in		The values to be converted.
+ *	count		The number of values to be converted.
+ *	out		The output array for the converted values.  May
+ *			be the same array as "in" or overlap it.  Arrays
+ *			that overlap but aren't the same are converted
+ *			serially.
+ * RETURNS:
+ *	NULL	"out" is NULL.
+ *	else	A pointer to the output array.
+ */
+EXTERNL float*
+cv_convert_floats_parallel(
+    const cv_converter*	converter,
+    const float* const	in,
+    const size_t	count,
+    float*		out);
+
+/*
+ * Converts an array of doubles, dividing large arrays among multiple threads.
+ * ARGUMENTS:
+ *	converter	The converter.
+ *	in		The values to be converted.
+ *	count		The number of values to be converted.
+ *	out		The output array for the converted values.  May
+ *			be the same array as "in" or overlap it.  Arrays
+ *			that overlap but aren't the same are converted
+ *			serially.
+ * RETURNS:
+ *	NULL	"out" is NULL.
+ *	else	A pointer to the output array.
+ */
+EXTERNL double*
+cv_convert_doubles_parallel(
+    const cv_converter*	converter,
+    const double* const	in,
+    const size_t	count,
+    double*		out);
+
+/*
+ * Converts a strided array of floats.  Strides are in units of array elements
+ * and may be negative.
+ * ARGUMENTS:
+ *	converter	The converter.
+ *	in		The first value to be converted.
+ *	inStride	The number of elements between successive input values.
+ *	count		The number of values to be converted.
+ *	out		The first output value.  The output values must not
+ *			overlap the input values unless "out" equals "in" and
+ *			"outStride" equals "inStride".
+ *	outStride	The number of elements between successive output
+ *			values.
+ * RETURNS:
+ *	NULL	"out" is NULL.
+ *	else	A pointer to the output array.
+ */
+EXTERNL float*
+cv_convert_floats_strided(
+    const cv_converter*	converter,
+    const float* const	in,
+    const ptrdiff_t	inStride,
+    const size_t	count,
+    float*		out,
+    const ptrdiff_t	outStride);
+
+/*
+ * Converts a strided array of doubles.  Strides are in units of array elements
+ * and may be negative.
+ * ARGUMENTS:
+ *	converter	The converter.
+ *	in		The first value to be converted.
+ *	inStride	The number of elements between successive input values.
+ *	count		The number of values to be converted.
+ *	out		The first output value.  The output values must not
+ *			overlap the input values unless "out" equals "in" and
+ *			"outStride" equals "inStride".
+ *	outStride	The number of elements between successive output
+ *			values.
+ * RETURNS:
+ *	NULL	"out" is NULL.
+ *	else	A pointer to the output array.
+ */
+EXTERNL double*
+cv_convert_doubles_strided(
+    const cv_converter*	converter,
+    const double* const	in,
+    const ptrdiff_t	inStride,
+    const size_t	count,
+    double*		out,
+    const ptrdiff_t	outStride);
+
+/*
+ * Converts an array of floats into an array of doubles.
+ * ARGUMENTS:
+ *	converter	The converter.
+ *	in		The values to be converted.
+ *	count		The number of values to be converted.
+ *	out		The output array for the converted values.  Must not
+ *			overlap "in".
+ * RETURNS:
+ *	NULL	"out" is NULL.
+ *	else	A pointer to the output array.
+ */
+EXTERNL double*
+cv_convert_floats_to_doubles(
+    const cv_converter*	converter,
+    const float* const	in,
+    const size_t	count,
+    double*		out);
+
+/*
+ * Converts an array of doubles into an array of floats.
+ * The conversion is done in double precision.
+ * ARGUMENTS:
+ *	converter	The converter.
+ *	in		The values to be converted.
+ *	count		The number of values to be converted.
+ *	out		The output array for the converted values.  Must not
+ *			overlap "in".
+ * RETURNS:
+ *	NULL	"out" is NULL.
+ *	else	A pointer to the output array.
+ */
+EXTERNL float*
+cv_convert_doubles_to_floats(
+    const cv_converter*	converter,
+    const double* const	in,
+    const size_t	count,
+    float*		out);
+
+/*
+ * Unpacks and converts an array of short integers into an array of doubles.  Each
+ * input value, "x", is unpacked as "x*scale + offset" before conversion (cf.
+ * the netCDF "scale_factor" and "add_offset" attributes).
+ * ARGUMENTS:
+ *	converter	The converter.
+ *	in		The packed values to be converted.
+ *	count		The number of values to be converted.
+ *	scale		The factor by which to multiply the packed values.
+ *	offset		The number to add to the scaled values.
+ *	out		The output array for the converted values.  Must not
+ *			overlap "in".
+ * RETURNS:
+ *	NULL	"out" is NULL.
+ *	else	A pointer to the output array.
+ */
+EXTERNL double*
+cv_convert_packed_shorts(
+    const cv_converter*	converter,
+    const short* const	in,
+    const size_t	count,
+    const double	scale,
+    const double	offset,
+    double*		out);
+
+/*
+ * Unpacks and converts an array of integers into an array of doubles.  Each
+ * input value, "x", is unpacked as "x*scale + offset" before conversion (cf.
+ * the netCDF "scale_factor" and "add_offset" attributes).
+ * ARGUMENTS:
+ *	converter	The converter.
+ *	in		The packed values to be converted.
+ *	count		The number of values to be converted.
+ *	scale		The factor by which to multiply the packed values.
+ *	offset		The number to add to the scaled values.
+ *	out		The output array for the converted values.  Must not
+ *			overlap "in".
+ * RETURNS:
+ *	NULL	"out" is NULL.
+ *	else	A pointer to the output array.
+ */
+EXTERNL double*
+cv_convert_packed_ints(
+    const cv_converter*	converter,
+    const int* const	in,
+    const size_t	count,
+    const double	scale,
+    const double	offset,
+    double*		out);
+
 /*
  * Returns a string representation of a converter.
  * ARGUMENTS:
@@ -228,6 +451,54 @@ cv_get_expression(
     size_t			max,
     const char* const		variable);
 
+/*
+ * The following are used only within the library.
+ */
+
+/*
+ * Returns a reference-counted converter.  Each call to cv_free() on the
+ * returned converter releases one reference.
+ *
+ * Arguments:
+ *	conv	Pointer to the converter.  If it's already reference-counted,
+ *		then another reference to it is returned; otherwise,
+ *		ownership of "conv" is transferred to the returned converter
+ *		on success.
+ * Returns:
+ *	NULL	Necessary memory couldn't be allocated.  "conv" is unchanged.
+ *	else	Pointer to the reference-counted converter.
+ */
+cv_converter*
+cvGetShared(
+    cv_converter* const	conv);
+
+/*
+ * Makes a converter reference-counted if it isn't already.
+ *
+ * Arguments:
+ *	conv	Address of the pointer to the converter.  On success, "*conv"
+ *		is the reference-counted converter.
+ * Returns:
+ *	0	Success.
+ *	-1	Necessary memory couldn't be allocated.  "*conv" is unchanged.
+ */
+int
+cvMakeShared(
+    cv_converter** const	conv);
+
+/*
+ * Returns another reference to a converter if it's reference-counted.
+ *
+ * Arguments:
+ *	conv	Pointer to the converter or NULL.
+ * Returns:
+ *	NULL	"conv" is NULL or isn't reference-counted.
+ *	else	Another reference to "conv".  Should be passed to cv_free().
+ */
+cv_converter*
+cvGetReference(
+    const cv_converter* const	conv);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,494 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Per-unit-system cache of converters between units.
+ *
+ * The cache maps a (from, to) pair of units to the converter returned by
+ * ut_get_converter().  Units are compared with ut_compare(), so structurally
+ * identical units share an entry.  Cached converters are reference-counted:
+ * every call to ut_get_converter() returns a new reference and cv_free()
+ * releases one.  The cache is bounded: when it's full, the least-recently used
+ * entry is evicted.  It's disabled (i.e., has a capacity of zero) by default.
+ *
+ * Lookups and insertions are serialized by a mutex and the reference-counts
+ * are atomic, so threads may get converters concurrently in the same
+ * unit-system.  Changing the capacity of a cache must not be concurrent with
+ * other use of its unit-system.
+ */
+
+/*LINTLIBRARY*/
+
+#include "config.h"
+
+#include "arena.h"
+#include "converterCache.h"
+#include "udunits2.h"
+#include "systemMap.h"
+#include "threadSupport.h"
+
+#ifdef _MSC_VER
+#include "tsearch.h"
+#else
+#include <search.h>
+#endif
+#include <stdlib.h>
+
+typedef struct CacheEntry {
+    struct CacheEntry*	newer;		/* more recently used entry */
+    struct CacheEntry*	older;		/* less recently used entry */
+    ut_unit*		from;		/* unit from which to convert */
+    ut_unit*		to;		/* unit to which to convert */
+    cv_converter*	converter;	/* reference-counted converter */
+} CacheEntry;
+
+typedef struct {
+    void*		tree;		/* entries ordered by units */
+    CacheEntry*		newest;		/* most recently used entry */
+    CacheEntry*		oldest;		/* least recently used entry */
+    size_t		count;		/* number of entries */
+    size_t		capacity;	/* maximum number of entries */
+    unsigned long	hits;		/* number of successful lookups */
+    unsigned long	misses;		/* number of unsuccessful lookups */
+} ConverterCache;
+
+static SystemMap*	systemToConverterCache = NULL;
+static UtMutex		cacheMutex = UT_MUTEX_INITIALIZER;
+
+
+static int
+compareEntries(
+    const void* const	node1,
+    const void* const	node2)
+{
+    const CacheEntry* const	entry1 = (const CacheEntry*)node1;
+    const CacheEntry* const	entry2 = (const CacheEntry*)node2;
+    int				cmp = ut_compare(entry1->from, entry2->from);
+
+    return cmp != 0
+	? cmp
+	: ut_compare(entry1->to, entry2->to);
+}
+
+
+static void
+ceFree(
+    CacheEntry* const	entry)
+{
+    if (entry != NULL) {
+	cv_free(entry->converter);
+	ut_free(entry->from);
+	ut_free(entry->to);
+	free(entry);
+    }
+}
+
+
+/*
+ * Removes an entry from the recently-used list of a converter-cache.
+ */
+static void
+ccUnlink(
+    ConverterCache* const	cache,
+    CacheEntry* const		entry)
+{
+    if (entry->newer == NULL) {
+	cache->newest = entry->older;
+    }
+    else {
+	entry->newer->older = entry->older;
+    }
+
+    if (entry->older == NULL) {
+	cache->oldest = entry->newer;
+    }
+    else {
+	entry->older->newer = entry->newer;
+    }
+
+    entry->newer = entry->older = NULL;
+}
+
+
+/*
+ * Makes an entry the most recently used one of a converter-cache.
+ */
+static void
+ccPushNewest(
+    ConverterCache* const	cache,
+    CacheEntry* const		entry)
+{
+    entry->older = cache->newest;
+    entry->newer = NULL;
+
+    if (cache->newest == NULL) {
+	cache->oldest = entry;
+    }
+    else {
+	cache->newest->newer = entry;
+    }
+
+    cache->newest = entry;
+}
+
+
+/*
+ * Removes and frees the least recently used entry of a converter-cache.
+ *
+ * Arguments:
+ *	cache	Pointer to the converter-cache.
+ * Returns:
+ *	0	The cache is empty or its least recently used entry isn't in
+ *		its tree.  The entry is kept so that the tree can't refer to
+ *		freed memory.
+ *	1	Success.
+ */
+static int
+ccEvictOldest(
+    ConverterCache* const	cache)
+{
+    CacheEntry* const	entry = cache->oldest;
+    int			evicted = 0;
+
+    if (entry != NULL && tdelete(entry, &cache->tree, compareEntries) != NULL) {
+	ccUnlink(cache, entry);
+	ceFree(entry);
+	cache->count--;
+	evicted = 1;
+    }
+
+    return evicted;
+}
+
+
+/*
+ * Removes all entries from a converter-cache.
+ */
+static void
+ccClear(
+    ConverterCache* const	cache)
+{
+    while (cache->oldest != NULL) {
+	if (!ccEvictOldest(cache)) {
+	    CacheEntry* const	entry = cache->oldest;
+
+	    /*
+	     * The tree is inconsistent with its comparison function.  Its
+	     * nodes are abandoned rather than left referring to freed entries.
+	     */
+	    cache->tree = NULL;
+
+	    ccUnlink(cache, entry);
+	    ceFree(entry);
+	    cache->count--;
+	}
+    }
+}
+
+
+/*
+ * Returns the converter-cache of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	NULL		"system" doesn't have a converter-cache or the cache is
+ *			disabled.
+ *	else		Pointer to the enabled converter-cache of "system".
+ */
+static ConverterCache*
+getEnabledCache(
+    const ut_system* const	system)
+{
+    ConverterCache*	cache = NULL;
+
+    if (systemToConverterCache != NULL) {
+	ConverterCache** const	entry =
+	    (ConverterCache**)smFind(systemToConverterCache, system);
+
+	if (entry != NULL && *entry != NULL && (*entry)->capacity > 0)
+	    cache = *entry;
+    }
+
+    return cache;
+}
+
+
+cv_converter*
+ccFind(
+    const ut_unit* const	from,
+    const ut_unit* const	to)
+{
+    cv_converter*		converter = NULL;
+    ConverterCache* const	cache = getEnabledCache(ut_get_system(from));
+
+    if (cache != NULL) {
+	CacheEntry		target;
+	CacheEntry**		node;
+
+	target.from = (ut_unit*)from;
+	target.to = (ut_unit*)to;
+
+	UT_MUTEX_LOCK(&cacheMutex);
+
+	node = tfind(&target, &cache->tree, compareEntries);
+
+	if (node == NULL) {
+	    cache->misses++;
+	}
+	else {
+	    CacheEntry* const	entry = *node;
+
+	    cache->hits++;
+
+	    if (entry != cache->newest) {
+		ccUnlink(cache, entry);
+		ccPushNewest(cache, entry);
+	    }
+
+	    converter = cvGetShared(entry->converter);
+	}
+
+	UT_MUTEX_UNLOCK(&cacheMutex);
+    }
+
+    return converter;
+}
+
+
+cv_converter*
+ccAdd(
+    const ut_unit* const	from,
+    const ut_unit* const	to,
+    cv_converter* const		converter)
+{
+    cv_converter*		result = converter;
+    ConverterCache* const	cache = getEnabledCache(ut_get_system(from));
+
+    if (cache != NULL) {
+	cv_converter* const	shared = cvGetShared(converter);
+
+	if (shared != NULL) {
+	    CacheEntry*	entry = malloc(sizeof(CacheEntry));
+
+	    result = shared;
+
+	    if (entry != NULL) {
+		entry->from = arenaCloneToHeap(from);
+		entry->to = arenaCloneToHeap(to);
+		entry->converter = NULL;
+
+		if (entry->from == NULL || entry->to == NULL) {
+		    ceFree(entry);
+		}
+		else {
+		    CacheEntry**	node;
+
+		    UT_MUTEX_LOCK(&cacheMutex);
+
+		    node = cache->count >= cache->capacity &&
+			    !ccEvictOldest(cache)
+			? NULL
+			: tsearch(entry, &cache->tree, compareEntries);
+
+		    if (node == NULL || *node != entry) {
+			ceFree(entry);
+		    }
+		    else {
+			entry->converter = cvGetShared(shared);
+
+			ccPushNewest(cache, entry);
+			cache->count++;
+		    }
+
+		    UT_MUTEX_UNLOCK(&cacheMutex);
+		}
+	    }				/* "entry" allocated */
+	}				/* "shared" allocated */
+    }					/* cache enabled */
+
+    ut_set_status(UT_SUCCESS);
+
+    return result;
+}
+
+
+void
+ccFreeSystem(
+    ut_system*	system)
+{
+    if (system != NULL && systemToConverterCache != NULL) {
+	ConverterCache** const	cache =
+	    (ConverterCache**)smFind(systemToConverterCache, system);
+
+	if (cache != NULL && *cache != NULL) {
+	    ccClear(*cache);
+	    free(*cache);
+	}
+
+	smRemove(systemToConverterCache, system);
+    }
+}
+
+
+/*
+ * Sets the capacity of the converter-cache of a unit-system.  When the cache
+ * is enabled, ut_get_converter() returns a shared, reference-counted converter
+ * for a (from, to) pair of units that it has seen before instead of building a
+ * new one.  The cache is disabled by default.  Changing the capacity empties
+ * the cache but doesn't reset its hit and miss counters.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	capacity	Maximum number of entries in the cache.  If zero, then
+ *			the cache is disabled.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" is NULL.
+ *	UT_OS		Operating-system failure.  See "errno".
+ */
+ut_status
+ut_set_converter_cache_capacity(
+    ut_system* const	system,
+    const size_t	capacity)
+{
+    ut_set_status(UT_SUCCESS);
+
+    if (system == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message(
+	    "ut_set_converter_cache_capacity(): NULL unit-system argument");
+    }
+    else {
+	if (systemToConverterCache == NULL) {
+	    systemToConverterCache = smNew();
+
+	    if (systemToConverterCache == NULL)
+		ut_set_status(UT_OS);
+	}
+
+	if (systemToConverterCache != NULL) {
+	    ConverterCache** const	entry =
+		(ConverterCache**)smSearch(systemToConverterCache, system);
+
+	    if (entry == NULL) {
+		ut_set_status(UT_OS);
+	    }
+	    else {
+		if (*entry == NULL) {
+		    *entry = calloc(1, sizeof(ConverterCache));
+
+		    if (*entry == NULL)
+			ut_set_status(UT_OS);
+		}
+
+		if (*entry != NULL) {
+		    ccClear(*entry);
+		    (*entry)->capacity = capacity;
+		}
+	    }				/* have system-map entry */
+	}				/* have system-map */
+    }					/* valid arguments */
+
+    return ut_get_status();
+}
+
+
+/*
+ * Removes all entries from the converter-cache of a unit-system and resets its
+ * hit and miss counters.  The cache remains enabled if it was.  Converters
+ * previously returned by ut_get_converter() remain valid until passed to
+ * cv_free().
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" is NULL.
+ */
+ut_status
+ut_flush_converter_cache(
+    ut_system* const	system)
+{
+    ut_set_status(UT_SUCCESS);
+
+    if (system == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message(
+	    "ut_flush_converter_cache(): NULL unit-system argument");
+    }
+    else if (systemToConverterCache != NULL) {
+	ConverterCache** const	cache =
+	    (ConverterCache**)smFind(systemToConverterCache, system);
+
+	if (cache != NULL && *cache != NULL) {
+	    UT_MUTEX_LOCK(&cacheMutex);
+	    ccClear(*cache);
+	    (*cache)->hits = 0;
+	    (*cache)->misses = 0;
+	    UT_MUTEX_UNLOCK(&cacheMutex);
+	}
+    }
+
+    return ut_get_status();
+}
+
+
+/*
+ * Returns statistics on the converter-cache of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	count		NULL or pointer to the number of entries in the cache.
+ *	hits		NULL or pointer to the number of times
+ *			ut_get_converter() found its units in the cache.
+ *	misses		NULL or pointer to the number of times
+ *			ut_get_converter() didn't find its units in the enabled
+ *			cache.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" is NULL.
+ */
+ut_status
+ut_get_converter_cache_stats(
+    const ut_system* const	system,
+    size_t* const		count,
+    unsigned long* const	hits,
+    unsigned long* const	misses)
+{
+    ut_set_status(UT_SUCCESS);
+
+    if (system == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message(
+	    "ut_get_converter_cache_stats(): NULL unit-system argument");
+    }
+    else {
+	const ConverterCache*	cache = NULL;
+
+	if (systemToConverterCache != NULL) {
+	    ConverterCache** const	entry =
+		(ConverterCache**)smFind(systemToConverterCache, system);
+
+	    if (entry != NULL)
+		cache = *entry;
+	}
+
+	UT_MUTEX_LOCK(&cacheMutex);
+
+	if (count != NULL)
+	    *count = cache == NULL ? 0 : cache->count;
+	if (hits != NULL)
+	    *hits = cache == NULL ? 0 : cache->hits;
+	if (misses != NULL)
+	    *misses = cache == NULL ? 0 : cache->misses;
+
+	UT_MUTEX_UNLOCK(&cacheMutex);
+    }
+
+    return ut_get_status();
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+#ifndef UT_CONVERTER_CACHE_H_INCLUDED
+#define UT_CONVERTER_CACHE_H_INCLUDED
+
+#include "udunits2.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Returns the cached converter between two units of the same unit-system.
+ *
+ * Arguments:
+ *	from		Pointer to the unit from which to convert values.
+ *	to		Pointer to the unit to which to convert values.
+ * Returns:
+ *	NULL		The converter-cache of the unit-system is disabled or
+ *			doesn't contain a converter for the units.
+ *	else		Pointer to a new reference to the cached converter.
+ *			The client should pass it to cv_free() when it's no
+ *			longer needed.
+ */
+cv_converter*
+ccFind(
+    const ut_unit* const	from,
+    const ut_unit* const	to);
+
+
+/*
+ * Adds a converter between two units of the same unit-system to the
+ * converter-cache of the unit-system.  The least-recently used entry is
+ * evicted if the cache is full.
+ *
+ * Arguments:
+ *	from		Pointer to the unit from which to convert values.  May
+ *			be freed upon return.
+ *	to		Pointer to the unit to which to convert values.  May be
+ *			freed upon return.
+ *	converter	Pointer to the converter from "from" to "to".
+ *			Ownership is transferred to this function.
+ * Returns:
+ *	Pointer to the converter to be returned to the client, which should
+ *	pass it to cv_free() when it's no longer needed.  If the cache is
+ *	disabled, then this is "converter".
+ */
+cv_converter*
+ccAdd(
+    const ut_unit* const	from,
+    const ut_unit* const	to,
+    cv_converter* const		converter);
+
+
+/*
+ * Frees resources associated with a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system to have its associated
+ *			resources freed.
+ */
+void
+ccFreeSystem(
+    ut_system*	system);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -6,14 +6,15 @@
  * redistribution conditions.
  */
 /*
- * This module is thread-compatible but not thread-safe.  Multi-threaded
- * access must be externally synchronized.
+ * Error-message handling.  A thread may override the process-wide
+ * error-message handler with its own.
  */
 
 /*LINTLIBRARY*/
 
 #include "config.h"
 
+#include "threadSupport.h"
 #include "udunits2.h"
 
 #include <stdarg.h>
@@ -63,12 +64,27 @@ ut_ignore(
 }
 
 
-static ut_error_message_handler	errorMessageHandler = ut_write_to_stderr;
+static ut_error_message_handler	processHandler = ut_write_to_stderr;
+static UT_THREAD_LOCAL ut_error_message_handler	threadHandler = NULL;
+
+
+/*
+ * Returns the error-message handler of the current thread.
+ */
+static ut_error_message_handler
+getHandler(void)
+{
+    return threadHandler != NULL
+	? threadHandler
+	: processHandler;
+}
 
 
 /*
  * Returns the previously-installed error-message handler and optionally
- * installs a new handler.  The initial handler is "ut_write_to_stderr()".
+ * installs a new handler.  The handler is used by every thread that hasn't
+ * overridden it via ut_set_thread_error_message_handler().  The initial handler
+ * is "ut_write_to_stderr()".
  *
  * Arguments:
  *      handler		NULL or pointer to the error-message handler.  If NULL,
@@ -81,10 +97,36 @@ ut_error_message_handler
 ut_set_error_message_handler(
     ut_error_message_handler	handler)
 {
-    ut_error_message_handler	prev = errorMessageHandler;
+    ut_error_message_handler	prev = processHandler;
 
     if (handler != NULL)
-	errorMessageHandler = handler;
+	processHandler = handler;
+
+    return prev;
+}
+
+
+/*
+ * Returns the previous error-message handler of the current thread and
+ * installs a new one.  The handler of a thread overrides the one installed by
+ * ut_set_error_message_handler() for that thread only.
+ *
+ * Arguments:
+ *      handler		NULL or pointer to the error-message handler of the
+ *			current thread.  If NULL, then the current thread uses
+ *			the handler installed by ut_set_error_message_handler().
+ * Returns:
+ *	NULL		The current thread didn't have its own handler.
+ *	else		Pointer to the previous error-message handler of the
+ *			current thread.
+ */
+ut_error_message_handler
+ut_set_thread_error_message_handler(
+    ut_error_message_handler	handler)
+{
+    ut_error_message_handler	prev = threadHandler;
+
+    threadHandler = handler;
 
     return prev;
 }
@@ -111,7 +153,7 @@ ut_handle_error_message(
 
     va_start(args, fmt);
 
-    nbytes = errorMessageHandler(fmt, args);
+    nbytes = getHandler()(fmt, args);
 
     va_end(args);
 
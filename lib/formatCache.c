@@ -0,0 +1,171 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Per-unit cache of the strings returned by ut_format().
+ *
+ * A unit has one slot for every combination of encoding, names-or-symbols, and
+ * definition-or-not.  Because the formatted string of a unit depends on the
+ * identifiers of other units, every slot records the generation of the cache
+ * when it was filled and every change to a unit-to-identifier mapping
+ * increments the generation, which invalidates all slots at once.  Units in
+ * the arena of the current thread aren't cached because they're transient.
+ *
+ * Access is serialized by a mutex, so threads may format units concurrently.
+ */
+
+/*LINTLIBRARY*/
+
+#include "config.h"
+
+#include "arena.h"
+#include "formatCache.h"
+#include "threadSupport.h"
+#include "udunits2.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Number of slots per unit: 3 encodings x names-or-symbols x
+ * definition-or-not.
+ */
+#define FC_SLOT_COUNT	12
+
+typedef struct {
+    unsigned long	generation;	/* 0 => empty */
+    char*		string;
+    int			nchar;
+} Slot;
+
+typedef struct {
+    Slot		slots[FC_SLOT_COUNT];
+} FormatCache;
+
+static UtMutex		cacheMutex = UT_MUTEX_INITIALIZER;
+static unsigned long	generation = 1;
+
+
+/*
+ * Returns the index of the slot for formatting options.
+ *
+ * Arguments:
+ *	opts		The formatting options.  See ut_format().
+ */
+static int
+slotIndex(
+    const unsigned	opts)
+{
+    return (int)(opts & (UT_LATIN1 | UT_UTF8)) * 4 +
+	((opts & UT_NAMES) ? 2 : 0) + ((opts & UT_DEFINITION) ? 1 : 0);
+}
+
+
+int
+fcFind(
+    const ut_unit* const	unit,
+    const unsigned		opts,
+    char*			buf,
+    const size_t		size,
+    unsigned long* const	gen)
+{
+    int			nchar = -1;
+    const FormatCache*	cache;
+
+    UT_MUTEX_LOCK(&cacheMutex);
+
+    *gen = generation;
+    cache = *coreGetFormatCache(unit);
+
+    if (cache != NULL) {
+	const Slot* const	slot = cache->slots + slotIndex(opts);
+
+	if (slot->generation == generation) {
+	    nchar = slot->nchar;
+
+	    if (size > 0) {
+		const size_t	n =
+		    (size_t)nchar < size ? (size_t)nchar : size - 1;
+
+		(void)memcpy(buf, slot->string, n);
+		buf[n] = 0;
+	    }
+	}
+    }
+
+    UT_MUTEX_UNLOCK(&cacheMutex);
+
+    return nchar;
+}
+
+
+void
+fcAdd(
+    const ut_unit* const	unit,
+    const unsigned		opts,
+    const unsigned long		gen,
+    const char* const		string,
+    const int			nchar)
+{
+    if (nchar >= 0 && !arenaContains(unit)) {
+	char* const	copy = malloc((size_t)nchar + 1);
+
+	if (copy != NULL) {
+	    void** const	cachePtr = coreGetFormatCache(unit);
+
+	    (void)memcpy(copy, string, (size_t)nchar);
+	    copy[nchar] = 0;
+
+	    UT_MUTEX_LOCK(&cacheMutex);
+
+	    if (*cachePtr == NULL)
+		*cachePtr = calloc(1, sizeof(FormatCache));
+
+	    if (*cachePtr != NULL) {
+		Slot* const	slot =
+		    ((FormatCache*)*cachePtr)->slots + slotIndex(opts);
+		char* const	old = slot->string;
+
+		slot->string = copy;
+		slot->nchar = nchar;
+		slot->generation = gen;
+
+		UT_MUTEX_UNLOCK(&cacheMutex);
+		free(old);
+	    }
+	    else {
+		UT_MUTEX_UNLOCK(&cacheMutex);
+		free(copy);
+	    }
+	}
+    }
+}
+
+
+void
+fcInvalidate(void)
+{
+    UT_MUTEX_LOCK(&cacheMutex);
+    generation++;
+    UT_MUTEX_UNLOCK(&cacheMutex);
+}
+
+
+void
+fcFree(
+    void* const		cache)
+{
+    if (cache != NULL) {
+	FormatCache* const	formatCache = cache;
+	int			i;
+
+	for (i = 0; i < FC_SLOT_COUNT; i++)
+	    free(formatCache->slots[i].string);
+
+	free(formatCache);
+    }
+}
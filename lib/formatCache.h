@@ -0,0 +1,108 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Per-unit cache of the strings returned by ut_format().
+ */
+#ifndef UT_FORMAT_CACHE_H_INCLUDED
+#define UT_FORMAT_CACHE_H_INCLUDED
+
+#include <stddef.h>
+
+#include "udunits2.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Copies the cached formatted string of a unit into a buffer.
+ *
+ * Arguments:
+ *	unit		Pointer to the unit.
+ *	opts		The formatting options.  See ut_format().
+ *	buf		Pointer to the buffer.
+ *	size		The size of "buf" in bytes.
+ *	generation	Pointer to the current generation of the cache.  Set
+ *			even if the string isn't cached; it's to be passed to
+ *			fcAdd() after "unit" is formatted.
+ * Returns:
+ *	-1		The string isn't cached.
+ *	else		The number of bytes of the string excluding the
+ *			terminating NUL.  As much of the string as fits is
+ *			copied into "buf" and NUL-terminated, like
+ *			snprintf().
+ */
+int
+fcFind(
+    const ut_unit* const	unit,
+    const unsigned		opts,
+    char*			buf,
+    const size_t		size,
+    unsigned long* const	generation);
+
+
+/*
+ * Adds the formatted string of a unit to the cache of the unit.  Does nothing
+ * if the unit or string can't be cached.
+ *
+ * Arguments:
+ *	unit		Pointer to the unit.
+ *	opts		The formatting options.  See ut_format().
+ *	generation	The generation returned by fcFind() before "unit" was
+ *			formatted.
+ *	string		Pointer to the formatted string.
+ *	nchar		The number of bytes in "string" excluding the
+ *			terminating NUL.
+ */
+void
+fcAdd(
+    const ut_unit* const	unit,
+    const unsigned		opts,
+    const unsigned long		generation,
+    const char* const		string,
+    const int			nchar);
+
+
+/*
+ * Invalidates the cached strings of all units.  Called whenever a
+ * unit-to-identifier mapping changes.
+ */
+void
+fcInvalidate(void);
+
+
+/*
+ * Frees a cache that's the format-cache of a unit.
+ *
+ * Arguments:
+ *	cache		Pointer to the cache or NULL.
+ */
+void
+fcFree(
+    void* const		cache);
+
+
+/*
+ * Returns the address of the format-cache of a unit.  Implemented by the
+ * unit module.
+ *
+ * Arguments:
+ *	unit		Pointer to the unit.
+ */
+void**
+coreGetFormatCache(
+    const ut_unit* const	unit);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
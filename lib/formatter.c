@@ -12,6 +12,7 @@
 
 #include "config.h"
 
+#include "formatCache.h"
 #include "udunits2.h"
 #include "unitToIdMap.h"
 
@@ -52,6 +53,120 @@ typedef struct {
 #define RETURNS_NAME(getId)	((getId) == getName)
 #define SUBTRACT_SIZET(a, b)    ((a) > (b) ? (a) - (b) : 0)
 
+/*
+ * Magnitude below which "%.*g" with DBL_DIG prints an integral value as an
+ * integer.
+ */
+#define INTEGRAL_LIMIT		1e15
+
+/*
+ * Prints a string.  Equivalent to snprintf(buf, size, "%s", string) but
+ * faster.
+ *
+ * Arguments:
+ *	buf		The buffer into which to print "string".
+ *	size		The size of "buf".
+ *	string		The string to be printed.
+ * Returns:
+ *	The number of bytes that would be printed if "size" were sufficiently
+ *	large excluding the terminating NUL.
+ */
+static int
+printString(
+    char* const		buf,
+    const size_t	size,
+    const char* const	string)
+{
+    const size_t	len = strlen(string);
+
+    if (size > 0) {
+	const size_t	n = len < size ? len : size - 1;
+
+	(void)memcpy(buf, string, n);
+	buf[n] = 0;
+    }
+
+    return (int)len;
+}
+
+
+/*
+ * Returns the decimal representation of an integer.
+ *
+ * Arguments:
+ *	value		The integer.
+ *	end		Pointer to the end of a buffer that's large enough for
+ *			the representation, which is written just before it.
+ * Returns:
+ *	Pointer to the beginning of the representation.
+ */
+static char*
+integerString(
+    const long long	value,
+    char*		end)
+{
+    unsigned long long	magnitude = value < 0
+	? 0ULL - (unsigned long long)value
+	: (unsigned long long)value;
+
+    do {
+	*--end = (char)('0' + magnitude % 10);
+	magnitude /= 10;
+    } while (magnitude != 0);
+
+    if (value < 0)
+	*--end = '-';
+
+    return end;
+}
+
+
+/*
+ * Prints a number between two strings.  Equivalent to snprintf(buf, size,
+ * "%s%.*g%s", before, DBL_DIG, value, after) but doesn't use snprintf() for
+ * integral values (e.g., exponents and most scale factors and offsets).
+ *
+ * Arguments:
+ *	buf		The buffer into which to print.
+ *	size		The size of "buf".
+ *	before		The string to print before the number.
+ *	value		The number.
+ *	after		The string to print after the number.
+ * Returns:
+ *	-1		Failure.
+ *	else		The number of bytes that would be printed if "size"
+ *			were sufficiently large excluding the terminating NUL.
+ */
+static int
+printNumber(
+    char* const		buf,
+    const size_t	size,
+    const char* const	before,
+    const double	value,
+    const char* const	after)
+{
+    int		nchar;
+
+    if (value == floor(value) && fabs(value) < INTEGRAL_LIMIT &&
+	    (value != 0 || !signbit(value))) {
+	char		digits[32];
+	char* const	end = digits + sizeof(digits) - 1;
+	const char*	number;
+	size_t		n;
+
+	*end = 0;
+	number = integerString((long long)value, end);
+	n = printString(buf, size, before);
+	n += printString(buf + n, SUBTRACT_SIZET(size, n), number);
+	nchar = (int)(n + printString(buf + n, SUBTRACT_SIZET(size, n), after));
+    }
+    else {
+	nchar = snprintf(buf, size, "%s%.*g%s", before, DBL_DIG, value, after);
+    }
+
+    return nchar;
+}
+
 static int
 asciiPrintProduct(
     const ut_unit* const* const	basicUnits,
@@ -229,7 +344,7 @@ printBasic(
     return
 	id == NULL
 	    ? -1
-	    : snprintf(buf, size, "%s", id);
+	    : printString(buf, size, id);
 }
 
 
@@ -292,7 +407,7 @@ asciiPrintProduct(
     size_t		        size,
     IdGetter			getId)
 {
-    int		nchar = snprintf(buf, size, "%s", "");
+    int		nchar = printString(buf, size, "");
 
     if (nchar >= 0) {
         int	i;
@@ -307,8 +422,8 @@ asciiPrintProduct(
              */
             if (nchar > 0) {
                 n = RETURNS_NAME(getId)
-                    ? snprintf(buf+nchar, size, "%s", "-")
-                    : snprintf(buf+nchar, size, "%s", ".");
+                    ? printString(buf+nchar, size, "-")
+                    : printString(buf+nchar, size, ".");
 
                 if (n < 0) {
                     nchar = n;
@@ -336,9 +451,8 @@ asciiPrintProduct(
              * Append exponent if appropriate.
              */
             if (powers[i] != 1) {
-                n = RETURNS_NAME(getId)
-                    ? snprintf(buf+nchar, size, "^%d", powers[i])
-                    : snprintf(buf+nchar, size, "%d", powers[i]);
+                n = printNumber(buf+nchar, size,
+                    RETURNS_NAME(getId) ? "^" : "", powers[i], "");
 
                 if (n < 0) {
                     nchar = n;
@@ -382,7 +496,7 @@ utf8PrintProduct(
     size_t		        size,
     IdGetter			getId)
 {
-    int		nchar = snprintf(buf, size, "%s", "");
+    int		nchar = printString(buf, size, "");
 
     if (nchar >= 0) {
         int	iBasic;
@@ -402,7 +516,7 @@ utf8PrintProduct(
                     /*
                      * Append mid-dot separator.
                      */
-                    n = snprintf(buf+nchar, size, "%s", "\xc2\xb7");
+                    n = printString(buf+nchar, size, "\xc2\xb7");
 
                     if (n < 0) {
                         nchar = n;
@@ -448,7 +562,7 @@ utf8PrintProduct(
                         /*
                          * Append superscript minus sign.
                          */
-                        n = snprintf(buf+nchar, size, "%s", "\xe2\x81\xbb");
+                        n = printString(buf+nchar, size, "\xe2\x81\xbb");
 
                         if (n < 0) {
                             nchar = n;
@@ -464,36 +578,27 @@ utf8PrintProduct(
                      * Append UTF-8 encoding of exponent magnitude.
                      */
                     {
-                        static int*	digit = NULL;
+                        /* log10(2) < 1/3 */
+                        int	digit[sizeof(powers[0])*CHAR_BIT/3 + 1];
+                        int	idig = 0;
 
-                        digit = realloc(digit, (size_t)((sizeof(powers[0])*
-                                        CHAR_BIT*(M_LOG10E/M_LOG2E)) + 1));
+                        for (; power > 0; power /= 10)
+                            digit[idig++] = power % 10;
 
-                        if (digit == NULL) {
-                            nchar = -1;
-                        }
-                        else {
-                            int	idig = 0;
-
-                            for (; power > 0; power /= 10)
-                                digit[idig++] = power % 10;
-
-                            while (idig-- > 0) {
-                                n = snprintf(buf+nchar, size, "%s",
-                                        exponentStrings[digit[idig]]);
-
-                                if (n < 0) {
-                                    nchar = n;
-                                    break;
-                                }
+                        while (idig-- > 0) {
+                            n = printString(buf+nchar, size, exponentStrings[digit[idig]]);
 
-                                nchar += n;
-                                size = SUBTRACT_SIZET(size, n);
+                            if (n < 0) {
+                                nchar = n;
+                                break;
                             }
 
-                            if (nchar < 0)
-                                break;
+                            nchar += n;
+                            size = SUBTRACT_SIZET(size, n);
                         }
+
+                        if (nchar < 0)
+                            break;
                     }		/* exponent digits block */
                 }		/* must print exponent */
             }			/* must print basic-unit */
@@ -504,18 +609,6 @@ utf8PrintProduct(
 }
 
 
-static const int*	globalPowers = NULL;
-
-
-static int
-compareExponents(
-    const void*	i,
-    const void*	j)
-{
-    return globalPowers[*(const int*)j] - globalPowers[*(const int*)i];
-}
-
-
 /*
  * Returns the order of basic-unit powers in decreasing order.
  *
@@ -557,9 +650,20 @@ getBasicOrder(
 
     *negativeCount = nNeg;
     *positiveCount = nPos;
-    globalPowers = powers;
 
-    qsort(order, n, sizeof(int), compareExponents);
+    /*
+     * Stable insertion sort.  The number of basic-units is small and, unlike
+     * qsort(3), this doesn't need global state for the comparison.
+     */
+    for (i = 1; i < n; i++) {
+	const int	index = order[i];
+	int		j;
+
+	for (j = i; j > 0 && powers[order[j-1]] < powers[index]; j--)
+	    order[j] = order[j-1];
+
+	order[j] = index;
+    }
 }
 
 
@@ -605,7 +709,7 @@ latin1PrintBasics(
 
 	if (power != 0) {
 	    if (needSeparator) {
-		n = snprintf(buf+nchar, size, "%s", "\xb7");	/* raised dot */
+		n = printString(buf+nchar, size, "\xb7");	/* raised dot */
 
 		if (n < 0) {
 		    nchar = n;
@@ -634,8 +738,7 @@ latin1PrintBasics(
              * Append exponent if appropriate.
              */
             if (power != 1) {
-                n = snprintf(buf+nchar, size, "%s",
-                    power == 2 ? "\xb2" : "\xb3");	/* superscript 2, superscript 3 */
+                n = printString(buf+nchar, size, power == 2 ? "\xb2" : "\xb3");	/* superscript 2, superscript 3 */
 
                 if (n < 0) {
                     nchar = n;
@@ -704,7 +807,7 @@ latin1PrintProduct(
 	else {
 	    getBasicOrder(powers, count, order, &positiveCount, &negativeCount);
 
-            nchar = snprintf(buf, size, "%s", "");
+            nchar = printString(buf, size, "");
 
             if (nchar >= 0 && (positiveCount + negativeCount > 0)) {
                 int		n;
@@ -712,7 +815,7 @@ latin1PrintProduct(
                 size = SUBTRACT_SIZET(size, nchar);
 
                 if (positiveCount == 0) {
-                    n = snprintf(buf+nchar, size, "%s", "1");
+                    n = printString(buf+nchar, size, "1");
                     if (0 > n) {
                         nchar = n;
                     }
@@ -734,8 +837,7 @@ latin1PrintProduct(
                 }
 
                 if (nchar >= 0 && negativeCount > 0) {
-                    n = snprintf(buf+nchar, size, "%s",
-                        negativeCount == 1 ? "/" : "/(");
+                    n = printString(buf+nchar, size, negativeCount == 1 ? "/" : "/(");
                     if (0 > n) {
                         nchar = n;
                     }
@@ -754,7 +856,7 @@ latin1PrintProduct(
                             size = SUBTRACT_SIZET(size, n);
 
                             if (negativeCount > 1) {
-                                n = snprintf(buf+nchar, size, "%s", ")");
+                                n = printString(buf+nchar, size, ")");
                                 if (0 > n) {
                                     nchar = n;
                                 }
@@ -825,7 +927,7 @@ formatProduct(
                 id == NULL
                     ? formatPar->printProduct(basicUnits, powers, count,
                         formatPar->buf, formatPar->size, formatPar->getId)
-                    : snprintf(formatPar->buf, formatPar->size, "%s", id);
+                    : printString(formatPar->buf, formatPar->size, id);
 	}
     }
     formatPar->nchar = nchar < 0 ? nchar : formatPar->nchar + nchar;
@@ -878,8 +980,7 @@ printGalilean(
 
     if (scale != 1) {
         needParens = addParens;
-        n = snprintf(buf, size, needParens ? "(%.*g " : "%.*g ", DBL_DIG,
-                scale);
+        n = printNumber(buf, size, needParens ? "(" : "", scale, " ");
         if (0 > n) {
             nchar = n;
         }
@@ -902,10 +1003,8 @@ printGalilean(
 
             if (offset != 0) {
                 needParens = addParens;
-                n = RETURNS_NAME(getId)
-                    ? snprintf(buf+nchar, size, " from %.*g", DBL_DIG,
-                            offset)
-                    : snprintf(buf+nchar, size, " @ %.*g", DBL_DIG, offset);
+                n = printNumber(buf+nchar, size,
+                    RETURNS_NAME(getId) ? " from " : " @ ", offset, "");
                 if (0 > n) {
                     nchar = n;
                 }
@@ -917,7 +1016,7 @@ printGalilean(
 
             if (nchar >= 0) {
                 if (needParens) {
-                    n = snprintf(buf+nchar, size, "%s", ")");
+                    n = printString(buf+nchar, size, ")");
                     if (0 > n) {
                         nchar = n;
                     }
@@ -973,7 +1072,7 @@ formatGalilean(
 		? printGalilean(scale, underlyingUnit, offset, formatPar->buf,
 		    formatPar->size, formatPar->getId, formatPar->getDefinition,
 		    formatPar->encoding, formatPar->addParens)
-		: snprintf(formatPar->buf, formatPar->size, "%s", id);
+		: printString(formatPar->buf, formatPar->size, id);
     }
 
     formatPar->nchar = nchar < 0 ? nchar : formatPar->nchar + nchar;
@@ -1034,7 +1133,7 @@ printTimestamp(
     int		nchar = 0;
 
     if (addParens) {
-	n = snprintf(buf, size, "%s", "(");
+	n = printString(buf, size, "(");
         if (0 > n) {
             nchar = -1;
         }
@@ -1089,8 +1188,7 @@ printTimestamp(
 		}			/* sufficient precision for seconds */
 
 		if (nchar >= 0) {
-                    n = snprintf(buf+nchar, size, "%s",
-                            addParens ? " UTC)" : " UTC");
+                    n = printString(buf+nchar, size, addParens ? " UTC)" : " UTC");
                     if (0 > n) {
                         nchar = -1;
                     }
@@ -1156,7 +1254,7 @@ formatTimestamp(
 		    second, resolution, formatPar->buf, formatPar->size,
 		    formatPar->getId, formatPar->getDefinition,
 		    formatPar->encoding, formatPar->addParens)
-		: snprintf(formatPar->buf, formatPar->size, "%s", id);
+		: printString(formatPar->buf, formatPar->size, id);
     }
 
     formatPar->nchar = nchar < 0 ? nchar : formatPar->nchar + nchar;
@@ -1266,7 +1364,7 @@ formatLogarithmic(
 		? printLogarithmic(base, reference, formatPar->buf,
 		    formatPar->size, formatPar->getId, formatPar->getDefinition,
 		    formatPar->encoding, formatPar->addParens)
-		: snprintf(formatPar->buf, formatPar->size, "%s", id);
+		: printString(formatPar->buf, formatPar->size, id);
     }
 
     formatPar->nchar = nchar < 0 ? nchar : formatPar->nchar + nchar;
@@ -1351,7 +1449,17 @@ ut_format(
 	ut_handle_error_message("Both UT_LATIN1 and UT_UTF8 specified");
     }
     else {
-	nchar = format(unit, buf, size, useNames, getDefinition, encoding, 0);
+	unsigned long	generation;
+
+	nchar = fcFind(unit, opts, buf, size, &generation);
+
+	if (nchar < 0) {
+	    nchar = format(unit, buf, size, useNames, getDefinition, encoding,
+		0);
+
+	    if (nchar >= 0 && (size_t)nchar < size)
+		fcAdd(unit, opts, generation, buf, nchar);
+	}
 
 	if (nchar < 0) {
 	    ut_set_status(UT_CANT_FORMAT);
@@ -0,0 +1,360 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Freezing of a unit-system.
+ *
+ * Freezing moves the entries of the identifier-to-unit, unit-to-identifier,
+ * and prefix maps of a unit-system into immutable hash tables that are
+ * referenced by the unit-system itself.  Lookups in a frozen unit-system
+ * neither search the global system-to-map trees nor modify anything, so they
+ * may be performed concurrently from any number of threads without locking.
+ * Functions that would modify a frozen unit-system fail with the status
+ * UT_FROZEN.
+ */
+
+/*LINTLIBRARY*/
+
+#include "config.h"
+
+#include "binaryDb.h"
+#include "frozenSystem.h"
+#include "idToUnitMap.h"
+#include "lazyUnits.h"
+#include "prefix.h"
+#include "udunits2.h"
+#include "unitToIdMap.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+int
+ftInit(
+    FrozenTable* const	table,
+    const size_t	count)
+{
+    size_t	nslots = 1;
+
+    while (nslots < 2*count)
+	nslots <<= 1;
+
+    table->slots = calloc(nslots, sizeof(FrozenSlot));
+    table->mask = nslots - 1;
+    table->count = 0;
+
+    return table->slots == NULL ? -1 : 0;
+}
+
+
+void
+ftDestroy(
+    FrozenTable* const	table)
+{
+    free(table->slots);
+
+    table->slots = NULL;
+    table->mask = 0;
+    table->count = 0;
+}
+
+
+void
+ftInsert(
+    FrozenTable* const	table,
+    const unsigned long	hash,
+    const void* const	key,
+    void* const		value)
+{
+    size_t	i = hash & table->mask;
+
+    while (table->slots[i].key != NULL)
+	i = (i + 1) & table->mask;
+
+    table->slots[i].hash = hash;
+    table->slots[i].key = key;
+    table->slots[i].value = value;
+    table->count++;
+}
+
+
+int
+ftAdd(
+    FrozenTable* const	table,
+    const unsigned long	hash,
+    const void* const	key,
+    void* const		value)
+{
+    int		status = 0;
+
+    if (table->slots == NULL || 2*(table->count + 1) > table->mask + 1) {
+	FrozenTable	grown;
+
+	if (ftInit(&grown, table->count < 32 ? 64 : 2*table->count) != 0) {
+	    status = -1;
+	}
+	else {
+	    if (table->slots != NULL) {
+		size_t	i;
+
+		for (i = 0; i <= table->mask; i++) {
+		    const FrozenSlot* const	slot = table->slots + i;
+
+		    if (slot->key != NULL)
+			ftInsert(&grown, slot->hash, slot->key, slot->value);
+		}
+
+		ftDestroy(table);
+	    }
+
+	    *table = grown;
+	}
+    }
+
+    if (status == 0)
+	ftInsert(table, hash, key, value);
+
+    return status;
+}
+
+
+void*
+ftFind(
+    const FrozenTable* const	table,
+    const unsigned long		hash,
+    const void* const		query,
+    int				(*matches)(const void* query, const void* key))
+{
+    void*	value = NULL;
+
+    if (table->slots != NULL) {
+	size_t	i = hash & table->mask;
+
+	for (; table->slots[i].key != NULL; i = (i + 1) & table->mask) {
+	    const FrozenSlot* const	slot = table->slots + i;
+
+	    if (slot->hash == hash && matches(query, slot->key)) {
+		value = slot->value;
+		break;
+	    }
+	}
+    }
+
+    return value;
+}
+
+
+void
+ftForEach(
+    const FrozenTable* const	table,
+    void			(*func)(const void* key, void* value))
+{
+    if (table->slots != NULL) {
+	size_t	i;
+
+	for (i = 0; i <= table->mask; i++)
+	    if (table->slots[i].key != NULL)
+		func(table->slots[i].key, table->slots[i].value);
+    }
+}
+
+
+unsigned long
+fsHashString(
+    const char*		string,
+    const int		fold)
+{
+    unsigned long	hash = FS_HASH_INIT;
+
+    if (fold) {
+	for (; *string; string++)
+	    hash = FS_HASH_STEP(hash, FS_FOLD(*string));
+    }
+    else {
+	for (; *string; string++)
+	    hash = FS_HASH_STEP(hash, *string);
+    }
+
+    return hash;
+}
+
+
+void
+fsFree(
+    FrozenSystem* const	frozen)
+{
+    itumFreeFrozen(frozen);
+    utimFreeFrozen(frozen);
+    ptvmFreeFrozen(frozen);
+    bdbFree(frozen->binaryDb);
+    free(frozen);
+}
+
+
+void
+fsFreeSystem(
+    ut_system*	system)
+{
+    if (system != NULL) {
+	FrozenSystem* const	frozen = coreGetFrozen(system);
+
+	if (frozen != NULL) {
+	    coreSetFrozen(system, NULL);
+	    fsFree(frozen);
+	}
+    }
+}
+
+
+/*
+ * Returns new, empty, frozen maps with room for all the entries of a
+ * unit-system.  The pending units of a unit-system that was read by
+ * ut_read_xml_lazy() are materialized first.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	NULL		Failure.  "ut_get_status()" will be UT_OS.
+ *	else		Pointer to the frozen maps.
+ */
+static FrozenSystem*
+fsAlloc(
+    ut_system* const	system)
+{
+    FrozenSystem*	frozen;
+
+    /*
+     * The maps must be complete.  Definitions that can't be materialized
+     * were reported and are omitted.
+     */
+    (void)luMaterializeAll(system);
+    ut_set_status(UT_SUCCESS);
+
+    frozen = calloc(1, sizeof(FrozenSystem));
+
+    if (frozen == NULL) {
+	ut_set_status(UT_OS);
+	ut_handle_error_message(strerror(errno));
+	ut_handle_error_message("Couldn't allocate %lu-byte frozen maps",
+	    sizeof(FrozenSystem));
+    }
+    else if (itumAllocFrozen(system, frozen) != UT_SUCCESS ||
+	    utimAllocFrozen(system, frozen) != UT_SUCCESS ||
+	    ptvmAllocFrozen(system, frozen) != UT_SUCCESS) {
+	ut_set_status(UT_OS);
+	ut_handle_error_message(strerror(errno));
+	ut_handle_error_message("Couldn't allocate frozen maps");
+	fsFree(frozen);
+	frozen = NULL;
+    }
+
+    return frozen;
+}
+
+
+FrozenSystem*
+fsCopy(
+    ut_system* const	system)
+{
+    FrozenSystem*	frozen = fsAlloc(system);
+
+    if (frozen != NULL && (itumCopyFrozen(system, frozen) != UT_SUCCESS ||
+	    utimCopyFrozen(system, frozen) != UT_SUCCESS ||
+	    ptvmCopyFrozen(system, frozen) != UT_SUCCESS)) {
+	ut_handle_error_message("Couldn't copy maps of unit-system");
+	fsFree(frozen);
+	frozen = NULL;
+    }
+
+    return frozen;
+}
+
+
+/*
+ * Freezes a unit-system.  The name-to-unit, symbol-to-unit, unit-to-name,
+ * unit-to-symbol, and prefix maps of the unit-system are compiled into
+ * immutable hash tables.  Afterwards, looking up units, identifiers, and
+ * prefixes in the unit-system (including by ut_parse()) doesn't modify any
+ * shared state and is safe from any thread, and functions that would modify
+ * the unit-system fail with the status UT_FROZEN.  A unit-system can't be
+ * thawed.  This function must not be called concurrently with any other use
+ * of the unit-system.  The pending units of a unit-system that was read by
+ * ut_read_xml_lazy() are materialized first.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system to be frozen.
+ * Returns:
+ *	UT_SUCCESS	Success.  Also returned if "system" is already frozen.
+ *	UT_BAD_ARG	"system" is NULL.
+ *	UT_OS		Operating-system failure.  See "errno".  "system" is
+ *			unchanged.
+ */
+ut_status
+ut_freeze_system(
+    ut_system* const	system)
+{
+    ut_set_status(UT_SUCCESS);
+
+    if (system == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message("ut_freeze_system(): NULL unit-system argument");
+    }
+    else if (coreGetFrozen(system) == NULL) {
+	FrozenSystem* const	frozen = fsAlloc(system);
+
+	if (frozen == NULL) {
+	    ut_handle_error_message(
+		"ut_freeze_system(): Couldn't freeze unit-system");
+	}
+	else {
+	    /*
+	     * Filling the frozen maps can't fail because they were allocated
+	     * for all entries.
+	     */
+	    itumFillFrozen(system, frozen);
+	    utimFillFrozen(system, frozen);
+	    ptvmFillFrozen(system, frozen);
+
+	    coreSetFrozen(system, frozen);
+	}
+    }					/* "system" not already frozen */
+
+    return ut_get_status();
+}
+
+
+/*
+ * Indicates whether or not a unit-system is frozen.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	0		"system" isn't frozen or is NULL.  "ut_get_status()"
+ *			will be
+ *			    UT_BAD_ARG	"system" is NULL.
+ *			    UT_SUCCESS	"system" isn't frozen.
+ *	else		"system" is frozen.
+ */
+int
+ut_is_frozen(
+    const ut_system* const	system)
+{
+    int		isFrozen = 0;
+
+    ut_set_status(UT_SUCCESS);
+
+    if (system == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message("ut_is_frozen(): NULL unit-system argument");
+    }
+    else {
+	isFrozen = coreGetFrozen(system) != NULL;
+    }
+
+    return isFrozen;
+}
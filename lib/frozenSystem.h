@@ -0,0 +1,294 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Immutable lookup tables of a frozen unit-system.
+ *
+ * When a unit-system is frozen by ut_freeze_system(), the identifier, unit,
+ * and prefix maps of the unit-system are moved into open-addressing hash
+ * tables that are referenced directly by the unit-system.  The tables are
+ * never modified afterwards, so they may be searched by any number of threads
+ * without locking.
+ */
+#ifndef UT_FROZEN_SYSTEM_H_INCLUDED
+#define UT_FROZEN_SYSTEM_H_INCLUDED
+
+#include <ctype.h>
+#include <stddef.h>
+
+#include "udunits2.h"
+
+/*
+ * Incremental FNV-1a hashing of characters.
+ */
+#define FS_HASH_INIT		2166136261UL
+#define FS_HASH_STEP(hash, c)	((((hash) ^ (unsigned char)(c)) * 16777619UL) \
+				    & 0xFFFFFFFFUL)
+#define FS_FOLD(c)		tolower((unsigned char)(c))
+
+/*
+ * A slot of a frozen hash table.  An unused slot has a NULL key.
+ */
+typedef struct {
+    unsigned long	hash;
+    const void*		key;
+    void*		value;
+} FrozenSlot;
+
+/*
+ * A frozen hash table.  The number of slots is a power of two that's at least
+ * twice the number of entries.
+ */
+typedef struct {
+    FrozenSlot*		slots;
+    size_t		mask;		/* number of slots - 1 */
+    size_t		count;		/* number of entries */
+} FrozenTable;
+
+typedef struct FrozenIdToUnitMap	FrozenIdToUnitMap;
+typedef struct FrozenUnitToIdMap	FrozenUnitToIdMap;
+typedef struct FrozenPrefixMap		FrozenPrefixMap;
+typedef struct BinaryDb			BinaryDb;
+
+/*
+ * The frozen maps of a unit-system.  The maps of a unit-system that was
+ * mapped from a binary unit-database by ut_mmap_binary() are NULL and its
+ * lookups are done in the database instead.
+ */
+typedef struct {
+    FrozenIdToUnitMap*	nameToUnit;
+    FrozenIdToUnitMap*	symbolToUnit;
+    FrozenUnitToIdMap*	unitToName;
+    FrozenUnitToIdMap*	unitToSymbol;
+    FrozenPrefixMap*	nameToPrefix;
+    FrozenPrefixMap*	symbolToPrefix;
+    BinaryDb*		binaryDb;	/* mapped database or NULL */
+} FrozenSystem;
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Initializes a frozen hash table for a given number of entries.
+ *
+ * Arguments:
+ *	table		Pointer to the table.
+ *	count		The number of entries that will be inserted.
+ * Returns:
+ *	0		Success.
+ *	-1		Failure.  See "errno".
+ */
+int
+ftInit(
+    FrozenTable* const	table,
+    const size_t	count);
+
+
+/*
+ * Releases the slots of a frozen hash table.  The keys and values aren't
+ * freed.
+ *
+ * Arguments:
+ *	table		Pointer to the table.
+ */
+void
+ftDestroy(
+    FrozenTable* const	table);
+
+
+/*
+ * Inserts an entry into a frozen hash table that's being built.  The table
+ * must have been initialized for at least one more entry and must not already
+ * contain the key.
+ *
+ * Arguments:
+ *	table		Pointer to the table.
+ *	hash		The hash-code of the key.
+ *	key		Pointer to the key.  Must not be NULL.
+ *	value		Pointer to the value.
+ */
+void
+ftInsert(
+    FrozenTable* const	table,
+    const unsigned long	hash,
+    const void* const	key,
+    void* const		value);
+
+
+/*
+ * Inserts an entry into a hash table that's built incrementally, growing the
+ * table when it becomes half full.  The table must have been zeroed or
+ * initialized by ftInit() and must not already contain the key.
+ *
+ * Arguments:
+ *	table		Pointer to the table.
+ *	hash		The hash-code of the key.
+ *	key		Pointer to the key.  Must not be NULL.
+ *	value		Pointer to the value.
+ * Returns:
+ *	0		Success.
+ *	-1		Failure.  See "errno".  The table is unmodified.
+ */
+int
+ftAdd(
+    FrozenTable* const	table,
+    const unsigned long	hash,
+    const void* const	key,
+    void* const		value);
+
+
+/*
+ * Returns the value of the entry of a frozen hash table that matches a query.
+ *
+ * Arguments:
+ *	table		Pointer to the table.
+ *	hash		The hash-code of the query.
+ *	query		Pointer to the query.
+ *	matches		Function that returns non-zero if and only if the query
+ *			matches the key of an entry.
+ * Returns:
+ *	NULL		No entry matches.
+ *	else		Pointer to the value of the matching entry.
+ */
+void*
+ftFind(
+    const FrozenTable* const	table,
+    const unsigned long		hash,
+    const void* const		query,
+    int				(*matches)(const void* query, const void* key));
+
+
+/*
+ * Calls a function for every entry of a frozen hash table.
+ *
+ * Arguments:
+ *	table		Pointer to the table.
+ *	func		Function to be called with the key and value of every
+ *			entry.
+ */
+void
+ftForEach(
+    const FrozenTable* const	table,
+    void			(*func)(const void* key, void* value));
+
+
+/*
+ * Returns the hash-code of a string.
+ *
+ * Arguments:
+ *	string		Pointer to the string.
+ *	fold		Whether or not to fold the string to lower case.
+ */
+unsigned long
+fsHashString(
+    const char*		string,
+    const int		fold);
+
+
+/*
+ * Returns the frozen maps of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	NULL		"system" isn't frozen.
+ *	else		Pointer to the frozen maps of "system".
+ */
+FrozenSystem*
+coreGetFrozen(
+    const ut_system* const	system);
+
+
+/*
+ * Sets the frozen maps of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	frozen		Pointer to the frozen maps or NULL.
+ */
+void
+coreSetFrozen(
+    ut_system* const		system,
+    FrozenSystem* const		frozen);
+
+
+/*
+ * Returns the hash-code of a unit.  Units that are equal according to
+ * ut_compare() have the same hash-code.
+ *
+ * Arguments:
+ *	unit		Pointer to the unit.
+ */
+unsigned long
+coreHashUnit(
+    const ut_unit* const	unit);
+
+
+/*
+ * Makes the converters of a unit to and from its product-unit reference-counted
+ * so that they're shared by the clones of the unit.
+ *
+ * Arguments:
+ *	unit		Pointer to the unit.  Must not be in the arena.
+ * Returns:
+ *	0		Success.
+ *	-1		Failure.  "ut_get_status()" will be UT_OS.  The unit
+ *			is still valid.
+ */
+int
+coreShareConverters(
+    ut_unit* const	unit);
+
+
+/*
+ * Returns frozen maps that contain copies of the entries of a unit-system,
+ * which isn't frozen.  The pending units of a unit-system that was read by
+ * ut_read_xml_lazy() are materialized first.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	NULL		Failure.  "ut_get_status()" will be
+ *			    UT_OS	Operating-system failure.  See "errno".
+ *	else		Pointer to the frozen maps.  The client should pass it
+ *			to fsFree() when it's no longer needed.
+ */
+FrozenSystem*
+fsCopy(
+    ut_system* const	system);
+
+
+/*
+ * Frees frozen maps.
+ *
+ * Arguments:
+ *	frozen		Pointer to the frozen maps.
+ */
+void
+fsFree(
+    FrozenSystem* const	frozen);
+
+
+/*
+ * Frees the frozen maps of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ */
+void
+fsFreeSystem(
+    ut_system*	system);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
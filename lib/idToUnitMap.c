@@ -14,6 +14,13 @@
 #include "config.h"
 
 #include "udunits2.h"
+#include "binaryDb.h"
+#include "frozenSystem.h"
+#include "idToUnitMap.h"
+#include "lazyUnits.h"
+#include "parseCache.h"
+#include "stats.h"
+#include "threadSupport.h"
 #include "unitAndId.h"
 #include "systemMap.h"
 
@@ -34,11 +41,33 @@
 typedef struct {
     int			(*compare)(const void*, const void*);
     void*		tree;
+    size_t		count;		/* number of entries in "tree" */
 } IdToUnitMap;
 
+/*
+ * Frozen identifier-to-unit map.  The keys are the identifiers of the entries,
+ * which are folded to lower case if the map is case-insensitive.
+ */
+struct FrozenIdToUnitMap {
+    FrozenTable		table;		/* identifier -> UnitAndId */
+    int			fold;		/* case-insensitive map? */
+};
+
 static SystemMap*	systemToNameToUnit;
 static SystemMap*	systemToSymbolToUnit;
 
+/*
+ * The observer of the identifier lookups of the current thread.  See
+ * itumObserveLookups().
+ */
+static UT_THREAD_LOCAL ItumObserver	lookupObserver = NULL;
+static UT_THREAD_LOCAL void*		lookupObserverArg = NULL;
+
+static IdToUnitMap*
+getMap(
+    const SystemMap* const	systemMap,
+    const ut_system* const	system);
+
 
 static int
 sensitiveCompare(
@@ -69,6 +98,7 @@ itumNew(
     if (map != NULL) {
 	map->tree = NULL;
 	map->compare = compare;
+	map->count = 0;
     }
 
     return map;
@@ -148,8 +178,17 @@ itumAdd(
 		    "\"%s\" already maps to existing but different unit", id);
 	    }
 
-            if (targetEntry != *treeEntry)
+            if (targetEntry != *treeEntry) {
                 uaiFree(targetEntry);
+	    }
+	    else {
+		/*
+		 * The clones that lookups return share the converters of the
+		 * mapped unit.  Not being able to share them isn't an error.
+		 */
+		(void)coreShareConverters(targetEntry->unit);
+		map->count++;
+	    }
 	}				/* found entry */
     }					/* "targetEntry" allocated */
 
@@ -185,6 +224,7 @@ itumRemove(
 
 	(void)tdelete(uai, &map->tree, map->compare);
 	uaiFree(uai);
+	map->count--;
     }
 
     return UT_SUCCESS;
@@ -235,6 +275,7 @@ itumFind(
  *	compare		Pointer to comparison function for unit-identifiers.
  * Returns:
  *	UT_BAD_ARG	"id" is NULL or "unit" is NULL.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_OS		Operating-sytem failure.  See "errno".
  *	UT_SUCCESS	Success.
  */
@@ -253,9 +294,20 @@ mapIdToUnit(
     else if (unit == NULL) {
 	status = UT_BAD_ARG;
     }
+    else if (coreGetFrozen(ut_get_system(unit)) != NULL) {
+	status = UT_FROZEN;
+	ut_set_status(status);
+	ut_handle_error_message("Unit-system is frozen");
+    }
     else {
 	ut_system*	system = ut_get_system(unit);
 
+	/*
+	 * A pending definition of the identifier is materialized first so
+	 * that it can't later replace or conflict with this mapping.
+	 */
+	(void)luMaterialize(system, id, compare == insensitiveCompare);
+
 	if (*systemMap == NULL) {
 	    *systemMap = smNew();
 
@@ -278,8 +330,12 @@ mapIdToUnit(
 			status = UT_OS;
 		}
 
-		if (*idToUnit != NULL)
+		if (*idToUnit != NULL) {
 		    status = itumAdd(*idToUnit, id, unit);
+
+		    if (status == UT_SUCCESS)
+			pcFlush(system);
+		}
 	    }				/* have system-map entry */
 	}				/* have system-map */
     }					/* valid arguments */
@@ -297,6 +353,7 @@ mapIdToUnit(
  *	system		Pointer to the unit-system associated with the mapping.
  * Returns:
  *	UT_BAD_ARG	"id" is NULL, "system" is NULL, or "compare" is NULL.
+ *	UT_FROZEN	"system" is frozen.
  *	UT_SUCCESS	Success.
  */
 static ut_status
@@ -310,14 +367,27 @@ unmapId(
     if (systemMap == NULL || id == NULL || system == NULL) {
 	status = UT_BAD_ARG;
     }
+    else if (coreGetFrozen(system) != NULL) {
+	status = UT_FROZEN;
+	ut_set_status(status);
+	ut_handle_error_message("Unit-system is frozen");
+    }
     else {
-	IdToUnitMap** const	idToUnit =
-	    (IdToUnitMap**)smFind(systemMap, system);
+	IdToUnitMap**	idToUnit;
 
+	/*
+	 * Pending definitions might refer to the identifier, so they're
+	 * materialized while it still maps to its unit.
+	 */
+	(void)luMaterializeAll(system);
+
+	idToUnit = (IdToUnitMap**)smFind(systemMap, system);
 	status =
 	    (idToUnit == NULL || *idToUnit == NULL)
 		? UT_SUCCESS
 		: itumRemove(*idToUnit, id);
+
+	pcFlush(system);
     }					/* valid arguments */
 
     return status;
@@ -335,6 +405,7 @@ unmapId(
  *			freed upon return.
  * Returns:
  *	UT_BAD_ARG	"name" or "unit" is NULL.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_OS		Operating-system error.  See "errno".
  *	UT_EXISTS	"name" already maps to a different unit.
  *	UT_SUCCESS	Success.
@@ -363,6 +434,7 @@ ut_map_name_to_unit(
  * Returns:
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"system" or "name" is NULL.
+ *	UT_FROZEN	"system" is frozen.
  */
 ut_status
 ut_unmap_name_to_unit(
@@ -387,6 +459,7 @@ ut_unmap_name_to_unit(
  *			be freed upon return.
  * Returns:
  *	UT_BAD_ARG	"symbol" or "unit" is NULL.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_OS		Operating-system error.  See "errno".
  *	UT_EXISTS	"symbol" already maps to a different unit.
  *	UT_SUCCESS	Success.
@@ -415,6 +488,7 @@ ut_map_symbol_to_unit(
  * Returns:
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"system" or "symbol" is NULL.
+ *	UT_FROZEN	"system" is frozen.
  */
 ut_status
 ut_unmap_symbol_to_unit(
@@ -428,52 +502,179 @@ ut_unmap_symbol_to_unit(
 }
 
 
+static int
+sensitiveMatches(
+    const void* const	query,
+    const void* const	key)
+{
+    return strcmp((const char*)query, (const char*)key) == 0;
+}
+
+
+static int
+foldedMatches(
+    const void* const	query,
+    const void* const	key)
+{
+    const char*	q = (const char*)query;
+    const char*	k = (const char*)key;
+
+    while (*k != 0 && FS_FOLD(*q) == (unsigned char)*k) {
+	q++;
+	k++;
+    }
+
+    return *q == 0 && *k == 0;
+}
+
+
+/*
+ * Returns the entry of a frozen identifier-to-unit map that corresponds to an
+ * identifier.
+ *
+ * Arguments:
+ *	map	Pointer to the frozen identifier-to-unit map.
+ *	id	The identifier to be used as the key in the search.
+ * Returns:
+ *	NULL	"map" doesn't contain an entry that corresponds to "id".
+ *	else	Pointer to the entry corresponding to "id".
+ */
+static const UnitAndId*
+fitumFind(
+    const FrozenIdToUnitMap* const	map,
+    const char* const			id)
+{
+    return map->fold
+	? ftFind(&map->table, fsHashString(id, 1), id, foldedMatches)
+	: ftFind(&map->table, fsHashString(id, 0), id, sensitiveMatches);
+}
+
+
 /*
  * Returns the unit to which an identifier maps in a particular unit-system.
+ * The unit isn't copied.
  *
  * Arguments:
- *	systemMap	NULL or pointer to the system-map.  If NULL, then
- *			NULL will be returned.
+ *	systemMap	Pointer to the pointer to the system-map, which may
+ *			be NULL.
+ *	frozenMap	Pointer to the frozen map that corresponds to
+ *			"systemMap" or NULL if "system" isn't frozen.
+ *	db		Pointer to the binary unit-database from which
+ *			"system" was mapped or NULL.
+ *	type		The type of "id" in "db".
  *	system		Pointer to the unit-system.
  *	id		Pointer to the identifier.
  * Returns:
  *	NULL	Failure.  "ut_get_status()" will be:
  *		    UT_BAD_ARG	        "system" is NULL or "id" is NULL.
  *	else	Pointer to the unit in "system" with the identifier "id".
- *		Should be passed to ut_free() when no longer needed.
+ *		Belongs to the map.
  */
-static ut_unit*
-getUnitById(
-    const SystemMap* const	systemMap,
-    const ut_system* const	system,
-    const char* const		id)
+static const ut_unit*
+findUnitById(
+    SystemMap* const* const		systemMap,
+    const FrozenIdToUnitMap* const	frozenMap,
+    const BinaryDb* const		db,
+    const BdbIdType			type,
+    const ut_system* const		system,
+    const char* const			id)
 {
-    ut_unit*	unit = NULL;		/* failure */
+    const ut_unit*	unit = NULL;		/* failure */
+
+    if (type == BDB_NAME) {
+	UT_STATS_ADD(nameLookups, 1);
+    }
+    else {
+	UT_STATS_ADD(symbolLookups, 1);
+    }
+
+    if (lookupObserver != NULL && id != NULL)
+	lookupObserver(lookupObserverArg, id);
 
     if (system == NULL) {
 	ut_set_status(UT_BAD_ARG);
-	ut_handle_error_message("getUnitById(): NULL unit-system argument");
+	ut_handle_error_message("findUnitById(): NULL unit-system argument");
     }
     else if (id == NULL) {
 	ut_set_status(UT_BAD_ARG);
-	ut_handle_error_message("getUnitById(): NULL identifier argument");
+	ut_handle_error_message("findUnitById(): NULL identifier argument");
     }
-    else if (systemMap != NULL) {
-	IdToUnitMap** const	idToUnit =
-	    (IdToUnitMap**)smFind(systemMap, system);
-
-	if (idToUnit != NULL) {
-	    const UnitAndId*	uai = itumFind(*idToUnit, id);
+    else if (db != NULL) {
+	unit = bdbGetUnitById(db, type, id);
+    }
+    else if (frozenMap != NULL) {
+	const UnitAndId*	uai = fitumFind(frozenMap, id);
 
-	    if (uai != NULL)
-		unit = ut_clone(uai->unit);
+	if (uai != NULL)
+	    unit = uai->unit;
+    }
+    else {
+	IdToUnitMap* const	idToUnit = getMap(*systemMap, system);
+	const UnitAndId*	uai =
+	    idToUnit == NULL ? NULL : itumFind(idToUnit, id);
+
+	/*
+	 * The identifier might belong to a pending definition of a lazily-read
+	 * unit-system.
+	 */
+	if (uai == NULL && luMaterialize(system, id, type == BDB_NAME)) {
+	    IdToUnitMap* const	materialized = getMap(*systemMap, system);
+
+	    if (materialized != NULL)
+		uai = itumFind(materialized, id);
 	}
+
+	if (uai != NULL)
+	    unit = uai->unit;
     }					/* valid arguments */
 
     return unit;
 }
 
 
+void
+itumObserveLookups(
+    const ItumObserver	observer,
+    void* const		arg)
+{
+    lookupObserver = observer;
+    lookupObserverArg = arg;
+}
+
+
+/*
+ * Returns the unit with a given name from a unit-system without copying it.
+ * Name comparisons are case-insensitive.
+ *
+ * Arguments:
+ *	system	Pointer to the unit-system.
+ *	name	Pointer to the name of the unit to be returned.
+ * Returns:
+ *	NULL	Failure.  "ut_get_status()" will be
+ *		    UT_SUCCESS		"name" doesn't map to a unit of
+ *					"system".
+ *		    UT_BAD_ARG		"system" or "name" is NULL.
+ *	else	Pointer to the unit of the unit-system with the given name.
+ *		The unit belongs to the unit-system and is valid until "name"
+ *		is unmapped or the unit-system is freed.  It must not be
+ *		passed to ut_free() or modified.  See ut_clone().
+ */
+const ut_unit*
+ut_get_unit_by_name_ref(
+    const ut_system* const	system,
+    const char* const		name)
+{
+    const FrozenSystem* const	frozen =
+	system == NULL ? NULL : coreGetFrozen(system);
+
+    ut_set_status(UT_SUCCESS);
+
+    return findUnitById(&systemToNameToUnit,
+	frozen == NULL ? NULL : frozen->nameToUnit,
+	frozen == NULL ? NULL : frozen->binaryDb, BDB_NAME, system, name);
+}
+
+
 /*
  * Returns the unit with a given name from a unit-system.  Name comparisons
  * are case-insensitive.
@@ -495,9 +696,43 @@ ut_get_unit_by_name(
     const ut_system* const	system,
     const char* const		name)
 {
+    const ut_unit* const	unit = ut_get_unit_by_name_ref(system, name);
+
+    return unit == NULL ? NULL : ut_clone(unit);
+}
+
+
+/*
+ * Returns the unit with a given symbol from a unit-system without copying it.
+ * Symbol comparisons are case-sensitive.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	symbol		Pointer to the symbol associated with the unit to be
+ *			returned.
+ * Returns:
+ *	NULL	Failure.  "ut_get_status()" will be
+ *		    UT_SUCCESS		"symbol" doesn't map to a unit of
+ *					"system".
+ *		    UT_BAD_ARG		"system" or "symbol" is NULL.
+ *	else	Pointer to the unit in the unit-system with the given symbol.
+ *		The unit belongs to the unit-system and is valid until
+ *		"symbol" is unmapped or the unit-system is freed.  It must not
+ *		be passed to ut_free() or modified.  See ut_clone().
+ */
+const ut_unit*
+ut_get_unit_by_symbol_ref(
+    const ut_system* const	system,
+    const char* const		symbol)
+{
+    const FrozenSystem* const	frozen =
+	system == NULL ? NULL : coreGetFrozen(system);
+
     ut_set_status(UT_SUCCESS);
 
-    return getUnitById(systemToNameToUnit, system, name);
+    return findUnitById(&systemToSymbolToUnit,
+	frozen == NULL ? NULL : frozen->symbolToUnit,
+	frozen == NULL ? NULL : frozen->binaryDb, BDB_SYMBOL, system, symbol);
 }
 
 
@@ -523,9 +758,9 @@ ut_get_unit_by_symbol(
     const ut_system* const	system,
     const char* const		symbol)
 {
-    ut_set_status(UT_SUCCESS);
+    const ut_unit* const	unit = ut_get_unit_by_symbol_ref(system, symbol);
 
-    return getUnitById(systemToSymbolToUnit, system, symbol);
+    return unit == NULL ? NULL : ut_clone(unit);
 }
 
 
@@ -560,3 +795,244 @@ itumFreeSystem(
 	}
     }					/* valid arguments */
 }
+
+
+/*
+ * Returns the identifier-to-unit map of a unit-system.
+ *
+ * Arguments:
+ *	systemMap	NULL or pointer to the system-map.
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	NULL		"system" doesn't have an identifier-to-unit map.
+ *	else		Pointer to the identifier-to-unit map of "system".
+ */
+static IdToUnitMap*
+getMap(
+    const SystemMap* const	systemMap,
+    const ut_system* const	system)
+{
+    IdToUnitMap**	idToUnit =
+	systemMap == NULL ? NULL : (IdToUnitMap**)smFind(systemMap, system);
+
+    return idToUnit == NULL ? NULL : *idToUnit;
+}
+
+
+/*
+ * Returns a new, empty, frozen identifier-to-unit map.
+ *
+ * Arguments:
+ *	map		Pointer to the identifier-to-unit map to be frozen or
+ *			NULL.
+ *	fold		Whether or not the map is case-insensitive.
+ * Returns:
+ *	NULL		Failure.  See "errno".
+ *	else		Pointer to a frozen map with room for all the entries of
+ *			"map".
+ */
+static FrozenIdToUnitMap*
+fitumNew(
+    const IdToUnitMap* const	map,
+    const int			fold)
+{
+    FrozenIdToUnitMap*	frozen = malloc(sizeof(FrozenIdToUnitMap));
+
+    if (frozen != NULL) {
+	frozen->fold = fold;
+
+	if (ftInit(&frozen->table, map == NULL ? 0 : map->count)) {
+	    free(frozen);
+	    frozen = NULL;
+	}
+    }
+
+    return frozen;
+}
+
+
+/*
+ * Adds an entry to a frozen identifier-to-unit map, which takes ownership of
+ * it.
+ *
+ * Arguments:
+ *	frozen		Pointer to the frozen map.
+ *	uai		Pointer to the entry.  Its identifier is folded if the
+ *			frozen map is case-insensitive.
+ */
+static void
+fitumInsert(
+    FrozenIdToUnitMap* const	frozen,
+    UnitAndId* const		uai)
+{
+    if (frozen->fold) {
+	char*	cp;
+
+	for (cp = uai->id; *cp; cp++)
+	    *cp = (char)FS_FOLD(*cp);
+    }
+
+    ftInsert(&frozen->table, fsHashString(uai->id, 0), uai->id, uai);
+}
+
+
+/*
+ * Moves the entries of an identifier-to-unit map into a frozen map.
+ *
+ * Arguments:
+ *	map		Pointer to the identifier-to-unit map or NULL.  Will be
+ *			empty on return.
+ *	frozen		Pointer to the frozen map.
+ */
+static void
+fitumFill(
+    IdToUnitMap* const		map,
+    FrozenIdToUnitMap* const	frozen)
+{
+    if (map != NULL) {
+	while (map->tree != NULL) {
+	    UnitAndId*	uai = *(UnitAndId**)map->tree;
+
+	    (void)tdelete(uai, &map->tree, map->compare);
+	    fitumInsert(frozen, uai);
+	}
+
+	map->count = 0;
+    }
+}
+
+
+/*
+ * The frozen map into which copyNode() copies entries and whether or not a
+ * copy failed.  twalk() has no client argument.
+ */
+static UT_THREAD_LOCAL FrozenIdToUnitMap*	copyTarget = NULL;
+static UT_THREAD_LOCAL int			copyFailed = 0;
+
+
+static void
+copyNode(
+    const void* const	node,
+    const VISIT		order,
+    const int		level)
+{
+    if (!copyFailed && (order == postorder || order == leaf)) {
+	const UnitAndId* const	uai = *(const UnitAndId* const*)node;
+	UnitAndId* const	copy = uaiNew(uai->unit, uai->id);
+
+	if (copy == NULL) {
+	    copyFailed = 1;
+	}
+	else {
+	    fitumInsert(copyTarget, copy);
+	}
+    }
+}
+
+
+/*
+ * Copies the entries of an identifier-to-unit map into a frozen map.
+ *
+ * Arguments:
+ *	map		Pointer to the identifier-to-unit map or NULL.
+ *	frozen		Pointer to the frozen map.
+ * Returns:
+ *	0		Success.
+ *	-1		Failure.  "ut_get_status()" will be UT_OS.  The entries
+ *			that were copied should be freed with the frozen map.
+ */
+static int
+fitumCopy(
+    const IdToUnitMap* const	map,
+    FrozenIdToUnitMap* const	frozen)
+{
+    int		status = 0;
+
+    if (map != NULL) {
+	copyTarget = frozen;
+	copyFailed = 0;
+	twalk(map->tree, copyNode);
+	status = copyFailed ? -1 : 0;
+	copyTarget = NULL;
+    }
+
+    return status;
+}
+
+
+static void
+freeEntry(
+    const void* const	key,
+    void* const		value)
+{
+    (void)key;
+    uaiFree((UnitAndId*)value);
+}
+
+
+static void
+fitumFree(
+    FrozenIdToUnitMap* const	frozen)
+{
+    if (frozen != NULL) {
+	ftForEach(&frozen->table, freeEntry);
+	ftDestroy(&frozen->table);
+	free(frozen);
+    }
+}
+
+
+ut_status
+itumAllocFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen)
+{
+    frozen->nameToUnit = fitumNew(getMap(systemToNameToUnit, system), 1);
+    frozen->symbolToUnit = fitumNew(getMap(systemToSymbolToUnit, system), 0);
+
+    return frozen->nameToUnit == NULL || frozen->symbolToUnit == NULL
+	? UT_OS
+	: UT_SUCCESS;
+}
+
+
+void
+itumFillFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen)
+{
+    fitumFill(getMap(systemToNameToUnit, system), frozen->nameToUnit);
+    fitumFill(getMap(systemToSymbolToUnit, system), frozen->symbolToUnit);
+}
+
+
+ut_status
+itumCopyFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen)
+{
+    return fitumCopy(getMap(systemToNameToUnit, system), frozen->nameToUnit)
+	    || fitumCopy(getMap(systemToSymbolToUnit, system),
+		frozen->symbolToUnit)
+	? UT_OS
+	: UT_SUCCESS;
+}
+
+
+void
+itumFreeFrozen(
+    FrozenSystem* const	frozen)
+{
+    fitumFree(frozen->nameToUnit);
+    fitumFree(frozen->symbolToUnit);
+    frozen->nameToUnit = NULL;
+    frozen->symbolToUnit = NULL;
+}
+
+
+const FrozenTable*
+itumGetFrozenTable(
+    const FrozenIdToUnitMap* const	frozen)
+{
+    return &frozen->table;
+}
@@ -9,6 +9,7 @@
 #define UT_ID_TO_UNIT_MAP_H_INCLUDED
 
 #include "udunits2.h"
+#include "frozenSystem.h"
 
 
 #ifdef __cplusplus
@@ -28,6 +29,108 @@ itumFreeSystem(
     ut_system*	system);
 
 
+/*
+ * Allocates the frozen name-to-unit and symbol-to-unit maps of a unit-system.
+ * The maps are empty but have room for all the entries of the unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	frozen		Pointer to the frozen maps of "system".
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_OS		Operating-system failure.  See "errno".  The maps that
+ *			were allocated should be freed by itumFreeFrozen().
+ */
+ut_status
+itumAllocFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen);
+
+
+/*
+ * Moves the entries of the name-to-unit and symbol-to-unit maps of a
+ * unit-system into its frozen maps, which must have been allocated by
+ * itumAllocFrozen().
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	frozen		Pointer to the frozen maps of "system".
+ */
+void
+itumFillFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen);
+
+
+/*
+ * Copies the entries of the name-to-unit and symbol-to-unit maps of a
+ * unit-system into frozen maps, which must have been allocated by
+ * itumAllocFrozen().  The unit-system isn't modified.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	frozen		Pointer to the frozen maps.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_OS		Operating-system failure.  See "errno".  The entries
+ *			that were copied are freed by itumFreeFrozen().
+ */
+ut_status
+itumCopyFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen);
+
+
+/*
+ * Frees the frozen name-to-unit and symbol-to-unit maps of a unit-system.
+ *
+ * Arguments:
+ *	frozen		Pointer to the frozen maps.
+ */
+void
+itumFreeFrozen(
+    FrozenSystem* const	frozen);
+
+
+/*
+ * Returns the hash table of a frozen identifier-to-unit map.  The keys of the
+ * table are the identifiers (folded to lower case if the map is
+ * case-insensitive) and the values are pointers to UnitAndId-s.
+ *
+ * Arguments:
+ *	frozen		Pointer to the frozen map.
+ */
+const FrozenTable*
+itumGetFrozenTable(
+    const FrozenIdToUnitMap* const	frozen);
+
+
+/*
+ * A function that's called with an identifier that's being looked up.
+ *
+ * Arguments:
+ *	arg		Client pointer passed to itumObserveLookups().
+ *	id		The identifier.
+ */
+typedef void (*ItumObserver)(void* arg, const char* id);
+
+
+/*
+ * Sets the function to be called with every identifier that the current
+ * thread looks up in a unit-system (e.g., by ut_get_unit_by_name() or
+ * ut_parse()) whether or not the identifier maps to a unit.  Other threads
+ * are unaffected.
+ *
+ * Arguments:
+ *	observer	The function or NULL to stop observing.
+ *	arg		Client pointer passed to "observer".
+ */
+void
+itumObserveLookups(
+    const ItumObserver	observer,
+    void* const		arg);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,422 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Deferred definitions of the units of a unit-system that was read by
+ * ut_read_xml_lazy().
+ *
+ * Instead of parsing the definition of a unit and mapping its identifiers when
+ * the unit-database is read, the definition and the mappings are recorded and
+ * the identifiers are indexed.  When an identifier of a pending definition is
+ * looked up (e.g., by ut_get_unit_by_name() or ut_parse()), the definition is
+ * parsed and its mappings are made -- exactly as ut_read_xml() would have --
+ * and the lookup proceeds as usual.  A definition may refer to units that are
+ * themselves pending.
+ *
+ * Because materializing a unit modifies the unit-system, a lazily-read
+ * unit-system must not be used concurrently until it's frozen by
+ * ut_freeze_system(), which materializes all pending definitions.
+ */
+
+/*LINTLIBRARY*/
+
+#include "config.h"
+
+#include "frozenSystem.h"
+#include "lazyUnits.h"
+#include "systemMap.h"
+#include "udunits2.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef enum {
+    LU_PENDING,
+    LU_BUSY,			/* being materialized */
+    LU_DONE,
+    LU_FAILED
+} LazyState;
+
+typedef struct {
+    char*		id;
+    char*		key;		/* folded "id" if a name; else "id" */
+    ut_encoding		encoding;
+    int			isName;
+    int			toUnit;
+} LazyMapping;
+
+struct LazyUnit {
+    ut_system*		system;
+    char*		definition;
+    LazyMapping*	mappings;
+    int			count;
+    int			capacity;
+    ut_encoding		encoding;
+    LazyState		state;
+};
+
+/*
+ * The deferred definitions of a unit-system and indexes of their
+ * identifier-to-unit mappings.  The indexes are frozen hash tables that are
+ * rebuilt when they become half full.
+ */
+typedef struct {
+    LazyUnit**		units;
+    size_t		count;
+    size_t		capacity;
+    size_t		npending;	/* number pending or being
+					 * materialized */
+    FrozenTable		names;		/* folded name -> LazyUnit */
+    FrozenTable		symbols;	/* symbol -> LazyUnit */
+} LazySystem;
+
+static SystemMap*	systemToLazy = NULL;
+
+
+static int
+sensitiveMatches(
+    const void* const	query,
+    const void* const	key)
+{
+    return strcmp((const char*)query, (const char*)key) == 0;
+}
+
+
+static int
+foldedMatches(
+    const void* const	query,
+    const void* const	key)
+{
+    const char*	q = (const char*)query;
+    const char*	k = (const char*)key;
+
+    while (*k != 0 && FS_FOLD(*q) == (unsigned char)*k) {
+	q++;
+	k++;
+    }
+
+    return *q == 0 && *k == 0;
+}
+
+
+/*
+ * Returns the deferred definitions of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	NULL		"system" doesn't have deferred definitions.
+ *	else		Pointer to the deferred definitions of "system".
+ */
+static LazySystem*
+getLazySystem(
+    const ut_system* const	system)
+{
+    LazySystem**	lazySystem =
+	systemToLazy == NULL ? NULL : (LazySystem**)smFind(systemToLazy, system);
+
+    return lazySystem == NULL ? NULL : *lazySystem;
+}
+
+
+LazyUnit*
+luNew(
+    ut_system* const	system,
+    const char* const	definition,
+    const ut_encoding	encoding)
+{
+    LazyUnit*		lazy = NULL;
+    LazySystem**	lazySystem = NULL;
+
+    if (systemToLazy == NULL)
+	systemToLazy = smNew();
+
+    if (systemToLazy != NULL)
+	lazySystem = (LazySystem**)smSearch(systemToLazy, system);
+
+    if (lazySystem != NULL && *lazySystem == NULL)
+	*lazySystem = calloc(1, sizeof(LazySystem));
+
+    if (lazySystem != NULL && *lazySystem != NULL) {
+	LazySystem* const	ls = *lazySystem;
+
+	if (ls->count == ls->capacity) {
+	    const size_t	capacity =
+		ls->capacity == 0 ? 256 : 2*ls->capacity;
+	    LazyUnit** const	units =
+		realloc(ls->units, capacity*sizeof(LazyUnit*));
+
+	    if (units != NULL) {
+		ls->units = units;
+		ls->capacity = capacity;
+	    }
+	}
+
+	if (ls->count < ls->capacity) {
+	    lazy = calloc(1, sizeof(LazyUnit));
+
+	    if (lazy != NULL) {
+		lazy->definition = strdup(definition);
+
+		if (lazy->definition == NULL) {
+		    free(lazy);
+		    lazy = NULL;
+		}
+		else {
+		    lazy->system = system;
+		    lazy->encoding = encoding;
+		    lazy->state = LU_PENDING;
+		    ls->units[ls->count++] = lazy;
+		    ls->npending++;
+		}
+	    }
+	}
+    }
+
+    if (lazy == NULL) {
+	ut_set_status(UT_OS);
+	ut_handle_error_message(strerror(errno));
+	ut_handle_error_message(
+	    "luNew(): Couldn't add deferred definition \"%s\"", definition);
+    }
+
+    return lazy;
+}
+
+
+int
+luAddMapping(
+    LazyUnit* const	lazy,
+    const char* const	id,
+    const ut_encoding	encoding,
+    const int		isName,
+    const int		toUnit)
+{
+    int		success = 0;
+
+    if (lazy->count == lazy->capacity) {
+	const int		capacity = lazy->capacity == 0 ? 8 : 2*lazy->capacity;
+	LazyMapping* const	mappings =
+	    realloc(lazy->mappings, capacity*sizeof(LazyMapping));
+
+	if (mappings != NULL) {
+	    lazy->mappings = mappings;
+	    lazy->capacity = capacity;
+	}
+    }
+
+    if (lazy->count < lazy->capacity) {
+	LazyMapping* const	mapping = lazy->mappings + lazy->count;
+
+	mapping->id = strdup(id);
+	mapping->key = NULL;
+
+	if (mapping->id != NULL) {
+	    mapping->encoding = encoding;
+	    mapping->isName = isName;
+	    mapping->toUnit = toUnit;
+
+	    if (!toUnit) {
+		success = 1;
+	    }
+	    else {
+		LazySystem* const	ls = getLazySystem(lazy->system);
+
+		if (isName) {
+		    mapping->key = strdup(id);
+
+		    if (mapping->key != NULL) {
+			char*	cp;
+
+			for (cp = mapping->key; *cp != 0; cp++)
+			    *cp = (char)FS_FOLD(*cp);
+
+			success = ftAdd(&ls->names,
+			    fsHashString(mapping->key, 0), mapping->key, lazy) == 0;
+		    }
+		}
+		else {
+		    mapping->key = mapping->id;
+		    success = ftAdd(&ls->symbols, fsHashString(id, 0),
+			mapping->key, lazy) == 0;
+		}
+	    }
+
+	    if (success) {
+		lazy->count++;
+	    }
+	    else {
+		if (mapping->key != mapping->id)
+		    free(mapping->key);
+		free(mapping->id);
+	    }
+	}
+    }
+
+    if (!success) {
+	ut_set_status(UT_OS);
+	ut_handle_error_message(strerror(errno));
+	ut_handle_error_message(
+	    "luAddMapping(): Couldn't add deferred mapping for \"%s\"", id);
+    }
+
+    return success;
+}
+
+
+ut_unit*
+luMaterializeUnit(
+    LazyUnit* const	lazy)
+{
+    ut_unit*	unit = NULL;
+
+    if (lazy->state == LU_PENDING) {
+	lazy->state = LU_BUSY;
+	unit = ut_parse(lazy->system, lazy->definition, lazy->encoding);
+
+	if (unit == NULL) {
+	    ut_set_status(UT_PARSE);
+	    ut_handle_error_message(
+		"Couldn't parse unit specification \"%s\"", lazy->definition);
+	}
+	else {
+	    int		i;
+
+	    for (i = 0; i < lazy->count; i++) {
+		const LazyMapping* const	mapping = lazy->mappings + i;
+		ut_status			status =
+		    mapping->toUnit
+			? mapping->isName
+			    ? ut_map_name_to_unit(mapping->id, mapping->encoding,
+				unit)
+			    : ut_map_symbol_to_unit(mapping->id,
+				mapping->encoding, unit)
+			: mapping->isName
+			    ? ut_map_unit_to_name(unit, mapping->id,
+				mapping->encoding)
+			    : ut_map_unit_to_symbol(unit, mapping->id,
+				mapping->encoding);
+
+		if (status != UT_SUCCESS) {
+		    ut_set_status(status);
+		    ut_handle_error_message("Couldn't map %s \"%s\" of unit "
+			"\"%s\"", mapping->isName ? "name" : "symbol",
+			mapping->id, lazy->definition);
+		    ut_free(unit);
+		    unit = NULL;
+		    break;
+		}
+	    }
+	}
+
+	lazy->state = unit == NULL ? LU_FAILED : LU_DONE;
+	getLazySystem(lazy->system)->npending--;
+    }
+
+    return unit;
+}
+
+
+int
+luMaterialize(
+    const ut_system* const	system,
+    const char* const		id,
+    const int			isName)
+{
+    int				materialized = 0;
+    const LazySystem* const	ls =
+	system == NULL || id == NULL ? NULL : getLazySystem(system);
+
+    if (ls != NULL) {
+	LazyUnit* const	lazy =
+	    isName
+		? ftFind(&ls->names, fsHashString(id, 1), id, foldedMatches)
+		: ftFind(&ls->symbols, fsHashString(id, 0), id,
+		    sensitiveMatches);
+
+	if (lazy != NULL && lazy->state == LU_PENDING) {
+	    ut_unit* const	unit = luMaterializeUnit(lazy);
+
+	    materialized = unit != NULL;
+	    ut_free(unit);
+	}
+    }
+
+    return materialized;
+}
+
+
+int
+luIsComplete(
+    const ut_system* const	system)
+{
+    const LazySystem* const	ls = getLazySystem(system);
+
+    return ls == NULL || ls->npending == 0;
+}
+
+
+ut_status
+luMaterializeAll(
+    const ut_system* const	system)
+{
+    ut_status			status = UT_SUCCESS;
+    const LazySystem* const	ls = getLazySystem(system);
+
+    if (ls != NULL) {
+	size_t	i;
+
+	for (i = 0; i < ls->count; i++) {
+	    if (ls->units[i]->state == LU_PENDING) {
+		ut_unit* const	unit = luMaterializeUnit(ls->units[i]);
+
+		if (unit != NULL) {
+		    ut_free(unit);
+		}
+		else if (status == UT_SUCCESS) {
+		    status = ut_get_status();
+		}
+	    }
+	}
+    }
+
+    return status;
+}
+
+
+void
+luFreeSystem(
+    ut_system* const	system)
+{
+    LazySystem* const	ls = getLazySystem(system);
+
+    if (ls != NULL) {
+	size_t	i;
+
+	for (i = 0; i < ls->count; i++) {
+	    LazyUnit* const	lazy = ls->units[i];
+	    int			j;
+
+	    for (j = 0; j < lazy->count; j++) {
+		if (lazy->mappings[j].key != lazy->mappings[j].id)
+		    free(lazy->mappings[j].key);
+		free(lazy->mappings[j].id);
+	    }
+
+	    free(lazy->mappings);
+	    free(lazy->definition);
+	    free(lazy);
+	}
+
+	free(ls->units);
+	ftDestroy(&ls->names);
+	ftDestroy(&ls->symbols);
+	free(ls);
+	smRemove(systemToLazy, system);
+    }
+}
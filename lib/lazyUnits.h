@@ -0,0 +1,154 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Deferred definitions of the units of a unit-system that was read by
+ * ut_read_xml_lazy().  See lazyUnits.c.
+ */
+#ifndef UT_LAZY_UNITS_H_INCLUDED
+#define UT_LAZY_UNITS_H_INCLUDED
+
+#include "udunits2.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct LazyUnit	LazyUnit;
+
+
+/*
+ * Adds a deferred unit definition to a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	definition	The definition of the unit (e.g., "kg.m/s2").  May be
+ *			freed upon return.
+ *	encoding	The encoding of "definition".
+ * Returns:
+ *	NULL		Failure.  "ut_get_status()" will be UT_OS.
+ *	else		Pointer to the deferred definition, which is owned by
+ *			"system".
+ */
+LazyUnit*
+luNew(
+    ut_system* const	system,
+    const char* const	definition,
+    const ut_encoding	encoding);
+
+
+/*
+ * Adds a mapping to a deferred unit definition.  The mapping is made when the
+ * unit is materialized.  If it's an identifier-to-unit mapping, then the
+ * identifier will materialize the unit when it's looked up.
+ *
+ * Arguments:
+ *	lazy		Pointer to the deferred definition.
+ *	id		The identifier.  May be freed upon return.
+ *	encoding	The encoding of "id".
+ *	isName		Whether "id" is a name or a symbol.
+ *	toUnit		Whether the mapping is from "id" to the unit or from the
+ *			unit to "id".
+ * Returns:
+ *	0		Failure.  "ut_get_status()" will be UT_OS.
+ *	else		Success.
+ */
+int
+luAddMapping(
+    LazyUnit* const	lazy,
+    const char* const	id,
+    const ut_encoding	encoding,
+    const int		isName,
+    const int		toUnit);
+
+
+/*
+ * Materializes a deferred unit definition: parses the definition and makes
+ * its mappings.
+ *
+ * Arguments:
+ *	lazy		Pointer to the deferred definition.
+ * Returns:
+ *	NULL		Failure.  "ut_get_status()" will be UT_PARSE or the
+ *			status of the failed mapping.
+ *	else		Pointer to the unit.  The client should pass it to
+ *			ut_free() when it's no longer needed.
+ */
+ut_unit*
+luMaterializeUnit(
+    LazyUnit* const	lazy);
+
+
+/*
+ * Materializes the deferred unit definition to which an identifier maps if
+ * it hasn't been materialized.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	id		The identifier.
+ *	isName		Whether "id" is a name or a symbol.
+ * Returns:
+ *	0		"id" doesn't map to a pending definition or the
+ *			definition couldn't be materialized.
+ *	else		The definition was materialized.
+ */
+int
+luMaterialize(
+    const ut_system* const	system,
+    const char* const		id,
+    const int			isName);
+
+
+/*
+ * Indicates if a unit-system has no deferred unit definitions that are
+ * pending or being materialized.  Looking up units in such a unit-system
+ * doesn't modify it.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	0		"system" has pending deferred definitions.
+ *	else		All the deferred definitions of "system", if any, have
+ *			been materialized.
+ */
+int
+luIsComplete(
+    const ut_system* const	system);
+
+
+/*
+ * Materializes all the pending deferred unit definitions of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	else		The status of the first failure.
+ */
+ut_status
+luMaterializeAll(
+    const ut_system* const	system);
+
+
+/*
+ * Frees the deferred unit definitions of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ */
+void
+luFreeSystem(
+    ut_system* const	system);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,378 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Concurrent parsing of unit specifications ahead of their use by a reader of
+ * a unit-database.
+ *
+ * A reader that's about to process the definitions of a file collects the
+ * specifications and identifiers that it will parse and parses them all at
+ * once, concurrently, in the unit-system as it is before the file is
+ * processed.  Each parse records the identifiers that it looks up.  While the
+ * file is processed, the reader records the identifiers that it maps.  A
+ * result is used only if none of the identifiers that its parse looked up has
+ * been mapped since, in which case the parse would have looked up the same
+ * units and produced the same result; otherwise, the reader parses the string
+ * itself.  This respects the dependencies between the definitions of a file
+ * without having to determine them.
+ */
+
+/*LINTLIBRARY*/
+
+#include "config.h"
+
+#include "frozenSystem.h"
+#include "idToUnitMap.h"
+#include "parseAhead.h"
+#include "threadPool.h"
+#include "udunits2.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Number of strings parsed by one task of paRun().
+ */
+#define PA_CHUNK_SIZE	32
+
+typedef struct {
+    char*		string;
+    ut_encoding		encoding;
+    ut_unit*		unit;		/* result of ut_parse() */
+    ut_status		status;		/* status set by ut_parse() */
+    char*		lookups;	/* looked-up identifiers, NUL-separated */
+    size_t		nbytes;		/* number of bytes in "lookups" */
+    size_t		capacity;	/* capacity of "lookups" in bytes */
+    int			parsed;		/* parsed and lookups recorded? */
+} Speculation;
+
+struct ParseAhead {
+    Speculation**	specs;
+    size_t		count;
+    size_t		capacity;
+    FrozenTable		index;		/* Speculation -> Speculation */
+    FrozenTable		mapped;		/* folded identifier -> itself */
+    int			valid;		/* paInvalidate() not called? */
+};
+
+
+static unsigned long
+specHash(
+    const char* const	string,
+    const ut_encoding	encoding)
+{
+    return FS_HASH_STEP(fsHashString(string, 0), encoding);
+}
+
+
+static int
+specMatches(
+    const void* const	query,
+    const void* const	key)
+{
+    const Speculation* const	q = (const Speculation*)query;
+    const Speculation* const	k = (const Speculation*)key;
+
+    return q->encoding == k->encoding && strcmp(q->string, k->string) == 0;
+}
+
+
+static int
+foldedMatches(
+    const void* const	query,
+    const void* const	key)
+{
+    const char*	q = (const char*)query;
+    const char*	k = (const char*)key;
+
+    while (*k != 0 && FS_FOLD(*q) == (unsigned char)*k) {
+	q++;
+	k++;
+    }
+
+    return *q == 0 && *k == 0;
+}
+
+
+ParseAhead*
+paNew(void)
+{
+    ParseAhead*	pa = calloc(1, sizeof(ParseAhead));
+
+    if (pa != NULL)
+	pa->valid = 1;
+
+    return pa;
+}
+
+
+int
+paAdd(
+    ParseAhead* const	pa,
+    const char* const	string,
+    const ut_encoding	encoding)
+{
+    int			status = 0;
+    Speculation		query;
+    const unsigned long	hash = specHash(string, encoding);
+
+    query.string = (char*)string;
+    query.encoding = encoding;
+
+    if (ftFind(&pa->index, hash, &query, specMatches) == NULL) {
+	Speculation*	spec = NULL;
+
+	if (pa->count == pa->capacity) {
+	    const size_t		capacity =
+		pa->capacity == 0 ? 256 : 2*pa->capacity;
+	    Speculation** const	specs =
+		realloc(pa->specs, capacity*sizeof(Speculation*));
+
+	    if (specs != NULL) {
+		pa->specs = specs;
+		pa->capacity = capacity;
+	    }
+	}
+
+	if (pa->count < pa->capacity)
+	    spec = calloc(1, sizeof(Speculation));
+
+	if (spec != NULL) {
+	    spec->string = strdup(string);
+	    spec->encoding = encoding;
+
+	    if (spec->string == NULL ||
+		    ftAdd(&pa->index, hash, spec, spec) != 0) {
+		free(spec->string);
+		free(spec);
+		spec = NULL;
+	    }
+	}
+
+	if (spec == NULL) {
+	    status = -1;
+	}
+	else {
+	    pa->specs[pa->count++] = spec;
+	}
+    }
+
+    return status;
+}
+
+
+/*
+ * Records an identifier that's looked up by the parse of a string.
+ */
+static void
+recordLookup(
+    void* const		arg,
+    const char* const	id)
+{
+    Speculation* const	spec = (Speculation*)arg;
+    const size_t	len = strlen(id) + 1;
+
+    if (spec->parsed) {
+	if (spec->nbytes + len > spec->capacity) {
+	    const size_t	capacity = 2*(spec->nbytes + len);
+	    char* const		lookups = realloc(spec->lookups, capacity);
+
+	    if (lookups == NULL) {
+		spec->parsed = 0;	/* the result mustn't be used */
+	    }
+	    else {
+		spec->lookups = lookups;
+		spec->capacity = capacity;
+	    }
+	}
+
+	if (spec->parsed) {
+	    (void)memcpy(spec->lookups + spec->nbytes, id, len);
+	    spec->nbytes += len;
+	}
+    }
+}
+
+
+typedef struct {
+    ParseAhead*		pa;
+    const ut_system*	system;
+} ParseAheadJob;
+
+
+/*
+ * Parses a chunk of the strings of a set.
+ *
+ * Arguments:
+ *	arg		Pointer to the ParseAheadJob.
+ *	index		Origin-0 index of the chunk.
+ */
+static void
+parseChunk(
+    void* const		arg,
+    const size_t	index)
+{
+    const ParseAheadJob* const	job = (const ParseAheadJob*)arg;
+    const size_t		begin = index * PA_CHUNK_SIZE;
+    const size_t		end = begin + PA_CHUNK_SIZE < job->pa->count
+	? begin + PA_CHUNK_SIZE
+	: job->pa->count;
+    size_t			i;
+    ut_error_message_handler	prevHandler;
+
+    /*
+     * Many of the strings, like identifiers that aren't defined yet, don't
+     * parse, which isn't worth reporting.
+     */
+    prevHandler = ut_set_thread_error_message_handler(ut_ignore);
+
+    for (i = begin; i < end; i++) {
+	Speculation* const	spec = job->pa->specs[i];
+
+	spec->parsed = 1;
+
+	itumObserveLookups(recordLookup, spec);
+	spec->unit = ut_parse(job->system, spec->string, spec->encoding);
+	spec->status = ut_get_status();
+	itumObserveLookups(NULL, NULL);
+    }
+
+    (void)ut_set_thread_error_message_handler(prevHandler);
+}
+
+
+void
+paRun(
+    ParseAhead* const		pa,
+    const ut_system* const	system)
+{
+    ParseAheadJob	job;
+
+    job.pa = pa;
+    job.system = system;
+
+    tpRun((pa->count + PA_CHUNK_SIZE - 1) / PA_CHUNK_SIZE, parseChunk, &job);
+}
+
+
+void
+paMapped(
+    ParseAhead* const	pa,
+    const char* const	id)
+{
+    const unsigned long	hash = fsHashString(id, 1);
+
+    if (pa->valid && ftFind(&pa->mapped, hash, id, foldedMatches) == NULL) {
+	char* const	key = strdup(id);
+
+	if (key == NULL) {
+	    pa->valid = 0;		/* the mapping couldn't be recorded */
+	}
+	else {
+	    char*	cp;
+
+	    for (cp = key; *cp != 0; cp++)
+		*cp = (char)FS_FOLD(*cp);
+
+	    if (ftAdd(&pa->mapped, hash, key, key) != 0) {
+		free(key);
+		pa->valid = 0;
+	    }
+	}
+    }
+}
+
+
+void
+paInvalidate(
+    ParseAhead* const	pa)
+{
+    pa->valid = 0;
+}
+
+
+int
+paTake(
+    ParseAhead* const		pa,
+    const char* const		string,
+    const ut_encoding		encoding,
+    ut_unit** const		unit)
+{
+    int			taken = 0;
+    Speculation		query;
+    Speculation*	spec;
+
+    query.string = (char*)string;
+    query.encoding = encoding;
+
+    spec = pa == NULL || !pa->valid
+	? NULL
+	: ftFind(&pa->index, specHash(string, encoding), &query, specMatches);
+
+    if (spec != NULL && spec->parsed) {
+	const char*	id = spec->lookups;
+	const char*	end = id + spec->nbytes;
+
+	for (; id < end; id += strlen(id) + 1) {
+	    if (ftFind(&pa->mapped, fsHashString(id, 1), id, foldedMatches)
+		    != NULL)
+		break;
+	}
+
+	if (id >= end) {
+	    /*
+	     * The unit is handed over, so a string that's parsed again must be
+	     * parsed by the client.
+	     */
+	    *unit = spec->unit;
+	    taken = 1;
+
+	    if (spec->unit != NULL) {
+		spec->unit = NULL;
+		spec->parsed = 0;
+	    }
+
+	    ut_set_status(spec->status);
+	}
+    }
+
+    return taken;
+}
+
+
+static void
+freeKey(
+    const void* const	key,
+    void* const		value)
+{
+    free((void*)key);
+}
+
+
+void
+paFree(
+    ParseAhead* const	pa)
+{
+    if (pa != NULL) {
+	size_t	i;
+
+	for (i = 0; i < pa->count; i++) {
+	    Speculation* const	spec = pa->specs[i];
+
+	    ut_free(spec->unit);
+	    free(spec->lookups);
+	    free(spec->string);
+	    free(spec);
+	}
+
+	ftForEach(&pa->mapped, freeKey);
+	ftDestroy(&pa->mapped);
+	ftDestroy(&pa->index);
+	free(pa->specs);
+	free(pa);
+    }
+}
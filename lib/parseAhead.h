@@ -0,0 +1,138 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Concurrent parsing of unit specifications ahead of their use by a reader of
+ * a unit-database.  See parseAhead.c.
+ */
+#ifndef UT_PARSE_AHEAD_H_INCLUDED
+#define UT_PARSE_AHEAD_H_INCLUDED
+
+#include "udunits2.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct ParseAhead	ParseAhead;
+
+
+/*
+ * Returns a new, empty set of strings to be parsed ahead.
+ *
+ * Returns:
+ *	NULL		Failure.  See "errno".
+ *	else		Pointer to the set.  Should be passed to paFree().
+ */
+ParseAhead*
+paNew(void);
+
+
+/*
+ * Adds a string to be parsed ahead.  Adding a string that's already in the
+ * set does nothing.
+ *
+ * Arguments:
+ *	pa		Pointer to the set.
+ *	string		The string.  May be freed upon return.
+ *	encoding	The encoding of "string".
+ * Returns:
+ *	0		Success.
+ *	-1		Failure.  See "errno".
+ */
+int
+paAdd(
+    ParseAhead* const	pa,
+    const char* const	string,
+    const ut_encoding	encoding);
+
+
+/*
+ * Parses the strings of a set in a unit-system using the thread-pool of the
+ * library.  The unit-system must not be modified until this function returns.
+ *
+ * Arguments:
+ *	pa		Pointer to the set.
+ *	system		Pointer to the unit-system.
+ */
+void
+paRun(
+    ParseAhead* const		pa,
+    const ut_system* const	system);
+
+
+/*
+ * Records that an identifier was mapped to a unit in the unit-system after
+ * paRun() was called.  The results of the strings whose parse looked up the
+ * identifier are no longer used.
+ *
+ * Arguments:
+ *	pa		Pointer to the set.
+ *	id		The identifier.
+ */
+void
+paMapped(
+    ParseAhead* const	pa,
+    const char* const	id);
+
+
+/*
+ * Records that the unit-system was modified in a way other than by mapping
+ * identifiers (e.g., by adding a prefix) after paRun() was called.  No
+ * results are used afterwards.
+ *
+ * Arguments:
+ *	pa		Pointer to the set.
+ */
+void
+paInvalidate(
+    ParseAhead* const	pa);
+
+
+/*
+ * Returns the result of parsing a string ahead if it's still what ut_parse()
+ * would return.  A unit is returned only once.
+ *
+ * Arguments:
+ *	pa		Pointer to the set or NULL.
+ *	string		The string.
+ *	encoding	The encoding of "string".
+ *	unit		Pointer to the unit that ut_parse() would return.  Set
+ *			on success.  The client should pass it to ut_free()
+ *			when it's no longer needed.
+ * Returns:
+ *	0		No result is available.  The client should call
+ *			ut_parse().
+ *	else		"*unit" is set and "ut_get_status()" is the status
+ *			that ut_parse() would set.
+ */
+int
+paTake(
+    ParseAhead* const		pa,
+    const char* const		string,
+    const ut_encoding		encoding,
+    ut_unit** const		unit);
+
+
+/*
+ * Frees a set of strings to be parsed ahead.
+ *
+ * Arguments:
+ *	pa		Pointer to the set or NULL.
+ */
+void
+paFree(
+    ParseAhead* const	pa);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,535 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Per-unit-system cache of parsed unit specifications.
+ *
+ * The cache maps a (string, encoding) pair to the unit that resulted from
+ * parsing it.  It's bounded: when it's full, the least-recently used entry is
+ * evicted.  It's disabled (i.e., has a capacity of zero) by default.
+ *
+ * Lookups and insertions are serialized by a mutex, so threads may parse
+ * concurrently in the same unit-system.  Changing the capacity of a cache
+ * must not be concurrent with other use of its unit-system.
+ */
+
+/*LINTLIBRARY*/
+
+#include "config.h"
+
+#include "arena.h"
+#include "parseCache.h"
+#include "udunits2.h"
+#include "systemMap.h"
+#include "threadSupport.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct CacheEntry {
+    struct CacheEntry*	next;		/* next entry in hash-bucket */
+    struct CacheEntry*	newer;		/* more recently used entry */
+    struct CacheEntry*	older;		/* less recently used entry */
+    char*		string;		/* parsed string */
+    ut_unit*		unit;		/* result of parsing "string" */
+    unsigned long	hash;		/* hash of "string" and "encoding" */
+    ut_encoding		encoding;	/* encoding of "string" */
+} CacheEntry;
+
+typedef struct {
+    CacheEntry**	buckets;	/* hash-table */
+    CacheEntry*		newest;		/* most recently used entry */
+    CacheEntry*		oldest;		/* least recently used entry */
+    size_t		bucketCount;	/* number of buckets; power of two */
+    size_t		count;		/* number of entries */
+    size_t		capacity;	/* maximum number of entries */
+    unsigned long	hits;		/* number of successful lookups */
+    unsigned long	misses;		/* number of unsuccessful lookups */
+} ParseCache;
+
+static SystemMap*	systemToParseCache = NULL;
+static UtMutex		cacheMutex = UT_MUTEX_INITIALIZER;
+
+
+/*
+ * Returns the hash of a string and its encoding (FNV-1a).
+ */
+static unsigned long
+hashString(
+    const char* const	string,
+    const ut_encoding	encoding)
+{
+    const unsigned char*	cp = (const unsigned char*)string;
+    unsigned long		hash = 2166136261UL ^ (unsigned long)encoding;
+
+    while (*cp)
+	hash = ((hash ^ *cp++) * 16777619UL) & 0xffffffffUL;
+
+    return hash;
+}
+
+
+static void
+ceFree(
+    CacheEntry* const	entry)
+{
+    if (entry != NULL) {
+	ut_free(entry->unit);
+	free(entry->string);
+	free(entry);
+    }
+}
+
+
+/*
+ * Removes an entry from the recently-used list of a parse-cache.
+ */
+static void
+pcUnlink(
+    ParseCache* const	cache,
+    CacheEntry* const	entry)
+{
+    if (entry->newer == NULL) {
+	cache->newest = entry->older;
+    }
+    else {
+	entry->newer->older = entry->older;
+    }
+
+    if (entry->older == NULL) {
+	cache->oldest = entry->newer;
+    }
+    else {
+	entry->older->newer = entry->newer;
+    }
+
+    entry->newer = entry->older = NULL;
+}
+
+
+/*
+ * Makes an entry the most recently used one of a parse-cache.
+ */
+static void
+pcPushNewest(
+    ParseCache* const	cache,
+    CacheEntry* const	entry)
+{
+    entry->older = cache->newest;
+    entry->newer = NULL;
+
+    if (cache->newest == NULL) {
+	cache->oldest = entry;
+    }
+    else {
+	cache->newest->newer = entry;
+    }
+
+    cache->newest = entry;
+}
+
+
+/*
+ * Removes and frees the least recently used entry of a parse-cache.
+ */
+static void
+pcEvictOldest(
+    ParseCache* const	cache)
+{
+    CacheEntry* const	entry = cache->oldest;
+
+    if (entry != NULL) {
+	CacheEntry**	link =
+	    &cache->buckets[entry->hash & (cache->bucketCount - 1)];
+
+	while (*link != entry)
+	    link = &(*link)->next;
+
+	*link = entry->next;
+
+	pcUnlink(cache, entry);
+	ceFree(entry);
+	cache->count--;
+    }
+}
+
+
+/*
+ * Removes all entries from a parse-cache.
+ */
+static void
+pcClear(
+    ParseCache* const	cache)
+{
+    while (cache->oldest != NULL)
+	pcEvictOldest(cache);
+}
+
+
+/*
+ * Frees a parse-cache and all its entries.
+ */
+static void
+pcFree(
+    ParseCache* const	cache)
+{
+    if (cache != NULL) {
+	pcClear(cache);
+	free(cache->buckets);
+	free(cache);
+    }
+}
+
+
+/*
+ * Returns the parse-cache of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	NULL		"system" doesn't have a parse-cache or the parse-cache
+ *			is disabled.
+ *	else		Pointer to the enabled parse-cache of "system".
+ */
+static ParseCache*
+getEnabledCache(
+    const ut_system* const	system)
+{
+    ParseCache*	cache = NULL;
+
+    if (systemToParseCache != NULL) {
+	ParseCache** const	entry =
+	    (ParseCache**)smFind(systemToParseCache, system);
+
+	if (entry != NULL && *entry != NULL && (*entry)->capacity > 0)
+	    cache = *entry;
+    }
+
+    return cache;
+}
+
+
+/*
+ * Returns the entry of a parse-cache corresponding to a string and encoding.
+ */
+static CacheEntry*
+pcLookup(
+    const ParseCache* const	cache,
+    const char* const		string,
+    const ut_encoding		encoding,
+    const unsigned long		hash)
+{
+    CacheEntry*	entry = cache->buckets[hash & (cache->bucketCount - 1)];
+
+    for (; entry != NULL; entry = entry->next) {
+	if (entry->hash == hash && entry->encoding == encoding &&
+		strcmp(entry->string, string) == 0)
+	    break;
+    }
+
+    return entry;
+}
+
+
+ut_unit*
+pcFind(
+    const ut_system* const	system,
+    const char* const		string,
+    const ut_encoding		encoding)
+{
+    ut_unit*		unit = NULL;
+    ParseCache* const	cache = getEnabledCache(system);
+
+    if (cache != NULL) {
+	CacheEntry*	entry;
+
+	UT_MUTEX_LOCK(&cacheMutex);
+
+	entry = pcLookup(cache, string, encoding, hashString(string, encoding));
+
+	if (entry == NULL) {
+	    cache->misses++;
+	}
+	else {
+	    cache->hits++;
+
+	    if (entry != cache->newest) {
+		pcUnlink(cache, entry);
+		pcPushNewest(cache, entry);
+	    }
+
+	    unit = ut_clone(entry->unit);
+	}
+
+	UT_MUTEX_UNLOCK(&cacheMutex);
+    }
+
+    return unit;
+}
+
+
+void
+pcAdd(
+    const ut_system* const	system,
+    const char* const		string,
+    const ut_encoding		encoding,
+    const ut_unit* const	unit)
+{
+    ParseCache* const	cache = getEnabledCache(system);
+
+    if (cache != NULL) {
+	const unsigned long	hash = hashString(string, encoding);
+
+	UT_MUTEX_LOCK(&cacheMutex);
+
+	if (pcLookup(cache, string, encoding, hash) == NULL) {
+	    CacheEntry*	entry = malloc(sizeof(CacheEntry));
+
+	    if (entry != NULL) {
+		entry->string = strdup(string);
+		entry->unit = arenaCloneToHeap(unit);
+
+		if (entry->string == NULL || entry->unit == NULL) {
+		    ceFree(entry);
+		}
+		else {
+		    CacheEntry** const	bucket =
+			&cache->buckets[hash & (cache->bucketCount - 1)];
+
+		    if (cache->count >= cache->capacity)
+			pcEvictOldest(cache);
+
+		    entry->hash = hash;
+		    entry->encoding = encoding;
+		    entry->next = *bucket;
+		    *bucket = entry;
+
+		    pcPushNewest(cache, entry);
+		    cache->count++;
+		}
+	    }				/* "entry" allocated */
+	}				/* "string" not in cache */
+
+	UT_MUTEX_UNLOCK(&cacheMutex);
+    }					/* cache enabled */
+}
+
+
+void
+pcFlush(
+    const ut_system* const	system)
+{
+    ParseCache* const	cache = getEnabledCache(system);
+
+    if (cache != NULL) {
+	UT_MUTEX_LOCK(&cacheMutex);
+	pcClear(cache);
+	UT_MUTEX_UNLOCK(&cacheMutex);
+    }
+}
+
+
+void
+pcFreeSystem(
+    ut_system*	system)
+{
+    if (system != NULL && systemToParseCache != NULL) {
+	ParseCache** const	cache =
+	    (ParseCache**)smFind(systemToParseCache, system);
+
+	if (cache != NULL)
+	    pcFree(*cache);
+
+	smRemove(systemToParseCache, system);
+    }
+}
+
+
+/*
+ * Sets the capacity of the parse-cache of a unit-system.  When the cache is
+ * enabled, ut_parse() returns a copy of the unit that resulted from a previous
+ * parse of an identical string with the same encoding instead of re-parsing
+ * it.  The cache is disabled by default.  Changing the capacity empties the
+ * cache but doesn't reset its hit and miss counters.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	capacity	Maximum number of entries in the cache.  If zero, then
+ *			the cache is disabled.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" is NULL.
+ *	UT_OS		Operating-system failure.  See "errno".
+ */
+ut_status
+ut_set_parse_cache_capacity(
+    ut_system* const	system,
+    const size_t	capacity)
+{
+    ut_set_status(UT_SUCCESS);
+
+    if (system == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message(
+	    "ut_set_parse_cache_capacity(): NULL unit-system argument");
+    }
+    else {
+	if (systemToParseCache == NULL) {
+	    systemToParseCache = smNew();
+
+	    if (systemToParseCache == NULL)
+		ut_set_status(UT_OS);
+	}
+
+	if (systemToParseCache != NULL) {
+	    ParseCache** const	entry =
+		(ParseCache**)smSearch(systemToParseCache, system);
+
+	    if (entry == NULL) {
+		ut_set_status(UT_OS);
+	    }
+	    else {
+		ParseCache*	cache = *entry;
+
+		if (cache == NULL) {
+		    cache = calloc(1, sizeof(ParseCache));
+
+		    if (cache == NULL) {
+			ut_set_status(UT_OS);
+		    }
+		    else {
+			*entry = cache;
+		    }
+		}
+
+		if (cache != NULL) {
+		    CacheEntry**	buckets = NULL;
+		    size_t		bucketCount = 0;
+
+		    if (capacity > 0) {
+			for (bucketCount = 1; bucketCount < capacity;
+				bucketCount <<= 1)
+			    ;		/* EMPTY */
+
+			buckets = calloc(bucketCount, sizeof(CacheEntry*));
+		    }
+
+		    if (capacity > 0 && buckets == NULL) {
+			ut_set_status(UT_OS);
+			ut_handle_error_message(
+			    "ut_set_parse_cache_capacity(): "
+			    "Couldn't allocate %lu-element hash-table",
+			    (unsigned long)bucketCount);
+		    }
+		    else {
+			pcClear(cache);
+			free(cache->buckets);
+
+			cache->buckets = buckets;
+			cache->bucketCount = bucketCount;
+			cache->capacity = capacity;
+		    }
+		}			/* "cache" allocated */
+	    }				/* have system-map entry */
+	}				/* have system-map */
+    }					/* valid arguments */
+
+    return ut_get_status();
+}
+
+
+/*
+ * Removes all entries from the parse-cache of a unit-system.  The cache
+ * remains enabled if it was.  The hit and miss counters are reset.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" is NULL.
+ */
+ut_status
+ut_flush_parse_cache(
+    ut_system* const	system)
+{
+    ut_set_status(UT_SUCCESS);
+
+    if (system == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message(
+	    "ut_flush_parse_cache(): NULL unit-system argument");
+    }
+    else if (systemToParseCache != NULL) {
+	ParseCache** const	cache =
+	    (ParseCache**)smFind(systemToParseCache, system);
+
+	if (cache != NULL && *cache != NULL) {
+	    UT_MUTEX_LOCK(&cacheMutex);
+	    pcClear(*cache);
+	    (*cache)->hits = 0;
+	    (*cache)->misses = 0;
+	    UT_MUTEX_UNLOCK(&cacheMutex);
+	}
+    }
+
+    return ut_get_status();
+}
+
+
+/*
+ * Returns statistics on the parse-cache of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	count		NULL or pointer to the number of entries in the cache.
+ *	hits		NULL or pointer to the number of times ut_parse() found
+ *			its string in the cache.
+ *	misses		NULL or pointer to the number of times ut_parse() didn't
+ *			find its string in the enabled cache.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" is NULL.
+ */
+ut_status
+ut_get_parse_cache_stats(
+    const ut_system* const	system,
+    size_t* const		count,
+    unsigned long* const	hits,
+    unsigned long* const	misses)
+{
+    ut_set_status(UT_SUCCESS);
+
+    if (system == NULL) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message(
+	    "ut_get_parse_cache_stats(): NULL unit-system argument");
+    }
+    else {
+	const ParseCache*	cache = NULL;
+
+	if (systemToParseCache != NULL) {
+	    ParseCache** const	entry =
+		(ParseCache**)smFind(systemToParseCache, system);
+
+	    if (entry != NULL)
+		cache = *entry;
+	}
+
+	UT_MUTEX_LOCK(&cacheMutex);
+
+	if (count != NULL)
+	    *count = cache == NULL ? 0 : cache->count;
+	if (hits != NULL)
+	    *hits = cache == NULL ? 0 : cache->hits;
+	if (misses != NULL)
+	    *misses = cache == NULL ? 0 : cache->misses;
+
+	UT_MUTEX_UNLOCK(&cacheMutex);
+    }
+
+    return ut_get_status();
+}
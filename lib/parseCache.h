@@ -0,0 +1,89 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+#ifndef UT_PARSE_CACHE_H_INCLUDED
+#define UT_PARSE_CACHE_H_INCLUDED
+
+#include "udunits2.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * Returns a copy of the unit that resulted from a previous, successful parse
+ * of a string in a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	string		The string that was parsed.
+ *	encoding	The encoding of "string".
+ * Returns:
+ *	NULL		The parse-cache of "system" is disabled or doesn't
+ *			contain "string".
+ *	else		Pointer to a copy of the cached unit.  The client
+ *			should pass it to ut_free() when it's no longer needed.
+ */
+ut_unit*
+pcFind(
+    const ut_system* const	system,
+    const char* const		string,
+    const ut_encoding		encoding);
+
+
+/*
+ * Adds the result of a successful parse to the parse-cache of a unit-system.
+ * Does nothing if the cache is disabled.  The least-recently used entry is
+ * evicted if the cache is full.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	string		The string that was parsed.  May be freed upon return.
+ *	encoding	The encoding of "string".
+ *	unit		The resulting unit.  A copy is cached, so "unit" may
+ *			be freed upon return.
+ */
+void
+pcAdd(
+    const ut_system* const	system,
+    const char* const		string,
+    const ut_encoding		encoding,
+    const ut_unit* const	unit);
+
+
+/*
+ * Removes all entries from the parse-cache of a unit-system.  Called whenever
+ * the identifier or prefix mappings of the unit-system change.  The hit and
+ * miss counters are not reset.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ */
+void
+pcFlush(
+    const ut_system* const	system);
+
+
+/*
+ * Frees resources associated with a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system to have its associated
+ *			resources freed.
+ */
+void
+pcFreeSystem(
+    ut_system*	system);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
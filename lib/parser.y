@@ -10,15 +10,21 @@
 /*
  * bison(1)-based parser for decoding formatted unit specifications.
  *
- * This module is thread-compatible but not thread-safe: multi-threaded access
- * must be externally synchronized.
+ * The parser and scanner are reentrant: all state of a parse is in a
+ * ParseContext and a scanner on the stack of ut_parse(), so different threads
+ * may parse concurrently in the same unit-system.
  */
 
 /*LINTLIBRARY*/
 
 #include "config.h"
 
+#include "frozenSystem.h"
+#include "lazyUnits.h"
+#include "parseCache.h"
 #include "prefix.h"
+#include "stats.h"
+#include "threadPool.h"
 #include "udunits2.h"
 
 #include <assert.h>
@@ -32,14 +38,15 @@
 #include <strings.h>
 #endif
 
-extern int utlex (void);
-
-static ut_unit*		_finalUnit;	/* fully-parsed specification */
-static ut_system*	_unitSystem;	/* The unit-system to use */
-static char*		_errorMessage;	/* last error-message */
-static ut_encoding	_encoding;	/* encoding of string to be parsed */
-static int		_restartScanner;/* restart scanner? */
-static int		_isTime;        /* product_exp is time? */
+/*
+ * State of a parse that's shared by the parser and the scanner.
+ */
+typedef struct {
+    ut_unit*		finalUnit;	/* fully-parsed specification */
+    ut_system*		unitSystem;	/* The unit-system to use */
+    int			isTime;		/* product_exp is time? */
+    size_t		consumed;	/* number of bytes scanned */
+} ParseContext;
 
 
 /*
@@ -88,21 +95,14 @@ ut_trim(
 
 
 /*
- *  YACC error routine:
+ *  YACC error routine.  Syntax errors are reported via ut_get_status().
  */
-void
+static void
 uterror(
-    char        	*s)
+    ParseContext* const	context,
+    void* const		scanner,
+    const char* const	s)
 {
-    static char*	nomem = "uterror(): out of memory";
-
-    if (_errorMessage != NULL && _errorMessage != nomem)
-	free(_errorMessage);
-
-    _errorMessage = strdup(s);
-
-    if (_errorMessage == NULL)
-	_errorMessage = nomem;
 }
 
 /**
@@ -192,10 +192,11 @@ static int clock_to_time(
  * @retval    0         If and only if the unit is not a time unit.
  */
 static int isTime(
+    const ut_system* const system,
     const ut_unit* const unit)
 {
     ut_status   prev = ut_get_status();
-    ut_unit*    second = ut_get_unit_by_name(_unitSystem, "second");
+    ut_unit*    second = ut_get_unit_by_name(system, "second");
     int         isTime = ut_are_convertible(unit, second);
 
     ut_free(second);
@@ -205,6 +206,11 @@ static int isTime(
 
 %}
 
+%define api.pure
+%parse-param {ParseContext* const context}
+%parse-param {void* const scanner}
+%lex-param {void* const scanner}
+
 %union {
     char*	id;			/* identifier */
     ut_unit*	unit;			/* "unit" structure */
@@ -212,6 +218,10 @@ static int isTime(
     long	ival;			/* integer numerical value */
 }
 
+%{
+extern int utlex(YYSTYPE* lvalp, void* scanner);
+%}
+
 %token  	ERR
 %token		SHIFT
 %token  	MULTIPLY
@@ -236,11 +246,12 @@ static int isTime(
 %%
 
 unit_spec:      /* nothing */ {
-		    _finalUnit = ut_get_dimensionless_unit_one(_unitSystem);
+		    context->finalUnit =
+			ut_get_dimensionless_unit_one(context->unitSystem);
 		    YYACCEPT;
 		} |
 		shift_exp {
-		    _finalUnit = $1;
+		    context->finalUnit = $1;
 		    YYACCEPT;
 		} |
 		error {
@@ -279,11 +290,11 @@ shift_exp:	product_exp {
 
 product_exp:	power_exp {
 		    $$ = $1;
-                    _isTime = isTime($$);
+                    context->isTime = isTime(context->unitSystem, $$);
 		} |
 		product_exp power_exp	{
 		    $$ = ut_multiply($1, $2);
-                    _isTime = isTime($$);
+                    context->isTime = isTime(context->unitSystem, $$);
 		    ut_free($1);
 		    ut_free($2);
 		    if ($$ == NULL)
@@ -297,7 +308,7 @@ product_exp:	power_exp {
 		} |
 		product_exp MULTIPLY power_exp	{
 		    $$ = ut_multiply($1, $3);
-                    _isTime = isTime($$);
+                    context->isTime = isTime(context->unitSystem, $$);
 		    ut_free($1);
 		    ut_free($3);
 		    if ($$ == NULL)
@@ -311,7 +322,7 @@ product_exp:	power_exp {
 		} |
 		product_exp DIVIDE power_exp	{
 		    $$ = ut_divide($1, $3);
-                    _isTime = isTime($$);
+                    context->isTime = isTime(context->unitSystem, $$);
 		    ut_free($1);
 		    ut_free($3);
 		    if ($$ == NULL)
@@ -349,41 +360,44 @@ power_exp:	basic_exp {
 		;
 
 basic_exp:	ID {
-		    double	prefix = 1;
-		    ut_unit*	unit = NULL;
-		    char*	cp = $1;
-		    int		symbolPrefixSeen = 0;
+		    double		prefix = 1;
+		    const ut_unit*	unit = NULL;
+		    char*		cp = $1;
+		    int			symbolPrefixSeen = 0;
 
 		    while (*cp) {
-			size_t	nchar;
-			double	value;
+			size_t	nameLen;
+			size_t	symbolLen;
+			double	nameValue;
+			double	symbolValue;
 
-			unit = ut_get_unit_by_name(_unitSystem, cp);
+			unit = ut_get_unit_by_name_ref(context->unitSystem, cp);
 
 			if (unit != NULL)
 			    break;
 
-			unit = ut_get_unit_by_symbol(_unitSystem, cp);
+			unit = ut_get_unit_by_symbol_ref(context->unitSystem,
+			    cp);
 
 			if (unit != NULL)
 			    break;
 
-			if (utGetPrefixByName(_unitSystem, cp, &value, &nchar)
-				== UT_SUCCESS) {
-			    prefix *= value;
-			    cp += nchar;
+			if (utGetPrefixes(context->unitSystem, cp, &nameValue,
+				&nameLen, &symbolValue, &symbolLen)
+				!= UT_SUCCESS)
+			    break;
+
+			if (nameValue != 0) {
+			    prefix *= nameValue;
+			    cp += nameLen;
+			}
+			else if (!symbolPrefixSeen && symbolValue != 0) {
+			    symbolPrefixSeen = 1;
+			    prefix *= symbolValue;
+			    cp += symbolLen;
 			}
 			else {
-			    if (!symbolPrefixSeen &&
-				    utGetPrefixBySymbol(_unitSystem, cp, &value,
-					&nchar) == UT_SUCCESS) {
-				symbolPrefixSeen = 1;
-				prefix *= value;
-				cp += nchar;
-			    }
-			    else {
-				break;
-			    }
+			    break;
 			}
 		    }
 
@@ -396,8 +410,6 @@ basic_exp:	ID {
 
 		    $$ = ut_scale(prefix, unit);
 
-		    ut_free(unit);
-
 		    if ($$ == NULL)
 			YYERROR;
 		} |
@@ -424,7 +436,7 @@ basic_exp:	ID {
 		} |
 		number {
 		    $$ = ut_scale($1,
-                        ut_get_dimensionless_unit_one(_unitSystem));
+                        ut_get_dimensionless_unit_one(context->unitSystem));
 		}
 		;
 
@@ -494,7 +506,6 @@ timestamp:	DATE {
 %%
 
 #define yymaxdepth	utmaxdepth
-#define yylval		utlval
 #define yychar		utchar
 #define yypact		utpact
 #define yyr1		utr1
@@ -541,15 +552,14 @@ timestamp:	DATE {
  *                      upon return.
  * Returns:
  *      NULL            Failure.  ut_handle_error_message() was called.
- *      else            Pointer to UTF-8 representation of "string".  Must not
- *                      be freed.  Subsequent calls may overwrite.
+ *      else            Pointer to UTF-8 representation of "string".  The
+ *                      client should free() it when it's no longer needed.
  */
-static const char*
+static char*
 latin1ToUtf8(
     const char* const   latin1String)
 {
-    static char*                utf8String = NULL;
-    static size_t               bufSize = 0;
+    char*                       utf8String;
     size_t                      size;
     const unsigned char*        in;
     unsigned char*              out;
@@ -557,19 +567,11 @@ latin1ToUtf8(
     assert(latin1String != NULL);
 
     size = 2 * strlen(latin1String) + 1;
+    utf8String = malloc(size);
 
-    if (size > bufSize) {
-        char*   buf = realloc(utf8String, size);
-
-        if (buf != NULL) {
-            utf8String = buf;
-            bufSize = size;
-        }
-        else {
-            ut_handle_error_message("Couldn't allocate %ld-byte buffer: %s",
-                (unsigned long)size, strerror(errno));
-            return NULL;
-        }
+    if (utf8String == NULL) {
+        ut_handle_error_message("Couldn't allocate %ld-byte buffer: %s",
+            (unsigned long)size, strerror(errno));
     }
 
     if (utf8String) {
@@ -592,6 +594,311 @@ latin1ToUtf8(
     return utf8String;
 }
 
+/*
+ * A scanner and the parse-context that it shares with the parser.  One can be
+ * reused for any number of parses by the same thread.
+ */
+typedef struct {
+    ParseContext	context;
+    yyscan_t		scanner;
+} Parser;
+
+
+/*
+ * Initializes a parser.
+ *
+ * Arguments:
+ *	parser		Pointer to the parser to be initialized.
+ *	system		Pointer to the unit-system in which the parsing will
+ *			occur.
+ * Returns:
+ *	0		Success.
+ *	-1		Failure.  "ut_get_status()" will be UT_OS.
+ */
+static int
+parserInit(
+    Parser* const		parser,
+    const ut_system* const	system)
+{
+    int		status = 0;
+
+    parser->context.finalUnit = NULL;
+    parser->context.unitSystem = (ut_system*)system;
+    parser->context.isTime = 0;
+    parser->context.consumed = 0;
+
+    if (utlex_init_extra(&parser->context, &parser->scanner) != 0) {
+	ut_set_status(UT_OS);
+	ut_handle_error_message(
+	    "ut_parse(): Couldn't initialize scanner: %s", strerror(errno));
+	status = -1;
+    }
+
+    return status;
+}
+
+
+/*
+ * Frees the resources of a parser.
+ *
+ * Arguments:
+ *	parser		Pointer to the parser.
+ */
+static void
+parserDestroy(
+    Parser* const	parser)
+{
+    utlex_destroy(parser->scanner);
+}
+
+
+/*
+ * Parses a string that isn't in the parse cache and adds the result to the
+ * parse cache.
+ *
+ * Arguments:
+ *	parser		Pointer to the parser.
+ *	string		The string to be parsed.
+ *	encoding	The encoding of "string".
+ * Returns:
+ *	NULL		Failure.  See ut_parse().
+ *	else		Pointer to the unit corresponding to "string".
+ */
+static ut_unit*
+parserParse(
+    Parser* const		parser,
+    const char* const		string,
+    const ut_encoding		encoding)
+{
+    ut_unit*	unit = NULL;		/* failure */
+    char*	latin1Copy = NULL;
+    const char*	utf8String;
+    UT_STATS_START(start);
+
+    UT_STATS_ADD(parses, 1);
+
+    if (encoding != UT_LATIN1) {
+	utf8String = string;
+    }
+    else {
+	utf8String = latin1Copy = latin1ToUtf8(string);
+
+	if (utf8String == NULL)
+	    ut_set_status(UT_OS);
+    }
+
+    if (utf8String != NULL) {
+	ParseContext* const	context = &parser->context;
+	yyscan_t const		scanner = parser->scanner;
+	YY_BUFFER_STATE		buf = ut_scan_string(utf8String, scanner);
+
+	context->finalUnit = NULL;
+	context->isTime = 0;
+	context->consumed = 0;
+	resetScanner(scanner);
+
+#if YYDEBUG
+	utset_debug(0, scanner);
+#endif
+
+	/*
+	 * The intermediate units of the parse are bump-allocated and released
+	 * together.  Only the final unit is copied to the heap.
+	 */
+	ut_arena_begin();
+
+	if (utparse(context, scanner) == 0) {
+	    int		status;
+
+	    if (context->consumed >= strlen(utf8String)) {
+		unit = context->finalUnit;	/* success */
+		status = UT_SUCCESS;
+	    }
+	    else {
+		/*
+		 * Parsing terminated before the end of the string.
+		 */
+		ut_free(context->finalUnit);
+		status = UT_SYNTAX;
+	    }
+
+	    ut_set_status(status);
+	}
+
+	if (unit == NULL) {
+	    /*
+	     * A syntax error that's detected by the parser itself doesn't set
+	     * the status.
+	     */
+	    const ut_status	status = ut_get_status() == UT_SUCCESS
+		? UT_SYNTAX
+		: ut_get_status();
+
+	    (void)ut_arena_end(NULL);
+	    ut_set_status(status);
+	}
+	else if ((unit = ut_arena_end(unit)) != NULL) {
+	    pcAdd(parser->context.unitSystem, string, encoding, unit);
+	    ut_set_status(UT_SUCCESS);
+	}
+
+	ut_delete_buffer(buf, scanner);
+	free(latin1Copy);
+    }					/* utf8String != NULL */
+
+    UT_STATS_STOP(parseNanoseconds, start);
+
+    return unit;
+}
+
+
+/*
+ * Returns the number of bytes of the letter of the scanner (see "letter" in
+ * scanner.l) at the start of a UTF-8 string.
+ *
+ * Arguments:
+ *	cp		Pointer to the string.
+ * Returns:
+ *	0		The string doesn't start with a letter.
+ *	else		The number of bytes of the letter.
+ */
+static size_t
+letterLength(
+    const unsigned char* const	cp)
+{
+    size_t	len = 0;
+
+    if (cp[0] == '_' || (cp[0] < 0x80 && isalpha(cp[0]))) {
+	len = 1;
+    }
+    else if (cp[0] == 0xc2) {
+	if (cp[1] == 0xa0 || cp[1] == 0xad || cp[1] == 0xb0 || cp[1] == 0xb5)
+	    len = 2;					/* nbsp shy degree mu */
+    }
+    else if (cp[0] == 0xc3) {
+	if (cp[1] >= 0x80 && cp[1] <= 0xbf && cp[1] != 0x97 && cp[1] != 0xb7)
+	    len = 2;					/* not times or divide */
+    }
+    else if (cp[0] >= 0xc8 && cp[0] <= 0xdf) {
+	if ((cp[1] & 0xc0) == 0x80)
+	    len = 2;
+    }
+    else if (cp[0] >= 0xe0 && cp[0] <= 0xef) {
+	if ((cp[1] & 0xc0) == 0x80 && (cp[2] & 0xc0) == 0x80)
+	    len = 3;
+    }
+
+    return len;
+}
+
+
+/*
+ * Indicates if a string is scanned as a single identifier (see "id" in
+ * scanner.l) and nothing else.
+ *
+ * Arguments:
+ *	string		Pointer to the UTF-8 string.
+ * Returns:
+ *	0		The string isn't a single identifier.
+ *	else		The string is a single identifier.
+ */
+static int
+isIdentifier(
+    const char* const	string)
+{
+    static const char* const	keywords[] = {"after", "from", "per", "ref",
+	"since"};
+    const unsigned char*	cp = (const unsigned char*)string;
+    int				isId;
+
+    if ((cp[0] == '%' || cp[0] == '\'' || cp[0] == '"') && cp[1] == 0) {
+	isId = 1;
+    }
+    else {
+	size_t	len = letterLength(cp);
+	int	lastIsLetter = len > 0;
+
+	/*
+	 * The identifier must start and end with a letter.
+	 */
+	while (len > 0) {
+	    cp += len;
+
+	    if (isdigit(*cp)) {
+		len = 1;
+		lastIsLetter = 0;
+	    }
+	    else {
+		len = letterLength(cp);
+
+		if (len > 0)
+		    lastIsLetter = 1;
+	    }
+	}
+
+	isId = *cp == 0 && lastIsLetter;
+
+	if (isId) {
+	    /*
+	     * These words are scanned as operators rather than identifiers.
+	     */
+	    size_t	i;
+
+	    for (i = 0; isId && i < sizeof(keywords)/sizeof(keywords[0]); i++)
+		isId = strcasecmp(string, keywords[i]) != 0;
+	}
+    }
+
+    return isId;
+}
+
+
+/*
+ * Returns the unit of a string that's a single identifier of a unit, exactly
+ * as the parser would return it, without scanning and parsing the string.
+ * This is the common case of a name or symbol of a unit, which is looked up
+ * like the parser looks up an identifier before trying prefixes.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	string		The string.
+ *	encoding	The encoding of "string".
+ * Returns:
+ *	NULL		"string" isn't a single identifier of a unit.  The
+ *			client should parse it.  The status is unspecified.
+ *	else		Pointer to the unit of "string".  The status is
+ *			UT_SUCCESS.
+ */
+static ut_unit*
+parseIdentifier(
+    const ut_system* const	system,
+    const char* const		string,
+    const ut_encoding		encoding)
+{
+    ut_unit*	unit = NULL;
+    const char*	cp;
+
+    /*
+     * A Latin-1 string that isn't ASCII must be converted to UTF-8 first.
+     */
+    for (cp = string; encoding == UT_LATIN1 && *cp != 0; cp++) {
+	if (*cp & 0x80)
+	    break;
+    }
+
+    if ((encoding != UT_LATIN1 || *cp == 0) && isIdentifier(string)) {
+	const ut_unit*	mapped = ut_get_unit_by_name_ref(system, string);
+
+	if (mapped == NULL)
+	    mapped = ut_get_unit_by_symbol_ref(system, string);
+
+	if (mapped != NULL && (unit = ut_clone(mapped)) != NULL)
+	    UT_STATS_ADD(parseIdentifiers, 1);
+    }
+
+    return unit;
+}
+
 
 /*
  * Returns the binary representation of a unit corresponding to a string
@@ -623,59 +930,284 @@ ut_parse(
 {
     ut_unit*	unit = NULL;		/* failure */
 
+    UT_STATS_ADD(parseCalls, 1);
+
     if (system == NULL || string == NULL) {
 	ut_set_status(UT_BAD_ARG);
     }
-    else {
-        const char*     utf8String;
+    else if ((unit = pcFind(system, string, encoding)) != NULL) {
+	UT_STATS_ADD(parseCacheHits, 1);
+        ut_set_status(UT_SUCCESS);
+    }
+    else if ((unit = parseIdentifier(system, string, encoding)) == NULL) {
+	Parser	parser;
 
-        if (encoding != UT_LATIN1) {
-            utf8String = string;
-        }
-        else {
-            utf8String = latin1ToUtf8(string);
-            encoding = UT_UTF8;
+	if (parserInit(&parser, system) == 0) {
+	    unit = parserParse(&parser, string, encoding);
+	    parserDestroy(&parser);
+	}
+    }                                   /* valid arguments */
 
-            if (utf8String == NULL)
-                ut_set_status(UT_OS);
-        }
+    return unit;
+}
 
-        if (utf8String != NULL) {
-            YY_BUFFER_STATE	buf = ut_scan_string(utf8String);
 
-            _unitSystem = (ut_system*)system;
-            _encoding = encoding;
-            _restartScanner = 1;
+/*
+ * Minimum number of distinct strings for which ut_parse_many() uses the
+ * thread-pool.  Only unit-systems that parsing doesn't modify are parsed by
+ * the thread-pool.
+ */
+#define PARSE_PARALLEL_THRESHOLD	256
 
-#if YYDEBUG
-            utdebug = 0;
-            ut_flex_debug = 0;
-#endif
+/*
+ * Number of distinct strings parsed by one task of ut_parse_many().
+ */
+#define PARSE_CHUNK_SIZE		64
 
-            _finalUnit = NULL;
-
-            if (utparse() == 0) {
-                int       status;
-                ptrdiff_t n = yy_c_buf_p  - buf->yy_ch_buf;
-
-                if (n >= strlen(utf8String)) {
-                    unit = _finalUnit;	/* success */
-                    status = UT_SUCCESS;
-                }
-                else {
-                    /*
-                     * Parsing terminated before the end of the string.
-                     */
-                    ut_free(_finalUnit);
-                    status = UT_SYNTAX;
-                }
-
-                ut_set_status(status);
-            }
+/*
+ * A batch of strings to be parsed by ut_parse_many().
+ */
+typedef struct {
+    const ut_system*	system;
+    const char* const*	strings;
+    size_t*		distinct;	/* indexes of distinct strings */
+    size_t		ndistinct;	/* number of distinct strings */
+    ut_encoding		encoding;
+    ut_unit**		units;
+    ut_status*		statuses;
+    ut_error_message_handler
+			handler;	/* caller's thread handler or NULL */
+} ParseJob;
 
-            ut_delete_buffer(buf);
-        }                               /* utf8String != NULL */
-    }                                   /* valid arguments */
 
-    return unit;
+/*
+ * Parses a chunk of the distinct strings of a batch with one scanner.
+ *
+ * Arguments:
+ *	arg		Pointer to the ParseJob.
+ *	index		Origin-0 index of the chunk.
+ */
+static void
+parseChunk(
+    void* const		arg,
+    const size_t	index)
+{
+    ParseJob* const	job = arg;
+    const size_t	begin = index * PARSE_CHUNK_SIZE;
+    const size_t	end = begin + PARSE_CHUNK_SIZE < job->ndistinct
+	? begin + PARSE_CHUNK_SIZE
+	: job->ndistinct;
+    Parser		parser;
+    int			initialized = 0;
+    size_t		i;
+    ut_error_message_handler
+			prevHandler =
+	ut_set_thread_error_message_handler(job->handler);
+
+    for (i = begin; i < end; i++) {
+	const size_t	j = job->distinct[i];
+	const char*	string = job->strings[j];
+	ut_unit*	unit = pcFind(job->system, string, job->encoding);
+
+	if (unit != NULL) {
+	    UT_STATS_ADD(parseCacheHits, 1);
+	    ut_set_status(UT_SUCCESS);
+	}
+	else if ((unit = parseIdentifier(job->system, string, job->encoding))
+		    == NULL &&
+		(initialized || (initialized =
+		    parserInit(&parser, job->system) == 0))) {
+	    unit = parserParse(&parser, string, job->encoding);
+	}
+
+	job->units[j] = unit;
+	job->statuses[j] = ut_get_status();
+    }
+
+    if (initialized)
+	parserDestroy(&parser);
+
+    (void)ut_set_thread_error_message_handler(prevHandler);
+}
+
+
+/*
+ * Returns the hash of a string for ut_parse_many().
+ */
+static size_t
+hashString(
+    const char*	string)
+{
+    size_t	hash = 2166136261u;
+
+    for (; *string; string++)
+	hash = (hash ^ (unsigned char)*string) * 16777619u;
+
+    return hash;
+}
+
+
+/*
+ * Parses an array of strings.  The result is the same as calling ut_parse()
+ * on each string, but identical strings are parsed only once, one scanner is
+ * used for many strings, and a large number of distinct strings is divided
+ * among the threads of the library's thread-pool (see cv_set_parallelism()) if
+ * the unit-system is frozen or has no pending deferred definitions (see
+ * ut_read_xml_lazy()).  Errors are reported via the error-message handler of
+ * the calling thread.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system in which the parsing will
+ *			occur.
+ *	strings		Pointer to the strings to be parsed.  A NULL element
+ *			results in the status UT_BAD_ARG for that element.
+ *	count		The number of strings.
+ *	encoding	The encoding of the strings.
+ *	units		Pointer to the output array of "count" units.  On
+ *			return, an element is NULL if and only if the
+ *			corresponding string couldn't be parsed; otherwise,
+ *			the client should pass it to ut_free() when it's no
+ *			longer needed.
+ *	statuses	Pointer to an output array of "count" statuses, which
+ *			are those that ut_parse() would set, or NULL.
+ * Returns:
+ *	UT_SUCCESS	All strings were parsed.
+ *	UT_BAD_ARG	"system" is NULL, or "strings" or "units" is NULL and
+ *			"count" isn't zero.  Nothing was done.
+ *	UT_OS		Operating-system failure.  See "errno".  Nothing was
+ *			done.
+ *	else		The status of the first string that couldn't be
+ *			parsed.
+ */
+ut_status
+ut_parse_many(
+    const ut_system* const	system,
+    const char* const* const	strings,
+    const size_t		count,
+    const ut_encoding		encoding,
+    ut_unit** const		units,
+    ut_status* const		statuses)
+{
+    ut_status	status = UT_SUCCESS;
+
+    UT_STATS_ADD(parseCalls, count);
+
+    if (system == NULL || (count > 0 && (strings == NULL || units == NULL))) {
+	status = UT_BAD_ARG;
+	ut_handle_error_message("ut_parse_many(): NULL argument");
+    }
+    else if (count > 0) {
+	size_t		nslots = 1;
+	size_t*		slots;
+	size_t*		first;		/* index of first identical string */
+	ut_status*	itemStatuses = statuses != NULL
+	    ? statuses
+	    : malloc(count * sizeof(ut_status));
+
+	while (nslots < 2*count)
+	    nslots <<= 1;
+
+	slots = malloc(nslots * sizeof(size_t));
+	first = malloc(2 * count * sizeof(size_t));
+
+	if (itemStatuses == NULL || slots == NULL || first == NULL) {
+	    status = UT_OS;
+	    ut_handle_error_message(strerror(errno));
+	    ut_handle_error_message(
+		"ut_parse_many(): Couldn't allocate %lu-element index arrays",
+		(unsigned long)count);
+	}
+	else {
+	    ParseJob	job;
+	    size_t	i;
+
+	    job.system = system;
+	    job.strings = strings;
+	    job.distinct = first + count;
+	    job.ndistinct = 0;
+	    job.encoding = encoding;
+	    job.units = units;
+	    job.statuses = itemStatuses;
+	    job.handler = ut_set_thread_error_message_handler(NULL);
+	    (void)ut_set_thread_error_message_handler(job.handler);
+
+	    /*
+	     * Identify the distinct strings.  "count" is used for an empty slot.
+	     */
+	    for (i = 0; i < nslots; i++)
+		slots[i] = count;
+
+	    for (i = 0; i < count; i++) {
+		first[i] = i;
+
+		if (strings[i] == NULL) {
+		    units[i] = NULL;
+		    itemStatuses[i] = UT_BAD_ARG;
+		}
+		else {
+		    size_t	slot = hashString(strings[i]) & (nslots - 1);
+
+		    for (; slots[slot] != count; slot = (slot + 1) & (nslots - 1)) {
+			if (strcmp(strings[slots[slot]], strings[i]) == 0) {
+			    first[i] = slots[slot];
+			    break;
+			}
+		    }
+
+		    if (first[i] == i) {
+			slots[slot] = i;
+			job.distinct[job.ndistinct++] = i;
+		    }
+		}
+	    }
+
+	    /*
+	     * Looking up the identifiers of a unit-system with pending
+	     * deferred definitions materializes them, which modifies the
+	     * unit-system.
+	     */
+	    if (job.ndistinct >= PARSE_PARALLEL_THRESHOLD &&
+		    (coreGetFrozen(system) != NULL || luIsComplete(system))) {
+		tpRun((job.ndistinct + PARSE_CHUNK_SIZE - 1) / PARSE_CHUNK_SIZE,
+		    parseChunk, &job);
+	    }
+	    else {
+		size_t	ichunk;
+
+		for (ichunk = 0; ichunk * PARSE_CHUNK_SIZE < job.ndistinct;
+			ichunk++)
+		    parseChunk(&job, ichunk);
+	    }
+
+	    /*
+	     * Copy the results of the distinct strings to their duplicates.
+	     */
+	    for (i = 0; i < count; i++) {
+		if (first[i] != i) {
+		    const ut_unit* const	unit = units[first[i]];
+
+		    if (unit == NULL) {
+			units[i] = NULL;
+			itemStatuses[i] = itemStatuses[first[i]];
+		    }
+		    else {
+			units[i] = ut_clone(unit);
+			itemStatuses[i] = ut_get_status();
+		    }
+		}
+
+		if (status == UT_SUCCESS)
+		    status = itemStatuses[i];
+	    }
+	}				/* arrays allocated */
+
+	free(first);
+	free(slots);
+	if (itemStatuses != statuses)
+	    free(itemStatuses);
+    }					/* valid arguments, "count > 0" */
+
+    ut_set_status(status);
+
+    return status;
 }
@@ -13,233 +13,473 @@
 
 #include "config.h"
 
+#include "binaryDb.h"
+#include "frozenSystem.h"
+#include "parseCache.h"
 #include "prefix.h"
+#include "stats.h"
 #include "udunits2.h"
 #include "systemMap.h"
 
 #include <ctype.h>
 #include <errno.h>
-#ifdef _MSC_VER
-#include "tsearch.h"
-#else
-#include <search.h>
-#endif
 #include <stdlib.h>
 #include <string.h>
 
+/*
+ * A node of a prefix trie.  The children of a node are a linked list of
+ * elements of the node array of the trie in increasing order of their
+ * characters.
+ */
 typedef struct {
-    void*	tree;
-    int		(*compare)(const void*, const void*);
-} PrefixToValueMap;
+    double	value;		/* 0 => only the beginning of a prefix */
+    int		firstChild;	/* index of the first child or -1 */
+    int		nextSibling;	/* index of the next sibling or -1 */
+    int		character;	/* folded if the map is case-insensitive */
+} PrefixNode;
 
+/*
+ * Prefix-to-value map.  The map is a trie that's flattened into an array of
+ * nodes so that a longest-prefix match needs neither comparison callbacks nor
+ * pointer-chasing through individually-allocated entries.
+ */
 typedef struct {
-    void*	nextTree;
-    double	value;
-    size_t	position;	/* origin-0 index of character in prefix */
-    int		character;
-} PrefixSearchEntry;
+    PrefixNode*	nodes;		/* "nodes[0]" is the root */
+    size_t	count;		/* number of nodes including the root */
+    size_t	capacity;	/* number of allocated nodes */
+    size_t	pathSize;	/* size of the NUL-terminated paths to all nodes */
+    int		fold;		/* case-insensitive map? */
+} PrefixToValueMap;
+
+/*
+ * Frozen prefix-to-value map.  Prefixes are found in the trie of the mutable
+ * map, which is moved into the frozen map.  Every node of the trie is also
+ * keyed by the string of characters that leads to it, which is folded to lower
+ * case if the map is case-insensitive, for the writing of binary
+ * unit-databases.  The value of a node that's only the beginning of a prefix
+ * is zero.
+ */
+struct FrozenPrefixMap {
+    PrefixToValueMap	trie;
+    FrozenTable		table;	/* path -> element of "values" */
+    char*		paths;	/* NUL-terminated paths of the nodes */
+    double*		values;	/* values of the nodes */
+};
 
 static SystemMap*	systemToNameToValue = NULL;
 static SystemMap*	systemToSymbolToValue = NULL;
 
 
 /******************************************************************************
- * Prefix Search Entry:
+ * Prefix-to-Value Map:
  ******************************************************************************/
 
 
-static PrefixSearchEntry*
-pseNew(
-    int			character,
-    size_t		position)
-{
-    PrefixSearchEntry*	entry = malloc(sizeof(PrefixSearchEntry));
-
-    if (entry == NULL) {
-	ut_set_status(UT_OS);
-	ut_handle_error_message(strerror(errno));
-	ut_handle_error_message(
-            "Couldn't allocate %lu-byte prefix-search-entry",
-	    sizeof(PrefixSearchEntry));
-    }
-    else {
-	entry->character = character;
-	entry->position = position;
-	entry->value = 0;
-	entry->nextTree = NULL;
-    }
-
-    return entry;
-}
-
-
 static void
-pseFree(
-    PrefixSearchEntry* const	entry)
+ptvmInit(
+    PrefixToValueMap* const	map,
+    const int			fold)
 {
-    free(entry);
+    map->nodes = NULL;
+    map->count = 0;
+    map->capacity = 0;
+    map->pathSize = 0;
+    map->fold = fold;
 }
 
 
-static int
-pseSensitiveCompare(
-    const void* const	entry1,
-    const void* const	entry2)
+static PrefixToValueMap*
+ptvmNew(
+    const int	fold)
 {
-    int	char1 = ((const PrefixSearchEntry*)entry1)->character;
-    int	char2 = ((const PrefixSearchEntry*)entry2)->character;
+    PrefixToValueMap*	map =
+	(PrefixToValueMap*)malloc(sizeof(PrefixToValueMap));
+
+    if (map != NULL)
+	ptvmInit(map, fold);
 
-    return char1 < char2 ? -1 : char1 == char2 ? 0 : 1;
+    return map;
 }
 
 
+/*
+ * Ensures that a prefix-to-value map has room for another node.
+ *
+ * Arguments:
+ *	map		Pointer to the prefix-to-value map.
+ * Returns:
+ *	0		Success.
+ *	else		Insufficient storage space is available.
+ */
 static int
-pseInsensitiveCompare(
-    const void* const	entry1,
-    const void* const	entry2)
+ptvmReserve(
+    PrefixToValueMap* const	map)
 {
-    int	char1 = tolower(((const PrefixSearchEntry*)entry1)->character);
-    int	char2 = tolower(((const PrefixSearchEntry*)entry2)->character);
+    int	error = 0;
+
+    if (map->count == map->capacity) {
+	const size_t	capacity = map->capacity == 0 ? 64 : 2*map->capacity;
+	PrefixNode*	nodes =
+	    realloc(map->nodes, capacity*sizeof(PrefixNode));
+
+	if (nodes == NULL) {
+	    ut_set_status(UT_OS);
+	    ut_handle_error_message(strerror(errno));
+	    ut_handle_error_message(
+		"Couldn't allocate %lu-node prefix-trie",
+		(unsigned long)capacity);
+	    error = 1;
+	}
+	else {
+	    map->nodes = nodes;
+	    map->capacity = capacity;
+
+	    if (map->count == 0) {
+		map->nodes[0].value = 0;
+		map->nodes[0].firstChild = -1;
+		map->nodes[0].nextSibling = -1;
+		map->nodes[0].character = 0;
+		map->count = 1;
+	    }
+	}
+    }
 
-    return char1 < char2 ? -1 : char1 == char2 ? 0 : 1;
+    return error;
 }
 
 
-/******************************************************************************
- * Prefix-to-Value Map:
- ******************************************************************************/
-
-
-static PrefixToValueMap*
-ptvmNew(
-    int		(*compare)(const void*, const void*))
+/*
+ * Returns the child of a node of a prefix-to-value map that has a given
+ * character.
+ *
+ * Arguments:
+ *	map		Pointer to the prefix-to-value map.
+ *	node		Index of the node.
+ *	c		The character.  Not folded.
+ * Returns:
+ *	-1		No such child.
+ *	else		Index of the child.
+ */
+static int
+ptvmChild(
+    const PrefixToValueMap* const	map,
+    const int				node,
+    const char				c)
 {
-    PrefixToValueMap*	map =
-	(PrefixToValueMap*)malloc(sizeof(PrefixToValueMap));
+    const PrefixNode* const	nodes = map->nodes;
+    const int			target =
+	map->fold ? FS_FOLD(c) : (unsigned char)c;
+    int				child = nodes[node].firstChild;
 
-    if (map != NULL) {
-	map->tree = NULL;
-	map->compare = compare;
-    }
+    while (child >= 0 && nodes[child].character < target)
+	child = nodes[child].nextSibling;
 
-    return map;
+    return child >= 0 && nodes[child].character == target ? child : -1;
 }
 
 
 /*
- * Returns the prefix search-entry that matches an identifier.  Inserts a
- * new prefix search-entry if no matching element is found.  Note that the
- * returned entry might have a different prefix value if it was previously
- * inserted.
+ * Adds a prefix to a prefix-to-value map.  Note that the prefix might already
+ * have a different value if it was previously added.
  *
  * Arguments:
  *	map		Pointer to the prefix-to-value map.
  *	id		The prefix identifier.  May be freed upon return.
  *	value		The prefix value.
  * Returns:
- *	NULL		"map" is NULL.
- *	NULL		"id" is NULL or the empty string.
- *	NULL		"value" is 0.
- *	NULL		Insufficient storage space is available.
- *	else		Pointer to the prefix-search-entry that matches "id".
+ *	0		"map" is NULL.
+ *	0		"id" is NULL or the empty string.
+ *	0		"value" is 0.
+ *	0		Insufficient storage space is available.
+ *	else		The value of the prefix in the map.
  */
-static const PrefixSearchEntry*
+static double
 ptvmSearch(
-    PrefixToValueMap*	map,
-    const char* const	id,
-    const double	value)
+    PrefixToValueMap* const	map,
+    const char* const		id,
+    const double		value)
 {
-    PrefixSearchEntry*	entry = NULL;	/* failure */
+    double	result = 0;		/* failure */
 
-    if (id != NULL && map != NULL && value != 0) {
-	size_t	len = strlen(id);
+    if (id != NULL && map != NULL && value != 0 && *id != 0) {
+	size_t	i;
+	int	node = 0;
 
-	if (len > 0) {
-	    size_t			i;
-	    PrefixSearchEntry* const*	treeEntry = NULL;
-	    void**			tree = &map->tree;
+	for (i = 0; id[i] != 0; i++) {
+	    int	child;
 
-	    for (i = 0; i < len; i++) {
-		PrefixSearchEntry* const	newEntry = pseNew(id[i], i);
+	    if (ptvmReserve(map))
+		break;
 
-		if (newEntry == NULL)
-		    break;
+	    child = ptvmChild(map, node, id[i]);
 
-		treeEntry = tsearch(newEntry, tree, map->compare);
+	    if (child < 0) {
+		const int	c = map->fold
+		    ? FS_FOLD(id[i])
+		    : (unsigned char)id[i];
+		int*		link = &map->nodes[node].firstChild;
 
-		if (treeEntry == NULL) {
-		    pseFree(newEntry);
-		    break;
-		}
-
-		tree = &(*treeEntry)->nextTree;	/* next binary-search tree */
+		while (*link >= 0 && map->nodes[*link].character < c)
+		    link = &map->nodes[*link].nextSibling;
 
-		if (newEntry != *treeEntry)
-		    pseFree(newEntry);
+		child = (int)map->count++;
+		map->nodes[child].value = 0;
+		map->nodes[child].firstChild = -1;
+		map->nodes[child].nextSibling = *link;
+		map->nodes[child].character = c;
+		*link = child;
+		map->pathSize += i + 2;
 	    }
 
-	    if (i >= len) {
-		entry = *treeEntry;
+	    node = child;
+	}
+
+	if (id[i] == 0) {
+	    if (map->nodes[node].value == 0)
+		map->nodes[node].value = value;
 
-		if (entry->value == 0)
-		    entry->value = value;
-	    }
+	    result = map->nodes[node].value;
 	}
     }
 
-    return entry;
+    return result;
 }
 
 
 /*
- * Returns the prefix search-entry that matches the beginning of a string.
+ * Finds the prefixes of two prefix-to-value maps that match the beginning of
+ * a string in a single pass over the string.  For each map, the longest match
+ * of the string's characters against the prefixes is found and it's only
+ * successful if it's a complete prefix.
  *
  * Arguments:
- *	map		Pointer to the prefix-to-value map.
+ *	maps		The maps.  An element may be NULL, in which case the
+ *			corresponding prefix isn't found.
  *	string		Pointer to the string to be examined for a prefix.
- * Returns:
- *	NULL		"map" is NULL.
- *	NULL		"string" is NULL or the empty string.
- *	NULL		"value" is 0.
- *	else		Pointer to the prefix-search-entry that matches the
- *			beginning of "string".
+ *	values		The values of the prefixes found in the corresponding
+ *			maps.  An element is set to 0 if no prefix is found.
+ *	lens		The numbers of characters of the prefixes found in the
+ *			corresponding maps.  An element is only set if the
+ *			corresponding prefix is found.
  */
-static const PrefixSearchEntry*
+static void
 ptvmFind(
-    PrefixToValueMap* const	map,
-    const char* const		string)
+    const PrefixToValueMap* const	maps[2],
+    const char* const			string,
+    double				values[2],
+    size_t				lens[2])
 {
-    PrefixSearchEntry*	entry = NULL;	/* failure */
+    int		nodes[2];
+    size_t	i;
+    int		k;
 
-    if (string != NULL && map != NULL && strlen(string) > 0) {
-	size_t	len = strlen(string);
+    for (k = 0; k < 2; k++) {
+	nodes[k] = maps[k] == NULL || maps[k]->count == 0 ? -1 : 0;
+	values[k] = 0;
+    }
 
-	if (len > 0) {
-	    size_t			i;
-	    PrefixSearchEntry*		lastEntry = NULL;
-	    void**			tree = &map->tree;
+    for (i = 0; string[i] != 0 && (nodes[0] >= 0 || nodes[1] >= 0); i++) {
+	for (k = 0; k < 2; k++) {
+	    if (nodes[k] >= 0) {
+		nodes[k] = ptvmChild(maps[k], nodes[k], string[i]);
 
-	    for (i = 0; i < len; i++) {
-		PrefixSearchEntry		targetEntry;
-		PrefixSearchEntry* const*	treeEntry;
+		if (nodes[k] >= 0) {
+		    values[k] = maps[k]->nodes[nodes[k]].value;
+		    lens[k] = i + 1;
+		}
+	    }
+	}
+    }
+}
 
-		targetEntry.character = string[i];
-		treeEntry = tfind(&targetEntry, tree, map->compare);
 
-		if (treeEntry == NULL)
-		    break;
+/******************************************************************************
+ * Frozen Prefix-to-Value Map:
+ ******************************************************************************/
 
-		lastEntry = *treeEntry;
 
-		tree = &(*treeEntry)->nextTree;	/* next binary-search tree */
-	    }
+static void
+fptvmFree(
+    FrozenPrefixMap* const	frozen)
+{
+    if (frozen != NULL) {
+	free(frozen->trie.nodes);
+	ftDestroy(&frozen->table);
+	free(frozen->paths);
+	free(frozen->values);
+	free(frozen);
+    }
+}
 
-	    if (lastEntry != NULL && lastEntry->value != 0)
-		entry = lastEntry;
+
+/*
+ * Returns a new, empty, frozen prefix-to-value map.
+ *
+ * Arguments:
+ *	map		Pointer to the prefix-to-value map to be frozen or NULL.
+ *	fold		Whether or not the map is case-insensitive.
+ * Returns:
+ *	NULL		Failure.  See "errno".
+ *	else		Pointer to a frozen map with room for all the nodes of
+ *			"map".
+ */
+static FrozenPrefixMap*
+fptvmNew(
+    const PrefixToValueMap* const	map,
+    const int				fold)
+{
+    FrozenPrefixMap*	frozen = calloc(1, sizeof(FrozenPrefixMap));
+
+    if (frozen != NULL) {
+	const size_t	nodeCount =
+	    map == NULL || map->count == 0 ? 0 : map->count - 1;
+
+	ptvmInit(&frozen->trie, fold);
+	frozen->paths = malloc((map == NULL ? 0 : map->pathSize) + 1);
+	frozen->values = malloc((nodeCount + 1) * sizeof(double));
+
+	if (frozen->paths == NULL || frozen->values == NULL ||
+		ftInit(&frozen->table, nodeCount)) {
+	    fptvmFree(frozen);
+	    frozen = NULL;
 	}
     }
 
-    return entry;
+    return frozen;
+}
+
+
+/*
+ * Adds the descendants of a node of a prefix-to-value map to the table of a
+ * frozen prefix-to-value map.
+ *
+ * Arguments:
+ *	map		Pointer to the prefix-to-value map.
+ *	node		Index of the node.
+ *	parentPath	Pointer to the path of the node, which has "depth"
+ *			characters.
+ *	depth		The depth of the node.
+ *	frozen		Pointer to the frozen map.
+ *	nextPath	Pointer to the location of the next path in
+ *			"frozen->paths".
+ */
+static void
+addPaths(
+    const PrefixToValueMap* const	map,
+    const int				node,
+    const char* const			parentPath,
+    const size_t			depth,
+    FrozenPrefixMap* const		frozen,
+    char** const			nextPath)
+{
+    int	child;
+
+    for (child = map->nodes[node].firstChild; child >= 0;
+	    child = map->nodes[child].nextSibling) {
+	char* const	path = *nextPath;
+	double* const	value = frozen->values + frozen->table.count;
+
+	(void)memcpy(path, parentPath, depth);
+	path[depth] = (char)map->nodes[child].character;
+	path[depth+1] = 0;
+	*nextPath += depth + 2;
+
+	*value = map->nodes[child].value;
+	ftInsert(&frozen->table, fsHashString(path, 0), path, value);
+
+	addPaths(map, child, path, depth+1, frozen, nextPath);
+    }
+}
+
+
+/*
+ * Moves the nodes of a prefix-to-value map into a frozen prefix-to-value map.
+ *
+ * Arguments:
+ *	map		Pointer to the prefix-to-value map or NULL.  The map
+ *			will be empty on return.
+ *	frozen		Pointer to the frozen map.
+ */
+static void
+fptvmFill(
+    PrefixToValueMap* const	map,
+    FrozenPrefixMap* const	frozen)
+{
+    if (map != NULL && map->count > 0) {
+	char*	nextPath = frozen->paths;
+
+	addPaths(map, 0, "", 0, frozen, &nextPath);
+
+	frozen->trie = *map;
+	ptvmInit(map, map->fold);
+    }
+}
+
+
+/*
+ * Copies the nodes of a prefix-to-value map into a frozen prefix-to-value map.
+ *
+ * Arguments:
+ *	map		Pointer to the prefix-to-value map or NULL.
+ *	frozen		Pointer to the frozen map.
+ * Returns:
+ *	0		Success.
+ *	-1		Failure.  "ut_get_status()" will be UT_OS.
+ */
+static int
+fptvmCopy(
+    const PrefixToValueMap* const	map,
+    FrozenPrefixMap* const		frozen)
+{
+    int		status = 0;
+
+    if (map != NULL && map->count > 0) {
+	PrefixNode* const	nodes = malloc(map->count * sizeof(PrefixNode));
+
+	if (nodes == NULL) {
+	    ut_set_status(UT_OS);
+	    ut_handle_error_message(strerror(errno));
+	    ut_handle_error_message(
+		"fptvmCopy(): Couldn't allocate %lu-node prefix trie",
+		(unsigned long)map->count);
+	    status = -1;
+	}
+	else {
+	    char*	nextPath = frozen->paths;
+
+	    addPaths(map, 0, "", 0, frozen, &nextPath);
+
+	    (void)memcpy(nodes, map->nodes, map->count * sizeof(PrefixNode));
+	    frozen->trie = *map;
+	    frozen->trie.nodes = nodes;
+	    frozen->trie.capacity = map->count;
+	}
+    }
+
+    return status;
+}
+
+
+/*
+ * Returns the prefix-to-value map of a unit-system.
+ *
+ * Arguments:
+ *	systemMap	NULL or pointer to the system-map.
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	NULL		"system" doesn't have a prefix-to-value map.
+ *	else		Pointer to the prefix-to-value map of "system".
+ */
+static PrefixToValueMap*
+getMap(
+    const SystemMap* const	systemMap,
+    const ut_system* const	system)
+{
+    PrefixToValueMap**	prefixToValue = systemMap == NULL
+	? NULL
+	: (PrefixToValueMap**)smFind(systemMap, system);
+
+    return prefixToValue == NULL ? NULL : *prefixToValue;
 }
 
 
@@ -257,11 +497,12 @@ ptvmFind(
  *			upon return.
  *	value		The value of the prefix (e.g., 1e6).
  *	systemMap	Pointer to system-map.
- *	compare		Prefix comparison function.
+ *	fold		Whether or not prefixes are case-insensitive.
  * Returns:
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"system" is NULL, "prefix" is NULL or empty, or "value"
  *                      is 0.
+ *	UT_FROZEN	"system" is frozen.
  *	UT_EXISTS	"prefix" already maps to a different value.
  *	UT_OS		Operating-system failure.  See "errno".
  */
@@ -271,13 +512,18 @@ addPrefix(
     const char* const	prefix,
     const double	value,
     SystemMap** const	systemMap,
-    int			(*compare)(const void*, const void*))
+    const int		fold)
 {
     ut_status		status;
 
     if (system == NULL) {
 	status = UT_BAD_ARG;
     }
+    else if (coreGetFrozen(system) != NULL) {
+	status = UT_FROZEN;
+	ut_set_status(status);
+	ut_handle_error_message("Unit-system is frozen");
+    }
     else if (prefix == NULL || strlen(prefix) == 0) {
 	status = UT_BAD_ARG;
     }
@@ -301,22 +547,25 @@ addPrefix(
 	    }
 	    else {
 		if (*prefixToValue == NULL) {
-		    *prefixToValue = ptvmNew(compare);
+		    *prefixToValue = ptvmNew(fold);
 
 		    if (*prefixToValue == NULL)
 			status = UT_OS;
 		}
 
 		if (*prefixToValue != NULL) {
-		    const PrefixSearchEntry*	entry =
+		    const double	result =
 			ptvmSearch(*prefixToValue, prefix, value);
 
 		    status =
-			entry == NULL
+			result == 0
 			    ? UT_OS
-			    : (entry->value == value)
+			    : (result == value)
 				? UT_SUCCESS
 				: UT_EXISTS;
+
+		    if (status == UT_SUCCESS)
+			pcFlush(system);
 		}
 	    }				/* have system-map entry */
 	}				/* have system-map */
@@ -338,6 +587,7 @@ addPrefix(
  * Returns:
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"system" or "name" is NULL, or "value" is 0.
+ *	UT_FROZEN	"system" is frozen.
  *	UT_EXISTS	"name" already maps to a different value.
  *	UT_OS		Operating-system failure.  See "errno".
  */
@@ -348,7 +598,7 @@ ut_add_name_prefix(
     const double	value)
 {
     ut_set_status(addPrefix(system, name, value, &systemToNameToValue,
-	pseInsensitiveCompare));
+	1));
 
     return ut_get_status();
 }
@@ -367,6 +617,7 @@ ut_add_name_prefix(
  *	UT_SUCCESS	Success.
  *	UT_BADSYSTEM	"system" or "symbol" is NULL.
  *	UT_BAD_ARG	"value" is 0.
+ *	UT_FROZEN	"system" is frozen.
  *	UT_EXISTS	"symbol" already maps to a different value.
  *	UT_OS		Operating-system failure.  See "errno".
  */
@@ -377,79 +628,130 @@ ut_add_symbol_prefix(
     const double	value)
 {
     ut_set_status(addPrefix(system, symbol, value, &systemToSymbolToValue,
-	pseSensitiveCompare));
+	0));
 
     return ut_get_status();
 }
 
 
 /*
- * Finds a prefix of a unit-system.
+ * Finds the name-prefix and symbol-prefix of a unit-system that match the
+ * beginning of a string.  If both are wanted, then they're found in a single
+ * pass over the string.
  *
  * Arguments:
  *	system		Pointer to the unit-system.
- *	systemMap	Pointer to system-map.
- *	string		Pointer to the string to be examined for a prefix.
- *	compare		Prefix comparison function.
- *	value		NULL or pointer to the memory location to receive the
- *			value of the name-prefix, if one is discovered.
- *	len		NULL or pointer to the memory location to receive the
- *			number of characters in the name-prefix, if one is
- *			discovered.
- *
+ *	string		Pointer to the string to be examined for prefixes.
+ *	wanted		Whether or not the name-prefix and symbol-prefix,
+ *			respectively, are wanted.
+ *	values		The values of the name-prefix and symbol-prefix,
+ *			respectively.  An element is set to 0 if the prefix
+ *			isn't wanted or isn't discovered.
+ *	lens		The numbers of characters in the name-prefix and
+ *			symbol-prefix, respectively.  An element is only set if
+ *			the prefix is discovered.
  * Returns:
- *	UT_SUCCESS	Success.
- *	UT_BAD_ARG	"system" is NULL, "systemMap" is NULL, "compare" is
- *                      NULL, "string" is NULL or empty, or "value" is 0.
- *	UT_OS		Operating-system failure.  See "errno".
- *	UT_UNKNOWN	No prefix-to-value map is associated with "system".
- *	UT_UNKNOWN	No prefix found in the prefix-to-value map associated
- *			with "system".
+ *	UT_SUCCESS	Success.  At least one wanted prefix was discovered.
+ *	UT_BAD_ARG	"system" is NULL or "string" is NULL or empty.
+ *	UT_UNKNOWN	No wanted prefix was discovered.
  */
 static ut_status
-findPrefix(
+findPrefixes(
     ut_system* const	system,
-    SystemMap* const	systemMap,
     const char* const	string,
-    double* const	value,
-    size_t* const	len)
+    const int		wanted[2],
+    double		values[2],
+    size_t		lens[2])
 {
     ut_status		status;
 
+    UT_STATS_ADD(prefixLookups, 1);
+
+    values[BDB_NAME] = values[BDB_SYMBOL] = 0;
+
     if (system == NULL) {
 	status = UT_BAD_ARG;
     }
-    else if (systemMap == NULL) {
-	status = UT_BAD_ARG;
-    }
-    else if (string == NULL || strlen(string) == 0) {
+    else if (string == NULL || *string == 0) {
 	status = UT_BAD_ARG;
     }
     else {
-	PrefixToValueMap** const	prefixToValue =
-	    (PrefixToValueMap**)smFind(systemMap, system);
+	const FrozenSystem* const	frozen = coreGetFrozen(system);
+
+	if (frozen != NULL && frozen->binaryDb != NULL) {
+	    int	type;
 
-	if (prefixToValue == NULL) {
-	    status = UT_UNKNOWN;
+	    for (type = BDB_NAME; type <= BDB_SYMBOL; type++)
+		if (wanted[type])
+		    values[type] = bdbFindPrefix(frozen->binaryDb,
+			(BdbIdType)type, string, lens + type);
 	}
 	else {
-	    const PrefixSearchEntry*	entry =
-		ptvmFind(*prefixToValue, string);
+	    const PrefixToValueMap*	maps[2];
+
+	    maps[BDB_NAME] = !wanted[BDB_NAME]
+		? NULL
+		: frozen != NULL
+		    ? &frozen->nameToPrefix->trie
+		    : getMap(systemToNameToValue, system);
+	    maps[BDB_SYMBOL] = !wanted[BDB_SYMBOL]
+		? NULL
+		: frozen != NULL
+		    ? &frozen->symbolToPrefix->trie
+		    : getMap(systemToSymbolToValue, system);
+
+	    ptvmFind(maps, string, values, lens);
+	}
 
-	    if (entry == NULL) {
-		status = UT_UNKNOWN;
-	    }
-	    else {
-		if (value != NULL)
-		    *value = entry->value;
+	status = values[BDB_NAME] == 0 && values[BDB_SYMBOL] == 0
+	    ? UT_UNKNOWN
+	    : UT_SUCCESS;
+    }					/* valid arguments */
 
-		if (len != NULL)
-		    *len = entry->position + 1;
+    return status;
+}
 
-		status = UT_SUCCESS;
-	    }				/* have prefix entry */
-	}				/* have system-map entry */
-    }					/* valid arguments */
+
+/*
+ * Finds one type of prefix of a unit-system that matches the beginning of a
+ * string.
+ *
+ * Arguments:
+ *	system	Pointer to the unit-system.
+ *	type	The type of the prefix.
+ *	string	Pointer to the string to be examined for a prefix.
+ *	value	NULL or pointer to the memory location to receive the value of
+ *		the prefix, if one is discovered.
+ *	len	NULL or pointer to the memory location to receive the number of
+ *		characters in the prefix, if one is discovered.
+ * Returns:
+ *	UT_BAD_ARG	"system" or "string" is NULL or "string" is empty.
+ *	UT_UNKNOWN	A prefix was not discovered.
+ *	UT_SUCCESS	Success.  "*value" and "*len" will be set if non-NULL.
+ */
+static ut_status
+findPrefix(
+    ut_system* const	system,
+    const BdbIdType	type,
+    const char* const	string,
+    double* const	value,
+    size_t* const	len)
+{
+    int		wanted[2] = {0, 0};
+    double	values[2];
+    size_t	lens[2];
+    ut_status	status;
+
+    wanted[type] = 1;
+    status = findPrefixes(system, string, wanted, values, lens);
+
+    if (status == UT_SUCCESS) {
+	if (value != NULL)
+	    *value = values[type];
+
+	if (len != NULL)
+	    *len = lens[type];
+    }
 
     return status;
 }
@@ -478,10 +780,7 @@ utGetPrefixByName(
     double* const	value,
     size_t* const	len)
 {
-    return
-	string == NULL
-	    ? UT_BAD_ARG
-	    : findPrefix(system, systemToNameToValue, string, value, len);
+    return findPrefix(system, BDB_NAME, string, value, len);
 }
 
 
@@ -508,8 +807,122 @@ utGetPrefixBySymbol(
     double* const	value,
     size_t* const	len)
 {
-    return
-	string == NULL
-	    ? UT_BAD_ARG
-	    : findPrefix(system, systemToSymbolToValue, string, value, len);
+    return findPrefix(system, BDB_SYMBOL, string, value, len);
+}
+
+
+ut_status
+utGetPrefixes(
+    ut_system* const	system,
+    const char* const	string,
+    double* const	nameValue,
+    size_t* const	nameLen,
+    double* const	symbolValue,
+    size_t* const	symbolLen)
+{
+    static const int	wanted[2] = {1, 1};
+    double		values[2];
+    size_t		lens[2] = {0, 0};
+    const ut_status	status =
+	findPrefixes(system, string, wanted, values, lens);
+
+    *nameValue = values[BDB_NAME];
+    *nameLen = lens[BDB_NAME];
+    *symbolValue = values[BDB_SYMBOL];
+    *symbolLen = lens[BDB_SYMBOL];
+
+    return status;
+}
+
+
+/*
+ * Frees resources associated with a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system to have its associated
+ *			resources freed.
+ */
+void
+ptvmFreeSystem(
+    ut_system*	system)
+{
+    if (system != NULL) {
+	SystemMap*	systemMaps[2];
+	int		i;
+
+	systemMaps[0] = systemToNameToValue;
+	systemMaps[1] = systemToSymbolToValue;
+
+	for (i = 0; i < 2; i++) {
+	    if (systemMaps[i] != NULL) {
+		PrefixToValueMap** const	prefixToValue =
+		    (PrefixToValueMap**)smFind(systemMaps[i], system);
+
+		if (prefixToValue != NULL && *prefixToValue != NULL) {
+		    free((*prefixToValue)->nodes);
+		    free(*prefixToValue);
+		}
+
+		smRemove(systemMaps[i], system);
+	    }
+	}
+    }					/* valid arguments */
+}
+
+
+ut_status
+ptvmAllocFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen)
+{
+    frozen->nameToPrefix = fptvmNew(getMap(systemToNameToValue, system), 1);
+    frozen->symbolToPrefix =
+	fptvmNew(getMap(systemToSymbolToValue, system), 0);
+
+    return frozen->nameToPrefix == NULL || frozen->symbolToPrefix == NULL
+	? UT_OS
+	: UT_SUCCESS;
+}
+
+
+void
+ptvmFillFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen)
+{
+    fptvmFill(getMap(systemToNameToValue, system), frozen->nameToPrefix);
+    fptvmFill(getMap(systemToSymbolToValue, system), frozen->symbolToPrefix);
+}
+
+
+ut_status
+ptvmCopyFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen)
+{
+    return fptvmCopy(getMap(systemToNameToValue, system),
+		frozen->nameToPrefix)
+	    || fptvmCopy(getMap(systemToSymbolToValue, system),
+		frozen->symbolToPrefix)
+	? UT_OS
+	: UT_SUCCESS;
+}
+
+
+void
+ptvmFreeFrozen(
+    FrozenSystem* const	frozen)
+{
+    fptvmFree(frozen->nameToPrefix);
+    fptvmFree(frozen->symbolToPrefix);
+    frozen->nameToPrefix = NULL;
+    frozen->symbolToPrefix = NULL;
+}
+
+
+const FrozenTable*
+ptvmGetFrozenTable(
+    const FrozenPrefixMap* const	frozen)
+{
+    return &frozen->table;
 }
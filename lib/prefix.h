@@ -6,6 +6,7 @@
 #define UT_PREFIX_H
 
 #include "udunits2.h"
+#include "frozenSystem.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -100,6 +101,116 @@ utGetPrefixBySymbol(
     double* const	value,
     size_t* const	len);
 
+/*
+ * Examines a string for both a name-prefix and a symbol-prefix in a single
+ * pass over the string.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	string		Pointer to the string to be examined for prefixes.
+ *	nameValue	Pointer to the memory location to receive the value of
+ *			the name-prefix or 0 if one isn't discovered.
+ *	nameLen		Pointer to the memory location to receive the number of
+ *			characters in the name-prefix.
+ *	symbolValue	Pointer to the memory location to receive the value of
+ *			the symbol-prefix or 0 if one isn't discovered.
+ *	symbolLen	Pointer to the memory location to receive the number of
+ *			characters in the symbol-prefix.
+ * Returns:
+ *	UT_BAD_ARG	"system" or "string" is NULL or "string" is empty.
+ *	UT_UNKNOWN	Neither a name-prefix nor a symbol-prefix was
+ *			discovered.
+ *	UT_SUCCESS	Success.  At least one prefix was discovered.
+ */
+ut_status
+utGetPrefixes(
+    ut_system* const	system,
+    const char* const	string,
+    double* const	nameValue,
+    size_t* const	nameLen,
+    double* const	symbolValue,
+    size_t* const	symbolLen);
+
+/*
+ * Frees resources associated with a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system to have its associated
+ *			resources freed.
+ */
+void
+ptvmFreeSystem(
+    ut_system*	system);
+
+/*
+ * Allocates the frozen name-prefix and symbol-prefix maps of a unit-system.
+ * The maps are empty but have room for all the prefixes of the unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	frozen		Pointer to the frozen maps of "system".
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_OS		Operating-system failure.  See "errno".  The maps that
+ *			were allocated should be freed by ptvmFreeFrozen().
+ */
+ut_status
+ptvmAllocFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen);
+
+/*
+ * Moves the prefixes of a unit-system into its frozen maps, which must have
+ * been allocated by ptvmAllocFrozen().
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	frozen		Pointer to the frozen maps of "system".
+ */
+void
+ptvmFillFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen);
+
+/*
+ * Copies the prefixes of a unit-system into frozen maps, which must have been
+ * allocated by ptvmAllocFrozen().  The unit-system isn't modified.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	frozen		Pointer to the frozen maps.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_OS		Operating-system failure.  See "errno".
+ */
+ut_status
+ptvmCopyFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen);
+
+/*
+ * Frees the frozen name-prefix and symbol-prefix maps of a unit-system.
+ *
+ * Arguments:
+ *	frozen		Pointer to the frozen maps.
+ */
+void
+ptvmFreeFrozen(
+    FrozenSystem* const	frozen);
+
+/*
+ * Returns the hash table of a frozen prefix map.  The keys of the table are
+ * NUL-terminated strings (folded to lower case if the map is case-insensitive)
+ * and the values are pointers to doubles.  A key whose value is zero is a
+ * proper beginning of a longer prefix rather than a prefix itself.
+ *
+ * Arguments:
+ *	frozen		Pointer to the frozen map.
+ */
+const FrozenTable*
+ptvmGetFrozenTable(
+    const FrozenPrefixMap* const	frozen);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,147 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Hot-path statistics of the UDUNITS-2 library.
+ *
+ * The counters are updated with relaxed atomic additions by the instrumented
+ * modules (see stats.h) and are only compiled into the library if
+ * UT_ENABLE_STATS is defined.
+ */
+
+/*LINTLIBRARY*/
+
+#include "config.h"
+
+#include "stats.h"
+#include "udunits2.h"
+
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef UT_ENABLE_STATS
+
+ut_stats	stCounters;
+
+/*
+ * Offsets of the counters in a "ut_stats".
+ */
+static const size_t	offsets[] = {
+    offsetof(ut_stats, parseCalls),
+    offsetof(ut_stats, parseCacheHits),
+    offsetof(ut_stats, parseIdentifiers),
+    offsetof(ut_stats, parses),
+    offsetof(ut_stats, parseNanoseconds),
+    offsetof(ut_stats, nameLookups),
+    offsetof(ut_stats, symbolLookups),
+    offsetof(ut_stats, prefixLookups),
+    offsetof(ut_stats, converterRequests),
+    offsetof(ut_stats, converterCacheHits),
+    offsetof(ut_stats, converterNanoseconds),
+    offsetof(ut_stats, combineCalls),
+    offsetof(ut_stats, combineFolds),
+    offsetof(ut_stats, arrayCalls),
+    offsetof(ut_stats, floatValues),
+    offsetof(ut_stats, doubleValues),
+    offsetof(ut_stats, parallelValues),
+    offsetof(ut_stats, stridedValues),
+    offsetof(ut_stats, mixedValues),
+    offsetof(ut_stats, packedValues)
+};
+
+#define NCOUNTERS	(sizeof(offsets)/sizeof(offsets[0]))
+
+/*
+ * Returns a counter of a "ut_stats".
+ *
+ * Arguments:
+ *	stats		Pointer to the statistics.
+ *	i		Origin-0 index of the counter in "offsets".
+ */
+#define COUNTER(stats, i) \
+    ((unsigned long long*)((char*)(stats) + offsets[i]))
+
+
+unsigned long long
+stNanoseconds(void)
+{
+#if defined(CLOCK_MONOTONIC)
+    struct timespec	ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (unsigned long long)ts.tv_sec * 1000000000u +
+	(unsigned long long)ts.tv_nsec;
+#else
+    return (unsigned long long)((double)clock() * 1e9 / CLOCKS_PER_SEC);
+#endif
+}
+
+#endif
+
+
+/*
+ * Returns the hot-path statistics of the library.
+ *
+ * Arguments:
+ *	stats		Pointer to the statistics to be set.
+ * Returns:
+ *	UT_SUCCESS	Success.  If the library wasn't built with statistics,
+ *			then "stats->enabled" and all counts are zero.
+ *	UT_BAD_ARG	"stats" is NULL.
+ */
+ut_status
+ut_get_stats(
+    ut_stats* const	stats)
+{
+    ut_status	status;
+
+    if (stats == NULL) {
+	status = UT_BAD_ARG;
+	ut_handle_error_message("ut_get_stats(): NULL argument");
+    }
+    else {
+	(void)memset(stats, 0, sizeof(*stats));
+
+#ifdef UT_ENABLE_STATS
+	{
+	    size_t	i;
+
+	    stats->enabled = 1;
+
+	    for (i = 0; i < NCOUNTERS; i++)
+		*COUNTER(stats, i) = UT_ATOMIC_ADD(COUNTER(&stCounters, i), 0);
+	}
+#endif
+
+	status = UT_SUCCESS;
+    }
+
+    ut_set_status(status);
+
+    return status;
+}
+
+
+/*
+ * Resets all the hot-path statistics of the library to zero.  A count added by
+ * another thread during the reset is kept rather than lost.
+ */
+void
+ut_reset_stats(void)
+{
+#ifdef UT_ENABLE_STATS
+    size_t	i;
+
+    for (i = 0; i < NCOUNTERS; i++) {
+	unsigned long long* const	counter = COUNTER(&stCounters, i);
+
+	(void)UT_ATOMIC_ADD(counter, 0 - UT_ATOMIC_ADD(counter, 0));
+    }
+#endif
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Hot-path statistics of the UDUNITS-2 library.  See ut_get_stats().
+ *
+ * The statistics are only gathered if UT_ENABLE_STATS is defined; otherwise,
+ * the macros expand to nothing and cost nothing.
+ */
+#ifndef UT_STATS_H_INCLUDED
+#define UT_STATS_H_INCLUDED
+
+#include "threadSupport.h"
+#include "udunits2.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifdef UT_ENABLE_STATS
+
+/*
+ * The counters.  The "enabled" member isn't used.
+ */
+extern ut_stats		stCounters;
+
+/*
+ * Returns the current time in nanoseconds from an arbitrary origin.
+ */
+unsigned long long
+stNanoseconds(void);
+
+/*
+ * Adds to a member of the counters.
+ */
+#   define UT_STATS_ADD(member, n) \
+	((void)UT_ATOMIC_ADD(&stCounters.member, (unsigned long long)(n)))
+
+/*
+ * Declares and initializes a variable with the start-time of a timed
+ * section and adds the elapsed time of the section to a member of the
+ * counters, respectively.
+ */
+#   define UT_STATS_START(start) \
+	const unsigned long long start = stNanoseconds()
+#   define UT_STATS_STOP(member, start) \
+	UT_STATS_ADD(member, stNanoseconds() - (start))
+
+#else
+
+#   define UT_STATS_ADD(member, n)		((void)0)
+#   define UT_STATS_START(start)		const int start = 0
+#   define UT_STATS_STOP(member, start)		((void)(start))
+
+#endif
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
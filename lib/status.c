@@ -6,21 +6,23 @@
  * redistribution conditions.
  */
 /*
- * Status of the last operation by the UDUNITS2(3) library.
+ * Status of the last operation by the UDUNITS2(3) library.  Each thread has
+ * its own status.
  */
 
 /*LINTLIBRARY*/
 
 #include "config.h"
 
+#include "threadSupport.h"
 #include "udunits2.h"
 
-static ut_status		_status = UT_SUCCESS;
+static UT_THREAD_LOCAL ut_status	_status = UT_SUCCESS;
 
 
 /*
- * Returns the status of the last operation by the units module.  This function
- * will not change the status.
+ * Returns the status of the last operation by the units module in the current
+ * thread.  This function will not change the status.
  */
 ut_status
 ut_get_status()
@@ -30,8 +32,9 @@ ut_get_status()
 
 
 /*
- * Sets the status of the units module.  This function would not normally be
- * called by the user unless they were doing their own parsing or formatting.
+ * Sets the status of the units module in the current thread.  This function
+ * would not normally be called by the user unless they were doing their own
+ * parsing or formatting.
  *
  * Arguments:
  *	status	The status of the units module.
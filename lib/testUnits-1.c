@@ -128,6 +128,116 @@ test_utInvCalendar(void)
 }
 
 
+static void
+test_utCalendars(void)
+{
+    utUnit	unit;
+    double	values[300];
+    int		years[300], months[300], days[300], hours[300], minutes[300];
+    float	seconds[300];
+    int		ok = 1;
+    int		i;
+
+    utIni(&unit);
+    CU_ASSERT_EQUAL(utScan("minutes since 1999-12-31 23:00:00", &unit), 0);
+    for (i = 0; i < 300; i++)
+	values[i] = i * 0.5 - 10;
+    CU_ASSERT_EQUAL(utCalendars(values, 300, &unit, years, months, days,
+	hours, minutes, seconds), 0);
+    for (i = 0; i < 300; i++) {
+	int	year, month, day, hour, minute;
+	float	second;
+
+	CU_ASSERT_EQUAL(utCalendar(values[i], &unit, &year, &month, &day,
+	    &hour, &minute, &second), 0);
+	ok &= years[i] == year && months[i] == month && days[i] == day &&
+	    hours[i] == hour && minutes[i] == minute && seconds[i] == second;
+    }
+    CU_ASSERT_TRUE(ok);
+    CU_ASSERT_EQUAL(years[0], 1999);
+    CU_ASSERT_EQUAL(minutes[0], 50);
+    CU_ASSERT_EQUAL(years[299], 2000);
+    CU_ASSERT_EQUAL(hours[299], 1);
+    CU_ASSERT_EQUAL(seconds[299], 30);
+
+    /* The same specification scanned again */
+    CU_ASSERT_EQUAL(utScan("minutes since 1999-12-31 23:00:00", &unit), 0);
+    CU_ASSERT_EQUAL(utCalendars(values, 1, &unit, years, months, days,
+	hours, minutes, seconds), 0);
+    CU_ASSERT_EQUAL(minutes[0], 50);
+
+    CU_ASSERT_EQUAL(utCalendars(values, 0, &unit, NULL, NULL, NULL, NULL,
+	NULL, NULL), 0);
+    CU_ASSERT_EQUAL(utCalendars(NULL, 1, &unit, years, months, days,
+	hours, minutes, seconds), UT_EINVALID);
+    CU_ASSERT_EQUAL(utScan("kg", &unit), 0);
+    CU_ASSERT_EQUAL(utCalendars(values, 1, &unit, years, months, days,
+	hours, minutes, seconds), UT_EINVALID);
+    utFree(&unit);
+}
+
+
+static void
+test_utInvCalendars(void)
+{
+    utUnit	unit;
+    int		years[] = {1994, 1994, 2000};
+    int		months[] = {12, 12, 3};
+    int		days[] = {15, 16, 1};
+    int		hours[] = {2, 2, 0};
+    int		minutes[] = {30, 30, 0};
+    double	seconds[] = {1, 1, 0};
+    double	values[3];
+    int		i;
+
+    utIni(&unit);
+    CU_ASSERT_EQUAL(utScan("seconds since 1994-12-15 2:29:60.0000 UTC", &unit),
+	0);
+    CU_ASSERT_EQUAL(utInvCalendars(years, months, days, hours, minutes,
+	seconds, 3, &unit, values), 0);
+    CU_ASSERT_EQUAL(values[0], 1);
+    CU_ASSERT_EQUAL(values[1], 86401);
+    for (i = 0; i < 3; i++) {
+	double	value;
+
+	CU_ASSERT_EQUAL(utInvCalendar(years[i], months[i], days[i], hours[i],
+	    minutes[i], seconds[i], &unit, &value), 0);
+	CU_ASSERT_EQUAL(values[i], value);
+    }
+    CU_ASSERT_EQUAL(utInvCalendars(years, months, days, hours, minutes,
+	seconds, 3, NULL, values), UT_EINVALID);
+    utFree(&unit);
+}
+
+
+/*
+ * Checks that utConvert() doesn't use the converter to a unit after the unit
+ * has been replaced.
+ */
+static void
+test_utConvertCache(void)
+{
+    utUnit	from, to;
+    double	slope, intercept;
+    int		i;
+
+    utIni(&from);
+    utIni(&to);
+    CU_ASSERT_EQUAL(utScan("km", &from), 0);
+    for (i = 0; i < 10; i++) {
+	CU_ASSERT_EQUAL(utScan(i % 2 ? "m" : "mm", &to), 0);
+	CU_ASSERT_EQUAL(utConvert(&from, &to, &slope, &intercept), 0);
+	CU_ASSERT_EQUAL(slope, i % 2 ? 1e3 : 1e6);
+	CU_ASSERT_EQUAL(intercept, 0);
+    }
+    utFree(&to);
+    CU_ASSERT_EQUAL(utScan("kg", &to), 0);
+    CU_ASSERT_EQUAL(utConvert(&from, &to, &slope, &intercept), UT_ECONVERT);
+    utFree(&to);
+    utFree(&from);
+}
+
+
 static void
 test_utIsTime(void)
 {
@@ -433,6 +543,9 @@ main(
 	    CU_ADD_TEST(testSuite, test_utScan);
 	    CU_ADD_TEST(testSuite, test_utCalendar);
 	    CU_ADD_TEST(testSuite, test_utInvCalendar);
+	    CU_ADD_TEST(testSuite, test_utCalendars);
+	    CU_ADD_TEST(testSuite, test_utInvCalendars);
+	    CU_ADD_TEST(testSuite, test_utConvertCache);
 	    CU_ADD_TEST(testSuite, test_utIsTime);
 	    CU_ADD_TEST(testSuite, test_utHasOrigin);
 	    CU_ADD_TEST(testSuite, test_utClear);
@@ -17,6 +17,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
 #include <CUnit/CUnit.h>
 #include <CUnit/Basic.h>
 
@@ -505,6 +508,73 @@ test_utGetSymbol(void)
 }
 
 
+static void
+test_reverseLookup(void)
+{
+    ut_system*	system = ut_new_system();
+    ut_unit*	base;
+    ut_unit*	scaled;
+    ut_unit*	clone;
+    const char*	latin1Name = "\xe5ngstr\xf6m";
+    const char*	utf8Name = "\xc3\xa5ngstr\xc3\xb6m";
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(system);
+    base = ut_new_base_unit(system);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(base);
+    scaled = ut_scale(1e-10, base);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(scaled);
+
+    CU_ASSERT_EQUAL(ut_map_unit_to_name(base, "meter", UT_ASCII), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_map_unit_to_name(scaled, latin1Name, UT_LATIN1),
+	UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_map_unit_to_name(scaled, "\xe5xyzzy", UT_LATIN1),
+	UT_EXISTS);
+    CU_ASSERT_EQUAL(ut_map_unit_to_symbol(scaled, "\xc3\x85", UT_UTF8),
+	UT_SUCCESS);
+
+    /* An equal unit that isn't the mapped one is found */
+    clone = ut_clone(scaled);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(clone);
+    CU_ASSERT_PTR_NULL(ut_get_name(clone, UT_ASCII));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+    CU_ASSERT_STRING_EQUAL(ut_get_name(clone, UT_LATIN1), latin1Name);
+    CU_ASSERT_STRING_EQUAL(ut_get_name(clone, UT_UTF8), utf8Name);
+    CU_ASSERT_STRING_EQUAL(ut_get_symbol(clone, UT_UTF8), "\xc3\x85");
+    CU_ASSERT_PTR_NULL(ut_get_symbol(clone, UT_LATIN1));
+    CU_ASSERT_STRING_EQUAL(ut_get_name(base, UT_UTF8), "meter");
+    CU_ASSERT_STRING_EQUAL(ut_get_name(base, UT_LATIN1), "meter");
+
+    /* An ASCII name is used by every encoding that has no name of its own */
+    CU_ASSERT_EQUAL(ut_map_unit_to_name(scaled, "angstrom", UT_ASCII),
+	UT_SUCCESS);
+    CU_ASSERT_STRING_EQUAL(ut_get_name(clone, UT_ASCII), "angstrom");
+    CU_ASSERT_STRING_EQUAL(ut_get_name(clone, UT_LATIN1), latin1Name);
+    CU_ASSERT_EQUAL(ut_unmap_unit_to_name(scaled, UT_LATIN1), UT_SUCCESS);
+    CU_ASSERT_STRING_EQUAL(ut_get_name(clone, UT_LATIN1), "angstrom");
+
+    /* A unit can be mapped again after being unmapped */
+    CU_ASSERT_EQUAL(ut_unmap_unit_to_name(scaled, UT_ASCII), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_unmap_unit_to_name(scaled, UT_ASCII), UT_SUCCESS);
+    CU_ASSERT_PTR_NULL(ut_get_name(clone, UT_ASCII));
+    CU_ASSERT_EQUAL(ut_map_unit_to_name(scaled, "Angstrom", UT_ASCII),
+	UT_SUCCESS);
+    CU_ASSERT_STRING_EQUAL(ut_get_name(clone, UT_ASCII), "Angstrom");
+
+    /* Freezing doesn't change the identifiers */
+    CU_ASSERT_EQUAL(ut_freeze_system(system), UT_SUCCESS);
+    CU_ASSERT_STRING_EQUAL(ut_get_name(clone, UT_ASCII), "Angstrom");
+    CU_ASSERT_STRING_EQUAL(ut_get_name(clone, UT_LATIN1), "Angstrom");
+    CU_ASSERT_STRING_EQUAL(ut_get_name(clone, UT_UTF8), utf8Name);
+    CU_ASSERT_STRING_EQUAL(ut_get_symbol(clone, UT_UTF8), "\xc3\x85");
+    CU_ASSERT_STRING_EQUAL(ut_get_name(base, UT_LATIN1), "meter");
+
+    ut_free(clone);
+    ut_free(scaled);
+    ut_free(base);
+    ut_free_system(system);
+}
+
+
 static void
 test_utMultiply(void)
 {
@@ -2301,6 +2371,2611 @@ test_timeResolution(void)
     ut_free(unit);
 }
 
+static void
+test_parseCache(void)
+{
+    ut_system*		xmlSystem;
+    ut_unit*		unit1;
+    ut_unit*		unit2;
+    ut_unit*		meter;
+    size_t		count;
+    unsigned long	hits;
+    unsigned long	misses;
+
+    CU_ASSERT_EQUAL(ut_set_parse_cache_capacity(NULL, 1), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_flush_parse_cache(NULL), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_get_parse_cache_stats(NULL, &count, &hits, &misses),
+        UT_BAD_ARG);
+
+    xmlSystem = ut_read_xml(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(xmlSystem);
+
+    /* Disabled by default */
+    unit1 = ut_parse(xmlSystem, "m s-1", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL(unit1);
+    ut_free(unit1);
+    CU_ASSERT_EQUAL(ut_get_parse_cache_stats(xmlSystem, &count, &hits,
+        &misses), UT_SUCCESS);
+    CU_ASSERT_EQUAL(count, 0);
+    CU_ASSERT_EQUAL(hits, 0);
+    CU_ASSERT_EQUAL(misses, 0);
+
+    CU_ASSERT_EQUAL(ut_set_parse_cache_capacity(xmlSystem, 2), UT_SUCCESS);
+
+    unit1 = ut_parse(xmlSystem, "m s-1", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL(unit1);
+    unit2 = ut_parse(xmlSystem, "m s-1", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL(unit2);
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+    CU_ASSERT_NOT_EQUAL(unit1, unit2);
+    CU_ASSERT_EQUAL(ut_compare(unit1, unit2), 0);
+    ut_free(unit1);
+    ut_free(unit2);
+    (void)ut_get_parse_cache_stats(xmlSystem, &count, &hits, &misses);
+    CU_ASSERT_EQUAL(count, 1);
+    CU_ASSERT_EQUAL(hits, 1);
+    CU_ASSERT_EQUAL(misses, 1);
+
+    /* Failures aren't cached */
+    CU_ASSERT_PTR_NULL(ut_parse(xmlSystem, "foobar", UT_ASCII));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_UNKNOWN);
+    CU_ASSERT_PTR_NULL(ut_parse(xmlSystem, "foobar", UT_ASCII));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_UNKNOWN);
+
+    /* Least-recently used entry is evicted */
+    unit1 = ut_parse(xmlSystem, "kg m-2 s-1", UT_ASCII);
+    ut_free(unit1);
+    unit1 = ut_parse(xmlSystem, "days since 1970-01-01", UT_ASCII);
+    ut_free(unit1);
+    (void)ut_get_parse_cache_stats(xmlSystem, &count, &hits, &misses);
+    CU_ASSERT_EQUAL(count, 2);
+    unit1 = ut_parse(xmlSystem, "m s-1", UT_ASCII);
+    ut_free(unit1);
+    (void)ut_get_parse_cache_stats(xmlSystem, &count, &hits, &misses);
+    CU_ASSERT_EQUAL(hits, 1);
+
+    /* Mapping changes invalidate the cache */
+    unit1 = ut_parse(xmlSystem, "cache_test_unit", UT_ASCII);
+    CU_ASSERT_PTR_NULL(unit1);
+    meter = ut_get_unit_by_name(xmlSystem, "meter");
+    CU_ASSERT_EQUAL(ut_map_name_to_unit("cache_test_unit", UT_ASCII, meter),
+        UT_SUCCESS);
+    (void)ut_get_parse_cache_stats(xmlSystem, &count, &hits, &misses);
+    CU_ASSERT_EQUAL(count, 0);
+    unit1 = ut_parse(xmlSystem, "cache_test_unit", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL(unit1);
+    CU_ASSERT_EQUAL(ut_compare(unit1, meter), 0);
+    ut_free(unit1);
+    CU_ASSERT_EQUAL(ut_unmap_name_to_unit(xmlSystem, "cache_test_unit",
+        UT_ASCII), UT_SUCCESS);
+    CU_ASSERT_PTR_NULL(ut_parse(xmlSystem, "cache_test_unit", UT_ASCII));
+    ut_free(meter);
+
+    unit1 = ut_parse(xmlSystem, "m", UT_ASCII);
+    ut_free(unit1);
+    CU_ASSERT_EQUAL(ut_add_name_prefix(xmlSystem, "mega", 1e6), UT_SUCCESS);
+    (void)ut_get_parse_cache_stats(xmlSystem, &count, &hits, &misses);
+    CU_ASSERT_EQUAL(count, 0);
+
+    CU_ASSERT_EQUAL(ut_flush_parse_cache(xmlSystem), UT_SUCCESS);
+    (void)ut_get_parse_cache_stats(xmlSystem, &count, &hits, &misses);
+    CU_ASSERT_EQUAL(count, 0);
+    CU_ASSERT_EQUAL(hits, 0);
+    CU_ASSERT_EQUAL(misses, 0);
+
+    ut_free_system(xmlSystem);
+}
+
+
+static void
+test_converterCache(void)
+{
+    ut_system*		xmlSystem;
+    ut_unit*		from;
+    ut_unit*		to;
+    cv_converter*	conv1;
+    cv_converter*	conv2;
+    size_t		count;
+    unsigned long	hits;
+    unsigned long	misses;
+
+    CU_ASSERT_EQUAL(ut_set_converter_cache_capacity(NULL, 1), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_flush_converter_cache(NULL), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_get_converter_cache_stats(NULL, &count, &hits,
+        &misses), UT_BAD_ARG);
+
+    xmlSystem = ut_read_xml(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(xmlSystem);
+    CU_ASSERT_EQUAL(ut_set_converter_cache_capacity(xmlSystem, 2),
+        UT_SUCCESS);
+
+    from = ut_parse(xmlSystem, "hours since 1900-01-01", UT_ASCII);
+    to = ut_parse(xmlSystem, "days since 1970-01-01", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(from);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(to);
+
+    conv1 = ut_get_converter(from, to);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv1);
+    conv2 = ut_get_converter(from, to);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv2);
+    CU_ASSERT_EQUAL(conv1, conv2);
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv1, 613608), 0));
+    (void)ut_get_converter_cache_stats(xmlSystem, &count, &hits, &misses);
+    CU_ASSERT_EQUAL(count, 1);
+    CU_ASSERT_EQUAL(hits, 1);
+    CU_ASSERT_EQUAL(misses, 1);
+    cv_free(conv2);
+
+    /* Returned converters outlive the cache entry */
+    CU_ASSERT_EQUAL(ut_flush_converter_cache(xmlSystem), UT_SUCCESS);
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv1, 613608), 0));
+    cv_free(conv1);
+    (void)ut_get_converter_cache_stats(xmlSystem, &count, &hits, &misses);
+    CU_ASSERT_EQUAL(count, 0);
+    CU_ASSERT_EQUAL(hits, 0);
+    CU_ASSERT_EQUAL(misses, 0);
+
+    /* Shared converters still fold */
+    ut_free(from);
+    ut_free(to);
+    from = ut_parse(xmlSystem, "km", UT_ASCII);
+    to = ut_parse(xmlSystem, "m", UT_ASCII);
+    conv1 = ut_get_converter(from, to);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv1);
+    conv2 = cv_combine(conv1, conv1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv2);
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv2, 1), 1e6));
+    cv_free(conv2);
+    cv_free(conv1);
+
+    ut_free(from);
+    ut_free(to);
+    ut_free_system(xmlSystem);
+}
+
+
+static void
+test_converterCacheOrigins(void)
+{
+    static const char* const	origins[] = {"1900-01-01", "1970-01-01",
+	"2000-01-01", "1950-06-15", "2020-12-31", "1800-03-01", "1990-01-01",
+	"1960-01-01"};
+    const int		norigin = sizeof(origins)/sizeof(origins[0]);
+    ut_system*		xmlSystem;
+    ut_unit*		units[sizeof(origins)/sizeof(origins[0])];
+    ut_unit*		to;
+    size_t		count;
+    unsigned long	hits;
+    unsigned long	misses;
+    int			i;
+    int			j;
+
+    xmlSystem = ut_read_xml(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(xmlSystem);
+    to = ut_parse(xmlSystem, "seconds since 1970-01-01", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(to);
+
+    for (i = 0; i < norigin; i++) {
+	char	spec[80];
+
+	(void)snprintf(spec, sizeof(spec), "hours since %s", origins[i]);
+	units[i] = ut_parse(xmlSystem, spec, UT_ASCII);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(units[i]);
+    }
+
+    /* The ordering of timestamp-units must be consistent */
+    for (i = 0; i < norigin; i++) {
+	for (j = 0; j < norigin; j++) {
+	    int	cmp = ut_compare(units[i], units[j]);
+
+	    CU_ASSERT_EQUAL(cmp, -ut_compare(units[j], units[i]));
+	    CU_ASSERT_EQUAL(cmp == 0, i == j);
+	}
+    }
+
+    /* Every pair is found and evictions don't corrupt the cache */
+    CU_ASSERT_EQUAL(ut_set_converter_cache_capacity(xmlSystem, norigin - 2),
+        UT_SUCCESS);
+
+    for (j = 0; j < 2; j++) {
+	for (i = 0; i < norigin; i++) {
+	    cv_converter*	conv1 = ut_get_converter(units[i], to);
+	    cv_converter*	conv2 = ut_get_converter(units[i], to);
+
+	    CU_ASSERT_PTR_NOT_NULL_FATAL(conv1);
+	    CU_ASSERT_EQUAL(conv1, conv2);
+	    cv_free(conv1);
+	    cv_free(conv2);
+	}
+    }
+
+    (void)ut_get_converter_cache_stats(xmlSystem, &count, &hits, &misses);
+    CU_ASSERT_EQUAL(count, norigin - 2);
+    CU_ASSERT_EQUAL(hits, 2*norigin);
+    CU_ASSERT_EQUAL(misses, 2*norigin);
+
+    for (i = 0; i < norigin; i++)
+	ut_free(units[i]);
+    ut_free(to);
+    ut_free_system(xmlSystem);
+}
+
+
+static void
+test_programConverter(void)
+{
+    cv_converter*	lg = cv_get_log(10);
+    cv_converter*	scale = cv_get_scale(10);
+    cv_converter*	offset = cv_get_offset(30);
+    cv_converter*	dB;
+    cv_converter*	dBm;
+    cv_converter*	clone;
+    double		values[1001];
+    float		floats[1001];
+    char		buf[80];
+    int			i;
+    int			ok;
+
+    dB = cv_combine(lg, scale);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(dB);
+    dBm = cv_combine(dB, offset);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(dBm);
+    cv_free(lg);
+    cv_free(scale);
+    cv_free(offset);
+    cv_free(dB);
+
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(dBm, 100), 50));
+    CU_ASSERT_TRUE(cv_get_expression(dBm, buf, sizeof(buf), "x") > 0);
+    CU_ASSERT_STRING_EQUAL(buf, "10*lg(x) + 30");
+
+    /* Disjoint, more than one block */
+    for (i = 0; i < 1000; i++)
+        values[i] = i + 1;
+    CU_ASSERT_EQUAL(cv_convert_doubles(dBm, values, 1000, values), values);
+    for (ok = 1, i = 0; i < 1000; i++)
+        ok &= areCloseDoubles(values[i], 10*log10(i + 1.0) + 30);
+    CU_ASSERT_TRUE(ok);
+
+    /* Overlapping, with the output after the input */
+    for (i = 0; i < 1000; i++)
+        values[i] = i + 1;
+    (void)cv_convert_doubles(dBm, values, 1000, values + 1);
+    for (ok = 1, i = 0; i < 1000; i++)
+        ok &= areCloseDoubles(values[i+1], 10*log10(i + 1.0) + 30);
+    CU_ASSERT_TRUE(ok);
+
+    /* Overlapping, with the output before the input */
+    for (i = 0; i < 1000; i++)
+        floats[i+1] = i + 1;
+    clone = cv_combine(cv_get_trivial(), dBm);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(clone);
+    (void)cv_convert_floats(clone, floats + 1, 1000, floats);
+    for (ok = 1, i = 0; i < 1000; i++)
+        ok &= areCloseFloats(floats[i], 10*log10(i + 1.0) + 30);
+    CU_ASSERT_TRUE(ok);
+
+    cv_free(clone);
+    cv_free(dBm);
+}
+
+
+static void
+test_arrayKernels(void)
+{
+    cv_converter*	convs[5];
+    double		values[203];
+    double		expect[203];
+    float		floats[203];
+    int			i;
+    int			j;
+
+    convs[0] = cv_get_inverse();
+    convs[1] = cv_get_scale(2);
+    convs[2] = cv_get_offset(-1);
+    convs[3] = cv_get_galilean(3, 4);
+    convs[4] = cv_get_log(2);
+
+    for (j = 0; j < 5; j++) {
+        int	ok = 1;
+
+        CU_ASSERT_PTR_NOT_NULL_FATAL(convs[j]);
+
+        for (i = 0; i < 101; i++)
+            expect[i] = cv_convert_double(convs[j], i + 1);
+
+        /* Disjoint */
+        for (i = 0; i < 101; i++)
+            values[i] = i + 1;
+        (void)cv_convert_doubles(convs[j], values, 101, values + 102);
+        for (i = 0; i < 101; i++)
+            ok &= areCloseDoubles(values[102+i], expect[i]);
+
+        /* Identical */
+        (void)cv_convert_doubles(convs[j], values, 101, values);
+        for (i = 0; i < 101; i++)
+            ok &= areCloseDoubles(values[i], expect[i]);
+
+        /* Overlapping */
+        for (i = 0; i < 101; i++)
+            values[i] = i + 1;
+        (void)cv_convert_doubles(convs[j], values, 101, values + 3);
+        for (i = 0; i < 101; i++)
+            ok &= areCloseDoubles(values[3+i], expect[i]);
+
+        for (i = 0; i < 101; i++)
+            floats[i+2] = i + 1;
+        (void)cv_convert_floats(convs[j], floats + 2, 101, floats);
+        for (i = 0; i < 101; i++)
+            ok &= areCloseFloats(floats[i], (float)expect[i]);
+
+        CU_ASSERT_TRUE(ok);
+        cv_free(convs[j]);
+    }
+}
+
+
+static void
+test_simplifiedConverter(void)
+{
+    cv_converter*	lg = cv_get_log(10);
+    cv_converter*	ln = cv_get_log(M_E);
+    cv_converter*	pw = cv_get_pow(10);
+    cv_converter*	milli = cv_get_scale(1e-3);
+    cv_converter*	kilo = cv_get_scale(1e3);
+    cv_converter*	deci = cv_get_scale(0.1);
+    cv_converter*	ten = cv_get_scale(10);
+    cv_converter*	tmp;
+    cv_converter*	tmp2;
+    cv_converter*	conv;
+    ut_system*		xmlSystem;
+    ut_unit*		dBm;
+    ut_unit*		dBW;
+    char		buf[80];
+
+    /* pow(10, x), then lg(x): the identity */
+    conv = cv_combine(pw, lg);
+    CU_ASSERT_PTR_EQUAL(conv, cv_get_trivial());
+    cv_free(conv);
+
+    /* pow(10, x), then ln(x): a scaling */
+    conv = cv_combine(pw, ln);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv);
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv, 2), 2*M_LN10));
+    CU_ASSERT_TRUE(cv_get_expression(conv, buf, sizeof(buf), "x") > 0);
+    CU_ASSERT_PTR_NULL(strstr(buf, "ln"));
+    cv_free(conv);
+
+    /* 0.001*x, then lg(x): the scaling becomes an offset */
+    conv = cv_combine(milli, lg);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv);
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv, 100), -1));
+    CU_ASSERT_TRUE(cv_get_expression(conv, buf, sizeof(buf), "x") > 0);
+    CU_ASSERT_STRING_EQUAL(buf, "lg(x) - 3");
+    cv_free(conv);
+
+    /* pow(10, x), 1000*x, lg(x), 10*x: a single affine transformation */
+    tmp = cv_combine(pw, kilo);
+    tmp2 = cv_combine(lg, ten);
+    conv = cv_combine(tmp, tmp2);
+    cv_free(tmp2);
+    cv_free(tmp);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv);
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv, 2), 50));
+    CU_ASSERT_TRUE(cv_get_expression(conv, buf, sizeof(buf), "x") > 0);
+    CU_ASSERT_STRING_EQUAL(buf, "10*x + 30");
+    cv_free(conv);
+
+    /* 0.1*x, pow(10, x), 0.001*x: the last scaling precedes pow() */
+    tmp = cv_combine(deci, pw);
+    conv = cv_combine(tmp, milli);
+    cv_free(tmp);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv);
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv, 30), 1));
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv, 50), 100));
+    CU_ASSERT_TRUE(cv_get_expression(conv, buf, sizeof(buf), "x") > 0);
+    CU_ASSERT_PTR_NOT_NULL(strstr(buf, "pow(10, "));
+    CU_ASSERT_PTR_NULL(strstr(buf, "0.001"));
+    cv_free(conv);
+
+    /* x - 1, pow(10, x), 10*x: the offset and scaling cancel */
+    tmp2 = cv_get_offset(-1);
+    tmp = cv_combine(tmp2, pw);
+    cv_free(tmp2);
+    conv = cv_combine(tmp, ten);
+    cv_free(tmp);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv);
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv, 2), 100));
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv, 0), 1));
+    CU_ASSERT_TRUE(cv_get_expression(conv, buf, sizeof(buf), "x") > 0);
+    CU_ASSERT_STRING_EQUAL(buf, "pow(10, x)");
+    cv_free(conv);
+
+    /* Negative scalings aren't moved past logarithms */
+    tmp = cv_get_scale(-1);
+    conv = cv_combine(tmp, lg);
+    cv_free(tmp);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv);
+    CU_ASSERT_TRUE(isnan(cv_convert_double(conv, 1)));
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv, -100), 2));
+    cv_free(conv);
+
+    cv_free(ten);
+    cv_free(deci);
+    cv_free(kilo);
+    cv_free(milli);
+    cv_free(pw);
+    cv_free(ln);
+    cv_free(lg);
+
+    /* Between logarithmic units with different references */
+    xmlSystem = ut_read_xml(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(xmlSystem);
+    dBm = ut_parse(xmlSystem, "0.1 lg(re mW)", UT_ASCII);
+    dBW = ut_parse(xmlSystem, "0.1 lg(re W)", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(dBm);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(dBW);
+    conv = ut_get_converter(dBm, dBW);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv);
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv, 30), 0));
+    CU_ASSERT_TRUE(areCloseDoubles(cv_convert_double(conv, 50), 20));
+    CU_ASSERT_TRUE(cv_get_expression(conv, buf, sizeof(buf), "x") > 0);
+    CU_ASSERT_PTR_NULL(strstr(buf, "lg"));
+    CU_ASSERT_PTR_NULL(strstr(buf, "pow"));
+    cv_free(conv);
+    ut_free(dBW);
+    ut_free(dBm);
+    ut_free_system(xmlSystem);
+}
+
+
+static void
+test_compiledConverter(void)
+{
+    cv_converter*	lg = cv_get_log(10);
+    cv_converter*	pw = cv_get_pow(10);
+    cv_converter*	scale = cv_get_scale(0.1);
+    cv_converter*	offset = cv_get_offset(30);
+    cv_converter*	scale10 = cv_get_scale(10);
+    cv_converter*	tmp;
+    cv_converter*	convs[4];
+    double		values[1205];
+    double		expect[1200];
+    double		out[1200];
+    float		floats[1205];
+    char		buf1[80];
+    char		buf2[80];
+    int			i;
+    int			j;
+
+    CU_ASSERT_PTR_NULL(cv_compile(NULL));
+
+    /* 10*lg(x) + 30: one stage */
+    tmp = cv_combine(lg, scale10);
+    convs[0] = cv_combine(tmp, offset);
+    cv_free(tmp);
+    /* pow(10, 0.1*x): one exponential stage */
+    convs[1] = cv_combine(scale, pw);
+    /* 1/x + 30: reciprocal stage */
+    convs[2] = cv_combine(cv_get_inverse(), offset);
+    /* pow(10, lg(x) + 30): two stages */
+    tmp = cv_combine(lg, offset);
+    convs[3] = cv_combine(tmp, pw);
+    cv_free(tmp);
+
+    cv_free(scale10);
+    cv_free(offset);
+    cv_free(scale);
+    cv_free(pw);
+    cv_free(lg);
+
+    for (j = 0; j < 4; j++) {
+	cv_converter*	compiled;
+	cv_converter*	clone;
+	int		ok = 1;
+	/* Keep the results of the last converter finite */
+	const double	step = j == 3 ? 1e-33 : 0.5;
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(convs[j]);
+	compiled = cv_compile(convs[j]);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(compiled);
+
+	CU_ASSERT_TRUE(cv_get_expression(convs[j], buf1, sizeof(buf1), "x") > 0);
+	CU_ASSERT_TRUE(cv_get_expression(compiled, buf2, sizeof(buf2), "x") > 0);
+	CU_ASSERT_STRING_EQUAL(buf1, buf2);
+
+	for (i = 0; i < 1200; i++)
+	    expect[i] = cv_convert_double(convs[j], (i + 1) * step);
+
+	ok &= areCloseDoubles(cv_convert_double(compiled, step), expect[0]);
+
+	/* Disjoint */
+	for (i = 0; i < 1200; i++)
+	    values[i] = (i + 1) * step;
+	(void)cv_convert_doubles(compiled, values, 1200, out);
+	for (i = 0; i < 1200; i++)
+	    ok &= areCloseDoubles(out[i], expect[i]);
+
+	/* Overlapping, with the output after the input */
+	(void)cv_convert_doubles(compiled, values, 1200, values + 1);
+	for (i = 0; i < 1200; i++)
+	    ok &= areCloseDoubles(values[i+1], expect[i]);
+
+	/* Identical */
+	for (i = 0; i < 1200; i++)
+	    values[i] = (i + 1) * step;
+	(void)cv_convert_doubles(compiled, values, 1200, values);
+	for (i = 0; i < 1200; i++)
+	    ok &= areCloseDoubles(values[i], expect[i]);
+
+	/* Overlapping, with the output before the input */
+	for (i = 0; i < 1200; i++)
+	    values[i+5] = (i + 1) * step;
+	(void)cv_convert_doubles(compiled, values + 5, 1200, values);
+	for (i = 0; i < 1200; i++)
+	    ok &= areCloseDoubles(values[i], expect[i]);
+
+	/* Floats, through a clone */
+	clone = cv_combine(cv_get_trivial(), compiled);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(clone);
+	for (i = 0; i < 1200; i++)
+	    floats[i] = (float)((i + 1) * step);
+	(void)cv_convert_floats(clone, floats, 1200, floats);
+	for (i = 0; i < 1200; i++)
+	    ok &= expect[i] > FLT_MAX ||
+		areCloseFloats(floats[i], (float)expect[i]);
+
+	CU_ASSERT_TRUE(ok);
+
+	cv_free(clone);
+	cv_free(compiled);
+	cv_free(convs[j]);
+    }
+}
+
+
+static void
+test_parallelConversion(void)
+{
+    const size_t	count = 100003;
+    cv_converter*	conv = cv_get_galilean(1.8, 32);
+    double*		values = malloc((2*count + 5) * sizeof(double));
+    float*		floats = malloc(2 * count * sizeof(float));
+    int			ok = 1;
+    size_t		i;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(values);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(floats);
+
+    CU_ASSERT_EQUAL(cv_set_parallelism(4, 1000), 0);
+
+    CU_ASSERT_PTR_NULL(cv_convert_doubles_parallel(NULL, values, 1, values));
+    CU_ASSERT_PTR_NULL(cv_convert_floats_parallel(conv, NULL, 1, floats));
+
+    /* Disjoint */
+    for (i = 0; i < count; i++)
+        values[i] = (double)i;
+    CU_ASSERT_PTR_EQUAL(
+        cv_convert_doubles_parallel(conv, values, count, values + count),
+        values + count);
+    for (i = 0; i < count; i++)
+        ok &= areCloseDoubles(values[count+i], 1.8*i + 32);
+
+    /* Identical */
+    (void)cv_convert_doubles_parallel(conv, values, count, values);
+    for (i = 0; i < count; i++)
+        ok &= areCloseDoubles(values[i], 1.8*i + 32);
+
+    /* Overlapping */
+    for (i = 0; i < count; i++)
+        values[i] = (double)i;
+    (void)cv_convert_doubles_parallel(conv, values, count, values + 5);
+    for (i = 0; i < count; i++)
+        ok &= areCloseDoubles(values[5+i], 1.8*i + 32);
+
+    for (i = 0; i < count; i++)
+        floats[i] = (float)(i % 1000);
+    (void)cv_convert_floats_parallel(conv, floats, count, floats + count);
+    for (i = 0; i < count; i++)
+        ok &= areCloseFloats(floats[count+i], (float)(1.8*(i % 1000) + 32));
+
+    CU_ASSERT_TRUE(ok);
+
+    /* Serial */
+    CU_ASSERT_EQUAL(cv_set_parallelism(1, 0), 0);
+    values[0] = 100;
+    (void)cv_convert_doubles_parallel(conv, values, count, values);
+    CU_ASSERT_TRUE(areCloseDoubles(values[0], 212));
+
+    CU_ASSERT_EQUAL(cv_set_parallelism(0, 65536), 0);
+
+    free(floats);
+    free(values);
+    cv_free(conv);
+}
+
+
+static void
+test_conversionPlan(void)
+{
+    const size_t	ncols = 3;
+    const size_t	count = 5003;
+    const size_t	stride = 4;
+    ut_unit*		from[3];
+    ut_unit*		to[3];
+    cv_converter*	convs[3];
+    ut_conversion_plan*	plan;
+    double*		columns[3];
+    double*		outColumns[3];
+    double*		records = malloc(count * stride * sizeof(double));
+    double*		outRecords = malloc(count * stride * sizeof(double));
+    int			ok = 1;
+    size_t		i;
+    size_t		j;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(records);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(outRecords);
+
+    from[0] = celsius;		to[0] = fahrenheit;
+    from[1] = kilometer;	to[1] = meter;
+    from[2] = kelvin;		to[2] = kelvin;
+
+    for (j = 0; j < ncols; j++) {
+	convs[j] = ut_get_converter(from[j], to[j]);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(convs[j]);
+	columns[j] = malloc(count * sizeof(double));
+	outColumns[j] = malloc(count * sizeof(double));
+	CU_ASSERT_PTR_NOT_NULL_FATAL(columns[j]);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(outColumns[j]);
+    }
+
+    plan = ut_new_conversion_plan(from, to, ncols);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(plan);
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_get_conversion_plan_size(plan), ncols);
+
+    /* Structure of arrays: disjoint, then in place */
+    for (j = 0; j < ncols; j++)
+	for (i = 0; i < count; i++)
+	    columns[j][i] = (double)i + j;
+    CU_ASSERT_EQUAL(ut_convert_columns(plan, (const double* const*)columns,
+	count, outColumns, 0), UT_SUCCESS);
+    for (j = 0; j < ncols; j++)
+	for (i = 0; i < count; i++)
+	    ok &= areCloseDoubles(outColumns[j][i],
+		cv_convert_double(convs[j], (double)i + j));
+    CU_ASSERT_EQUAL(ut_convert_columns(plan, (const double* const*)columns,
+	count, columns, 0), UT_SUCCESS);
+    for (j = 0; j < ncols; j++)
+	for (i = 0; i < count; i++)
+	    ok &= columns[j][i] == outColumns[j][i];
+    CU_ASSERT_TRUE(ok);
+
+    /* Array of structures: the padding between records isn't touched */
+    for (i = 0; i < count; i++) {
+	for (j = 0; j < ncols; j++)
+	    records[i*stride+j] = (double)i - j;
+	records[i*stride+ncols] = -1;
+	outRecords[i*stride+ncols] = -2;
+    }
+    CU_ASSERT_EQUAL(ut_convert_records(plan, records, stride, count,
+	outRecords, stride, 0), UT_SUCCESS);
+    for (i = 0; i < count; i++) {
+	for (j = 0; j < ncols; j++)
+	    ok &= areCloseDoubles(outRecords[i*stride+j],
+		cv_convert_double(convs[j], (double)i - j));
+	ok &= outRecords[i*stride+ncols] == -2;
+    }
+    CU_ASSERT_EQUAL(ut_convert_records(plan, records, stride, count,
+	records, stride, 0), UT_SUCCESS);
+    for (i = 0; i < count; i++) {
+	for (j = 0; j < ncols; j++)
+	    ok &= records[i*stride+j] == outRecords[i*stride+j];
+	ok &= records[i*stride+ncols] == -1;
+    }
+    CU_ASSERT_TRUE(ok);
+
+    /* Packed output records are the same as padded ones */
+    for (i = 0; i < count; i++)
+	for (j = 0; j < ncols; j++)
+	    records[i*stride+j] = (double)i - j;
+    CU_ASSERT_EQUAL(ut_convert_records(plan, records, stride, count,
+	records, ncols, 0), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_convert_records(plan, records, stride, count,
+	outRecords, ncols, 0), UT_SUCCESS);
+    for (i = 0; i < count; i++)
+	for (j = 0; j < ncols; j++)
+	    ok &= areCloseDoubles(outRecords[i*ncols+j],
+		cv_convert_double(convs[j], (double)i - j));
+    CU_ASSERT_TRUE(ok);
+
+    /* In parallel */
+    CU_ASSERT_EQUAL(cv_set_parallelism(4, 1000), 0);
+    for (j = 0; j < ncols; j++)
+	for (i = 0; i < count; i++)
+	    columns[j][i] = (double)i + j;
+    CU_ASSERT_EQUAL(ut_convert_columns(plan, (const double* const*)columns,
+	count, columns, 1), UT_SUCCESS);
+    for (j = 0; j < ncols; j++)
+	for (i = 0; i < count; i++)
+	    ok &= columns[j][i] == outColumns[j][i];
+    for (i = 0; i < count; i++)
+	for (j = 0; j < ncols; j++)
+	    records[i*stride+j] = (double)i - j;
+    CU_ASSERT_EQUAL(ut_convert_records(plan, records, stride, count,
+	records, stride, 1), UT_SUCCESS);
+    for (i = 0; i < count; i++)
+	for (j = 0; j < ncols; j++)
+	    ok &= areCloseDoubles(records[i*stride+j],
+		cv_convert_double(convs[j], (double)i - j));
+    CU_ASSERT_TRUE(ok);
+    CU_ASSERT_EQUAL(cv_set_parallelism(0, 65536), 0);
+
+    /* Invalid arguments */
+    CU_ASSERT_EQUAL(ut_convert_columns(NULL, (const double* const*)columns,
+	count, columns, 0), UT_BAD_ARG);
+    {
+	double*	column = outColumns[1];
+
+	outColumns[1] = NULL;
+	CU_ASSERT_EQUAL(ut_convert_columns(plan,
+	    (const double* const*)columns, count, outColumns, 0), UT_BAD_ARG);
+	outColumns[1] = column;
+    }
+    CU_ASSERT_EQUAL(ut_convert_records(plan, records, ncols - 1, count,
+	outRecords, stride, 0), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_get_conversion_plan_size(NULL), 0);
+    CU_ASSERT_EQUAL(ut_get_status(), UT_BAD_ARG);
+
+    to[1] = kilogram;
+    CU_ASSERT_PTR_NULL(ut_new_conversion_plan(from, to, ncols));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_MEANINGLESS);
+    CU_ASSERT_PTR_NULL(ut_new_conversion_plan(NULL, to, ncols));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_BAD_ARG);
+
+    ut_free_conversion_plan(plan);
+    ut_free_conversion_plan(NULL);
+
+    for (j = 0; j < ncols; j++) {
+	free(outColumns[j]);
+	free(columns[j]);
+	cv_free(convs[j]);
+    }
+    free(outRecords);
+    free(records);
+}
+
+
+static void
+test_stridedConversion(void)
+{
+    cv_converter*	conv = cv_get_galilean(2, 1);
+    double		doubles[3000];
+    double		results[1000];
+    float		floats[3000];
+    short		shorts[1000];
+    int			ints[1000];
+    int			ok = 1;
+    int			i;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(conv);
+
+    CU_ASSERT_PTR_NULL(cv_convert_doubles_strided(conv, NULL, 1, 1, doubles,
+        1));
+    CU_ASSERT_PTR_NULL(cv_convert_packed_shorts(NULL, shorts, 1, 1, 0,
+        doubles));
+
+    /* Gather a hyperslab into a contiguous array */
+    for (i = 0; i < 3000; i++)
+        doubles[i] = i;
+    CU_ASSERT_PTR_EQUAL(cv_convert_doubles_strided(conv, doubles, 3, 1000,
+        results, 1), results);
+    for (i = 0; i < 1000; i++)
+        ok &= areCloseDoubles(results[i], 2*(3*i) + 1);
+
+    /* Scatter in reverse order */
+    (void)cv_convert_doubles_strided(conv, results + 999, -1, 1000, doubles,
+        3);
+    for (i = 0; i < 1000; i++)
+        ok &= areCloseDoubles(doubles[3*i], 2*(2*(3*(999-i)) + 1) + 1);
+
+    /* In place */
+    for (i = 0; i < 3000; i++)
+        floats[i] = (float)i;
+    (void)cv_convert_floats_strided(conv, floats, 2, 1500, floats, 2);
+    for (i = 0; i < 3000; i++)
+        ok &= areCloseFloats(floats[i], i % 2 ? i : 2*i + 1);
+
+    for (i = 0; i < 1000; i++)
+        floats[i] = (float)i;
+    CU_ASSERT_PTR_EQUAL(cv_convert_floats_to_doubles(conv, floats, 1000,
+        results), results);
+    for (i = 0; i < 1000; i++)
+        ok &= areCloseDoubles(results[i], 2*i + 1);
+
+    CU_ASSERT_PTR_EQUAL(cv_convert_doubles_to_floats(conv, results, 1000,
+        floats), floats);
+    for (i = 0; i < 1000; i++)
+        ok &= areCloseFloats(floats[i], 2*(2*i + 1) + 1);
+
+    for (i = 0; i < 1000; i++) {
+        shorts[i] = (short)(i - 500);
+        ints[i] = 100000 * (i - 500);
+    }
+    CU_ASSERT_PTR_EQUAL(cv_convert_packed_shorts(conv, shorts, 1000, 0.5, 10,
+        results), results);
+    for (i = 0; i < 1000; i++)
+        ok &= areCloseDoubles(results[i], 2*((i-500)*0.5 + 10) + 1);
+
+    CU_ASSERT_PTR_EQUAL(cv_convert_packed_ints(conv, ints, 1000, 1e-5, 0,
+        results), results);
+    for (i = 0; i < 1000; i++)
+        ok &= areCloseDoubles(results[i], 2*(i-500) + 1);
+
+    CU_ASSERT_TRUE(ok);
+    cv_free(conv);
+}
+
+
+#ifdef HAVE_PTHREAD_H
+/*
+ * Parses, formats, and converts in a loop.  Returns the number of failures.
+ */
+static void*
+parseRepeatedly(
+    void* const	arg)
+{
+    static const char* const	specs[] = {"m/s", "kg.m2.s-2", "K @ 273.15",
+	"s since 2000-01-01", "Mm^2", "(K @ 273.15)/s", "lg(re m)"};
+    ut_system* const		system = (ut_system*)arg;
+    long			failures = 0;
+    int				i;
+
+    for (i = 0; i < 2000; i++) {
+	const char* const	spec = specs[i % 7];
+	ut_unit*		unit = ut_parse(system, spec, UT_LATIN1);
+
+	if (unit == NULL || ut_get_status() != UT_SUCCESS) {
+	    failures++;
+	}
+	else {
+	    char		buf[128];
+	    cv_converter*	conv = ut_get_converter(unit, unit);
+
+	    if (ut_format(unit, buf, sizeof(buf), UT_ASCII) <= 0)
+		failures++;
+	    if (conv == NULL || cv_convert_double(conv, 2.5) != 2.5)
+		failures++;
+
+	    cv_free(conv);
+	    ut_free(unit);
+	}
+
+	if (ut_parse(system, "m/", UT_ASCII) != NULL)
+	    failures++;
+	if (ut_parse(system, "gronks", UT_ASCII) != NULL ||
+		ut_get_status() != UT_UNKNOWN)
+	    failures++;
+    }
+
+    return (void*)failures;
+}
+#endif
+
+
+static void
+test_concurrency(void)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_t	threads[4];
+    int		i;
+
+    CU_ASSERT_EQUAL(ut_set_parse_cache_capacity(unitSystem, 4), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_set_converter_cache_capacity(unitSystem, 4),
+	UT_SUCCESS);
+
+    for (i = 0; i < 4; i++)
+	CU_ASSERT_EQUAL_FATAL(
+	    pthread_create(threads + i, NULL, parseRepeatedly, unitSystem), 0);
+
+    ut_set_status(UT_BAD_ARG);
+
+    for (i = 0; i < 4; i++) {
+	void*	failures;
+
+	CU_ASSERT_EQUAL(pthread_join(threads[i], &failures), 0);
+	CU_ASSERT_PTR_NULL(failures);
+    }
+
+    /* The status is per-thread */
+    CU_ASSERT_EQUAL(ut_get_status(), UT_BAD_ARG);
+
+    CU_ASSERT_EQUAL(ut_set_parse_cache_capacity(unitSystem, 0), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_set_converter_cache_capacity(unitSystem, 0),
+	UT_SUCCESS);
+#endif
+}
+
+
+#ifdef HAVE_PTHREAD_H
+static int	processMessages;
+static int	threadMessages;
+
+
+static int
+countProcessMessage(
+    const char* const	fmt,
+    va_list		args)
+{
+    processMessages++;
+    return 0;
+}
+
+
+static int
+countThreadMessage(
+    const char* const	fmt,
+    va_list		args)
+{
+    threadMessages++;
+    return 0;
+}
+
+
+/*
+ * Reports an error-message with a handler of its own.  Returns the number of
+ * failures.
+ */
+static void*
+reportWithThreadHandler(
+    void* const	arg)
+{
+    long	failures = 0;
+
+    if (ut_set_thread_error_message_handler(countThreadMessage) != NULL)
+	failures++;
+
+    (void)ut_handle_error_message("thread message");
+
+    if (ut_set_thread_error_message_handler(NULL) != countThreadMessage)
+	failures++;
+
+    return (void*)failures;
+}
+#endif
+
+
+static void
+test_threadErrorHandler(void)
+{
+#ifdef HAVE_PTHREAD_H
+    pthread_t			thread;
+    void*			failures;
+    ut_error_message_handler	prev =
+	ut_set_error_message_handler(countProcessMessage);
+
+    processMessages = threadMessages = 0;
+    CU_ASSERT_EQUAL_FATAL(
+	pthread_create(&thread, NULL, reportWithThreadHandler, NULL), 0);
+    CU_ASSERT_EQUAL(pthread_join(thread, &failures), 0);
+    CU_ASSERT_PTR_NULL(failures);
+    CU_ASSERT_EQUAL(threadMessages, 1);
+    CU_ASSERT_EQUAL(processMessages, 0);
+
+    /* The handler set by another thread doesn't apply to this one */
+    (void)ut_handle_error_message("process message");
+    CU_ASSERT_EQUAL(processMessages, 1);
+
+    /* The process-wide handler is overridden for this thread only */
+    CU_ASSERT_PTR_NULL(ut_set_thread_error_message_handler(countThreadMessage));
+    (void)ut_handle_error_message("thread message");
+    CU_ASSERT_EQUAL(threadMessages, 2);
+    CU_ASSERT_EQUAL(processMessages, 1);
+    CU_ASSERT_EQUAL(ut_set_error_message_handler(NULL), countProcessMessage);
+    CU_ASSERT_EQUAL(ut_set_thread_error_message_handler(NULL),
+	countThreadMessage);
+    (void)ut_handle_error_message("process message");
+    CU_ASSERT_EQUAL(processMessages, 2);
+
+    CU_ASSERT_EQUAL(ut_set_error_message_handler(prev), countProcessMessage);
+#endif
+}
+
+static void
+test_freezeSystem(void)
+{
+    static const char* const	specs[] = {"kilometer", "KILOMETER", "km",
+	"Kilometers", "degree_Celsius", "\xc2\xb0" "C", "\xc2\xb5s",
+	"microsecond", "megaparsec", "hPa", "kg.m2.s-2", "K @ 273.15",
+	"s since 2000-01-01", "lg(re mW)", "dam", "dekameter", "Mm^2"};
+    enum {NSPECS = sizeof(specs)/sizeof(specs[0])};
+    static const int		formats[] = {UT_UTF8, UT_ASCII | UT_NAMES,
+	UT_LATIN1 | UT_NAMES, UT_UTF8 | UT_DEFINITION};
+    enum {NFORMATS = sizeof(formats)/sizeof(formats[0])};
+    char			before[NSPECS][NFORMATS][128];
+    ut_system*			xmlSystem;
+    ut_unit*			unit;
+    ut_unit*			meter;
+    int				i;
+
+    ut_set_error_message_handler(ut_ignore);
+
+    xmlSystem = ut_read_xml(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(xmlSystem);
+    CU_ASSERT_FALSE(ut_is_frozen(xmlSystem));
+
+    for (i = 0; i < NSPECS; i++) {
+	int	j;
+
+	unit = ut_parse(xmlSystem, specs[i], UT_UTF8);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+
+	for (j = 0; j < NFORMATS; j++)
+	    CU_ASSERT_TRUE(ut_format(unit, before[i][j], sizeof(before[i][j]),
+		formats[j]) > 0);
+
+	ut_free(unit);
+    }
+
+    CU_ASSERT_EQUAL(ut_freeze_system(NULL), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_freeze_system(xmlSystem), UT_SUCCESS);
+    CU_ASSERT_TRUE(ut_is_frozen(xmlSystem));
+    CU_ASSERT_EQUAL(ut_freeze_system(xmlSystem), UT_SUCCESS);
+
+    for (i = 0; i < NSPECS; i++) {
+	int	j;
+
+	unit = ut_parse(xmlSystem, specs[i], UT_UTF8);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+
+	for (j = 0; j < NFORMATS; j++) {
+	    char	buf[128];
+
+	    CU_ASSERT_TRUE(ut_format(unit, buf, sizeof(buf), formats[j]) > 0);
+	    CU_ASSERT_STRING_EQUAL(buf, before[i][j]);
+	}
+
+	ut_free(unit);
+    }
+
+    CU_ASSERT_PTR_NULL(ut_parse(xmlSystem, "gronks", UT_ASCII));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_UNKNOWN);
+    CU_ASSERT_PTR_NULL(ut_get_unit_by_name(xmlSystem, "kilometer"));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+
+    meter = ut_get_unit_by_name(xmlSystem, "METER");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(meter);
+    unit = ut_get_unit_by_symbol(xmlSystem, "m");
+    CU_ASSERT_EQUAL(ut_compare(unit, meter), 0);
+    ut_free(unit);
+    CU_ASSERT_PTR_NULL(ut_get_unit_by_symbol(xmlSystem, "M"));
+    CU_ASSERT_STRING_EQUAL(ut_get_name(meter, UT_ASCII), "meter");
+    CU_ASSERT_STRING_EQUAL(ut_get_symbol(meter, UT_UTF8), "m");
+
+    unit = ut_get_unit_by_name(xmlSystem, "degree_Celsius");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+    CU_ASSERT_STRING_EQUAL(ut_get_symbol(unit, UT_UTF8), "\xc2\xb0" "C");
+    ut_free(unit);
+
+    /* Modification of a frozen unit-system fails */
+    CU_ASSERT_EQUAL(ut_map_name_to_unit("gronk", UT_ASCII, meter), UT_FROZEN);
+    CU_ASSERT_EQUAL(ut_map_symbol_to_unit("gk", UT_ASCII, meter), UT_FROZEN);
+    CU_ASSERT_EQUAL(ut_unmap_name_to_unit(xmlSystem, "meter", UT_ASCII),
+	UT_FROZEN);
+    CU_ASSERT_EQUAL(ut_unmap_symbol_to_unit(xmlSystem, "m", UT_ASCII),
+	UT_FROZEN);
+    CU_ASSERT_EQUAL(ut_map_unit_to_name(meter, "gronk", UT_ASCII), UT_FROZEN);
+    CU_ASSERT_EQUAL(ut_map_unit_to_symbol(meter, "gk", UT_ASCII), UT_FROZEN);
+    CU_ASSERT_EQUAL(ut_unmap_unit_to_name(meter, UT_ASCII), UT_FROZEN);
+    CU_ASSERT_EQUAL(ut_unmap_unit_to_symbol(meter, UT_ASCII), UT_FROZEN);
+    CU_ASSERT_EQUAL(ut_add_name_prefix(xmlSystem, "gronko", 2), UT_FROZEN);
+    CU_ASSERT_EQUAL(ut_add_symbol_prefix(xmlSystem, "g", 2), UT_FROZEN);
+    CU_ASSERT_PTR_NULL(ut_new_base_unit(xmlSystem));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_FROZEN);
+    CU_ASSERT_PTR_NULL(ut_new_dimensionless_unit(xmlSystem));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_FROZEN);
+    CU_ASSERT_PTR_NULL(ut_get_unit_by_name(xmlSystem, "gronk"));
+    CU_ASSERT_STRING_EQUAL(ut_get_name(meter, UT_ASCII), "meter");
+    ut_free(meter);
+
+#ifdef HAVE_PTHREAD_H
+    {
+	pthread_t	threads[4];
+
+	for (i = 0; i < 4; i++)
+	    CU_ASSERT_EQUAL_FATAL(
+		pthread_create(threads + i, NULL, parseRepeatedly, xmlSystem),
+		0);
+
+	for (i = 0; i < 4; i++) {
+	    void*	failures;
+
+	    CU_ASSERT_EQUAL(pthread_join(threads[i], &failures), 0);
+	    CU_ASSERT_PTR_NULL(failures);
+	}
+    }
+#endif
+
+    ut_free_system(xmlSystem);
+    ut_set_error_message_handler(ut_write_to_stderr);
+}
+
+
+static void
+test_binaryDatabase(void)
+{
+    static const char* const	specs[] = {"kilometer", "KILOMETER", "km",
+	"Kilometers", "degree_Celsius", "\xc2\xb0" "C", "\xc2\xb5s",
+	"microsecond", "megaparsec", "hPa", "kg.m2.s-2", "K @ 273.15",
+	"s since 2000-01-01", "lg(re mW)", "dam", "dekameter", "Mm^2", "rad",
+	"percent", "degF", "1"};
+    enum {NSPECS = sizeof(specs)/sizeof(specs[0])};
+    static const int		formats[] = {UT_UTF8, UT_ASCII | UT_NAMES,
+	UT_LATIN1 | UT_NAMES, UT_UTF8 | UT_DEFINITION};
+    enum {NFORMATS = sizeof(formats)/sizeof(formats[0])};
+    static const char		path[] = "testUnits.bdb";
+    char			expected[NSPECS][NFORMATS][128];
+    ut_system*			xmlSystem;
+    ut_system*			binSystem;
+    ut_unit*			unit;
+    ut_unit*			kelvin;
+    cv_converter*		converter;
+    FILE*			file;
+    int				i;
+
+    ut_set_error_message_handler(ut_ignore);
+
+    xmlSystem = ut_read_xml(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(xmlSystem);
+
+    for (i = 0; i < NSPECS; i++) {
+	int	j;
+
+	unit = ut_parse(xmlSystem, specs[i], UT_UTF8);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+
+	for (j = 0; j < NFORMATS; j++)
+	    CU_ASSERT_TRUE(ut_format(unit, expected[i][j],
+		sizeof(expected[i][j]), formats[j]) > 0);
+
+	ut_free(unit);
+    }
+
+    CU_ASSERT_EQUAL(ut_write_binary(NULL, path), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_write_binary(xmlSystem, NULL), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_write_binary(xmlSystem, "/nonexistent/dir/x.bdb"),
+	UT_OPEN_ARG);
+    CU_ASSERT_EQUAL(ut_write_binary(xmlSystem, path), UT_SUCCESS);
+
+    /* Writing doesn't freeze the unit-system */
+    CU_ASSERT_FALSE(ut_is_frozen(xmlSystem));
+    unit = ut_get_unit_by_name(xmlSystem, "meter");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+    CU_ASSERT_EQUAL(ut_map_name_to_unit("binary_meter", UT_ASCII, unit),
+	UT_SUCCESS);
+    ut_free(unit);
+    ut_free_system(xmlSystem);
+
+    CU_ASSERT_PTR_NULL(ut_read_binary(NULL));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_BAD_ARG);
+    CU_ASSERT_PTR_NULL(ut_read_binary("/nonexistent/dir/x.bdb"));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_OPEN_ARG);
+    CU_ASSERT_PTR_NULL(ut_read_binary(xmlPath));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_PARSE);
+
+    binSystem = ut_read_binary(path);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(binSystem);
+    CU_ASSERT_FALSE(ut_is_frozen(binSystem));
+
+    for (i = 0; i < NSPECS; i++) {
+	int	j;
+
+	unit = ut_parse(binSystem, specs[i], UT_UTF8);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+
+	for (j = 0; j < NFORMATS; j++) {
+	    char	buf[128];
+
+	    CU_ASSERT_TRUE(ut_format(unit, buf, sizeof(buf), formats[j]) > 0);
+	    CU_ASSERT_STRING_EQUAL(buf, expected[i][j]);
+	}
+
+	ut_free(unit);
+    }
+
+    unit = ut_parse(binSystem, "degF", UT_ASCII);
+    kelvin = ut_get_unit_by_symbol(binSystem, "K");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(kelvin);
+    converter = ut_get_converter(unit, kelvin);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(converter);
+    CU_ASSERT_DOUBLE_EQUAL(cv_convert_double(converter, 32), 273.15, 1e-9);
+    cv_free(converter);
+    ut_free(kelvin);
+    ut_free(unit);
+
+    unit = ut_get_unit_by_name(binSystem, "Second");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+    CU_ASSERT_STRING_EQUAL(ut_get_symbol(unit, UT_ASCII), "s");
+    ut_free(unit);
+
+    /* The loaded unit-system is mutable */
+    unit = ut_get_unit_by_name(binSystem, "meter");
+    CU_ASSERT_EQUAL(ut_map_name_to_unit("gronk", UT_ASCII, unit), UT_SUCCESS);
+    ut_free(unit);
+    unit = ut_parse(binSystem, "kilogronk", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL(unit);
+    ut_free(unit);
+    ut_free_system(binSystem);
+
+    /* A corrupt file is rejected */
+    file = fopen(path, "r+b");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    CU_ASSERT_EQUAL(fseek(file, 100, SEEK_SET), 0);
+    CU_ASSERT_EQUAL(fputc(0x55, file), 0x55);
+    CU_ASSERT_EQUAL(fclose(file), 0);
+    CU_ASSERT_PTR_NULL(ut_read_binary(path));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_PARSE);
+
+    (void)remove(path);
+    ut_set_error_message_handler(ut_write_to_stderr);
+}
+
+
+static void
+test_binaryTimestamps(void)
+{
+    static const char* const	origins[] = {"1900-01-01", "1970-01-01",
+	"2000-01-01", "1950-06-15", "2020-12-31", "1800-03-01", "1990-01-01",
+	"1960-01-01"};
+    enum {NORIGINS = sizeof(origins)/sizeof(origins[0])};
+    static const char		path[] = "testUnits-timestamps.bdb";
+    char			specs[NORIGINS][80];
+    char			names[NORIGINS][32];
+    ut_system*			xmlSystem;
+    ut_system*			binSystem;
+    int				i;
+
+    xmlSystem = ut_read_xml(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(xmlSystem);
+
+    for (i = 0; i < NORIGINS; i++) {
+	ut_unit*	unit;
+
+	(void)snprintf(specs[i], sizeof(specs[i]), "hours since %s",
+	    origins[i]);
+	(void)snprintf(names[i], sizeof(names[i]), "epoch_%d", i);
+	unit = ut_parse(xmlSystem, specs[i], UT_ASCII);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+	CU_ASSERT_EQUAL(ut_map_name_to_unit(names[i], UT_ASCII, unit),
+	    UT_SUCCESS);
+	ut_free(unit);
+    }
+
+    CU_ASSERT_EQUAL_FATAL(ut_write_binary(xmlSystem, path), UT_SUCCESS);
+    ut_free_system(xmlSystem);
+
+    binSystem = ut_read_binary(path);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(binSystem);
+
+    /* Each name still maps to its own timestamp-unit */
+    for (i = 0; i < NORIGINS; i++) {
+	ut_unit* const	unit = ut_get_unit_by_name(binSystem, names[i]);
+	ut_unit* const	expected = ut_parse(binSystem, specs[i], UT_ASCII);
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(expected);
+	CU_ASSERT_EQUAL(ut_compare(unit, expected), 0);
+	ut_free(expected);
+	ut_free(unit);
+    }
+
+    ut_free_system(binSystem);
+    (void)remove(path);
+}
+
+
+static void
+test_mappedDatabase(void)
+{
+    static const char* const	specs[] = {"kilometer", "KILOMETER", "km",
+	"degree_Celsius", "\xc2\xb0" "C", "\xc2\xb5s", "hPa", "kg.m2.s-2",
+	"K @ 273.15", "s since 2000-01-01", "lg(re mW)", "Mm^2", "degF", "1"};
+    enum {NSPECS = sizeof(specs)/sizeof(specs[0])};
+    static const int		formats[] = {UT_UTF8, UT_ASCII | UT_NAMES,
+	UT_LATIN1 | UT_NAMES, UT_UTF8 | UT_DEFINITION};
+    enum {NFORMATS = sizeof(formats)/sizeof(formats[0])};
+    static const char		path[] = "testUnits.bdb";
+    static const char		copyPath[] = "testUnits-copy.bdb";
+    char			expected[NSPECS][NFORMATS][128];
+    ut_system*			xmlSystem;
+    ut_system*			mappedSystem;
+    ut_system*			copySystem;
+    ut_unit*			unit;
+    ut_unit*			meter;
+    FILE*			file;
+    FILE*			copy;
+    int				c;
+    int				i;
+
+    ut_set_error_message_handler(ut_ignore);
+
+    xmlSystem = ut_read_xml(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(xmlSystem);
+
+    for (i = 0; i < NSPECS; i++) {
+	int	j;
+
+	unit = ut_parse(xmlSystem, specs[i], UT_UTF8);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+
+	for (j = 0; j < NFORMATS; j++)
+	    CU_ASSERT_TRUE(ut_format(unit, expected[i][j],
+		sizeof(expected[i][j]), formats[j]) > 0);
+
+	ut_free(unit);
+    }
+
+    CU_ASSERT_EQUAL_FATAL(ut_write_binary(xmlSystem, path), UT_SUCCESS);
+    ut_free_system(xmlSystem);
+
+    CU_ASSERT_PTR_NULL(ut_mmap_binary(NULL));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_BAD_ARG);
+    CU_ASSERT_PTR_NULL(ut_mmap_binary("/nonexistent/dir/x.bdb"));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_OPEN_ARG);
+    CU_ASSERT_PTR_NULL(ut_mmap_binary(xmlPath));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_PARSE);
+
+    mappedSystem = ut_mmap_binary(path);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(mappedSystem);
+    CU_ASSERT_TRUE(ut_is_frozen(mappedSystem));
+
+    for (i = 0; i < NSPECS; i++) {
+	int	j;
+
+	unit = ut_parse(mappedSystem, specs[i], UT_UTF8);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+
+	for (j = 0; j < NFORMATS; j++) {
+	    char	buf[128];
+
+	    CU_ASSERT_TRUE(ut_format(unit, buf, sizeof(buf), formats[j]) > 0);
+	    CU_ASSERT_STRING_EQUAL(buf, expected[i][j]);
+	}
+
+	ut_free(unit);
+    }
+
+    /* Lookups in the mapped tables */
+    meter = ut_get_unit_by_name(mappedSystem, "METERS");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(meter);
+    CU_ASSERT_STRING_EQUAL(ut_get_name(meter, UT_ASCII), "meter");
+    CU_ASSERT_STRING_EQUAL(ut_get_symbol(meter, UT_UTF8), "m");
+    CU_ASSERT_PTR_NULL(ut_get_unit_by_symbol(mappedSystem, "M"));
+    CU_ASSERT_PTR_NULL(ut_get_unit_by_name(mappedSystem, "gronk"));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+    unit = ut_parse(mappedSystem, "\xb5m", UT_LATIN1);
+    CU_ASSERT_PTR_NOT_NULL(unit);
+    ut_free(unit);
+    unit = ut_get_unit_by_symbol(mappedSystem, "\xc2\xb0" "C");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+    CU_ASSERT_STRING_EQUAL(ut_get_symbol(unit, UT_UTF8), "\xc2\xb0" "C");
+    CU_ASSERT_STRING_EQUAL(ut_get_symbol(unit, UT_LATIN1), "\xb0" "C");
+    ut_free(unit);
+    CU_ASSERT_PTR_NULL(ut_parse(mappedSystem, "kilogronk", UT_ASCII));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_UNKNOWN);
+
+    /* The mapped unit-system is immutable */
+    CU_ASSERT_EQUAL(ut_map_name_to_unit("gronk", UT_ASCII, meter), UT_FROZEN);
+    CU_ASSERT_EQUAL(ut_add_name_prefix(mappedSystem, "gronko", 2), UT_FROZEN);
+    ut_free(meter);
+
+    /* Writing a mapped unit-system copies the database */
+    CU_ASSERT_EQUAL(ut_write_binary(mappedSystem, copyPath), UT_SUCCESS);
+    file = fopen(path, "rb");
+    copy = fopen(copyPath, "rb");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(copy);
+    do {
+	c = getc(file);
+    } while (getc(copy) == c && c != EOF);
+    CU_ASSERT_EQUAL(c, EOF);
+    CU_ASSERT_TRUE(feof(copy));
+    (void)fclose(file);
+    (void)fclose(copy);
+
+    copySystem = ut_mmap_binary(copyPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(copySystem);
+    unit = ut_parse(copySystem, "hPa", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL(unit);
+    ut_free(unit);
+    ut_free_system(copySystem);
+    (void)remove(copyPath);
+
+#ifdef HAVE_PTHREAD_H
+    {
+	pthread_t	threads[4];
+
+	for (i = 0; i < 4; i++)
+	    CU_ASSERT_EQUAL_FATAL(
+		pthread_create(threads + i, NULL, parseRepeatedly,
+		    mappedSystem),
+		0);
+
+	for (i = 0; i < 4; i++) {
+	    void*	failures;
+
+	    CU_ASSERT_EQUAL(pthread_join(threads[i], &failures), 0);
+	    CU_ASSERT_PTR_NULL(failures);
+	}
+    }
+#endif
+
+    ut_free_system(mappedSystem);
+
+    /* A corrupt file is rejected */
+    file = fopen(path, "r+b");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(file);
+    CU_ASSERT_EQUAL(fseek(file, 300, SEEK_SET), 0);
+    CU_ASSERT_EQUAL(fputc(0x55, file), 0x55);
+    CU_ASSERT_EQUAL(fclose(file), 0);
+    CU_ASSERT_PTR_NULL(ut_mmap_binary(path));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_PARSE);
+
+    (void)remove(path);
+    ut_set_error_message_handler(ut_write_to_stderr);
+}
+
+
+static void
+test_arena(void)
+{
+    ut_system*	system;
+    ut_unit*	meter;
+    ut_unit*	second;
+    ut_unit*	kelvin;
+    ut_unit*	area;
+    ut_unit*	speed;
+    ut_unit*	celsius;
+    ut_unit*	timestamp;
+    ut_unit*	unit;
+    ut_unit*	result;
+    ut_unit*	expected;
+    cv_converter* converter;
+    char	before[128];
+    char	after[128];
+    int		i;
+
+    ut_set_error_message_handler(ut_ignore);
+
+    system = ut_read_xml(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(system);
+
+    CU_ASSERT_PTR_NULL(ut_arena_end(NULL));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_BAD_ARG);
+
+    ut_arena_begin();
+
+    meter = ut_get_unit_by_name(system, "meter");
+    second = ut_get_unit_by_name(system, "second");
+    kelvin = ut_get_unit_by_name(system, "kelvin");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(meter);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(second);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(kelvin);
+    area = ut_raise(meter, 2);
+    speed = ut_divide(meter, second);
+    celsius = ut_offset(kelvin, 273.15);
+    timestamp = ut_offset_by_time(second,
+	ut_encode_time(2000, 1, 1, 0, 0, 0));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(area);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(speed);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(celsius);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(timestamp);
+
+    /* Converters of units in the arena are released with the arena */
+    converter = ut_get_converter(celsius, kelvin);
+    CU_ASSERT_PTR_NOT_NULL(converter);
+    CU_ASSERT_DOUBLE_EQUAL(cv_convert_double(converter, 0), 273.15, 1e-9);
+    cv_free(converter);
+    converter = ut_get_converter(timestamp, second);
+    cv_free(converter);
+
+    /* Enough intermediate units to extend the arena */
+    for (i = 0; i < 1000; i++) {
+	unit = ut_multiply(area, speed);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+	ut_free(unit);
+    }
+
+    /* Nested arenas are merged */
+    ut_arena_begin();
+    unit = ut_scale(1000, meter);
+    CU_ASSERT_PTR_EQUAL(ut_arena_end(unit), unit);
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+    ut_free(unit);
+
+    /* Units that the library stores are on the heap */
+    CU_ASSERT_EQUAL(ut_map_name_to_unit("arena_area", UT_ASCII, area),
+	UT_SUCCESS);
+    unit = ut_parse(system, "km/h", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL(unit);
+    ut_free(unit);
+
+    /* The dimensionless unit one isn't in the arena */
+    unit = ut_get_dimensionless_unit_one(system);
+    CU_ASSERT_PTR_EQUAL(ut_arena_end(unit), unit);
+    ut_arena_begin();
+
+    result = ut_multiply(area, speed);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(result);
+    CU_ASSERT_TRUE(ut_format(result, before, sizeof(before), UT_ASCII) > 0);
+
+    unit = ut_arena_end(result);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+    CU_ASSERT_PTR_NOT_EQUAL(unit, result);
+    CU_ASSERT_TRUE(ut_format(unit, after, sizeof(after), UT_ASCII) > 0);
+    CU_ASSERT_STRING_EQUAL(after, before);
+    expected = ut_parse(system, "m3/s", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(expected);
+    CU_ASSERT_EQUAL(ut_compare(unit, expected), 0);
+    ut_free(expected);
+    ut_free(unit);
+
+    CU_ASSERT_PTR_NULL(ut_arena_end(NULL));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_BAD_ARG);
+
+    unit = ut_get_unit_by_name(system, "arena_area");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+    expected = ut_parse(system, "m2", UT_ASCII);
+    CU_ASSERT_EQUAL(ut_compare(unit, expected), 0);
+    ut_free(expected);
+    ut_free(unit);
+    unit = ut_parse(system, "km/h", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL(unit);
+    ut_free(unit);
+
+    ut_free_system(system);
+    ut_set_error_message_handler(ut_write_to_stderr);
+}
+
+
+static void
+test_productStorage(void)
+{
+    enum {NBASE = 12};	/* more than are stored inline */
+    ut_system*	system = ut_new_system();
+    ut_unit*	base[NBASE];
+    ut_unit*	product;
+    ut_unit*	squared;
+    ut_unit*	unit;
+    char	buf[256];
+    int		i;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(system);
+
+    for (i = 0; i < NBASE; i++) {
+	char	symbol[8];
+
+	base[i] = ut_new_base_unit(system);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(base[i]);
+	(void)snprintf(symbol, sizeof(symbol), "u%d", i);
+	CU_ASSERT_EQUAL(ut_map_unit_to_symbol(base[i], symbol, UT_ASCII),
+	    UT_SUCCESS);
+    }
+
+    product = ut_clone(base[0]);
+    for (i = 1; i < NBASE; i++) {
+	unit = ut_multiply(product, base[i]);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+	ut_free(product);
+	product = unit;
+    }
+
+    CU_ASSERT_TRUE(ut_format(product, buf, sizeof(buf), UT_ASCII) > 0);
+    CU_ASSERT_STRING_EQUAL(buf, "u0.u1.u2.u3.u4.u5.u6.u7.u8.u9.u10.u11");
+
+    squared = ut_raise(product, 2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(squared);
+    unit = ut_root(squared, 2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+    CU_ASSERT_EQUAL(ut_compare(unit, product), 0);
+    ut_free(unit);
+    unit = ut_divide(squared, product);
+    CU_ASSERT_EQUAL(ut_compare(unit, product), 0);
+    ut_free(unit);
+    unit = ut_divide(product, product);
+    CU_ASSERT_TRUE(ut_is_dimensionless(unit));
+    ut_free(unit);
+    unit = ut_clone(squared);
+    CU_ASSERT_EQUAL(ut_compare(unit, squared), 0);
+    CU_ASSERT_NOT_EQUAL(ut_compare(unit, product), 0);
+    ut_free(unit);
+
+    /* A basic-unit equals its product-unit */
+    unit = ut_multiply(base[NBASE-1], ut_get_dimensionless_unit_one(system));
+    CU_ASSERT_EQUAL(ut_compare(unit, base[NBASE-1]), 0);
+    CU_ASSERT_TRUE(ut_format(unit, buf, sizeof(buf), UT_ASCII) > 0);
+    CU_ASSERT_STRING_EQUAL(buf, "u11");
+    ut_free(unit);
+
+    ut_free(squared);
+    ut_free(product);
+    for (i = 0; i < NBASE; i++)
+	ut_free(base[i]);
+    ut_free_system(system);
+}
+
+
+static void
+test_dimensionSignature(void)
+{
+    enum {NBASE = 10};	/* more than can be packed */
+    ut_system*	system = ut_new_system();
+    ut_unit*	base[NBASE];
+    ut_unit*	radian;
+    ut_unit*	unit1;
+    ut_unit*	unit2;
+    ut_unit*	tmp;
+    int		i;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(system);
+
+    for (i = 0; i < NBASE; i++) {
+	base[i] = ut_new_base_unit(system);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(base[i]);
+    }
+    radian = ut_new_dimensionless_unit(system);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(radian);
+
+    for (i = 0; i < NBASE; i++) {
+	/* Dimensionless basic-units are ignored */
+	unit1 = ut_multiply(base[i], radian);
+	CU_ASSERT_TRUE(ut_are_convertible(unit1, base[i]));
+	CU_ASSERT_TRUE(ut_are_convertible(base[i], unit1));
+
+	/* Reciprocals are convertible */
+	unit2 = ut_invert(unit1);
+	CU_ASSERT_TRUE(ut_are_convertible(unit2, base[i]));
+	ut_free(unit2);
+
+	unit2 = ut_raise(base[i], 2);
+	CU_ASSERT_FALSE(ut_are_convertible(unit2, base[i]));
+	CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+	ut_free(unit2);
+
+	unit2 = ut_multiply(base[i], base[(i+1) % NBASE]);
+	CU_ASSERT_FALSE(ut_are_convertible(unit2, unit1));
+	ut_free(unit2);
+	ut_free(unit1);
+    }
+
+    CU_ASSERT_TRUE(ut_are_convertible(radian,
+	ut_get_dimensionless_unit_one(system)));
+    CU_ASSERT_FALSE(ut_are_convertible(radian, base[0]));
+
+    /* Powers that don't fit in a byte */
+    unit1 = ut_raise(base[1], 200);
+    unit2 = ut_raise(base[1], -200);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unit1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unit2);
+    CU_ASSERT_TRUE(ut_are_convertible(unit1, unit2));
+    tmp = ut_multiply(unit1, base[1]);
+    CU_ASSERT_FALSE(ut_are_convertible(tmp, unit1));
+    CU_ASSERT_FALSE(ut_are_convertible(tmp, base[1]));
+    ut_free(tmp);
+    ut_free(unit2);
+
+    /* Mixed packed and hashed dimensions */
+    unit2 = ut_multiply(base[9], base[0]);
+    tmp = ut_divide(radian, unit2);
+    CU_ASSERT_TRUE(ut_are_convertible(tmp, unit2));
+    CU_ASSERT_FALSE(ut_are_convertible(tmp, base[0]));
+    CU_ASSERT_FALSE(ut_are_convertible(unit1, unit2));
+    ut_free(tmp);
+    ut_free(unit2);
+    ut_free(unit1);
+
+    for (i = 0; i < NBASE; i++)
+	ut_free(base[i]);
+    ut_free(radian);
+    ut_free_system(system);
+}
+
+
+static void
+test_parseMany(void)
+{
+    static const char* const	strings[] = {"km", "kg.m2.s-2", "km", NULL,
+	"gronk", "s since 2000-01-01", "m/", "kg.m2.s-2", "degC", "gronk"};
+    enum {NSTRINGS = sizeof(strings)/sizeof(strings[0]), NMANY = 1000};
+    static const ut_status	expected[NSTRINGS] = {UT_SUCCESS, UT_SUCCESS,
+	UT_SUCCESS, UT_BAD_ARG, UT_UNKNOWN, UT_SUCCESS, UT_SYNTAX,
+	UT_SUCCESS, UT_SUCCESS, UT_UNKNOWN};
+    static const char* const	names[] = {"km/h", "Pa", "furlong", "erg/s",
+	"degree_Celsius", "mile/hour", "lbf"};
+    ut_system*			system;
+    ut_system*			lazySystem;
+    ut_unit**			lazyUnits;
+    ut_unit*			units[NSTRINGS];
+    ut_status			statuses[NSTRINGS];
+    char			(*buffers)[32];
+    const char**		many;
+    ut_unit**			manyUnits;
+    int				i;
+
+    ut_set_error_message_handler(ut_ignore);
+
+    system = ut_read_xml(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(system);
+
+    CU_ASSERT_EQUAL(ut_parse_many(NULL, strings, NSTRINGS, UT_ASCII, units,
+	NULL), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_parse_many(system, NULL, NSTRINGS, UT_ASCII, units,
+	NULL), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_parse_many(system, NULL, 0, UT_ASCII, NULL, NULL),
+	UT_SUCCESS);
+
+    CU_ASSERT_EQUAL(ut_parse_many(system, strings, NSTRINGS, UT_ASCII, units,
+	statuses), UT_BAD_ARG);
+
+    for (i = 0; i < NSTRINGS; i++) {
+	CU_ASSERT_EQUAL(statuses[i], expected[i]);
+
+	if (expected[i] != UT_SUCCESS) {
+	    CU_ASSERT_PTR_NULL(units[i]);
+	}
+	else {
+	    ut_unit* const	unit = ut_parse(system, strings[i], UT_ASCII);
+
+	    CU_ASSERT_PTR_NOT_NULL_FATAL(units[i]);
+	    CU_ASSERT_EQUAL(ut_compare(units[i], unit), 0);
+	    ut_free(unit);
+	}
+    }
+
+    /* Duplicates are distinct copies */
+    CU_ASSERT_PTR_NOT_EQUAL(units[0], units[2]);
+    ut_free(units[0]);
+    CU_ASSERT_EQUAL(ut_compare(units[2], units[1]) != 0, 1);
+
+    for (i = 1; i < NSTRINGS; i++)
+	ut_free(units[i]);
+
+    CU_ASSERT_EQUAL(ut_parse_many(system, strings + 4, 1, UT_ASCII, units,
+	NULL), UT_UNKNOWN);
+    CU_ASSERT_EQUAL(ut_get_status(), UT_UNKNOWN);
+
+    /* Enough distinct strings to use the thread-pool */
+    buffers = malloc(NMANY * sizeof(*buffers));
+    many = malloc(NMANY * sizeof(*many));
+    manyUnits = malloc(NMANY * sizeof(*manyUnits));
+    lazyUnits = malloc(NMANY * sizeof(*lazyUnits));
+    CU_ASSERT_PTR_NOT_NULL_FATAL(buffers);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(many);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(manyUnits);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(lazyUnits);
+
+    for (i = 0; i < NMANY; i++) {
+	(void)snprintf(buffers[i], sizeof(buffers[i]), "%d %s", i % 700 + 1,
+	    names[i % 7]);
+	many[i] = buffers[i];
+    }
+
+    CU_ASSERT_EQUAL(cv_set_parallelism(4, 1000), 0);
+    CU_ASSERT_EQUAL(ut_parse_many(system, many, NMANY, UT_ASCII, manyUnits,
+	NULL), UT_SUCCESS);
+
+    /* A unit-system that's still being loaded is parsed serially */
+    lazySystem = ut_read_xml_lazy(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(lazySystem);
+    CU_ASSERT_EQUAL(ut_parse_many(lazySystem, many, NMANY, UT_ASCII,
+	lazyUnits, NULL), UT_SUCCESS);
+    CU_ASSERT_EQUAL(cv_set_parallelism(0, 65536), 0);
+
+    for (i = 0; i < NMANY; i++) {
+	ut_unit* const	unit = ut_parse(system, many[i], UT_ASCII);
+	char		buf1[128];
+	char		buf2[128];
+
+	CU_ASSERT_PTR_NOT_NULL_FATAL(manyUnits[i]);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(lazyUnits[i]);
+	CU_ASSERT_EQUAL(ut_compare(manyUnits[i], unit), 0);
+	CU_ASSERT_TRUE(ut_format(manyUnits[i], buf1, sizeof(buf1),
+	    UT_ASCII | UT_DEFINITION) > 0);
+	CU_ASSERT_TRUE(ut_format(lazyUnits[i], buf2, sizeof(buf2),
+	    UT_ASCII | UT_DEFINITION) > 0);
+	CU_ASSERT_STRING_EQUAL(buf1, buf2);
+	ut_free(unit);
+	ut_free(lazyUnits[i]);
+	ut_free(manyUnits[i]);
+    }
+
+    ut_free_system(lazySystem);
+    free(lazyUnits);
+    free(manyUnits);
+    free(many);
+    free(buffers);
+    ut_free_system(system);
+    ut_set_error_message_handler(ut_write_to_stderr);
+}
+
+
+/*
+ * Returns the numeric factor of a unit relative to another or 0.
+ */
+static double
+prefixFactor(
+    ut_system* const	system,
+    const char* const	string,
+    ut_unit* const	base)
+{
+    double		factor = 0;
+    ut_unit* const	unit = ut_parse(system, string, UT_ASCII);
+
+    if (unit != NULL) {
+	cv_converter* const	converter = ut_get_converter(unit, base);
+
+	if (converter != NULL) {
+	    factor = cv_convert_double(converter, 1);
+	    cv_free(converter);
+	}
+
+	ut_free(unit);
+    }
+
+    return factor;
+}
+
+
+static void
+test_identifierParsing(void)
+{
+    /* Identifiers of units and strings that must be parsed */
+    static const char* const	strings[] = {"K", "Pa", "percent", "%", "'",
+	"degrees_north", "DEGREES_NORTH", "\xc2\xb0", "km", "m2", "K2", "kg.m",
+	"hPa", "degree_Celsius", "\xc3\xa5ngstr\xc3\xb6m"};
+    enum {NSTRINGS = sizeof(strings)/sizeof(strings[0])};
+    ut_system*			system;
+    ut_unit*			unit;
+    ut_unit*			expected;
+    ut_unit*			units[NSTRINGS];
+    ut_stats			stats;
+    char			buf[80];
+    int				i;
+
+    ut_set_error_message_handler(ut_ignore);
+
+    system = ut_read_xml(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(system);
+
+    for (i = 0; i < NSTRINGS; i++) {
+	/* The parentheses force the string to be parsed */
+	(void)snprintf(buf, sizeof(buf), "(%s)", strings[i]);
+	expected = ut_parse(system, buf, UT_UTF8);
+	unit = ut_parse(system, strings[i], UT_UTF8);
+
+	if (expected == NULL) {
+	    CU_ASSERT_PTR_NULL(unit);
+	}
+	else {
+	    CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+	    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+	    CU_ASSERT_EQUAL(ut_compare(unit, expected), 0);
+	}
+
+	ut_free(unit);
+	ut_free(expected);
+    }
+
+    /* Latin-1 strings that aren't ASCII are converted before the lookup */
+    expected = ut_parse(system, "\xc2\xb0", UT_UTF8);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(expected);
+    unit = ut_parse(system, "\xb0", UT_LATIN1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+    CU_ASSERT_EQUAL(ut_compare(unit, expected), 0);
+    ut_free(unit);
+    ut_free(expected);
+
+    /* Keywords and unknown identifiers are still errors */
+    CU_ASSERT_PTR_NULL(ut_parse(system, "per", UT_ASCII));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SYNTAX);
+    CU_ASSERT_PTR_NULL(ut_parse(system, "Since", UT_ASCII));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SYNTAX);
+    CU_ASSERT_PTR_NULL(ut_parse(system, "gronk", UT_ASCII));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_UNKNOWN);
+
+    /* ut_parse_many() resolves identifiers in the same way */
+    CU_ASSERT_EQUAL(ut_parse_many(system, strings, NSTRINGS, UT_UTF8, units,
+	NULL), UT_SUCCESS);
+
+    for (i = 0; i < NSTRINGS; i++) {
+	unit = ut_parse(system, strings[i], UT_UTF8);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(units[i]);
+	CU_ASSERT_EQUAL(ut_compare(units[i], unit), 0);
+	ut_free(unit);
+	ut_free(units[i]);
+    }
+
+    /* Identifiers aren't parsed */
+    ut_reset_stats();
+    unit = ut_parse(system, "Pa", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL(unit);
+    ut_free(unit);
+    CU_ASSERT_EQUAL(ut_get_stats(&stats), UT_SUCCESS);
+
+    if (stats.enabled) {
+	CU_ASSERT_EQUAL(stats.parseCalls, 1);
+	CU_ASSERT_EQUAL(stats.parseIdentifiers, 1);
+	CU_ASSERT_EQUAL(stats.parses, 0);
+    }
+
+    ut_free_system(system);
+    ut_set_error_message_handler(ut_write_to_stderr);
+}
+
+
+static void
+test_unitReferences(void)
+{
+    ut_system*		system;
+    const ut_unit*	ref;
+    const ut_unit*	celsiusRef;
+    const ut_unit*	kelvinRef;
+    ut_unit*		unit;
+    ut_unit*		kelvinUnit;
+    ut_unit*		celsius1;
+    ut_unit*		celsius2;
+    cv_converter*	converter;
+
+    ut_set_error_message_handler(ut_ignore);
+
+    system = ut_read_xml(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(system);
+
+    CU_ASSERT_PTR_NULL(ut_get_unit_by_name_ref(NULL, "meter"));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_BAD_ARG);
+    CU_ASSERT_PTR_NULL(ut_get_unit_by_name_ref(system, NULL));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_BAD_ARG);
+    CU_ASSERT_PTR_NULL(ut_get_unit_by_symbol_ref(system, NULL));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_BAD_ARG);
+    CU_ASSERT_PTR_NULL(ut_get_unit_by_name_ref(system, "gronk"));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+    CU_ASSERT_PTR_NULL(ut_get_unit_by_symbol_ref(system, "M"));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+
+    /* The unit of the unit-system is returned rather than a copy */
+    ref = ut_get_unit_by_name_ref(system, "METER");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(ref);
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+    CU_ASSERT_PTR_EQUAL(ut_get_unit_by_name_ref(system, "meter"), ref);
+    CU_ASSERT_PTR_EQUAL(ut_get_system(ref), system);
+    unit = ut_get_unit_by_name(system, "meter");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+    CU_ASSERT_PTR_NOT_EQUAL(unit, ref);
+    CU_ASSERT_EQUAL(ut_compare(unit, ref), 0);
+    ut_free(unit);
+
+    kelvinRef = ut_get_unit_by_symbol_ref(system, "K");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(kelvinRef);
+    CU_ASSERT_PTR_EQUAL(ut_get_unit_by_symbol_ref(system, "K"), kelvinRef);
+    celsiusRef = ut_get_unit_by_name_ref(system, "degC");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(celsiusRef);
+
+    /* Copies share the converters of the unit-system's unit */
+    kelvinUnit = ut_parse(system, "K", UT_ASCII);
+    celsius1 = ut_parse(system, "degC", UT_ASCII);
+    celsius2 = ut_clone(celsius1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(kelvinUnit);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(celsius1);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(celsius2);
+    CU_ASSERT_EQUAL(ut_compare(celsius1, celsiusRef), 0);
+    CU_ASSERT_EQUAL(ut_compare(kelvinUnit, kelvinRef), 0);
+    ut_free(celsius1);
+
+    converter = ut_get_converter(celsius2, kelvinUnit);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(converter);
+    CU_ASSERT_DOUBLE_EQUAL(cv_convert_double(converter, 0), 273.15, 1e-12);
+    cv_free(converter);
+
+    converter = ut_get_converter(kelvinUnit, celsius2);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(converter);
+    CU_ASSERT_DOUBLE_EQUAL(cv_convert_double(converter, 273.15), 0, 1e-12);
+    cv_free(converter);
+
+    /* Identifiers refer to the same units after freezing */
+    CU_ASSERT_EQUAL(ut_freeze_system(system), UT_SUCCESS);
+    CU_ASSERT_PTR_EQUAL(ut_get_unit_by_name_ref(system, "meter"), ref);
+    CU_ASSERT_PTR_EQUAL(ut_get_unit_by_symbol_ref(system, "K"), kelvinRef);
+    CU_ASSERT_PTR_EQUAL(ut_get_unit_by_name_ref(system, "degC"), celsiusRef);
+
+    converter = ut_get_converter(celsius2, kelvinUnit);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(converter);
+    CU_ASSERT_DOUBLE_EQUAL(cv_convert_double(converter, 100), 373.15, 1e-12);
+    cv_free(converter);
+
+    ut_free(celsius2);
+    ut_free(kelvinUnit);
+    ut_free_system(system);
+    ut_set_error_message_handler(ut_write_to_stderr);
+}
+
+
+static void
+test_prefixTrie(void)
+{
+    ut_system*	system = ut_new_system();
+    ut_unit*	meter;
+    int		frozen;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(system);
+    meter = ut_new_base_unit(system);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(meter);
+    CU_ASSERT_EQUAL(ut_map_name_to_unit("meter", UT_ASCII, meter), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_map_symbol_to_unit("m", UT_ASCII, meter), UT_SUCCESS);
+
+    CU_ASSERT_EQUAL(ut_add_name_prefix(system, "deci", 0.1), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_add_name_prefix(system, "deca", 10), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_add_name_prefix(system, "Mega", 1e6), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_add_name_prefix(system, "MEGA", 1e6), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_add_name_prefix(system, "mega", 2e6), UT_EXISTS);
+    CU_ASSERT_EQUAL(ut_add_symbol_prefix(system, "d", 0.1), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_add_symbol_prefix(system, "da", 10), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_add_symbol_prefix(system, "M", 1e6), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_add_symbol_prefix(system, "m", 1e-3), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_add_symbol_prefix(system, "d", 1), UT_EXISTS);
+
+    for (frozen = 0; frozen < 2; frozen++) {
+	CU_ASSERT_DOUBLE_EQUAL(prefixFactor(system, "decimeter", meter), 0.1,
+	    1e-12);
+	CU_ASSERT_DOUBLE_EQUAL(prefixFactor(system, "DecaMeter", meter), 10,
+	    1e-12);
+	CU_ASSERT_DOUBLE_EQUAL(prefixFactor(system, "megameter", meter), 1e6,
+	    1e-6);
+	CU_ASSERT_DOUBLE_EQUAL(prefixFactor(system, "Megadecimeter", meter),
+	    1e5, 1e-6);
+	CU_ASSERT_DOUBLE_EQUAL(prefixFactor(system, "dm", meter), 0.1, 1e-12);
+	CU_ASSERT_DOUBLE_EQUAL(prefixFactor(system, "dam", meter), 10, 1e-12);
+	CU_ASSERT_DOUBLE_EQUAL(prefixFactor(system, "Mm", meter), 1e6, 1e-6);
+	CU_ASSERT_DOUBLE_EQUAL(prefixFactor(system, "mm", meter), 1e-3,
+	    1e-15);
+	CU_ASSERT_DOUBLE_EQUAL(prefixFactor(system, "decim", meter), 0.1,
+	    1e-12);
+	/* Only one symbol-prefix is allowed */
+	CU_ASSERT_EQUAL(prefixFactor(system, "mMm", meter), 0);
+	CU_ASSERT_EQUAL(prefixFactor(system, "mM", meter), 0);
+	/* The longest match must be a complete prefix */
+	CU_ASSERT_EQUAL(prefixFactor(system, "decmeter", meter), 0);
+	CU_ASSERT_EQUAL(prefixFactor(system, "Dm", meter), 0);
+
+	CU_ASSERT_EQUAL(ut_freeze_system(system), UT_SUCCESS);
+    }
+
+    CU_ASSERT_EQUAL(ut_add_name_prefix(system, "kilo", 1e3), UT_FROZEN);
+    CU_ASSERT_EQUAL(prefixFactor(system, "kilometer", meter), 0);
+
+    ut_free(meter);
+    ut_free_system(system);
+}
+
+
+static void
+test_timeArrays(void)
+{
+    enum {COUNT = 2000};
+    static double	values[COUNT];
+    static int		years[COUNT];
+    static int		months[COUNT];
+    static int		days[COUNT];
+    static int		hours[COUNT];
+    static int		minutes[COUNT];
+    static double	seconds[COUNT];
+    static double	resolutions[COUNT];
+    static double	encoded[COUNT];
+    int			i;
+
+    /* From before the Julian day origin to well after the present */
+    for (i = 0; i < COUNT; i++)
+	values[i] = -2.2e11 + i*(2.5e11/COUNT) + i*0.37;
+    values[0] = 0;
+    values[1] = ut_encode_time(1582, 10, 15, 0, 0, 0) - 0.5;
+    values[2] = ut_encode_time(-1, 12, 31, 23, 59, 59.5);
+
+    CU_ASSERT_EQUAL(ut_decode_times(values, COUNT, years, months, days, hours,
+	minutes, seconds, resolutions), UT_SUCCESS);
+
+    for (i = 0; i < COUNT; i++) {
+	int	year, month, day, hour, minute;
+	double	second, resolution;
+
+	ut_decode_time(values[i], &year, &month, &day, &hour, &minute, &second,
+	    &resolution);
+	CU_ASSERT_EQUAL(years[i], year);
+	CU_ASSERT_EQUAL(months[i], month);
+	CU_ASSERT_EQUAL(days[i], day);
+	CU_ASSERT_EQUAL(hours[i], hour);
+	CU_ASSERT_EQUAL(minutes[i], minute);
+	CU_ASSERT_EQUAL(seconds[i], second);
+	CU_ASSERT_EQUAL(resolutions[i], resolution);
+    }
+
+    CU_ASSERT_EQUAL(ut_encode_times(years, months, days, hours, minutes,
+	seconds, COUNT, encoded), UT_SUCCESS);
+
+    for (i = 0; i < COUNT; i++)
+	CU_ASSERT_EQUAL(encoded[i], ut_encode_time(years[i], months[i], days[i],
+	    hours[i], minutes[i], seconds[i]));
+
+    /* Dates outside the range of the integer arithmetic */
+    values[0] = -1e12;
+    years[0] = -10000;
+    CU_ASSERT_EQUAL(ut_decode_times(values, 1, years + 1, months, days, hours,
+	minutes, seconds, NULL), UT_SUCCESS);
+    {
+	int	year, month, day, hour, minute;
+	double	second, resolution;
+
+	ut_decode_time(values[0], &year, &month, &day, &hour, &minute, &second,
+	    &resolution);
+	CU_ASSERT_EQUAL(years[1], year);
+	CU_ASSERT_EQUAL(months[0], month);
+	CU_ASSERT_EQUAL(days[0], day);
+    }
+    years[0] = -10000;
+    CU_ASSERT_EQUAL(ut_encode_times(years, months, days, hours, minutes,
+	seconds, 2, encoded), UT_SUCCESS);
+    CU_ASSERT_EQUAL(encoded[0], ut_encode_time(years[0], months[0], days[0],
+	hours[0], minutes[0], seconds[0]));
+
+    /* An invalid clock-time */
+    hours[0] = 24;
+    CU_ASSERT_EQUAL(ut_encode_times(years, months, days, hours, minutes,
+	seconds, 1, encoded), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(encoded[0], ut_encode_date(years[0], months[0], days[0]));
+
+    CU_ASSERT_EQUAL(ut_decode_times(NULL, 1, years, months, days, hours,
+	minutes, seconds, NULL), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_encode_times(years, months, days, hours, minutes,
+	NULL, 1, encoded), UT_BAD_ARG);
+    CU_ASSERT_EQUAL(ut_decode_times(NULL, 0, NULL, NULL, NULL, NULL, NULL,
+	NULL, NULL), UT_SUCCESS);
+}
+
+
+static void
+test_timestampConverter(void)
+{
+    ut_system*		xmlSystem = ut_read_xml(xmlPath);
+    ut_unit*		hours1900;
+    ut_unit*		days1970;
+    ut_unit*		days1970b;
+    ut_unit*		hour;
+    cv_converter*	converter;
+    int			i;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(xmlSystem);
+    hours1900 = ut_parse(xmlSystem, "hours since 1900-01-01", UT_ASCII);
+    days1970 = ut_parse(xmlSystem, "days since 1970-01-01", UT_ASCII);
+    days1970b = ut_parse(xmlSystem, "day since 1970-01-01 00:00", UT_ASCII);
+    hour = ut_get_unit_by_name(xmlSystem, "hour");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(hours1900);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(days1970);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(days1970b);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(hour);
+
+    /* The converters to and from seconds are cached by the units */
+    for (i = 0; i < 3; i++) {
+	converter = ut_get_converter(hours1900, days1970);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(converter);
+	CU_ASSERT_DOUBLE_EQUAL(cv_convert_double(converter, 0), -25567,
+	    1e-9);
+	CU_ASSERT_DOUBLE_EQUAL(cv_convert_double(converter, 25567*24 + 12),
+	    0.5, 1e-9);
+	cv_free(converter);
+
+	converter = ut_get_converter(days1970, hours1900);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(converter);
+	CU_ASSERT_DOUBLE_EQUAL(cv_convert_double(converter, 1), 25568*24,
+	    1e-6);
+	cv_free(converter);
+    }
+
+    /* Identical origins */
+    converter = ut_get_converter(days1970b, days1970);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(converter);
+    CU_ASSERT_EQUAL(cv_convert_double(converter, 123.25), 123.25);
+    cv_free(converter);
+
+    /* A timestamp-unit and a non-timestamp unit */
+    CU_ASSERT_PTR_NULL(ut_get_converter(hours1900, hour));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_MEANINGLESS);
+    CU_ASSERT_PTR_NULL(ut_get_converter(hour, days1970));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_MEANINGLESS);
+
+    ut_free(hour);
+    ut_free(days1970b);
+    ut_free(days1970);
+    ut_free(hours1900);
+    ut_free_system(xmlSystem);
+}
+
+static void
+test_formatCache(void)
+{
+    ut_system*	xmlSystem = ut_read_xml(xmlPath);
+    ut_unit*	squareMeter;
+    ut_unit*	unit;
+    char	buf[128];
+    int		i;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(xmlSystem);
+    squareMeter = ut_parse(xmlSystem, "m2", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(squareMeter);
+
+    /* Repeated formatting returns the cached string */
+    for (i = 0; i < 3; i++) {
+	CU_ASSERT_EQUAL(ut_format(squareMeter, buf, sizeof(buf), UT_ASCII), 2);
+	CU_ASSERT_STRING_EQUAL(buf, "m2");
+	CU_ASSERT_EQUAL(ut_format(squareMeter, buf, sizeof(buf),
+	    UT_ASCII | UT_NAMES), 7);
+	CU_ASSERT_STRING_EQUAL(buf, "meter^2");
+	CU_ASSERT_EQUAL(ut_format(squareMeter, buf, sizeof(buf), UT_UTF8), 3);
+	CU_ASSERT_STRING_EQUAL(buf, "m\xc2\xb2");
+    }
+
+    /* A hit truncates like a miss */
+    CU_ASSERT_EQUAL(ut_format(squareMeter, buf, 2, UT_ASCII | UT_NAMES), 7);
+    CU_ASSERT_STRING_EQUAL(buf, "m");
+    CU_ASSERT_EQUAL(ut_format(squareMeter, buf, 0, UT_ASCII), 2);
+
+    /* Mapping changes invalidate the cache */
+    CU_ASSERT_EQUAL(ut_map_unit_to_symbol(squareMeter, "msq", UT_ASCII),
+	UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_format(squareMeter, buf, sizeof(buf), UT_ASCII), 3);
+    CU_ASSERT_STRING_EQUAL(buf, "msq");
+    CU_ASSERT_EQUAL(ut_format(squareMeter, buf, sizeof(buf),
+	UT_ASCII | UT_DEFINITION), 2);
+    CU_ASSERT_STRING_EQUAL(buf, "m2");
+    CU_ASSERT_EQUAL(ut_unmap_unit_to_symbol(squareMeter, UT_ASCII), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_format(squareMeter, buf, sizeof(buf), UT_ASCII), 2);
+    CU_ASSERT_STRING_EQUAL(buf, "m2");
+
+    /* Numbers */
+    unit = ut_scale(0.5, squareMeter);
+    CU_ASSERT_EQUAL(ut_format(unit, buf, sizeof(buf), UT_ASCII), 6);
+    CU_ASSERT_STRING_EQUAL(buf, "0.5 m2");
+    ut_free(unit);
+    unit = ut_scale(-3, squareMeter);
+    CU_ASSERT_EQUAL(ut_format(unit, buf, sizeof(buf), UT_ASCII), 5);
+    CU_ASSERT_STRING_EQUAL(buf, "-3 m2");
+    ut_free(unit);
+    unit = ut_scale(1e20, squareMeter);
+    CU_ASSERT_EQUAL(ut_format(unit, buf, sizeof(buf), UT_ASCII), 8);
+    CU_ASSERT_STRING_EQUAL(buf, "1e+20 m2");
+    ut_free(unit);
+    unit = ut_offset(squareMeter, -40);
+    CU_ASSERT_EQUAL(ut_format(unit, buf, sizeof(buf), UT_ASCII | UT_NAMES),
+	16);
+    CU_ASSERT_STRING_EQUAL(buf, "meter^2 from -40");
+    ut_free(unit);
+    unit = ut_raise(squareMeter, -12);
+    CU_ASSERT_EQUAL(ut_format(unit, buf, sizeof(buf), UT_ASCII | UT_NAMES),
+	9);
+    CU_ASSERT_STRING_EQUAL(buf, "meter^-24");
+    ut_free(unit);
+
+    ut_free(squareMeter);
+    ut_free_system(xmlSystem);
+}
+
+
+static void
+test_lazyXml(void)
+{
+    static const char* const	specs[] = {"newton", "kN", "km/h", "degC",
+	"Bq", "furlongs/fortnight", "mW/cm2", "hours since 1970-01-01", "dB",
+	"lb(re 1 Pa)"};
+    ut_system*	eagerSystem = ut_read_xml(xmlPath);
+    ut_system*	lazySystem = ut_read_xml_lazy(xmlPath);
+    ut_unit*	newton;
+    ut_unit*	unit;
+    ut_unit*	unit2;
+    char	buf1[128];
+    char	buf2[128];
+    int		i;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(eagerSystem);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(lazySystem);
+
+    /* Units are materialized on first lookup */
+    newton = ut_get_unit_by_name(lazySystem, "newton");
+    CU_ASSERT_PTR_NOT_NULL_FATAL(newton);
+    unit = ut_parse(lazySystem, "kg.m.s-2", UT_ASCII);
+    CU_ASSERT_EQUAL(ut_compare(newton, unit), 0);
+    ut_free(unit);
+    CU_ASSERT_EQUAL(ut_format(newton, buf1, sizeof(buf1), UT_ASCII), 1);
+    CU_ASSERT_STRING_EQUAL(buf1, "N");
+    unit = ut_get_unit_by_name(lazySystem, "NEWTONS");
+    CU_ASSERT_EQUAL(ut_compare(newton, unit), 0);
+    ut_free(unit);
+    unit = ut_get_unit_by_symbol(lazySystem, "N");
+    CU_ASSERT_EQUAL(ut_compare(newton, unit), 0);
+    ut_free(unit);
+    CU_ASSERT_PTR_NULL(ut_get_unit_by_symbol(lazySystem, "n"));
+
+    /* Aliases */
+    unit = ut_get_unit_by_symbol(lazySystem, "Bq");
+    unit2 = ut_get_unit_by_symbol(lazySystem, "Hz");
+    CU_ASSERT_PTR_NOT_NULL(unit);
+    CU_ASSERT_EQUAL(ut_compare(unit, unit2), 0);
+    ut_free(unit2);
+    ut_free(unit);
+
+    /* The lazy system defines the same units as the eager one */
+    for (i = 0; i < sizeof(specs)/sizeof(specs[0]); i++) {
+	unit = ut_parse(eagerSystem, specs[i], UT_ASCII);
+	unit2 = ut_parse(lazySystem, specs[i], UT_ASCII);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit2);
+	CU_ASSERT_TRUE(ut_format(unit, buf1, sizeof(buf1),
+	    UT_ASCII | UT_DEFINITION) > 0);
+	CU_ASSERT_TRUE(ut_format(unit2, buf2, sizeof(buf2),
+	    UT_ASCII | UT_DEFINITION) > 0);
+	CU_ASSERT_STRING_EQUAL(buf1, buf2);
+	ut_free(unit2);
+	ut_free(unit);
+    }
+
+    /* Unmapping an identifier of a pending unit */
+    CU_ASSERT_EQUAL(ut_unmap_name_to_unit(lazySystem, "watt", UT_ASCII),
+	UT_SUCCESS);
+    CU_ASSERT_PTR_NULL(ut_get_unit_by_name(lazySystem, "watt"));
+    unit = ut_get_unit_by_symbol(lazySystem, "W");
+    CU_ASSERT_PTR_NOT_NULL(unit);
+    ut_free(unit);
+
+    /* Freezing materializes the remaining units */
+    CU_ASSERT_EQUAL(ut_freeze_system(lazySystem), UT_SUCCESS);
+    unit = ut_get_unit_by_name(lazySystem, "furlong");
+    CU_ASSERT_PTR_NOT_NULL(unit);
+    ut_free(unit);
+    unit = ut_get_unit_by_symbol(lazySystem, "Pa");
+    CU_ASSERT_PTR_NOT_NULL(unit);
+    CU_ASSERT_EQUAL(ut_format(unit, buf1, sizeof(buf1), UT_ASCII), 2);
+    ut_free(unit);
+
+    ut_free(newton);
+    ut_free_system(lazySystem);
+    ut_free_system(eagerSystem);
+}
+
+
+/*
+ * Error messages captured by captureMessage().
+ */
+static char	capturedMessages[4096];
+
+
+static int
+captureMessage(
+    const char* const	fmt,
+    va_list		args)
+{
+    const size_t	len = strlen(capturedMessages);
+
+    return vsnprintf(capturedMessages + len, sizeof(capturedMessages) - len,
+	fmt, args);
+}
+
+
+/*
+ * Returns the contents of a file.  The client should free() it.
+ */
+static char*
+readFile(
+    const char* const	path,
+    long* const		size)
+{
+    char*	buf = NULL;
+    FILE*	file = fopen(path, "rb");
+
+    if (file != NULL) {
+	if (fseek(file, 0, SEEK_END) == 0 && (*size = ftell(file)) >= 0 &&
+		fseek(file, 0, SEEK_SET) == 0) {
+	    buf = malloc(*size + 1);
+
+	    if (buf != NULL && fread(buf, 1, *size, file) != (size_t)*size) {
+		free(buf);
+		buf = NULL;
+	    }
+	}
+
+	(void)fclose(file);
+    }
+
+    return buf;
+}
+
+
+static void
+test_parallelXml(void)
+{
+    static const char* const	specs[] = {"newton", "kN", "km/h", "degC",
+	"Bq", "furlongs/fortnight", "mW/cm2", "hours since 1970-01-01", "dB",
+	"lb(re 1 Pa)", "\xc2\xb5s", "megaparsec", "dekameter"};
+    static const char		eagerPath[] = "testUnits-eager.bdb";
+    static const char		parallelPath[] = "testUnits-parallel.bdb";
+    ut_system*			eagerSystem;
+    ut_system*			parallelSystem;
+    ut_unit*			unit;
+    ut_unit*			unit2;
+    char			buf1[128];
+    char			buf2[128];
+    char			expected[sizeof(capturedMessages)];
+    char*			eagerBytes;
+    char*			parallelBytes;
+    long			eagerSize;
+    long			parallelSize;
+    glob_t			files;
+    int				status;
+    int				i;
+
+    ut_set_error_message_handler(ut_write_to_stderr);
+
+    /* Use several threads even on a single processor */
+    CU_ASSERT_EQUAL(cv_set_parallelism(4, 65536), 0);
+
+    eagerSystem = ut_read_xml(xmlPath);
+    parallelSystem = ut_read_xml_parallel(xmlPath);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(eagerSystem);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(parallelSystem);
+    CU_ASSERT_EQUAL(ut_get_status(), UT_SUCCESS);
+
+    for (i = 0; i < sizeof(specs)/sizeof(specs[0]); i++) {
+	unit = ut_parse(eagerSystem, specs[i], UT_UTF8);
+	unit2 = ut_parse(parallelSystem, specs[i], UT_UTF8);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit);
+	CU_ASSERT_PTR_NOT_NULL_FATAL(unit2);
+	CU_ASSERT_TRUE(ut_format(unit, buf1, sizeof(buf1),
+	    UT_ASCII | UT_DEFINITION) > 0);
+	CU_ASSERT_TRUE(ut_format(unit2, buf2, sizeof(buf2),
+	    UT_ASCII | UT_DEFINITION) > 0);
+	CU_ASSERT_STRING_EQUAL(buf1, buf2);
+	CU_ASSERT_TRUE(ut_format(unit, buf1, sizeof(buf1), UT_UTF8) > 0);
+	CU_ASSERT_TRUE(ut_format(unit2, buf2, sizeof(buf2), UT_UTF8) > 0);
+	CU_ASSERT_STRING_EQUAL(buf1, buf2);
+	ut_free(unit2);
+	ut_free(unit);
+    }
+
+    /* The unit-systems are identical */
+    CU_ASSERT_EQUAL(ut_write_binary(eagerSystem, eagerPath), UT_SUCCESS);
+    CU_ASSERT_EQUAL(ut_write_binary(parallelSystem, parallelPath), UT_SUCCESS);
+    eagerBytes = readFile(eagerPath, &eagerSize);
+    parallelBytes = readFile(parallelPath, &parallelSize);
+    CU_ASSERT_PTR_NOT_NULL(eagerBytes);
+    CU_ASSERT_PTR_NOT_NULL(parallelBytes);
+    if (eagerBytes != NULL && parallelBytes != NULL) {
+	CU_ASSERT_EQUAL(eagerSize, parallelSize);
+	CU_ASSERT_TRUE(eagerSize == parallelSize &&
+	    memcmp(eagerBytes, parallelBytes, eagerSize) == 0);
+    }
+    free(parallelBytes);
+    free(eagerBytes);
+    (void)unlink(parallelPath);
+    (void)unlink(eagerPath);
+
+    ut_free_system(parallelSystem);
+    ut_free_system(eagerSystem);
+
+    /* Failures are reported like ut_read_xml() reports them */
+    CU_ASSERT_PTR_NULL(ut_read_xml_parallel("xmlFailures/noExist.xml"));
+    CU_ASSERT_EQUAL(ut_get_status(), UT_OPEN_ARG);
+
+    status = glob("xmlFailures/*.xml", 0, NULL, &files);
+    CU_ASSERT_TRUE(status == 0 || status == GLOB_NOMATCH);
+
+    ut_set_error_message_handler(captureMessage);
+
+    for (i = 0; i < files.gl_pathc; i++) {
+	ut_status	expectedStatus;
+
+	capturedMessages[0] = 0;
+	CU_ASSERT_PTR_NULL(ut_read_xml(files.gl_pathv[i]));
+	expectedStatus = ut_get_status();
+	(void)strcpy(expected, capturedMessages);
+
+	capturedMessages[0] = 0;
+	CU_ASSERT_PTR_NULL(ut_read_xml_parallel(files.gl_pathv[i]));
+	CU_ASSERT_EQUAL(ut_get_status(), expectedStatus);
+	CU_ASSERT_STRING_EQUAL(capturedMessages, expected);
+    }
+
+    globfree(&files);
+
+    status = glob("xmlSuccesses/*.xml", 0, NULL, &files);
+    CU_ASSERT_TRUE(status == 0 || status == GLOB_NOMATCH);
+
+    for (i = 0; i < files.gl_pathc; i++) {
+	capturedMessages[0] = 0;
+	eagerSystem = ut_read_xml(files.gl_pathv[i]);
+	(void)strcpy(expected, capturedMessages);
+
+	capturedMessages[0] = 0;
+	parallelSystem = ut_read_xml_parallel(files.gl_pathv[i]);
+	CU_ASSERT_EQUAL(parallelSystem == NULL, eagerSystem == NULL);
+	CU_ASSERT_STRING_EQUAL(capturedMessages, expected);
+
+	ut_free_system(parallelSystem);
+	ut_free_system(eagerSystem);
+    }
+
+    globfree(&files);
+
+    CU_ASSERT_EQUAL(cv_set_parallelism(0, 65536), 0);
+    ut_set_error_message_handler(ut_ignore);
+}
+
+
+static void
+test_stats(void)
+{
+    ut_system*		xmlSystem = ut_read_xml(xmlPath);
+    ut_unit*		meter;
+    ut_unit*		kilometer;
+    cv_converter*	converter;
+    double		values[3] = {1, 2, 3};
+    ut_stats		stats;
+
+    CU_ASSERT_PTR_NOT_NULL_FATAL(xmlSystem);
+    CU_ASSERT_EQUAL(ut_get_stats(NULL), UT_BAD_ARG);
+
+    ut_reset_stats();
+    CU_ASSERT_EQUAL(ut_get_stats(&stats), UT_SUCCESS);
+    CU_ASSERT_EQUAL(stats.parseCalls, 0);
+    CU_ASSERT_EQUAL(stats.doubleValues, 0);
+
+    /* A cached converter is shared and must still be counted once */
+    CU_ASSERT_EQUAL(ut_set_converter_cache_capacity(xmlSystem, 8), UT_SUCCESS);
+    meter = ut_get_unit_by_name(xmlSystem, "meter");
+    kilometer = ut_parse(xmlSystem, "km", UT_ASCII);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(kilometer);
+    converter = ut_get_converter(meter, kilometer);
+    CU_ASSERT_PTR_NOT_NULL_FATAL(converter);
+    CU_ASSERT_PTR_NOT_NULL(cv_convert_doubles(converter, values, 3, values));
+    CU_ASSERT_DOUBLE_EQUAL(values[2], 0.003, 1e-15);
+
+    CU_ASSERT_EQUAL(ut_get_stats(&stats), UT_SUCCESS);
+
+    if (!stats.enabled) {
+	CU_ASSERT_EQUAL(stats.parseCalls, 0);
+	CU_ASSERT_EQUAL(stats.converterRequests, 0);
+	CU_ASSERT_EQUAL(stats.doubleValues, 0);
+    }
+    else {
+	CU_ASSERT_TRUE(stats.parseCalls >= 1);
+	CU_ASSERT_TRUE(stats.parses >= 1);
+	CU_ASSERT_TRUE(stats.nameLookups >= 1);
+	CU_ASSERT_TRUE(stats.converterRequests >= 1);
+	CU_ASSERT_EQUAL(stats.arrayCalls, 1);
+	CU_ASSERT_EQUAL(stats.doubleValues, 3);
+	CU_ASSERT_EQUAL(stats.floatValues, 0);
+
+	ut_reset_stats();
+	CU_ASSERT_EQUAL(ut_get_stats(&stats), UT_SUCCESS);
+	CU_ASSERT_TRUE(stats.enabled);
+	CU_ASSERT_EQUAL(stats.doubleValues, 0);
+	CU_ASSERT_EQUAL(stats.converterRequests, 0);
+    }
+
+    cv_free(converter);
+    ut_free(kilometer);
+    ut_free(meter);
+    ut_free_system(xmlSystem);
+}
+
+
 int
 main(
     const int           argc,
@@ -2339,6 +5014,7 @@ main(
 	    CU_ADD_TEST(testSuite, test_utMapUnitToName);
 	    CU_ADD_TEST(testSuite, test_utGetName);
 	    CU_ADD_TEST(testSuite, test_utGetSymbol);
+	    CU_ADD_TEST(testSuite, test_reverseLookup);
 	    CU_ADD_TEST(testSuite, test_utToString);
 	    CU_ADD_TEST(testSuite, test_utGetDimensionlessUnitOne);
 	    CU_ADD_TEST(testSuite, test_utGetSystem);
@@ -2353,6 +5029,35 @@ main(
 	    CU_ADD_TEST(testSuite, test_visitor);
 	    CU_ADD_TEST(testSuite, test_xml);
 	    CU_ADD_TEST(testSuite, test_timeResolution);
+	    CU_ADD_TEST(testSuite, test_parseCache);
+	    CU_ADD_TEST(testSuite, test_converterCache);
+	    CU_ADD_TEST(testSuite, test_converterCacheOrigins);
+	    CU_ADD_TEST(testSuite, test_programConverter);
+	    CU_ADD_TEST(testSuite, test_arrayKernels);
+	    CU_ADD_TEST(testSuite, test_simplifiedConverter);
+	    CU_ADD_TEST(testSuite, test_compiledConverter);
+	    CU_ADD_TEST(testSuite, test_parallelConversion);
+	    CU_ADD_TEST(testSuite, test_stridedConversion);
+	    CU_ADD_TEST(testSuite, test_conversionPlan);
+	    CU_ADD_TEST(testSuite, test_concurrency);
+	    CU_ADD_TEST(testSuite, test_threadErrorHandler);
+	    CU_ADD_TEST(testSuite, test_freezeSystem);
+	    CU_ADD_TEST(testSuite, test_binaryDatabase);
+	    CU_ADD_TEST(testSuite, test_binaryTimestamps);
+	    CU_ADD_TEST(testSuite, test_mappedDatabase);
+	    CU_ADD_TEST(testSuite, test_arena);
+	    CU_ADD_TEST(testSuite, test_productStorage);
+	    CU_ADD_TEST(testSuite, test_dimensionSignature);
+	    CU_ADD_TEST(testSuite, test_parseMany);
+	    CU_ADD_TEST(testSuite, test_identifierParsing);
+	    CU_ADD_TEST(testSuite, test_unitReferences);
+	    CU_ADD_TEST(testSuite, test_prefixTrie);
+	    CU_ADD_TEST(testSuite, test_timeArrays);
+	    CU_ADD_TEST(testSuite, test_timestampConverter);
+	    CU_ADD_TEST(testSuite, test_formatCache);
+	    CU_ADD_TEST(testSuite, test_lazyXml);
+	    CU_ADD_TEST(testSuite, test_parallelXml);
+	    CU_ADD_TEST(testSuite, test_stats);
 	    /*
 	    */
 
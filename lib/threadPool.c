@@ -0,0 +1,307 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Persistent pool of worker threads for data-parallel operations.
+ *
+ * A job comprises a number of independent tasks that are identified by their
+ * index.  The threads of the pool -- and the thread that submitted the job --
+ * repeatedly claim the next unclaimed index until none remain.  Only one job
+ * runs at a time: a thread that submits a job while another is running
+ * executes its tasks itself.  The worker threads are created on first use and
+ * persist until the number of threads is changed.
+ *
+ * If the library is built without POSIX threads, then all tasks are executed
+ * by the calling thread.
+ */
+
+/*LINTLIBRARY*/
+
+#include "config.h"
+
+#include "threadPool.h"
+#include "threadSupport.h"
+
+#include <stdlib.h>
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define TP_MAX_THREADS	64
+
+
+/*
+ * Executes all tasks serially.
+ */
+static void
+tpRunSerially(
+    const size_t	ntasks,
+    const tpTask	task,
+    void* const		arg)
+{
+    size_t	i;
+
+    for (i = 0; i < ntasks; i++)
+	task(arg, i);
+}
+
+
+#ifdef HAVE_PTHREAD_H
+
+static pthread_mutex_t	submitMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t	poolMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	workCond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	doneCond = PTHREAD_COND_INITIALIZER;
+static pthread_t	workers[TP_MAX_THREADS];
+static unsigned		workerCount = 0;	/* number of running workers */
+static unsigned		threadCount = 0;	/* 0 => processor count */
+static pthread_once_t	processorOnce = PTHREAD_ONCE_INIT;
+static unsigned		processorCount = 1;
+static int		stopping = 0;		/* workers should exit */
+static unsigned long	generation = 0;		/* incremented per job */
+static tpTask		jobTask = NULL;
+static void*		jobArg = NULL;
+static size_t		jobCount = 0;		/* number of tasks in job */
+static size_t		jobNext = 0;		/* next unclaimed task */
+static size_t		jobPending = 0;		/* number of unfinished tasks */
+
+
+/*
+ * Returns the number of online processors.
+ */
+static unsigned
+tpProcessorCount(void)
+{
+    long	n = -1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    return n < 1
+	? 1
+	: n > TP_MAX_THREADS
+	    ? TP_MAX_THREADS
+	    : (unsigned)n;
+}
+
+
+/*
+ * Initializes "processorCount".
+ */
+static void
+tpInitProcessorCount(void)
+{
+    processorCount = tpProcessorCount();
+}
+
+
+/*
+ * Returns the number of threads -- including the calling thread -- that
+ * tpRun() uses.  Doesn't lock "submitMutex", so it can be called while a job
+ * runs, including by one of its tasks.
+ */
+static unsigned
+tpThreadCount(void)
+{
+    unsigned	count = UT_ATOMIC_LOAD(&threadCount);
+
+    if (count == 0) {
+	(void)pthread_once(&processorOnce, tpInitProcessorCount);
+	count = processorCount;
+    }
+
+    return count;
+}
+
+
+/*
+ * Claims and executes tasks of the current job until none remain.  Must be
+ * called with "poolMutex" locked; returns with it locked.
+ */
+static void
+tpWork(void)
+{
+    while (jobNext < jobCount) {
+	const size_t	index = jobNext++;
+	const tpTask	task = jobTask;
+	void* const	arg = jobArg;
+
+	(void)pthread_mutex_unlock(&poolMutex);
+	task(arg, index);
+	(void)pthread_mutex_lock(&poolMutex);
+
+	if (--jobPending == 0)
+	    (void)pthread_cond_broadcast(&doneCond);
+    }
+}
+
+
+static void*
+tpWorker(
+    void*	arg)
+{
+    unsigned long	seen = 0;
+
+    (void)arg;
+    (void)pthread_mutex_lock(&poolMutex);
+
+    while (!stopping) {
+	if (generation == seen) {
+	    (void)pthread_cond_wait(&workCond, &poolMutex);
+	}
+	else {
+	    seen = generation;
+	    tpWork();
+	}
+    }
+
+    (void)pthread_mutex_unlock(&poolMutex);
+
+    return NULL;
+}
+
+
+/*
+ * Stops and joins all worker threads.  Must be called with "submitMutex"
+ * locked.
+ */
+static void
+tpStop(void)
+{
+    unsigned	i;
+
+    (void)pthread_mutex_lock(&poolMutex);
+    stopping = 1;
+    (void)pthread_cond_broadcast(&workCond);
+    (void)pthread_mutex_unlock(&poolMutex);
+
+    for (i = 0; i < workerCount; i++)
+	(void)pthread_join(workers[i], NULL);
+
+    workerCount = 0;
+    stopping = 0;
+}
+
+
+/*
+ * Ensures that the worker threads exist.  Must be called with "submitMutex"
+ * locked.  On failure, the pool has fewer workers than requested.
+ */
+static void
+tpStart(void)
+{
+    const unsigned	count = tpThreadCount();
+
+    while (workerCount + 1 < count) {
+	if (pthread_create(workers + workerCount, NULL, tpWorker, NULL) != 0)
+	    break;
+
+	workerCount++;
+    }
+}
+
+
+void
+tpRun(
+    const size_t	ntasks,
+    const tpTask	task,
+    void* const		arg)
+{
+    if (ntasks <= 1 || pthread_mutex_trylock(&submitMutex) != 0) {
+	tpRunSerially(ntasks, task, arg);
+    }
+    else {
+	tpStart();
+
+	if (workerCount == 0) {
+	    tpRunSerially(ntasks, task, arg);
+	}
+	else {
+	    (void)pthread_mutex_lock(&poolMutex);
+
+	    jobTask = task;
+	    jobArg = arg;
+	    jobCount = ntasks;
+	    jobNext = 0;
+	    jobPending = ntasks;
+	    generation++;
+	    (void)pthread_cond_broadcast(&workCond);
+
+	    tpWork();
+
+	    while (jobPending > 0)
+		(void)pthread_cond_wait(&doneCond, &poolMutex);
+
+	    jobTask = NULL;
+	    jobArg = NULL;
+	    jobCount = jobNext = 0;
+
+	    (void)pthread_mutex_unlock(&poolMutex);
+	}
+
+	(void)pthread_mutex_unlock(&submitMutex);
+    }
+}
+
+
+unsigned
+tpGetThreadCount(void)
+{
+    return tpThreadCount();
+}
+
+
+int
+tpSetThreadCount(
+    const unsigned	nthreads)
+{
+    int		status = -1;
+
+    if (pthread_mutex_trylock(&submitMutex) == 0) {
+	tpStop();
+
+	UT_ATOMIC_STORE(&threadCount,
+	    nthreads > TP_MAX_THREADS ? TP_MAX_THREADS : nthreads);
+	status = 0;
+
+	(void)pthread_mutex_unlock(&submitMutex);
+    }
+
+    return status;
+}
+
+#else	/* !HAVE_PTHREAD_H */
+
+void
+tpRun(
+    const size_t	ntasks,
+    const tpTask	task,
+    void* const		arg)
+{
+    tpRunSerially(ntasks, task, arg);
+}
+
+
+unsigned
+tpGetThreadCount(void)
+{
+    return 1;
+}
+
+
+int
+tpSetThreadCount(
+    const unsigned	nthreads)
+{
+    (void)nthreads;
+
+    return 0;
+}
+
+#endif	/* HAVE_PTHREAD_H */
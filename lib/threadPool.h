@@ -0,0 +1,84 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+#ifndef UT_THREAD_POOL_H_INCLUDED
+#define UT_THREAD_POOL_H_INCLUDED
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * A task to be executed by the thread-pool.
+ *
+ * Arguments:
+ *	arg		Client pointer passed to tpRun().
+ *	index		Origin-0 index of the task.
+ */
+typedef void (*tpTask)(void* arg, size_t index);
+
+
+/*
+ * Executes tasks on the persistent thread-pool of the library.  The calling
+ * thread participates.  The worker threads are created on first use.  If the
+ * pool is busy with tasks from another thread or the library was built
+ * without thread support, then the tasks are executed by the calling thread.
+ *
+ * Arguments:
+ *	ntasks		Number of tasks.
+ *	task		Function to execute for each task.
+ *	arg		Client pointer passed to "task".
+ * Returns upon completion of all tasks.
+ */
+void
+tpRun(
+    const size_t	ntasks,
+    const tpTask	task,
+    void* const		arg);
+
+
+/*
+ * Returns the number of threads -- including the calling thread -- that
+ * tpRun() uses.  Doesn't block, even while the pool is in use.
+ */
+unsigned
+tpGetThreadCount(void);
+
+
+/*
+ * Sets the number of threads -- including the calling thread -- that tpRun()
+ * uses.  Existing worker threads are stopped.
+ *
+ * Arguments:
+ *	nthreads	Number of threads.  If zero, then the number of online
+ *			processors is used.
+ * Returns:
+ *	0		Success.
+ *	-1		Failure.  The pool is in use.
+ */
+int
+tpSetThreadCount(
+    const unsigned	nthreads);
+
+
+/*
+ * Returns the number of values below which conversion is done serially by the
+ * calling thread.  Defined by the converter module.  See cv_set_parallelism().
+ */
+size_t
+cvGetParallelThreshold(void);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,96 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Portability macros for the thread-safety of the UDUNITS-2 library.
+ */
+#ifndef UT_THREAD_SUPPORT_H_INCLUDED
+#define UT_THREAD_SUPPORT_H_INCLUDED
+
+/*
+ * Storage-class specifier for variables that have one instance per thread.
+ */
+#if defined(_MSC_VER)
+#   define UT_THREAD_LOCAL	__declspec(thread)
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#   define UT_THREAD_LOCAL	_Thread_local
+#elif defined(__GNUC__)
+#   define UT_THREAD_LOCAL	__thread
+#else
+#   define UT_THREAD_LOCAL	/* the library isn't thread-safe */
+#endif
+
+/*
+ * Statically-initializable mutual-exclusion lock.
+ */
+#if defined(HAVE_PTHREAD_H)
+#   include <pthread.h>
+    typedef pthread_mutex_t	UtMutex;
+#   define UT_MUTEX_INITIALIZER	PTHREAD_MUTEX_INITIALIZER
+#   define UT_MUTEX_LOCK(mutex)	((void)pthread_mutex_lock(mutex))
+#   define UT_MUTEX_UNLOCK(mutex)	((void)pthread_mutex_unlock(mutex))
+#elif defined(_MSC_VER)
+#   include <windows.h>
+    typedef SRWLOCK		UtMutex;
+#   define UT_MUTEX_INITIALIZER	SRWLOCK_INIT
+#   define UT_MUTEX_LOCK(mutex)	AcquireSRWLockExclusive(mutex)
+#   define UT_MUTEX_UNLOCK(mutex)	ReleaseSRWLockExclusive(mutex)
+#else
+    typedef int			UtMutex;
+#   define UT_MUTEX_INITIALIZER	0
+#   define UT_MUTEX_LOCK(mutex)	((void)(mutex))
+#   define UT_MUTEX_UNLOCK(mutex)	((void)(mutex))
+#endif
+
+/*
+ * Atomic increment and decrement of a "long" reference-count.  Both evaluate
+ * to the new value.
+ */
+#if defined(__GNUC__)
+#   define UT_ATOMIC_INCREMENT(count) \
+	__atomic_add_fetch((count), 1, __ATOMIC_RELAXED)
+#   define UT_ATOMIC_DECREMENT(count) \
+	__atomic_sub_fetch((count), 1, __ATOMIC_ACQ_REL)
+#elif defined(_MSC_VER)
+#   define UT_ATOMIC_INCREMENT(count) \
+	InterlockedIncrement((volatile LONG*)(count))
+#   define UT_ATOMIC_DECREMENT(count) \
+	InterlockedDecrement((volatile LONG*)(count))
+#else
+#   define UT_ATOMIC_INCREMENT(count)	(++*(count))
+#   define UT_ATOMIC_DECREMENT(count)	(--*(count))
+#endif
+
+/*
+ * Atomic addition to an "unsigned long long" counter whose value isn't used to
+ * synchronize anything.  The value of the expression is unspecified except
+ * that adding zero evaluates to the current value of the counter.
+ */
+#if defined(__GNUC__)
+#   define UT_ATOMIC_ADD(count, n) \
+	__atomic_add_fetch((count), (n), __ATOMIC_RELAXED)
+#elif defined(_MSC_VER)
+#   define UT_ATOMIC_ADD(count, n) \
+	InterlockedExchangeAdd64((volatile LONG64*)(count), (LONG64)(n))
+#else
+#   define UT_ATOMIC_ADD(count, n)	(*(count) += (n))
+#endif
+
+/*
+ * Atomic load and store of a word-sized setting whose value isn't used to
+ * synchronize anything.  Aligned word-sized accesses are atomic under MSVC.
+ */
+#if defined(__GNUC__)
+#   define UT_ATOMIC_LOAD(var)		__atomic_load_n((var), __ATOMIC_RELAXED)
+#   define UT_ATOMIC_STORE(var, value) \
+	__atomic_store_n((var), (value), __ATOMIC_RELAXED)
+#else
+#   define UT_ATOMIC_LOAD(var)		(*(var))
+#   define UT_ATOMIC_STORE(var, value)	((void)(*(var) = (value)))
+#endif
+
+#endif
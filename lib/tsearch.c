@@ -111,3 +111,30 @@ tdelete(const void *vkey, void **vrootp,
     *rootp = q;				/* link parent to new node */
     return(p);
 }
+
+
+/* walk the nodes of a tree */
+static void
+trecurse(const node *root, void (*action)(const void *, VISIT, int),
+    int level)
+{
+    if (root->left == (struct node_t *)0 && root->right == (struct node_t *)0)
+	(*action)(root, leaf, level);
+    else {
+	(*action)(root, preorder, level);
+	if (root->left != (struct node_t *)0)
+	    trecurse(root->left, action, level + 1);
+	(*action)(root, postorder, level);
+	if (root->right != (struct node_t *)0)
+	    trecurse(root->right, action, level + 1);
+	(*action)(root, endorder, level);
+    }
+}
+
+/* walk the nodes of a tree in order */
+void
+twalk(const void *vroot, void (*action)(const void *, VISIT, int))
+{
+    if (vroot != (node *)0 && action != 0)
+	trecurse((const node *)vroot, action, 0);
+}
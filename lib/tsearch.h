@@ -10,5 +10,10 @@ void * tfind(const void *vkey, void **vrootp,
 void * tdelete(const void *vkey, void **vrootp,
     int (*compar)(const void *, const void *));
 
+typedef enum { preorder, postorder, endorder, leaf } VISIT;
+
+void twalk(const void *vroot,
+    void (*action)(const void *, VISIT, int));
+
 
 #endif
\ No newline at end of file
@@ -19,12 +19,35 @@
 
 #include "udunits.h"
 
+/*
+ * Number of values converted by utCalendars() at a time.
+ */
+#define CALENDAR_BLOCK_SIZE	256
+
+/*
+ * A unit that was created by this package.  The converters that involve the
+ * unit are cached here so that they're created once rather than on every
+ * call.
+ */
+typedef struct Registration {
+    struct Registration*	prev;		/* previous in list of all */
+    struct Registration*	next;		/* next in list of all */
+    ut_unit*			unit2;
+    unsigned long		serial;		/* unique identifier */
+    cv_converter*		toEncoded;	/* unit2 -> encodedTimeUnit */
+    cv_converter*		fromEncoded;	/* encodedTimeUnit -> unit2 */
+    cv_converter*		toOther;	/* unit2 -> unit of "otherSerial" */
+    unsigned long		otherSerial;
+} Registration;
+
 static ut_system*	unitSystem = NULL;
 static ut_unit*		encodedTimeUnit = NULL;
 static ut_unit*		second = NULL;
 static char*		buffer;
 static int		buflen = 80;
-static void*		unit2s = NULL;
+static void*		unit2s = NULL;		/* unit2 -> Registration */
+static Registration*	registrations = NULL;
+static unsigned long	nextSerial = 1;
 
 /*
  * Initialize the udunits(3) package.
@@ -36,10 +59,8 @@ utInit(
     int status;
 
     (void)ut_set_error_message_handler(ut_ignore);
-    if (unitSystem != NULL) {
-	ut_free_system(unitSystem);
-	unitSystem = NULL;
-    }
+    if (unitSystem != NULL)
+	utTerm();
     unitSystem = ut_read_xml(NULL);
     if (unitSystem == NULL) {
 	status = ut_get_status() == UT_PARSE
@@ -50,7 +71,8 @@ utInit(
 	second = ut_get_unit_by_name(unitSystem, "second");
 	encodedTimeUnit =
 	    ut_offset_by_time(second, ut_encode_time(2001, 1, 1, 0, 0, 0.0));
-	buffer = malloc(buflen);
+	if (buffer == NULL)
+	    buffer = malloc(buflen);
 	if (buffer == NULL) {
 	    buflen = 0;
 	    status = UT_EALLOC;
@@ -76,19 +98,75 @@ compare(
     const void*	key1,
     const void*	key2)
 {
-    return key1 < key2 ? -1 : key1 == key2 ? 0 : 1;
+    const ut_unit* const	unit1 = ((const Registration*)key1)->unit2;
+    const ut_unit* const	unit2 = ((const Registration*)key2)->unit2;
+
+    return unit1 < unit2 ? -1 : unit1 == unit2 ? 0 : 1;
+}
+
+/*
+ * Returns the registration of a unit or NULL if the unit wasn't created by
+ * this package (e.g., because the unit-structure wasn't initialized).
+ */
+static Registration*
+findRegistration(
+    const ut_unit* const	unit2)
+{
+    Registration	query;
+    void*		node;
+
+    query.unit2 = (ut_unit*)unit2;
+    node = tfind(&query, &unit2s, compare);
+
+    return node == NULL ? NULL : *(Registration**)node;
+}
+
+static void
+freeRegistration(
+    Registration* const	reg)
+{
+    (void)tdelete(reg, &unit2s, compare);
+    if (reg->prev == NULL) {
+	registrations = reg->next;
+    }
+    else {
+	reg->prev->next = reg->next;
+    }
+    if (reg->next != NULL)
+	reg->next->prev = reg->prev;
+    cv_free(reg->toOther);
+    cv_free(reg->fromEncoded);
+    cv_free(reg->toEncoded);
+    ut_free(reg->unit2);
+    free(reg);
 }
 
 static void
 freeIfAllocated(
     utUnit* const	unit)
 {
-    if (tdelete(unit->unit2, &unit2s, compare) != NULL) {
-	ut_free(unit->unit2);
-    }
+    Registration* const	reg = findRegistration(unit->unit2);
+
+    if (reg != NULL)
+	freeRegistration(reg);
     unit->unit2 = NULL;
 }
 
+/*
+ * Returns a converter between two units from a cache slot, creating and
+ * caching it if necessary.  The returned converter belongs to the slot.
+ */
+static cv_converter*
+getCachedConverter(
+    cv_converter** const	slot,
+    ut_unit* const		from,
+    ut_unit* const		to)
+{
+    if (*slot == NULL)
+	*slot = ut_get_converter(from, to);
+    return *slot;
+}
+
 void
 utFree(
     utUnit* const	unit)
@@ -110,15 +188,50 @@ setUnit(
     utUnit* const	unit,
     ut_unit* const	unit2)
 {
-    int	status;
-
-    if (tsearch(unit2, &unit2s, compare) == NULL) {
-	status = UT_EALLOC;
+    int			status;
+    Registration* const	current = findRegistration(unit->unit2);
+
+    if (current != NULL && current->unit2 != unit2 &&
+	    ut_compare(current->unit2, unit2) == 0) {
+	/*
+	 * Keep the equal unit of the unit-structure and its converters (e.g.,
+	 * when the same specification is repeatedly scanned).
+	 */
+	ut_free(unit2);
+	status = 0;
     }
     else {
-	freeIfAllocated(unit);
-	unit->unit2 = unit2;
-	status = 0;
+	Registration*	reg = calloc(1, sizeof(Registration));
+	void*		node = NULL;
+
+	if (reg != NULL) {
+	    reg->unit2 = unit2;
+	    node = tsearch(reg, &unit2s, compare);
+	}
+	if (node == NULL) {
+	    free(reg);
+	    ut_free(unit2);
+	    status = UT_EALLOC;
+	}
+	else {
+	    if (*(Registration**)node != reg) {
+		/*
+		 * The unit is shared (e.g., the dimensionless unit one).
+		 */
+		free(reg);
+	    }
+	    else {
+		reg->serial = nextSerial++;
+		reg->next = registrations;
+		if (registrations != NULL)
+		    registrations->prev = reg;
+		registrations = reg;
+	    }
+	    if (current == NULL || current->unit2 != unit2)
+		freeIfAllocated(unit);
+	    unit->unit2 = unit2;
+	    status = 0;
+	}
     }
     return status;
 }
@@ -184,6 +297,65 @@ static int daysInMonth(
             : daysInMonth[1][month-1];
 }
 
+/*
+ * Sets the single-precision second of a decoded time, carrying into the
+ * minute, etc. if the second rounds up to 60.
+ */
+static void
+setSecond(
+    const double	sec,
+    int* const		year,
+    int* const		month,
+    int* const		day,
+    int* const		hour,
+    int* const		minute,
+    float* const	second)
+{
+    *second = (float)sec;
+    if (*second > 59) {
+	*second = 0;
+	*minute += 1;
+	if (*minute > 59) {
+	    *minute = 0;
+	    *hour += 1;
+	    if (*hour > 23) {
+		*hour = 0;
+		*day += 1;
+		if (*day > daysInMonth(*year, *month)) {
+		    *day = 1;
+		    *month += 1;
+		    if (*month > 12) {
+			*month = 1;
+			*year += 1;
+		    }
+		}
+	    }
+	}
+    }
+}
+
+/*
+ * Returns the converter from a unit to the encoded time unit.  If the unit was
+ * created by this package, then the converter is cached and "*local" is set
+ * to NULL; otherwise, "*local" is set to the converter, which the caller must
+ * free.
+ */
+static cv_converter*
+getCalendarConverter(
+    const utUnit* const	unit,
+    const int		inverse,
+    cv_converter** const	local)
+{
+    Registration* const	reg = findRegistration(unit->unit2);
+
+    *local = NULL;
+    return inverse
+	? getCachedConverter(reg == NULL ? local : &reg->fromEncoded,
+	    encodedTimeUnit, unit->unit2)
+	: getCachedConverter(reg == NULL ? local : &reg->toEncoded,
+	    unit->unit2, encodedTimeUnit);
+}
+
 /*
 * Convert a temporal value into a UTC Gregorian date and time.
 */
@@ -198,9 +370,10 @@ utCalendar(
     int			*minute,
     float		*second)
 {
-    int		status = 0;	/* success */
+    int			status = 0;	/* success */
+    cv_converter*	local;
+    cv_converter*	converter = getCalendarConverter(unit, 0, &local);
 
-    cv_converter* converter = ut_get_converter(unit->unit2, encodedTimeUnit);
     if (converter == NULL) {
         status = encodedTimeUnit == NULL ? UT_ENOINIT : UT_EINVALID;
     }
@@ -209,28 +382,65 @@ utCalendar(
         double	sec, res;
 
         ut_decode_time(encodedTime, year, month, day, hour, minute, &sec, &res);
-        *second = (float)sec;
-        if (*second > 59) {
-            *second = 0;
-	    *minute += 1;
-	    if (*minute > 59) {
-	        *minute = 0;
-	        *hour += 1;
-	        if (*hour > 23) {
-	            *hour = 0;
-	            *day += 1;
-	            if (*day > daysInMonth(*year, *month)) {
-	                *day = 1;
-	                *month += 1;
-	                if (*month > 12) {
-	                    *month = 1;
-	                    *year += 1;
-	                }
-	            }
-	        }
+	setSecond(sec, year, month, day, hour, minute, second);
+	cv_free(local);
+    }
+    return status;
+}
+
+/*
+ * Convert temporal values into UTC Gregorian dates and times.  The result is
+ * the same as calling utCalendar() on each value, but one converter is used
+ * for all the values.
+ */
+int
+utCalendars(
+    const double	*values,
+    size_t		count,
+    const utUnit	*unit,
+    int			*years,
+    int			*months,
+    int			*days,
+    int			*hours,
+    int			*minutes,
+    float		*seconds)
+{
+    int		status = 0;	/* success */
+
+    if (unit == NULL || (count > 0 && (values == NULL || years == NULL ||
+	    months == NULL || days == NULL || hours == NULL ||
+	    minutes == NULL || seconds == NULL))) {
+	status = UT_EINVALID;
+    }
+    else {
+	cv_converter*	local;
+	cv_converter*	converter = getCalendarConverter(unit, 0, &local);
+
+	if (converter == NULL) {
+	    status = encodedTimeUnit == NULL ? UT_ENOINIT : UT_EINVALID;
+	}
+	else {
+	    double	encodedTimes[CALENDAR_BLOCK_SIZE];
+	    double	secs[CALENDAR_BLOCK_SIZE];
+	    size_t	start;
+
+	    for (start = 0; start < count; start += CALENDAR_BLOCK_SIZE) {
+		const size_t	n = count - start < CALENDAR_BLOCK_SIZE
+		    ? count - start
+		    : CALENDAR_BLOCK_SIZE;
+		size_t		i;
+
+		(void)cv_convert_doubles(converter, values + start, n,
+		    encodedTimes);
+		(void)ut_decode_times(encodedTimes, n, years + start,
+		    months + start, days + start, hours + start,
+		    minutes + start, secs, NULL);
+		for (i = start; i < start + n; i++)
+		    setSecond(secs[i-start], years + i, months + i, days + i,
+			hours + i, minutes + i, seconds + i);
 	    }
+	    cv_free(local);
 	}
-	cv_free(converter);
     }
     return status;
 }
@@ -251,9 +461,10 @@ utInvCalendar(
     const utUnit	*unit,
     double		*value)
 {
-    int		status = 0;	/* success */
+    int			status = 0;	/* success */
+    cv_converter*	local;
+    cv_converter*	converter = getCalendarConverter(unit, 1, &local);
 
-    cv_converter* converter = ut_get_converter(encodedTimeUnit, unit->unit2);
     if (converter == NULL) {
 	status = encodedTimeUnit == NULL ? UT_ENOINIT : UT_EINVALID;
     }
@@ -262,7 +473,50 @@ utInvCalendar(
 	    ut_encode_time(year, month, day, hour, minute, second);
 
 	*value = cv_convert_double(converter, encodedTime);
-	cv_free(converter);
+	cv_free(local);
+    }
+    return status;
+}
+
+/*
+ * Convert dates into temporal values.  The result is the same as calling
+ * utInvCalendar() on each date, but one converter is used for all the dates.
+ */
+int
+utInvCalendars(
+    const int		*years,
+    const int		*months,
+    const int		*days,
+    const int		*hours,
+    const int		*minutes,
+    const double	*seconds,
+    size_t		count,
+    const utUnit	*unit,
+    double		*values)
+{
+    int		status = 0;	/* success */
+
+    if (unit == NULL || (count > 0 && (years == NULL || months == NULL ||
+	    days == NULL || hours == NULL || minutes == NULL ||
+	    seconds == NULL || values == NULL))) {
+	status = UT_EINVALID;
+    }
+    else {
+	cv_converter*	local;
+	cv_converter*	converter = getCalendarConverter(unit, 1, &local);
+
+	if (converter == NULL) {
+	    status = encodedTimeUnit == NULL ? UT_ENOINIT : UT_EINVALID;
+	}
+	else {
+	    /*
+	     * Like ut_encode_time(), an invalid clock-time is ignored.
+	     */
+	    (void)ut_encode_times(years, months, days, hours, minutes, seconds,
+		count, values);
+	    (void)cv_convert_doubles(converter, values, count, values);
+	    cv_free(local);
+	}
     }
     return status;
 }
@@ -547,7 +801,27 @@ utConvert(
     double		*intercept)
 {
     int			status;
-    cv_converter*	converter = ut_get_converter(from->unit2, to->unit2);
+    Registration* const	fromReg = findRegistration(from->unit2);
+    Registration* const	toReg = findRegistration(to->unit2);
+    cv_converter*	local = NULL;
+    cv_converter*	converter;
+
+    if (fromReg == NULL || toReg == NULL) {
+	converter = getCachedConverter(&local, from->unit2, to->unit2);
+    }
+    else {
+	/*
+	 * The serial number, unlike the address, of the destination unit
+	 * isn't reused.
+	 */
+	if (fromReg->otherSerial != toReg->serial) {
+	    cv_free(fromReg->toOther);
+	    fromReg->toOther = NULL;
+	    fromReg->otherSerial = toReg->serial;
+	}
+	converter = getCachedConverter(&fromReg->toOther, from->unit2,
+	    to->unit2);
+    }
 
     if (converter == NULL) {
 	status = ut_get_status();
@@ -569,6 +843,7 @@ utConvert(
 	*intercept = cv_convert_double(converter, 0.0);
 	*slope = cv_convert_double(converter, 1.0) - *intercept;
 	status = 0;
+	cv_free(local);
     }
     return status;
 }
@@ -603,7 +878,7 @@ utPrint(
 	}
 	else {
 	    int		newLen = buflen * 2;
-	    char*	newBuf = malloc(newLen);
+	    char*	newBuf = realloc(buffer, newLen);
 
 	    if (newBuf == NULL) {
 		status = UT_EALLOC;
@@ -694,6 +969,8 @@ utFind(
 void
 utTerm()
 {
+    while (registrations != NULL)
+	freeRegistration(registrations);
     ut_free(second);
     second = NULL;
     ut_free(encodedTimeUnit);
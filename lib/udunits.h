@@ -126,6 +126,40 @@ EXTERNL int	utInvCalendar	PROTO((
     double		*value
 ));
 
+/*
+ *	Convert temporal values into UTC Gregorian dates and times.  The
+ *	result is the same as calling utCalendar() on each value, but one
+ *	converter is used for all the values.
+ */
+EXTERNL int	utCalendars	PROTO((
+    const double	*values,
+    size_t		count,
+    const utUnit	*unit,
+    int			*years,
+    int			*months,
+    int			*days,
+    int			*hours,
+    int			*minutes,
+    float		*seconds
+));
+
+/*
+ *	Convert dates into temporal values.  The result is the same as
+ *	calling utInvCalendar() on each date, but one converter is used for
+ *	all the dates.
+ */
+EXTERNL int	utInvCalendars	PROTO((
+    const int		*years,
+    const int		*months,
+    const int		*days,
+    const int		*hours,
+    const int		*minutes,
+    const double	*seconds,
+    size_t		count,
+    const utUnit	*unit,
+    double		*values
+));
+
 /*
  *	Indicate if a unit structure refers to a unit of time.
  */
@@ -82,6 +82,7 @@ char* str,
 
 typedef struct ut_system	ut_system;
 typedef union ut_unit		ut_unit;
+typedef struct ut_conversion_plan	ut_conversion_plan;
 
 enum utStatus {
     UT_SUCCESS = 0,	/* Success */
@@ -99,7 +100,8 @@ enum utStatus {
     UT_OPEN_ARG,	/* Can't open argument-specified unit database */
     UT_OPEN_ENV,	/* Can't open environment-specified unit database */
     UT_OPEN_DEFAULT,	/* Can't open installed, default, unit database */
-    UT_PARSE		/* Error parsing unit specification */
+    UT_PARSE,		/* Error parsing unit specification */
+    UT_FROZEN		/* The unit-system is frozen and can't be modified */
 };
 typedef enum utStatus          ut_status;
 
@@ -205,6 +207,61 @@ typedef struct ut_visitor {
 typedef int (*ut_error_message_handler)(const char* fmt, va_list args);
 
 
+/*
+ * Hot-path statistics of the library.  See ut_get_stats().  Every member is
+ * a cumulative count over all threads since the library was loaded or
+ * ut_reset_stats() was last called.
+ */
+typedef struct ut_stats {
+    /*
+     * Whether or not the library was built with statistics (e.g., by
+     * "cmake -DENABLE_STATS=ON" or "configure --enable-stats").  If not, then
+     * all the other members are zero.
+     */
+    int			enabled;
+    /*
+     * Parsing:
+     */
+    unsigned long long	parseCalls;	/* strings passed to ut_parse() and
+					   ut_parse_many() */
+    unsigned long long	parseCacheHits;	/* found in the parse cache */
+    unsigned long long	parseIdentifiers; /* resolved as a single identifier
+					   without being parsed */
+    unsigned long long	parses;		/* strings scanned and parsed */
+    unsigned long long	parseNanoseconds; /* time spent in "parses" */
+    /*
+     * Identifier lookups:
+     */
+    unsigned long long	nameLookups;	/* name-to-unit lookups */
+    unsigned long long	symbolLookups;	/* symbol-to-unit lookups */
+    unsigned long long	prefixLookups;	/* prefix lookups */
+    /*
+     * Converters:
+     */
+    unsigned long long	converterRequests; /* calls to ut_get_converter() */
+    unsigned long long	converterCacheHits; /* found in the converter-cache */
+    unsigned long long	converterNanoseconds; /* time spent building
+					   converters that weren't cached */
+    unsigned long long	combineCalls;	/* calls to cv_combine() */
+    unsigned long long	combineFolds;	/* combinations of non-trivial
+					   converters that were folded into
+					   one converter instead of a
+					   program */
+    /*
+     * Array conversions.  "Values" are the numbers of converted values.
+     */
+    unsigned long long	arrayCalls;	/* calls to the array-conversion
+					   functions */
+    unsigned long long	floatValues;	/* cv_convert_floats() */
+    unsigned long long	doubleValues;	/* cv_convert_doubles() */
+    unsigned long long	parallelValues;	/* cv_convert_*_parallel() */
+    unsigned long long	stridedValues;	/* cv_convert_*_strided() */
+    unsigned long long	mixedValues;	/* cv_convert_floats_to_doubles() and
+					   cv_convert_doubles_to_floats() */
+    unsigned long long	packedValues;	/* cv_convert_packed_*() */
+} ut_stats;
+
+
 #ifdef __cplusplus
 EXTERNL "C" {
 #endif
@@ -262,6 +319,123 @@ ut_read_xml(
     const char*	path);
 
 
+/*
+ * Returns the unit-system corresponding to an XML file like ut_read_xml() but
+ * defers the definition of every unit that's defined by a <def> element until
+ * one of its identifiers is first looked up (e.g., by ut_get_unit_by_name(),
+ * ut_get_unit_by_symbol(), or ut_parse()).  Until then, the unit isn't mapped
+ * to its identifiers by the unit-to-identifier maps.  Because looking up a
+ * unit can modify the unit-system, the unit-system must not be used
+ * concurrently until it's frozen by ut_freeze_system(), which materializes
+ * all units.
+ *
+ * Arguments:
+ *	path	The pathname of the XML file or NULL.  See ut_read_xml().
+ * Returns:
+ *	NULL	Failure.  See ut_read_xml().
+ *	else	Pointer to the unit-system defined by "path".
+ */
+EXTERNL ut_system*
+ut_read_xml_lazy(
+    const char*	path);
+
+
+/*
+ * Returns the unit-system corresponding to an XML file like ut_read_xml() but
+ * uses the thread-pool of the library (see cv_set_parallelism()).  The file
+ * and the files that it imports are read and tokenized concurrently, and the
+ * unit definitions of each file are parsed ahead, concurrently, before the
+ * file is processed.  The files are processed in the same order as by
+ * ut_read_xml() and a result of parsing ahead is used only if the definitions
+ * that it depends on haven't changed since, so the unit-system is the same as
+ * the one returned by ut_read_xml().  This function is no more thread-safe
+ * than ut_read_xml().
+ *
+ * Arguments:
+ *	path	The pathname of the XML file or NULL.  See ut_read_xml().
+ * Returns:
+ *	NULL	Failure.  See ut_read_xml().
+ *	else	Pointer to the unit-system defined by "path".
+ */
+EXTERNL ut_system*
+ut_read_xml_parallel(
+    const char*	path);
+
+
+/*
+ * Writes a unit-system to a binary unit-database file that can be read by
+ * ut_read_binary() or mapped by ut_mmap_binary() much faster than ut_read_xml()
+ * can read the XML database.
+ * The file contains the base and dimensionless units, the "second" unit, the
+ * name-to-unit, symbol-to-unit, unit-to-name, and unit-to-symbol mappings,
+ * and the prefixes of the unit-system.  The file is only portable between
+ * hosts with the same byte-order and floating-point representation.  The
+ * unit-system isn't frozen by this function (see "ut_freeze_system()"), but the
+ * pending units of a unit-system that was read by ut_read_xml_lazy() are
+ * materialized.
+ *
+ * Arguments:
+ *	system	Pointer to the unit-system to be written.
+ *	path	Pathname of the file to be created.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" or "path" is NULL.
+ *	UT_OPEN_ARG	The file couldn't be created.  See "errno" for reason.
+ *	UT_PARSE	A unit of the unit-system couldn't be indexed.  No file
+ *			is created.
+ *	UT_OS		Operating-system error.  See "errno".
+ */
+EXTERNL ut_status
+ut_write_binary(
+    ut_system* const	system,
+    const char* const	path);
+
+/*
+ * Returns the unit-system corresponding to a binary unit-database file that
+ * was created by ut_write_binary().  The returned unit-system isn't frozen.
+ *
+ * Arguments:
+ *	path	The pathname of the binary unit-database file.
+ * Returns:
+ *	NULL	Failure.  "ut_get_status()" will be
+ *		    UT_BAD_ARG		"path" is NULL.
+ *		    UT_OPEN_ARG		The file couldn't be opened.  See
+ *					"errno" for reason.
+ *		    UT_PARSE		The file isn't a binary unit-database
+ *					of a supported version or is corrupt.
+ *		    UT_OS		Operating-system error.  See "errno".
+ *	else	Pointer to the unit-system defined by "path".
+ */
+EXTERNL ut_system*
+ut_read_binary(
+    const char* const	path);
+
+/*
+ * Returns a frozen unit-system that's mapped read-only from a binary
+ * unit-database file that was created by ut_write_binary().  The identifier,
+ * unit, and prefix tables of the unit-system aren't copied: they're used where
+ * they're mapped and are, consequently, shared by all the processes that map
+ * the same file.  The file must not be modified while it's mapped: replace it
+ * by renaming a new file over it.  Where memory-mapping isn't available, the
+ * file is read into private memory instead.
+ *
+ * Arguments:
+ *	path	The pathname of the binary unit-database file.
+ * Returns:
+ *	NULL	Failure.  "ut_get_status()" will be
+ *		    UT_BAD_ARG		"path" is NULL.
+ *		    UT_OPEN_ARG		The file couldn't be opened.  See
+ *					"errno" for reason.
+ *		    UT_PARSE		The file isn't a binary unit-database
+ *					of a supported version or is corrupt.
+ *		    UT_OS		Operating-system error.  See "errno".
+ *	else	Pointer to the frozen unit-system defined by "path".
+ */
+EXTERNL ut_system*
+ut_mmap_binary(
+    const char* const	path);
+
+
 /*
  * Returns a new unit-system.  On success, the unit-system will only contain
  * the dimensionless unit one.  See "ut_get_dimensionless_unit_one()".
@@ -288,6 +462,46 @@ ut_free_system(
     ut_system*	system);
 
 
+/*
+ * Freezes a unit-system.  The name-to-unit, symbol-to-unit, unit-to-name,
+ * unit-to-symbol, and prefix maps of the unit-system are compiled into
+ * immutable hash tables.  Afterwards, looking up units, identifiers, and
+ * prefixes in the unit-system (including by ut_parse()) doesn't modify any
+ * shared state and is safe from any thread, and functions that would modify
+ * the unit-system fail with the status UT_FROZEN.  A unit-system can't be
+ * thawed.  This function must not be called concurrently with any other use
+ * of the unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system to be frozen.
+ * Returns:
+ *	UT_SUCCESS	Success.  Also returned if "system" is already frozen.
+ *	UT_BAD_ARG	"system" is NULL.
+ *	UT_OS		Operating-system failure.  See "errno".  "system" is
+ *			unchanged.
+ */
+EXTERNL ut_status
+ut_freeze_system(
+    ut_system* const	system);
+
+
+/*
+ * Indicates whether or not a unit-system is frozen.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	0		"system" isn't frozen or is NULL.  "ut_get_status()"
+ *			will be
+ *			    UT_BAD_ARG	"system" is NULL.
+ *			    UT_SUCCESS	"system" isn't frozen.
+ *	else		"system" is frozen.
+ */
+EXTERNL int
+ut_is_frozen(
+    const ut_system* const	system);
+
+
 /*
  * Returns the unit-system to which a unit belongs.
  *
@@ -343,6 +557,29 @@ ut_get_unit_by_name(
     const char* const		name);
 
 
+/*
+ * Returns the unit with a given name from a unit-system without copying it.
+ * Name comparisons are case-insensitive.
+ *
+ * Arguments:
+ *	system	Pointer to the unit-system.
+ *	name	Pointer to the name of the unit to be returned.
+ * Returns:
+ *	NULL	Failure.  "ut_get_status()" will be
+ *		    UT_SUCCESS		"name" doesn't map to a unit of
+ *					"system".
+ *		    UT_BAD_ARG		"system" or "name" is NULL.
+ *	else	Pointer to the unit of the unit-system with the given name.
+ *		The unit belongs to the unit-system and is valid until "name"
+ *		is unmapped or the unit-system is freed.  It must not be
+ *		passed to ut_free() or modified.  See ut_clone().
+ */
+EXTERNL const ut_unit*
+ut_get_unit_by_name_ref(
+    const ut_system* const	system,
+    const char* const		name);
+
+
 /*
  * Returns the unit with a given symbol from a unit-system.  Symbol
  * comparisons are case-sensitive.
@@ -366,6 +603,30 @@ ut_get_unit_by_symbol(
     const char* const		symbol);
 
 
+/*
+ * Returns the unit with a given symbol from a unit-system without copying it.
+ * Symbol comparisons are case-sensitive.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	symbol		Pointer to the symbol associated with the unit to be
+ *			returned.
+ * Returns:
+ *	NULL	Failure.  "ut_get_status()" will be
+ *		    UT_SUCCESS		"symbol" doesn't map to a unit of
+ *					"system".
+ *		    UT_BAD_ARG		"system" or "symbol" is NULL.
+ *	else	Pointer to the unit in the unit-system with the given symbol.
+ *		The unit belongs to the unit-system and is valid until
+ *		"symbol" is unmapped or the unit-system is freed.  It must not
+ *		be passed to ut_free() or modified.  See ut_clone().
+ */
+EXTERNL const ut_unit*
+ut_get_unit_by_symbol_ref(
+    const ut_system* const	system,
+    const char* const		symbol);
+
+
 /*
  * Sets the "second" unit of a unit-system.  This function must be called before
  * the first call to "ut_offset_by_time()". ut_read_xml() calls this function if the
@@ -377,6 +638,8 @@ ut_get_unit_by_symbol(
  *	UT_BAD_ARG	"second" is NULL.
  *	UT_EXISTS	The second unit of the unit-system to which "second"
  *			belongs is set to a different unit.
+ *	UT_FROZEN	The unit-system to which "second" belongs is frozen
+ *			and its second unit isn't set.
  *	UT_SUCCESS	Success.
  */
 EXTERNL ut_status
@@ -402,6 +665,7 @@ ut_set_second(
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"system" or "name" is NULL, or "value" is 0.
  *	UT_EXISTS	"name" already maps to a different value.
+ *	UT_FROZEN	"system" is frozen.
  *	UT_OS		Operating-system failure.  See "errno".
  */
 EXTERNL ut_status
@@ -425,6 +689,7 @@ ut_add_name_prefix(
  *	UT_BADSYSTEM	"system" or "symbol" is NULL.
  *	UT_BAD_ARG	"value" is 0.
  *	UT_EXISTS	"symbol" already maps to a different value.
+ *	UT_FROZEN	"system" is frozen.
  *	UT_OS		Operating-system failure.  See "errno".
  */
 EXTERNL ut_status
@@ -448,6 +713,7 @@ ut_add_symbol_prefix(
  * Returns:
  *	NULL	Failure.  "ut_get_status()" will be
  *		    UT_BAD_ARG		"system" or "name" is NULL.
+ *		    UT_FROZEN		"system" is frozen.
  *		    UT_OS		Operating-system error.  See "errno".
  *	else	Pointer to the new base-unit.  The pointer should be passed to
  *		ut_free() when the unit is no longer needed by the client (the
@@ -469,6 +735,7 @@ ut_new_base_unit(
  * Returns:
  *	NULL	Failure.  "ut_get_status()" will be
  *		    UT_BAD_ARG		"system" is NULL.
+ *		    UT_FROZEN		"system" is frozen.
  *		    UT_OS		Operating-system error.  See "errno".
  *	else	Pointer to the new dimensionless-unit.  The pointer should be
  *		passed to ut_free() when the unit is no longer needed by the
@@ -510,6 +777,40 @@ ut_free(
     ut_unit* const	unit);
 
 
+/*
+ * Begins bump-allocation of units in the current thread.  Until the matching
+ * ut_arena_end(), new units are allocated from a per-thread arena and are
+ * released in bulk by the outermost ut_arena_end().  Calls may be nested.
+ * Units that are stored by the library (e.g., by ut_map_name_to_unit()) are
+ * always allocated on the heap.
+ */
+EXTERNL void
+ut_arena_begin(void);
+
+
+/*
+ * Ends bump-allocation of units in the current thread.  If this is the
+ * outermost call, then all units created since the matching ut_arena_begin()
+ * are released except for a given one, which is copied to the heap.  The
+ * released units must not be used afterwards.
+ *
+ * Arguments:
+ *	result	Pointer to the unit to be kept or NULL.
+ * Returns:
+ *	NULL	"result" is NULL or failure.  ut_get_status() will be
+ *		    UT_SUCCESS	"result" is NULL.
+ *		    UT_BAD_ARG	There's no matching ut_arena_begin().
+ *		    UT_OS	Operating-system failure.  See "errno".
+ *	else	Pointer to the unit corresponding to "result".  If this is the
+ *		outermost call, then it's a heap copy and "result" must not be
+ *		used afterwards.  The pointer should be passed to ut_free()
+ *		when the unit is no longer needed by the client.
+ */
+EXTERNL ut_unit*
+ut_arena_end(
+    ut_unit* const	result);
+
+
 /******************************************************************************
  * Mapping between Units and Names:
  ******************************************************************************/
@@ -546,6 +847,7 @@ ut_get_name(
  *			freed upon return.
  * Returns:
  *	UT_BAD_ARG	"name" or "unit" is NULL.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_OS		Operating-system error.  See "errno".
  *	UT_EXISTS	"name" already maps to a different unit.
  *	UT_SUCCESS	Success.
@@ -568,6 +870,7 @@ ut_map_name_to_unit(
  * Returns:
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"system" or "name" is NULL.
+ *	UT_FROZEN	"system" is frozen.
  */
 EXTERNL ut_status
 ut_unmap_name_to_unit(
@@ -589,6 +892,7 @@ ut_unmap_name_to_unit(
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"unit" or "name" is NULL, or "name" is not in the
  *                      specified encoding.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_OS		Operating-system error.  See "errno".
  *	UT_EXISTS	"unit" already maps to a name.
  */
@@ -608,6 +912,7 @@ ut_map_unit_to_name(
  *			removed.
  * Returns:
  *	UT_BAD_ARG	"unit" is NULL.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_SUCCESS	Success.
  */
 EXTERNL ut_status
@@ -652,6 +957,7 @@ ut_get_symbol(
  *			be freed upon return.
  * Returns:
  *	UT_BAD_ARG	"symbol" or "unit" is NULL.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_OS		Operating-system error.  See "errno".
  *	UT_EXISTS	"symbol" already maps to a different unit.
  *	UT_SUCCESS	Success.
@@ -674,6 +980,7 @@ ut_map_symbol_to_unit(
  * Returns:
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"system" or "symbol" is NULL.
+ *	UT_FROZEN	"system" is frozen.
  */
 EXTERNL ut_status
 ut_unmap_symbol_to_unit(
@@ -694,6 +1001,7 @@ ut_unmap_symbol_to_unit(
  * Returns:
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"unit" or "symbol" is NULL.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_OS		Operating-system error.  See "errno".
  *	UT_EXISTS	"unit" already maps to a symbol.
  */
@@ -715,6 +1023,7 @@ ut_map_unit_to_symbol(
  * Returns:
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"unit" is NULL.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  */
 EXTERNL ut_status
 ut_unmap_unit_to_symbol(
@@ -831,7 +1140,10 @@ ut_are_convertible(
  *						"ut_are_convertible()".
  *	else		Pointer to the appropriate converter.  The pointer
  *			should be passed to cv_free() when no longer needed by
- *			the client.
+ *			the client.  If the converter-cache of the unit-system
+ *			is enabled, then the converter is shared with the
+ *			cache and other clients.  See
+ *			ut_set_converter_cache_capacity().
  */
 EXTERNL cv_converter*
 ut_get_converter(
@@ -839,6 +1151,200 @@ ut_get_converter(
     ut_unit* const	to);
 
 
+/*
+ * Sets the capacity of the converter-cache of a unit-system.  When the cache
+ * is enabled, ut_get_converter() returns a shared, reference-counted converter
+ * for a pair of units whose converter it has already built instead of building
+ * a new one.  Units are compared with ut_compare().  Each converter so
+ * returned must still be passed to cv_free() exactly once.  The
+ * least-recently used entry is evicted when the cache is full.  The cache is
+ * disabled by default.  Changing the capacity empties the cache.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	capacity	Maximum number of entries in the cache.  If zero, then
+ *			the cache is disabled.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" is NULL.
+ *	UT_OS		Operating-system failure.  See "errno".
+ */
+EXTERNL ut_status
+ut_set_converter_cache_capacity(
+    ut_system* const	system,
+    const size_t	capacity);
+
+
+/*
+ * Removes all entries from the converter-cache of a unit-system and resets its
+ * hit and miss counters.  The cache remains enabled if it was.  Converters
+ * previously returned by ut_get_converter() remain valid until passed to
+ * cv_free().
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" is NULL.
+ */
+EXTERNL ut_status
+ut_flush_converter_cache(
+    ut_system* const	system);
+
+
+/*
+ * Returns statistics on the converter-cache of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	count		NULL or pointer to the number of entries in the cache.
+ *	hits		NULL or pointer to the number of times
+ *			ut_get_converter() found its units in the cache.
+ *	misses		NULL or pointer to the number of times
+ *			ut_get_converter() didn't find its units in the enabled
+ *			cache.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" is NULL.
+ */
+EXTERNL ut_status
+ut_get_converter_cache_stats(
+    const ut_system* const	system,
+    size_t* const		count,
+    unsigned long* const	hits,
+    unsigned long* const	misses);
+
+
+/*
+ * Returns a new conversion plan for columns of values, each of which has its
+ * own pair of units.  The converter of each column is obtained from
+ * ut_get_converter() and compiled by cv_compile() once, here, so that blocks
+ * of columns can then be converted in one call by ut_convert_columns() or
+ * ut_convert_records().
+ *
+ * Arguments:
+ *	from		The units from which to convert the values of the
+ *			columns.  "from[i]" is the unit of column "i".
+ *	to		The units to which to convert the values of the
+ *			columns.  "to[i]" is the unit of column "i".
+ *	count		The number of columns.
+ * Returns:
+ *	NULL		Failure.  "ut_get_status()" will be
+ *			    UT_BAD_ARG		"from" or "to" is NULL or
+ *						contains NULL.
+ *			    UT_NOT_SAME_SYSTEM	The units of a column belong to
+ *						different unit-systems.
+ *			    UT_MEANINGLESS	Conversion between the units of
+ *						a column isn't possible.
+ *			    UT_OS		Operating-system failure.  See
+ *						"errno".
+ *	else		Pointer to the plan.  Should be passed to
+ *			ut_free_conversion_plan() when no longer needed.
+ */
+EXTERNL ut_conversion_plan*
+ut_new_conversion_plan(
+    ut_unit* const* const	from,
+    ut_unit* const* const	to,
+    const size_t		count);
+
+
+/*
+ * Returns the number of columns of a conversion plan.
+ *
+ * Arguments:
+ *	plan		Pointer to the plan.
+ * Returns:
+ *	0		"plan" is NULL or has no columns.  "ut_get_status()" will
+ *			be UT_BAD_ARG or UT_SUCCESS, respectively.
+ *	else		The number of columns.
+ */
+EXTERNL size_t
+ut_get_conversion_plan_size(
+    const ut_conversion_plan* const	plan);
+
+
+/*
+ * Converts a block of columns of double-precision values that are stored as
+ * separate arrays (i.e., a structure of arrays).
+ *
+ * Arguments:
+ *	plan		Pointer to the conversion plan.
+ *	in		The input columns.  "in[i]" points to the "count"
+ *			values of column "i".
+ *	count		The number of values per column.
+ *	out		The output columns.  "out[i]" points to the output
+ *			array of column "i", which may be the same as or
+ *			overlap "in[i]" but must not overlap any other column.
+ *	parallel	Whether or not the columns may be divided among the
+ *			threads of the library's thread-pool (see
+ *			cv_set_parallelism()).  They are if the total number of
+ *			values is at least the threshold set by that function.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"plan", "in", or "out" is NULL or "in" or "out"
+ *			contains NULL.  Nothing was converted.
+ */
+EXTERNL ut_status
+ut_convert_columns(
+    const ut_conversion_plan* const	plan,
+    const double* const* const		in,
+    const size_t			count,
+    double* const* const		out,
+    const int				parallel);
+
+
+/*
+ * Converts a block of records of double-precision values (i.e., an array of
+ * structures).  The value of column "j" of record "i" is at
+ * "in[i*inStride+j]".
+ *
+ * Arguments:
+ *	plan		Pointer to the conversion plan.
+ *	in		Pointer to the first input record.
+ *	inStride	The number of doubles from the start of one input
+ *			record to the start of the next.  Must be at least the
+ *			number of columns.  Values between the columns of a
+ *			record are ignored.
+ *	count		The number of records.
+ *	out		Pointer to the first output record.  The output
+ *			records must not overlap the input records unless
+ *			"out" equals "in" and "outStride" equals "inStride".
+ *	outStride	The number of doubles from the start of one output
+ *			record to the start of the next.  Must be at least the
+ *			number of columns.  Values between the columns of a
+ *			record aren't modified.
+ *	parallel	Whether or not the records may be divided among the
+ *			threads of the library's thread-pool (see
+ *			cv_set_parallelism()).  They are if the total number of
+ *			values is at least the threshold set by that function.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"plan", "in", or "out" is NULL, a stride is less than
+ *			the number of columns, or "out" equals "in" but the
+ *			strides differ.  Nothing was converted.
+ */
+EXTERNL ut_status
+ut_convert_records(
+    const ut_conversion_plan* const	plan,
+    const double* const			in,
+    const size_t			inStride,
+    const size_t			count,
+    double* const			out,
+    const size_t			outStride,
+    const int				parallel);
+
+
+/*
+ * Frees a conversion plan.
+ *
+ * Arguments:
+ *	plan		Pointer to the plan or NULL.
+ */
+EXTERNL void
+ut_free_conversion_plan(
+    ut_conversion_plan* const	plan);
+
+
 /******************************************************************************
  * Arithmetic Unit Manipulation:
  ******************************************************************************/
@@ -1108,6 +1614,48 @@ ut_parse(
     ut_encoding		        encoding);
 
 
+/*
+ * Parses an array of strings.  The result is the same as calling ut_parse()
+ * on each string, but identical strings are parsed only once, one scanner is
+ * used for many strings, and a large number of distinct strings is divided
+ * among the threads of the library's thread-pool (see cv_set_parallelism()) if
+ * the unit-system is frozen or has no pending deferred definitions (see
+ * ut_read_xml_lazy()).  Errors are reported via the error-message handler of
+ * the calling thread.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system in which the parsing will
+ *			occur.
+ *	strings		Pointer to the strings to be parsed.  A NULL element
+ *			results in the status UT_BAD_ARG for that element.
+ *	count		The number of strings.
+ *	encoding	The encoding of the strings.
+ *	units		Pointer to the output array of "count" units.  On
+ *			return, an element is NULL if and only if the
+ *			corresponding string couldn't be parsed; otherwise,
+ *			the client should pass it to ut_free() when it's no
+ *			longer needed.
+ *	statuses	Pointer to an output array of "count" statuses, which
+ *			are those that ut_parse() would set, or NULL.
+ * Returns:
+ *	UT_SUCCESS	All strings were parsed.
+ *	UT_BAD_ARG	"system" is NULL, or "strings" or "units" is NULL and
+ *			"count" isn't zero.  Nothing was done.
+ *	UT_OS		Operating-system failure.  See "errno".  Nothing was
+ *			done.
+ *	else		The status of the first string that couldn't be
+ *			parsed.
+ */
+EXTERNL ut_status
+ut_parse_many(
+    const ut_system* const	system,
+    const char* const* const	strings,
+    const size_t		count,
+    const ut_encoding		encoding,
+    ut_unit** const		units,
+    ut_status* const		statuses);
+
+
 /*
  * Removes leading and trailing whitespace from a string.
  *
@@ -1124,6 +1672,67 @@ ut_trim(
     const ut_encoding	encoding);
 
 
+/*
+ * Sets the capacity of the parse-cache of a unit-system.  When the cache is
+ * enabled, ut_parse() returns a copy of the unit that resulted from a previous
+ * parse of an identical string with the same encoding instead of re-parsing
+ * it.  The least-recently used entry is evicted when the cache is full.  The
+ * cache is emptied whenever a name, symbol, or prefix mapping of the
+ * unit-system changes.  The cache is disabled by default.  Changing the
+ * capacity empties the cache.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	capacity	Maximum number of entries in the cache.  If zero, then
+ *			the cache is disabled.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" is NULL.
+ *	UT_OS		Operating-system failure.  See "errno".
+ */
+EXTERNL ut_status
+ut_set_parse_cache_capacity(
+    ut_system* const	system,
+    const size_t	capacity);
+
+
+/*
+ * Removes all entries from the parse-cache of a unit-system and resets its
+ * hit and miss counters.  The cache remains enabled if it was.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" is NULL.
+ */
+EXTERNL ut_status
+ut_flush_parse_cache(
+    ut_system* const	system);
+
+
+/*
+ * Returns statistics on the parse-cache of a unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	count		NULL or pointer to the number of entries in the cache.
+ *	hits		NULL or pointer to the number of times ut_parse() found
+ *			its string in the cache.
+ *	misses		NULL or pointer to the number of times ut_parse() didn't
+ *			find its string in the enabled cache.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"system" is NULL.
+ */
+EXTERNL ut_status
+ut_get_parse_cache_stats(
+    const ut_system* const	system,
+    size_t* const		count,
+    unsigned long* const	hits,
+    unsigned long* const	misses);
+
+
 /*
  * Formats a unit.
  *
@@ -1280,22 +1889,87 @@ ut_decode_time(
     double	*resolution);
 
 
+/*
+ * Decodes an array of times from double-precision values.  The result is the
+ * same as calling ut_decode_time() on each value, but faster.
+ *
+ * Arguments:
+ *      values          Pointer to the values to be decoded.
+ *      count           The number of values.
+ *      years           Pointer to the "count" years to be set.
+ *      months          Pointer to the "count" months to be set.
+ *      days            Pointer to the "count" days to be set.
+ *      hours           Pointer to the "count" hours to be set.
+ *      minutes         Pointer to the "count" minutes to be set.
+ *      seconds         Pointer to the "count" seconds to be set.
+ *      resolutions     NULL or pointer to the "count" resolutions, in
+ *                      seconds, to be set.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"count" isn't zero and a pointer other than
+ *			"resolutions" is NULL.
+ */
+EXTERNL ut_status
+ut_decode_times(
+    const double* const	values,
+    const size_t	count,
+    int* const		years,
+    int* const		months,
+    int* const		days,
+    int* const		hours,
+    int* const		minutes,
+    double* const	seconds,
+    double* const	resolutions);
+
+
+/*
+ * Encodes an array of times as double-precision values.  The result is the
+ * same as calling ut_encode_time() on each time, but faster.
+ *
+ * Arguments:
+ *	years		Pointer to the "count" years.
+ *	months		Pointer to the "count" months.
+ *	days		Pointer to the "count" days.
+ *	hours		Pointer to the "count" hours.
+ *	minutes		Pointer to the "count" minutes.
+ *	seconds		Pointer to the "count" seconds.
+ *	count		The number of times.
+ *	values		Pointer to the "count" values to be set.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"count" isn't zero and a pointer is NULL.
+ *	UT_BAD_ARG	A clock-time is invalid.  Like ut_encode_time(), the
+ *			corresponding value is just that of the date.
+ */
+EXTERNL ut_status
+ut_encode_times(
+    const int* const	years,
+    const int* const	months,
+    const int* const	days,
+    const int* const	hours,
+    const int* const	minutes,
+    const double* const	seconds,
+    const size_t	count,
+    double* const	values);
+
+
 /******************************************************************************
  * Error Handling:
  ******************************************************************************/
 
 
 /*
- * Returns the status of the last operation by the units module.  This function
- * will not change the status.
+ * Returns the status of the last operation by the units module in the current
+ * thread.  This function will not change the status.
  */
 EXTERNL ut_status
 ut_get_status(void);
 
 
 /*
- * Sets the status of the units module.  This function would not normally be
- * called by the user unless they were doing their own parsing or formatting.
+ * Sets the status of the units module in the current thread.  This function
+ * would not normally be called by the user unless they were doing their own
+ * parsing or formatting.
  *
  * Arguments:
  *	status	The status of the units module.
@@ -1324,7 +1998,9 @@ ut_handle_error_message(
 
 /*
  * Returns the previously-installed error-message handler and optionally
- * installs a new handler.  The initial handler is "ut_write_to_stderr()".
+ * installs a new handler.  The handler is used by every thread that hasn't
+ * overridden it via ut_set_thread_error_message_handler().  The initial handler
+ * is "ut_write_to_stderr()".
  *
  * Arguments:
  *      handler		NULL or pointer to the error-message handler.  If NULL,
@@ -1338,6 +2014,25 @@ ut_set_error_message_handler(
     ut_error_message_handler	handler);
 
 
+/*
+ * Returns the previous error-message handler of the current thread and
+ * installs a new one.  The handler of a thread overrides the one installed by
+ * ut_set_error_message_handler() for that thread only.
+ *
+ * Arguments:
+ *      handler		NULL or pointer to the error-message handler of the
+ *			current thread.  If NULL, then the current thread uses
+ *			the handler installed by ut_set_error_message_handler().
+ * Returns:
+ *	NULL		The current thread didn't have its own handler.
+ *	else		Pointer to the previous error-message handler of the
+ *			current thread.
+ */
+EXTERNL ut_error_message_handler
+ut_set_thread_error_message_handler(
+    ut_error_message_handler	handler);
+
+
 /*
  * Writes an error-message to the standard-error stream when received and
  * appends a newline.  This is the initial error-message handler.
@@ -1371,6 +2066,36 @@ ut_ignore(
     va_list		args);
 
 
+/******************************************************************************
+ * Statistics:
+ ******************************************************************************/
+
+
+/*
+ * Returns the hot-path statistics of the library.  The statistics are only
+ * gathered if the library was built with them; otherwise, all counts are zero
+ * and "stats->enabled" is zero.  Counts are updated atomically but aren't
+ * read as a consistent snapshot while other threads use the library.
+ *
+ * Arguments:
+ *	stats		Pointer to the statistics to be set.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"stats" is NULL.
+ */
+EXTERNL ut_status
+ut_get_stats(
+    ut_stats* const	stats);
+
+
+/*
+ * Resets all the hot-path statistics of the library to zero.  Does nothing if
+ * the library wasn't built with statistics.
+ */
+EXTERNL void
+ut_reset_stats(void);
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -13,6 +13,7 @@
 
 #include "config.h"
 
+#include "arena.h"
 #include "unitAndId.h"
 #include "udunits2.h"
 
@@ -61,7 +62,7 @@ uaiNew(
 		ut_handle_error_message("Couldn't duplicate identifier");
 	    }
 	    else {
-		entry->unit = ut_clone(unit);
+		entry->unit = arenaCloneToHeap(unit);
 
 		if (entry->unit == NULL) {
 		    assert(ut_get_status() != UT_SUCCESS);
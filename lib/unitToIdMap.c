@@ -14,29 +14,48 @@
 #include "config.h"
 
 #include "udunits2.h"
+#include "arena.h"
+#include "binaryDb.h"
+#include "frozenSystem.h"
+#include "formatCache.h"
 #include "unitAndId.h"
 #include "unitToIdMap.h"		/* this module's API */
 #include "systemMap.h"
 
 #include <assert.h>
 #include <errno.h>
-
-#ifdef _MSC_VER
-#include "tsearch.h"
-#else
-#include <search.h>
-#endif
-
 #include <stdlib.h>
 
 #include <string.h>
 
+/*
+ * The identifiers of a unit by encoding.
+ */
 typedef struct {
-    void*		ascii;
-    void*		latin1;
-    void*		utf8;
+    ut_unit*		unit;		/* the key */
+    UnitAndId*		ids[3];		/* ASCII, Latin-1, and UTF-8 entries or
+					 * NULL */
+} IdSlots;
+
+typedef struct {
+    FrozenTable		index;		/* unit -> IdSlots */
+    size_t		counts[3];	/* number of entries by encoding */
+    size_t		latin1Size;	/* size of Latin-1 identifiers */
 } UnitToIdMap;
 
+/*
+ * Frozen unit-to-identifier map.  The Latin-1 identifiers are also converted
+ * to UTF-8 so that lookups don't have to modify the map.
+ */
+struct FrozenUnitToIdMap {
+    FrozenTable		ascii;		/* unit -> UnitAndId */
+    FrozenTable		latin1;		/* unit -> UnitAndId */
+    FrozenTable		utf8;		/* unit -> UnitAndId */
+    FrozenTable		latin1AsUtf8;	/* unit -> element of "converted" */
+    UnitAndId*		converted;	/* Latin-1 entries in UTF-8 */
+    char*		utf8Ids;	/* identifiers of "converted" */
+};
+
 static SystemMap*	systemToUnitToName = NULL;
 static SystemMap*	systemToUnitToSymbol = NULL;
 
@@ -45,6 +64,41 @@ static SystemMap*	systemToUnitToSymbol = NULL;
  * Miscellaneous Functions:
  ******************************************************************************/
 
+/*
+ * Unconditionally converts an ISO Latin-1 string into a UTF-8 string in a
+ * buffer.
+ *
+ * Arguments:
+ *	latin1String	Pointer to the ISO Latin-1 string.
+ *	utf8String	Pointer to the buffer.  Must have room for twice the
+ *			number of characters in "latin1String" plus one.
+ * Returns:
+ *	Pointer to the character in "utf8String" after the terminating NUL.
+ */
+static char*
+convertLatin1ToUtf8(
+    const char* const	latin1String,
+    char* const		utf8String)
+{
+    const char*		inp;
+    char*		outp;
+
+    for (inp = latin1String, outp = utf8String; *inp; ++inp, ++outp) {
+	if ((*inp & 0x80U) == 0) {
+	    *outp = *inp;
+	}
+	else {
+	    *outp++ = (char)(0xC0U | ((unsigned char)*inp >> 6));
+	    *outp = (char)(0x80U | (*inp & 0x3FU));
+	}
+    }
+
+    *outp++ = 0;
+
+    return outp;
+}
+
+
 /*
  * Unconditionally converts an ISO Latin-1 string into a UTF-8 string.
  *
@@ -61,7 +115,6 @@ latin1ToUtf8(
 {
     int			nchar;
     const char*		inp;
-    char*		outp;
     char*		utf8String;
 
     for (nchar = 0, inp = latin1String; *inp; ++inp, ++nchar)
@@ -70,19 +123,8 @@ latin1ToUtf8(
 
     utf8String = malloc(nchar+1);
 
-    if (utf8String != NULL) {
-	for (inp = latin1String, outp = utf8String; *inp; ++inp, ++outp) {
-	    if ((*inp & 0x80U) == 0) {
-		*outp = *inp;
-	    }
-	    else {
-		*outp++ = (char)(0xC0U | ((unsigned)*inp >> 6));
-		*outp = (char)(0x80U | (*inp & 0x3FU));
-	    }
-	}
-
-	*outp = 0;
-    }
+    if (utf8String != NULL)
+	(void)convertLatin1ToUtf8(latin1String, utf8String);
 
     return utf8String;
 }
@@ -165,37 +207,41 @@ adjustEncoding(
  * Internal Map Functions:
  ******************************************************************************/
 
+/*
+ * Returns the index of the identifier slot of an encoding.
+ */
+#define SLOT(encoding) \
+    ((encoding) == UT_ASCII ? 0 : (encoding) == UT_LATIN1 ? 1 : 2)
+
+
 static int
-compareUnits(
-    const void* const	entry1,
-    const void* const	entry2)
+slotsMatch(
+    const void* const	query,
+    const void* const	key)
 {
-    return ut_compare(((const UnitAndId*)entry1)->unit,
-	((const UnitAndId*)entry2)->unit);
+    return ut_compare((const ut_unit*)query, ((const IdSlots*)key)->unit)
+	== 0;
 }
 
 
 /*
- * Selects a unit-and-identifier tree corresponding to a given encoding.
+ * Returns the identifier slots of a unit.
  *
  * Arguments:
  *	map		The unit-to-id map.
- *	encoding	The encoding.
+ *	unit		The unit.
+ *	hash		The hash-code of "unit".  See coreHashUnit().
  * Returns:
- *	Pointer to the root of the unit-and-identifier tree in "map" that
- *	corresponds to "encoding".
+ *	NULL		"map" has never contained an identifier for "unit".
+ *	else		Pointer to the identifier slots of "unit".
  */
-static void**
-selectTree(
-    UnitToIdMap* const	unitToIdMap,
-    const ut_encoding	encoding)
+static IdSlots*
+findSlots(
+    const UnitToIdMap* const	map,
+    const ut_unit* const	unit,
+    const unsigned long		hash)
 {
-    return
-	encoding == UT_ASCII
-	    ? &unitToIdMap->ascii
-	    : encoding == UT_LATIN1
-		? &unitToIdMap->latin1
-		: &unitToIdMap->utf8;
+    return ftFind(&map->index, hash, unit, slotsMatch);
 }
 
 
@@ -209,15 +255,28 @@ selectTree(
 static UnitToIdMap*
 utimNew(void)
 {
-    UnitToIdMap* const	map = malloc(sizeof(UnitToIdMap));
+    return calloc(1, sizeof(UnitToIdMap));
+}
 
-    if (map != NULL) {
-	map->ascii = NULL;
-	map->latin1 = NULL;
-	map->utf8 = NULL;
-    }
 
-    return map;
+/*
+ * Frees the identifier slots of a unit and their entries.
+ */
+static void
+freeSlots(
+    const void* const	key,
+    void* const		value)
+{
+    IdSlots* const	slots = (IdSlots*)value;
+    int			i;
+
+    (void)key;
+
+    for (i = 0; i < 3; i++)
+	uaiFree(slots->ids[i]);
+
+    ut_free(slots->unit);
+    free(slots);
 }
 
 
@@ -232,20 +291,8 @@ utimFree(
     UnitToIdMap*	map)
 {
     if (map != NULL) {
-	ut_encoding	encodings[] = {UT_ASCII, UT_LATIN1, UT_UTF8};
-	int		i;
-
-	for (i = 0; i < sizeof(encodings)/sizeof(encodings[0]); ++i) {
-	    void**	rootp = selectTree(map, encodings[i]);
-
-	    while (*rootp != NULL) {
-		UnitAndId*	uai = **(UnitAndId***)rootp;
-
-		(void)tdelete(uai, rootp, compareUnits);
-		uaiFree(uai);
-	    }
-	}
-
+	ftForEach(&map->index, freeSlots);
+	ftDestroy(&map->index);
 	free(map);
     }
 }
@@ -284,38 +331,58 @@ utimAdd(
 	ut_handle_error_message("Identifier not in given encoding");
     }
     else {
-	UnitAndId*	targetEntry = uaiNew(unit, id);
+	const unsigned long	hash = coreHashUnit(unit);
+	IdSlots*		slots = findSlots(map, unit, hash);
 
-	if (targetEntry == NULL) {
-            status = ut_get_status();
-        }
-        else {
-	    void**	rootp = selectTree(map, encoding);
+	status = UT_SUCCESS;
 
-	    UnitAndId**	treeEntry = tsearch(targetEntry, rootp, compareUnits);
+	if (slots == NULL) {
+	    slots = calloc(1, sizeof(IdSlots));
 
-	    if (treeEntry == NULL) {
+	    if (slots != NULL) {
+		slots->unit = arenaCloneToHeap(unit);
+
+		if (slots->unit == NULL ||
+			ftAdd(&map->index, hash, slots, slots) != 0) {
+		    ut_free(slots->unit);
+		    free(slots);
+		    slots = NULL;
+		}
+	    }
+
+	    if (slots == NULL) {
 		status = UT_OS;
-                ut_set_status(status);
+		ut_set_status(status);
 		ut_handle_error_message(strerror(errno));
-		ut_handle_error_message("Couldn't add search-tree entry");
-		uaiFree(targetEntry);
+		ut_handle_error_message("Couldn't add unit-to-identifier entry");
 	    }
-	    else {
-		if (strcmp((*treeEntry)->id, id) != 0) {
+	}
+
+	if (slots != NULL) {
+	    UnitAndId** const	entry = slots->ids + SLOT(encoding);
+
+	    if (*entry != NULL) {
+		if (strcmp((*entry)->id, id) != 0) {
 		    status = UT_EXISTS;
-                    ut_set_status(status);
+		    ut_set_status(status);
 		    ut_handle_error_message("Unit already maps to \"%s\"",
-			(*treeEntry)->id);
+			(*entry)->id);
 		}
-		else {
-		    status = UT_SUCCESS;
+	    }
+	    else {
+		*entry = uaiNew(unit, id);
+
+		if (*entry == NULL) {
+		    status = ut_get_status();
 		}
+		else {
+		    map->counts[SLOT(encoding)]++;
 
-                if (targetEntry != *treeEntry)
-                    uaiFree(targetEntry);
+		    if (encoding == UT_LATIN1)
+			map->latin1Size += strlen(id) + 1;
+		}
 	    }
-	}				/* "targetEntry" allocated */
+	}				/* have identifier slots */
     }					/* valid arguments */
 
     return status;
@@ -323,7 +390,8 @@ utimAdd(
 
 
 /*
- * Removes an entry from a unit-to-identifier map.
+ * Removes an entry from a unit-to-identifier map.  The identifier slots of the
+ * unit are kept for when it's mapped again.
  *
  * Arguments:
  *	map		Pointer to the unit-to-identifier map.
@@ -338,148 +406,93 @@ utimRemove(
     const ut_unit*	unit,
     ut_encoding		encoding)
 {
-    UnitAndId		targetEntry;
-    UnitAndId**		treeEntry;
+    IdSlots*	slots;
 
     assert(map != NULL);
     assert(unit != NULL);
 
-    targetEntry.unit = (ut_unit*)unit;
-    treeEntry = tfind(&targetEntry, selectTree(map, encoding), compareUnits);
-
-    if (treeEntry != NULL && *treeEntry != NULL) {
-	UnitAndId*	uai = *treeEntry;
-
-	(void)tdelete(uai, selectTree(map, encoding), compareUnits);
-	uaiFree(uai);
-    }
-
-    return UT_SUCCESS;
-}
+    slots = findSlots(map, unit, coreHashUnit(unit));
 
+    if (slots != NULL && slots->ids[SLOT(encoding)] != NULL) {
+	UnitAndId** const	entry = slots->ids + SLOT(encoding);
 
-/*
- * Returns the unit-and-identifier whose ASCII identifier corresponding to a
- * unit.
- *
- * Arguments:
- *	map	The unit-to-identifier map.
- *	unit	The unit to be used as the key in the search.
- * Returns:
- *	NULL	The map doesn't contain an entry corresponding to "unit" whose
- *		identifier is in ASCII.
- *	else	Pointer to the entry corresponding to "unit" whose identifier is
- *		in ASCII.
- */
-static UnitAndId*
-utimFindAsciiByUnit(
-    UnitToIdMap* const	map,
-    const ut_unit* const	unit)
-{
-    UnitAndId	targetEntry;
-    UnitAndId**	treeEntry;
+	map->counts[SLOT(encoding)]--;
 
-    targetEntry.unit = (ut_unit*)unit;
-    treeEntry = tfind(&targetEntry, &map->ascii, compareUnits);
+	if (encoding == UT_LATIN1)
+	    map->latin1Size -= strlen((*entry)->id) + 1;
 
-    return treeEntry == NULL ? NULL : *treeEntry;
-}
-
-
-/*
- * Finds a unit-search-entry with a Latin-1 identifier correcponding to a unit.
- *
- * Arguments:
- *	map	The unit-to-identifier map.
- *	unit	The unit to be used as the key in the search.
- * Returns:
- *	NULL	The map doesn't contain an entry corresponding to "unit" whose
- *		identifier is in Latin-1.
- *	else	Pointer to the entry corresponding to "unit" whose identifier is
- *		in Latin-1 (and might, actually, be in ASCII).
- */
-static UnitAndId*
-utimFindLatin1ByUnit(
-    UnitToIdMap* const	map,
-    const ut_unit* const	unit)
-{
-    UnitAndId	targetEntry;
-    UnitAndId**	treeEntry;
-
-    targetEntry.unit = (ut_unit*)unit;
-    treeEntry = tfind(&targetEntry, &map->latin1, compareUnits);
-
-    if (treeEntry == NULL)
-	treeEntry = tfind(&targetEntry, &map->ascii, compareUnits);
+	uaiFree(*entry);
+	*entry = NULL;
+    }
 
-    return treeEntry == NULL ? NULL : *treeEntry;
+    return UT_SUCCESS;
 }
 
 
 /*
- * Finds an entry with a UTF-8 identifier corresponding to a unit.
+ * Returns the entry of a unit-to-identifier map whose identifier is in a
+ * given encoding and corresponds to a unit.  An ASCII identifier is also in
+ * Latin-1 and UTF-8.  The UTF-8 version of a Latin-1 identifier is created
+ * and added to the map the first time it's needed.  The unit is located by a
+ * single probe of a hash table.
  *
  * Arguments:
- *	map	The unit-to-identifier map.
- *	unit	The unit to be used as the key in the search.
+ *	map		The unit-to-identifier map.
+ *	unit		The unit to be used as the key in the search.
+ *	encoding	The encoding of the identifier.
  * Returns:
- *	NULL	The map doesn't contain an entry corresponding to "unit" whose
- *		identifier is in UTF-8.
- *	else	Pointer to the entry corresponding to "unit" whose identifier is
- *		in UTF-8 (and might, actually, be in ASCII).
+ *	NULL		The map doesn't contain an entry corresponding to
+ *			"unit" whose identifier is in the given encoding.
+ *	else		Pointer to the entry corresponding to "unit" whose
+ *			identifier is in the given encoding.
  */
 static UnitAndId*
-utimFindUtf8ByUnit(
-    UnitToIdMap* const	        map,
-    const ut_unit* const	unit)
+utimFindByUnit(
+    UnitToIdMap* const		map,
+    const ut_unit* const	unit,
+    const ut_encoding		encoding)
 {
-    UnitAndId	targetEntry;
-    UnitAndId**	treeEntry = NULL;	/* failure */
-
-    targetEntry.unit = (ut_unit*)unit;
-    treeEntry = tfind(&targetEntry, &map->utf8, compareUnits);
-
-    if (treeEntry == NULL) {
-	treeEntry = tfind(&targetEntry, &map->latin1, compareUnits);
-
-	if (treeEntry == NULL) {
-	    treeEntry = tfind(&targetEntry, &map->ascii, compareUnits);
-	}
-	else {
-	    /*
-	     * Create the UTF-8 version of the Latin-1 identifier and add it to
-	     * the UTF-8 unit-to-id map so that it will be found next time.
-	     */
-	    char* const	id = latin1ToUtf8((*treeEntry)->id);
-
-	    if (id == NULL) {
-		ut_set_status(UT_OS);
-		ut_handle_error_message(strerror(errno));
-		ut_handle_error_message(
-		    "Couldn't convert identifier from ISO-8859-1 to UTF-8");
-		treeEntry = NULL;
-	    }
-	    else {
-		UnitAndId*	newEntry = uaiNew(unit, id);
-
-		if (newEntry != NULL) {
-		    treeEntry = tsearch(newEntry, &map->utf8, compareUnits);
+    IdSlots* const	slots = findSlots(map, unit, coreHashUnit(unit));
+    UnitAndId*		entry = NULL;
+
+    if (slots != NULL) {
+	if (encoding == UT_UTF8) {
+	    entry = slots->ids[2];
+
+	    if (entry == NULL && slots->ids[1] != NULL) {
+		/*
+		 * Create the UTF-8 version of the Latin-1 identifier and add
+		 * it to the map so that it will be found next time.
+		 */
+		char* const	id = latin1ToUtf8(slots->ids[1]->id);
+
+		if (id == NULL) {
+		    ut_set_status(UT_OS);
+		    ut_handle_error_message(strerror(errno));
+		    ut_handle_error_message(
+			"Couldn't convert identifier from ISO-8859-1 to UTF-8");
+		}
+		else {
+		    entry = uaiNew(slots->unit, id);
 
-		    if (treeEntry == NULL) {
-			uaiFree(newEntry);
-			ut_set_status(UT_OS);
-			ut_handle_error_message(strerror(errno));
-			ut_handle_error_message(
-                            "Couldn't add unit-and-identifier to search-tree");
+		    if (entry != NULL) {
+			slots->ids[2] = entry;
+			map->counts[2]++;
 		    }
+
+		    free(id);
 		}
+	    }
+	}
+	else if (encoding == UT_LATIN1) {
+	    entry = slots->ids[1];
+	}
 
-		free(id);
-	    }				/* UTF-8 identifier created */
-	}				/* found Latin-1 identifier */
-    }					/* no UTF-8 identifier */
+	if (entry == NULL)
+	    entry = slots->ids[0];
+    }
 
-    return treeEntry == NULL ? NULL : *treeEntry;
+    return entry;
 }
 
 
@@ -495,6 +508,7 @@ utimFindUtf8ByUnit(
  * Returns:
  *	UT_BAD_ARG	"unit" or "id" is NULL, or "id" is inconsistent with
  *                      "encoding".
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_OS		Operating-system error.  See "errno".
  *	UT_EXISTS	"unit" already maps to a different identifier.
  *	UT_SUCCESS	Success.
@@ -513,6 +527,11 @@ mapUnitToId(
     if (unit == NULL || id == NULL) {
 	status = UT_BAD_ARG;
     }
+    else if (coreGetFrozen(ut_get_system(unit)) != NULL) {
+	status = UT_FROZEN;
+	ut_set_status(status);
+	ut_handle_error_message("Unit-system is frozen");
+    }
     else {
 	if (*systemMap == NULL) {
 	    *systemMap = smNew();
@@ -536,8 +555,10 @@ mapUnitToId(
 			status = UT_OS;
 		}
 
-		if (*unitToIdMap != NULL)
+		if (*unitToIdMap != NULL) {
 		    status = utimAdd(*unitToIdMap, unit, id, encoding);
+		    fcInvalidate();
+		}
 	    }
 	}
     }
@@ -557,6 +578,7 @@ mapUnitToId(
  * Returns:
  *	UT_BAD_ARG	"systemMap" is NULL.
  *	UT_BAD_ARG	"unit" is NULL.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_SUCCESS	Success.
  */
 static ut_status
@@ -570,6 +592,11 @@ unmapUnitToId(
     if (systemMap == NULL || unit == NULL) {
 	status = UT_BAD_ARG;
     }
+    else if (coreGetFrozen(ut_get_system(unit)) != NULL) {
+	status = UT_FROZEN;
+	ut_set_status(status);
+	ut_handle_error_message("Unit-system is frozen");
+    }
     else {
 	UnitToIdMap** const	unitToIdMap =
 	    (UnitToIdMap**)smFind(systemMap, ut_get_system(unit));
@@ -578,18 +605,75 @@ unmapUnitToId(
 	    (unitToIdMap == NULL || *unitToIdMap == NULL)
 		? UT_SUCCESS
 		: utimRemove(*unitToIdMap, unit, encoding);
+
+	fcInvalidate();
     }
 
     return status;
 }
 
 
+static int
+unitMatches(
+    const void* const	query,
+    const void* const	key)
+{
+    return ut_compare((const ut_unit*)query, (const ut_unit*)key) == 0;
+}
+
+
+/*
+ * Returns the identifier in a given encoding to which a unit maps in a frozen
+ * unit-to-identifier map.
+ *
+ * Arguments:
+ *	map		Pointer to the frozen unit-to-identifier map.
+ *	unit		Pointer to the unit whose identifier should be returned.
+ *	encoding	The desired encoding of the identifier.
+ * Returns:
+ *	NULL		"map" doesn't contain an identifier for "unit" in the
+ *			given encoding.
+ *	else		Pointer to the identifier in the given encoding
+ *			associated with "unit".
+ */
+static const char*
+getFrozenId(
+    const FrozenUnitToIdMap* const	map,
+    const ut_unit* const		unit,
+    const ut_encoding			encoding)
+{
+    const unsigned long	hash = coreHashUnit(unit);
+    const UnitAndId*	uai = NULL;
+
+    if (encoding == UT_UTF8) {
+	uai = ftFind(&map->utf8, hash, unit, unitMatches);
+
+	if (uai == NULL)
+	    uai = ftFind(&map->latin1AsUtf8, hash, unit, unitMatches);
+    }
+    else if (encoding == UT_LATIN1) {
+	uai = ftFind(&map->latin1, hash, unit, unitMatches);
+    }
+
+    if (uai == NULL)
+	uai = ftFind(&map->ascii, hash, unit, unitMatches);
+
+    return uai == NULL ? NULL : uai->id;
+}
+
+
 /*
  * Returns the identifier in a given encoding to which a unit associated with
  * a unit-system maps.
  *
  * Arguments:
  *	systemMap	Pointer to the system-to-unit-to-id map.
+ *	frozenMap	Pointer to the frozen map that corresponds to
+ *			"systemMap" or NULL if the unit-system of "unit" isn't
+ *			frozen.
+ *	db		Pointer to the binary unit-database from which the
+ *			unit-system of "unit" was mapped or NULL.
+ *	type		The type of the identifier in "db".
  *	unit		Pointer to the unit whose identifier should be returned.
  *	encoding	The desired encoding of the identifier.
  * Returns:
@@ -600,9 +684,12 @@ unmapUnitToId(
  */
 static const char*
 getId(
-    SystemMap* const	systemMap,
-    const ut_unit* const	unit,
-    const ut_encoding	encoding)
+    SystemMap* const			systemMap,
+    const FrozenUnitToIdMap* const	frozenMap,
+    const BinaryDb* const		db,
+    const BdbIdType			type,
+    const ut_unit* const		unit,
+    const ut_encoding			encoding)
 {
     const char*	id = NULL;		/* failure */
 
@@ -610,17 +697,18 @@ getId(
 	ut_set_status(UT_BAD_ARG);
 	ut_handle_error_message("NULL unit argument");
     }
+    else if (db != NULL) {
+	id = bdbGetId(db, type, unit, encoding);
+    }
+    else if (frozenMap != NULL) {
+	id = getFrozenId(frozenMap, unit, encoding);
+    }
     else {
 	UnitToIdMap** const	unitToId =
 	    (UnitToIdMap**)smFind(systemMap, ut_get_system(unit));
 
 	if (unitToId != NULL) {
-	    UnitAndId*	mapEntry =
-		encoding == UT_LATIN1
-		    ? utimFindLatin1ByUnit(*unitToId, unit)
-		    : encoding == UT_UTF8
-			? utimFindUtf8ByUnit(*unitToId, unit)
-			: utimFindAsciiByUnit(*unitToId, unit);
+	    UnitAndId*	mapEntry = utimFindByUnit(*unitToId, unit, encoding);
 
 	    if (mapEntry != NULL)
 		id = mapEntry->id;
@@ -649,6 +737,7 @@ getId(
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"unit" or "name" is NULL, or "name" is not in the
  *                      specified encoding.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_OS		Operating-system error.  See "errno".
  *	UT_EXISTS	"unit" already maps to a name.
  */
@@ -673,6 +762,7 @@ ut_map_unit_to_name(
  *			removed.
  * Returns:
  *	UT_BAD_ARG	"unit" is NULL.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_SUCCESS	Success.
  */
 ut_status
@@ -698,6 +788,7 @@ ut_unmap_unit_to_name(
  * Returns:
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"unit" or "symbol" is NULL.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  *	UT_OS		Operating-system error.  See "errno".
  *	UT_EXISTS	"unit" already maps to a symbol.
  */
@@ -724,6 +815,7 @@ ut_map_unit_to_symbol(
  * Returns:
  *	UT_SUCCESS	Success.
  *	UT_BAD_ARG	"unit" is NULL.
+ *	UT_FROZEN	The unit-system of "unit" is frozen.
  */
 ut_status
 ut_unmap_unit_to_symbol(
@@ -755,9 +847,14 @@ ut_get_name(
     const ut_unit* const	unit,
     const ut_encoding	encoding)
 {
+    const FrozenSystem* const	frozen =
+	unit == NULL ? NULL : coreGetFrozen(ut_get_system(unit));
+
     ut_set_status(UT_SUCCESS);
 
-    return getId(systemToUnitToName, unit, encoding);
+    return getId(systemToUnitToName,
+	frozen == NULL ? NULL : frozen->unitToName,
+	frozen == NULL ? NULL : frozen->binaryDb, BDB_NAME, unit, encoding);
 }
 
 
@@ -780,9 +877,14 @@ ut_get_symbol(
     const ut_unit* const	unit,
     const ut_encoding	encoding)
 {
+    const FrozenSystem* const	frozen =
+	unit == NULL ? NULL : coreGetFrozen(ut_get_system(unit));
+
     ut_set_status(UT_SUCCESS);
 
-    return getId(systemToUnitToSymbol, unit, encoding);
+    return getId(systemToUnitToSymbol,
+	frozen == NULL ? NULL : frozen->unitToSymbol,
+	frozen == NULL ? NULL : frozen->binaryDb, BDB_SYMBOL, unit, encoding);
 }
 
 
@@ -817,3 +919,303 @@ utimFreeSystem(
 	}
     }
 }
+
+
+/*
+ * Returns the unit-to-identifier map of a unit-system.
+ *
+ * Arguments:
+ *	systemMap	NULL or pointer to the system-to-unit-to-identifier map.
+ *	system		Pointer to the unit-system.
+ * Returns:
+ *	NULL		"system" doesn't have a unit-to-identifier map.
+ *	else		Pointer to the unit-to-identifier map of "system".
+ */
+static UnitToIdMap*
+getMap(
+    const SystemMap* const	systemMap,
+    const ut_system* const	system)
+{
+    UnitToIdMap**	unitToId =
+	systemMap == NULL ? NULL : (UnitToIdMap**)smFind(systemMap, system);
+
+    return unitToId == NULL ? NULL : *unitToId;
+}
+
+
+static void
+freeEntry(
+    const void* const	key,
+    void* const		value)
+{
+    (void)key;
+    uaiFree((UnitAndId*)value);
+}
+
+
+static void
+futimFree(
+    FrozenUnitToIdMap* const	frozen)
+{
+    if (frozen != NULL) {
+	ftForEach(&frozen->ascii, freeEntry);
+	ftForEach(&frozen->latin1, freeEntry);
+	ftForEach(&frozen->utf8, freeEntry);
+	ftDestroy(&frozen->ascii);
+	ftDestroy(&frozen->latin1);
+	ftDestroy(&frozen->utf8);
+	ftDestroy(&frozen->latin1AsUtf8);
+	free(frozen->converted);
+	free(frozen->utf8Ids);
+	free(frozen);
+    }
+}
+
+
+/*
+ * Returns a new, empty, frozen unit-to-identifier map.
+ *
+ * Arguments:
+ *	map		Pointer to the unit-to-identifier map to be frozen or
+ *			NULL.
+ * Returns:
+ *	NULL		Failure.  See "errno".
+ *	else		Pointer to a frozen map with room for all the entries of
+ *			"map".
+ */
+static FrozenUnitToIdMap*
+futimNew(
+    const UnitToIdMap* const	map)
+{
+    FrozenUnitToIdMap*	frozen = calloc(1, sizeof(FrozenUnitToIdMap));
+
+    if (frozen != NULL) {
+	const size_t	latin1Count = map == NULL ? 0 : map->counts[1];
+	const size_t	latin1Size = map == NULL ? 0 : map->latin1Size;
+
+	frozen->converted = malloc((latin1Count + 1) * sizeof(UnitAndId));
+	frozen->utf8Ids = malloc(2 * latin1Size + 1);
+
+	if (frozen->converted == NULL || frozen->utf8Ids == NULL ||
+		ftInit(&frozen->ascii, map == NULL ? 0 : map->counts[0]) ||
+		ftInit(&frozen->latin1, latin1Count) ||
+		ftInit(&frozen->utf8, map == NULL ? 0 : map->counts[2]) ||
+		ftInit(&frozen->latin1AsUtf8, latin1Count)) {
+	    futimFree(frozen);
+	    frozen = NULL;
+	}
+    }
+
+    return frozen;
+}
+
+
+/*
+ * Adds the UTF-8 forms of the Latin-1 entries of a frozen unit-to-identifier
+ * map to the map.
+ *
+ * Arguments:
+ *	frozen		Pointer to the frozen map.
+ */
+static void
+futimConvertLatin1(
+    FrozenUnitToIdMap* const	frozen)
+{
+    char*	utf8Id = frozen->utf8Ids;
+    size_t	i;
+
+    for (i = 0; i <= frozen->latin1.mask; i++) {
+	const FrozenSlot* const	slot = frozen->latin1.slots + i;
+
+	if (slot->key != NULL) {
+	    const UnitAndId* const	uai = (const UnitAndId*)slot->value;
+	    UnitAndId* const	converted =
+		frozen->converted + frozen->latin1AsUtf8.count;
+
+	    converted->unit = uai->unit;
+	    converted->id = utf8Id;
+	    utf8Id = convertLatin1ToUtf8(uai->id, utf8Id);
+
+	    ftInsert(&frozen->latin1AsUtf8, slot->hash, converted->unit,
+		converted);
+	}
+    }
+}
+
+
+/*
+ * Moves the entries of a unit-to-identifier map into a frozen map.
+ *
+ * Arguments:
+ *	map		Pointer to the unit-to-identifier map or NULL.  Will be
+ *			empty on return.
+ *	frozen		Pointer to the frozen map.
+ */
+static void
+futimFill(
+    UnitToIdMap* const		map,
+    FrozenUnitToIdMap* const	frozen)
+{
+    if (map != NULL) {
+	FrozenTable* const	tables[3] =
+	    {&frozen->ascii, &frozen->latin1, &frozen->utf8};
+	size_t			i;
+
+	/*
+	 * The entries are moved into the frozen tables of their encodings.
+	 */
+	for (i = 0; map->index.slots != NULL && i <= map->index.mask; i++) {
+	    const FrozenSlot* const	slot = map->index.slots + i;
+
+	    if (slot->key != NULL) {
+		IdSlots* const	slots = (IdSlots*)slot->value;
+		int		j;
+
+		for (j = 0; j < 3; j++) {
+		    UnitAndId* const	uai = slots->ids[j];
+
+		    if (uai != NULL)
+			ftInsert(tables[j], slot->hash, uai->unit, uai);
+
+		    slots->ids[j] = NULL;
+		}
+
+		freeSlots(slot->key, slots);
+	    }
+	}
+
+	ftDestroy(&map->index);
+	(void)memset(&map->index, 0, sizeof(map->index));
+
+	futimConvertLatin1(frozen);
+
+	map->counts[0] = map->counts[1] = map->counts[2] = 0;
+	map->latin1Size = 0;
+    }
+}
+
+
+/*
+ * Copies the entries of a unit-to-identifier map into a frozen map.
+ *
+ * Arguments:
+ *	map		Pointer to the unit-to-identifier map or NULL.
+ *	frozen		Pointer to the frozen map.
+ * Returns:
+ *	0		Success.
+ *	-1		Failure.  "ut_get_status()" will be UT_OS.  The entries
+ *			that were copied should be freed with the frozen map.
+ */
+static int
+futimCopy(
+    const UnitToIdMap* const	map,
+    FrozenUnitToIdMap* const	frozen)
+{
+    int		status = 0;
+
+    if (map != NULL) {
+	FrozenTable* const	tables[3] =
+	    {&frozen->ascii, &frozen->latin1, &frozen->utf8};
+	size_t			i;
+
+	for (i = 0; status == 0 && map->index.slots != NULL &&
+		i <= map->index.mask; i++) {
+	    const FrozenSlot* const	slot = map->index.slots + i;
+
+	    if (slot->key != NULL) {
+		const IdSlots* const	slots = (const IdSlots*)slot->value;
+		int			j;
+
+		for (j = 0; status == 0 && j < 3; j++) {
+		    const UnitAndId* const	uai = slots->ids[j];
+
+		    if (uai != NULL) {
+			UnitAndId* const	copy =
+			    uaiNew(uai->unit, uai->id);
+
+			if (copy == NULL) {
+			    status = -1;
+			}
+			else {
+			    ftInsert(tables[j], slot->hash, copy->unit, copy);
+			}
+		    }
+		}
+	    }
+	}
+
+	if (status == 0)
+	    futimConvertLatin1(frozen);
+    }
+
+    return status;
+}
+
+
+ut_status
+utimAllocFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen)
+{
+    frozen->unitToName = futimNew(getMap(systemToUnitToName, system));
+    frozen->unitToSymbol = futimNew(getMap(systemToUnitToSymbol, system));
+
+    return frozen->unitToName == NULL || frozen->unitToSymbol == NULL
+	? UT_OS
+	: UT_SUCCESS;
+}
+
+
+void
+utimFillFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen)
+{
+    futimFill(getMap(systemToUnitToName, system), frozen->unitToName);
+    futimFill(getMap(systemToUnitToSymbol, system), frozen->unitToSymbol);
+}
+
+
+ut_status
+utimCopyFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen)
+{
+    return futimCopy(getMap(systemToUnitToName, system), frozen->unitToName)
+	    || futimCopy(getMap(systemToUnitToSymbol, system),
+		frozen->unitToSymbol)
+	? UT_OS
+	: UT_SUCCESS;
+}
+
+
+void
+utimFreeFrozen(
+    FrozenSystem* const	frozen)
+{
+    futimFree(frozen->unitToName);
+    futimFree(frozen->unitToSymbol);
+    frozen->unitToName = NULL;
+    frozen->unitToSymbol = NULL;
+}
+
+
+const FrozenTable*
+utimGetFrozenTable(
+    const FrozenUnitToIdMap* const	frozen,
+    const ut_encoding			encoding)
+{
+    return encoding == UT_LATIN1
+	? &frozen->latin1
+	: encoding == UT_UTF8
+	    ? &frozen->utf8
+	    : &frozen->ascii;
+}
+
+
+const FrozenTable*
+utimGetFrozenLatin1AsUtf8Table(
+    const FrozenUnitToIdMap* const	frozen)
+{
+    return &frozen->latin1AsUtf8;
+}
@@ -8,6 +8,9 @@
 #ifndef UT_UNIT_TO_ID_MAP_H_INCLUDED
 #define UT_UNIT_TO_ID_MAP_H_INCLUDED
 
+#include "udunits2.h"
+#include "frozenSystem.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -25,6 +28,97 @@ utimFreeSystem(
     ut_system*	system);
 
 
+/*
+ * Allocates the frozen unit-to-name and unit-to-symbol maps of a unit-system.
+ * The maps are empty but have room for all the entries of the unit-system.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	frozen		Pointer to the frozen maps of "system".
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_OS		Operating-system failure.  See "errno".  The maps that
+ *			were allocated should be freed by utimFreeFrozen().
+ */
+ut_status
+utimAllocFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen);
+
+
+/*
+ * Moves the entries of the unit-to-name and unit-to-symbol maps of a
+ * unit-system into its frozen maps, which must have been allocated by
+ * utimAllocFrozen().
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	frozen		Pointer to the frozen maps of "system".
+ */
+void
+utimFillFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen);
+
+
+/*
+ * Copies the entries of the unit-to-name and unit-to-symbol maps of a
+ * unit-system into frozen maps, which must have been allocated by
+ * utimAllocFrozen().  The unit-system isn't modified.
+ *
+ * Arguments:
+ *	system		Pointer to the unit-system.
+ *	frozen		Pointer to the frozen maps.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_OS		Operating-system failure.  See "errno".  The entries
+ *			that were copied are freed by utimFreeFrozen().
+ */
+ut_status
+utimCopyFrozen(
+    const ut_system* const	system,
+    FrozenSystem* const		frozen);
+
+
+/*
+ * Frees the frozen unit-to-name and unit-to-symbol maps of a unit-system.
+ *
+ * Arguments:
+ *	frozen		Pointer to the frozen maps.
+ */
+void
+utimFreeFrozen(
+    FrozenSystem* const	frozen);
+
+
+/*
+ * Returns a hash table of a frozen unit-to-identifier map.  The keys of the
+ * table are the units and the values are pointers to UnitAndId-s.  Only the
+ * identifiers that were mapped in the given encoding are in the table.
+ *
+ * Arguments:
+ *	frozen		Pointer to the frozen map.
+ *	encoding	The encoding of the identifiers.
+ */
+const FrozenTable*
+utimGetFrozenTable(
+    const FrozenUnitToIdMap* const	frozen,
+    const ut_encoding			encoding);
+
+
+/*
+ * Returns the hash table of a frozen unit-to-identifier map whose values are
+ * the Latin-1 identifiers converted to UTF-8.  The keys of the table are the
+ * units and the values are pointers to UnitAndId-s.
+ *
+ * Arguments:
+ *	frozen		Pointer to the frozen map.
+ */
+const FrozenTable*
+utimGetFrozenLatin1AsUtf8Table(
+    const FrozenUnitToIdMap* const	frozen);
+
+
 #ifdef __cplusplus
 }
 #endif
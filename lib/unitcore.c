@@ -38,7 +38,13 @@
 #include "config.h"
 
 #include "udunits2.h"		/* this module's API */
+#include "arena.h"
 #include "converter.h"
+#include "converterCache.h"
+#include "formatCache.h"
+#include "binaryDb.h"
+#include "frozenSystem.h"
+#include "stats.h"
 
 #include <assert.h>
 #include <ctype.h>
@@ -89,6 +95,7 @@ struct ut_system {
     ut_unit*		one;		/* the dimensionless-unit one */
     BasicUnit**		basicUnits;
     int			basicCount;
+    FrozenSystem*	frozen;		/* frozen maps or NULL */
 };
 
 typedef struct {
@@ -124,6 +131,25 @@ typedef enum {
 #undef	MAX
 #define	MAX(a,b)	((a) > (b) ? (a) : (b))
 
+/*
+ * Maximum number of basic-units in a product that's computed without
+ * allocating memory.
+ */
+#define PRODUCT_LOCAL_COUNT	32
+
+/*
+ * Maximum number of basic-units of a product-unit that are stored in the
+ * unit itself rather than in separately-allocated arrays.  Enough for any
+ * product of the SI base-units and the radian.
+ */
+#define PRODUCT_INLINE_COUNT	8
+
+/*
+ * Number of basic-units whose powers can be packed into the dimension
+ * signature of a product-unit: one byte each.  See productInitDimension().
+ */
+#define DIMENSION_PACKED_COUNT	8
+
 #define GET_PRODUCT(unit) \
 			((unit)->common.ops->getProduct(unit))
 #define CLONE(unit)	((unit)->common.ops->clone(unit))
@@ -151,20 +177,32 @@ typedef struct {
     UnitType		type;
     cv_converter*	toProduct;
     cv_converter*	fromProduct;
+    void*		formatCache;	/* see formatCache.c */
 } Common;
 
-struct BasicUnit {
-    Common		common;
-    ProductUnit*	product;		/* equivalent product-unit */
-    int			index;			/* system->basicUnits index */
-    int			isDimensionless;
-};
-
 struct ProductUnit {
     Common		common;
     short*		indexes;
     short*		powers;
     int			count;
+    /*
+     * Indexes followed by powers if "count <= PRODUCT_INLINE_COUNT"
+     */
+    short		pairs[2*PRODUCT_INLINE_COUNT];
+    /*
+     * Signatures of the powers of the dimensionful basic-units of the unit
+     * and of its reciprocal.  See productInitDimension().
+     */
+    unsigned long long	dimension;
+    unsigned long long	inverseDimension;
+    int			isPacked;	/* signatures are exact */
+};
+
+struct BasicUnit {
+    Common		common;
+    ProductUnit		product;		/* equivalent product-unit */
+    int			index;			/* system->basicUnits index */
+    int			isDimensionless;
 };
 
 typedef struct {
@@ -214,13 +252,17 @@ static bool areAlmostEqual(
  * The following function are declared here because they are used in the
  * basic-unit section  before they are defined in the product-unit section.
  */
-static ProductUnit*	productNew(
+static int		productInit(
+    ProductUnit* const		productUnit,
     ut_system* const		system,
     const short* const		indexes,
     const short* const		powers,
     const int			count);
-static void		productFree(
-    ut_unit* const		unit);
+static void		productDestroy(
+    ProductUnit* const		productUnit);
+static void		productInitDimension(
+    ProductUnit* const		productUnit,
+    const int			newIsDimensionless);
 static ut_unit*		productMultiply(
     const ut_unit* const	unit1,
     const ut_unit* const	unit2);
@@ -231,6 +273,14 @@ static ut_unit*		productRoot(
     const ut_unit* const	unit,
     const int			root);
 
+/*
+ * The following function is declared here because it's used in the
+ * timestamp-unit section before it's defined.
+ */
+static cv_converter*	getConverter(
+    ut_unit* const		from,
+    ut_unit* const		to);
+
 
 /*
  * The following two functions convert between Julian day number and
@@ -368,21 +418,120 @@ gregorianDateToJulianDay(year, month, day)
 }
 
 /*
- * Returns the Julian day number that is the origin of all things temporal in
- * this module.
- *
- * Returns:
- *      The Julian day number that is the origin for time in this module.
+ * The Julian day number that is the origin of all things temporal in this
+ * module: gregorianDateToJulianDay(2001, 1, 1).
  */
+#define JULDAY_ORIGIN		2451911L
+
+/*
+ * The first day of the Gregorian calendar as "day + 31*(month + 12*year)" and
+ * as a Julian day number.
+ */
+#define GREGORIAN_START_DATE	(15 + 31 * (10 + (12 * 1582)))
+#define GREGORIAN_START_JULDAY	2299161L
+
+/*
+ * The ranges of Julian day numbers and years for which the integer-arithmetic
+ * calendar functions below are used.  Within them, they agree with
+ * julianDayToGregorianDate() and gregorianDateToJulianDay(), which are used
+ * outside them.
+ */
+#define FAST_JULDAY_MIN		0L
+#define FAST_JULDAY_MAX		100000000L
+#define FAST_YEAR_MIN		(-4800)
+#define FAST_YEAR_MAX		100000
+#define FAST_DAY_MAX		1000000
+
+
+/*
+ * Converts a Julian day number in [FAST_JULDAY_MIN, FAST_JULDAY_MAX] to a
+ * Gregorian/Julian date using only integer arithmetic with no branches, so
+ * that loops over it can be vectorized.
+ */
+static inline void
+fastJulianDayToDate(
+    const int32_t	julday,
+    int* const		year,
+    int* const		month,
+    int* const		day)
+{
+    const int32_t	isGregorian = julday >= GREGORIAN_START_JULDAY;
+    const int32_t	a = julday + (isGregorian ? 32044 : 32082);
+    const int32_t	b = isGregorian ? (4*a + 3) / 146097 : 0;
+    const int32_t	c = a - (146097*b) / 4;
+    const int32_t	d = (4*c + 3) / 1461;
+    const int32_t	e = c - (1461*d) / 4;
+    const int32_t	m = (5*e + 2) / 153;
+    const int32_t	y = 100*b + d - 4800 + m/10;
+
+    *day = e - (153*m + 2)/5 + 1;
+    *month = m + 3 - 12*(m/10);
+    *year = y <= 0 ? y - 1 : y;		/* there's no year 0 */
+}
+
+
+/*
+ * Converts a Gregorian/Julian date to a Julian day number using only integer
+ * arithmetic with no branches.  The year must be in [FAST_YEAR_MIN,
+ * FAST_YEAR_MAX], the month in [1, 12], and the absolute value of the day no
+ * more than FAST_DAY_MAX.
+ */
+static inline int32_t
+fastDateToJulianDay(
+    const int		year,
+    const int		month,
+    const int		day)
+{
+    /* Year 0 is taken to be the start of the common era */
+    const int32_t	iy = year < 0 ? year + 1 : year == 0 ? 1 : year;
+    const int32_t	a = (14 - month) / 12;
+    const int32_t	y = iy + 4800 - a;
+    const int32_t	m = month + 12*a - 3;
+    const int32_t	julday = day + (153*m + 2)/5 + 365*y + y/4 - 32083;
+
+    return day + 31*(month + 12*iy) >= GREGORIAN_START_DATE
+	? julday - y/100 + y/400 + 38
+	: julday;
+}
+
+
+static inline int
+isFastDate(
+    const int		year,
+    const int		month,
+    const int		day)
+{
+    return year >= FAST_YEAR_MIN && year <= FAST_YEAR_MAX &&
+	month >= 1 && month <= 12 &&
+	day >= -FAST_DAY_MAX && day <= FAST_DAY_MAX;
+}
+
+
 static long
-getJuldayOrigin()
+dateToJulianDay(
+    const int		year,
+    const int		month,
+    const int		day)
 {
-    static long juldayOrigin;
+    return isFastDate(year, month, day)
+	? fastDateToJulianDay(year, month, day)
+	: gregorianDateToJulianDay(year, month, day);
+}
 
-    if (juldayOrigin == 0)
-	juldayOrigin = gregorianDateToJulianDay(2001, 1, 1);
 
-    return juldayOrigin;
+static void
+julianDayToDate(
+    const long		julday,
+    int* const		year,
+    int* const		month,
+    int* const		day)
+{
+    if (julday >= FAST_JULDAY_MIN && julday <= FAST_JULDAY_MAX) {
+	fastJulianDayToDate((int32_t)julday, year, month, day);
+    }
+    else {
+	julianDayToGregorianDate(julday, year, month, day);
+    }
 }
 
 
@@ -452,8 +601,7 @@ ut_encode_date(
     int		month,
     int		day)
 {
-    return 86400.0 *
-	(gregorianDateToJulianDay(year, month, day) - getJuldayOrigin());
+    return 86400.0 * (dateToJulianDay(year, month, day) - JULDAY_ORIGIN);
 }
 
 
@@ -486,37 +634,28 @@ ut_encode_time(
 
 
 /*
- * Decodes a time from a double-precision value.
+ * Decodes the clock-time of a double-precision time value.
  *
  * Arguments:
  *      value           The value to be decoded.
- *      year            Pointer to the variable to be set to the year.
- *      month           Pointer to the variable to be set to the month.
- *      day             Pointer to the variable to be set to the day.
  *      hour            Pointer to the variable to be set to the hour.
  *      minute          Pointer to the variable to be set to the minute.
  *      second          Pointer to the variable to be set to the second.
- *      resolution      Pointer to the variable to be set to the resolution
- *                      of the decoded time in seconds.
+ * Returns:
+ *	The number of days from the origin to the date of "value".
  */
-void
-ut_decode_time(
-    double	value,
-    int		*year,
-    int		*month,
-    int		*day,
-    int		*hour,
-    int		*minute,
-    double	*second,
-    double	*resolution)
+static inline int
+decodeClock(
+    double		value,
+    int* const		hour,
+    int* const		minute,
+    double* const	second)
 {
     int     days;
     int     hours;
     int     minutes;
     int     d;
     double  seconds;
-    /* Uncertainty of input value */
-    double  uncer = ldexp(value < 0 ? -value : value, -DBL_MANT_DIG);
 
     days = (int)floor(value/86400.0);
     // `long long` is necessary for dates like `1-01-01`
@@ -540,9 +679,191 @@ ut_decode_time(
     *second = seconds;
     *minute = minutes;
     *hour = hours;
-    *resolution = uncer;
 
-    julianDayToGregorianDate(getJuldayOrigin() + days, year, month, day);
+    return days;
+}
+
+
+/*
+ * Decodes a time from a double-precision value.
+ *
+ * Arguments:
+ *      value           The value to be decoded.
+ *      year            Pointer to the variable to be set to the year.
+ *      month           Pointer to the variable to be set to the month.
+ *      day             Pointer to the variable to be set to the day.
+ *      hour            Pointer to the variable to be set to the hour.
+ *      minute          Pointer to the variable to be set to the minute.
+ *      second          Pointer to the variable to be set to the second.
+ *      resolution      Pointer to the variable to be set to the resolution
+ *                      of the decoded time in seconds.
+ */
+void
+ut_decode_time(
+    double	value,
+    int		*year,
+    int		*month,
+    int		*day,
+    int		*hour,
+    int		*minute,
+    double	*second,
+    double	*resolution)
+{
+    /* Uncertainty of input value */
+    *resolution = ldexp(value < 0 ? -value : value, -DBL_MANT_DIG);
+
+    julianDayToDate(JULDAY_ORIGIN + decodeClock(value, hour, minute, second),
+	year, month, day);
+}
+
+
+/*
+ * Decodes an array of times from double-precision values.  The result is the
+ * same as calling ut_decode_time() on each value, but the dates are computed
+ * with integer arithmetic in loops that can be vectorized.
+ *
+ * Arguments:
+ *      values          Pointer to the values to be decoded.
+ *      count           The number of values.
+ *      years           Pointer to the "count" years to be set.
+ *      months          Pointer to the "count" months to be set.
+ *      days            Pointer to the "count" days to be set.
+ *      hours           Pointer to the "count" hours to be set.
+ *      minutes         Pointer to the "count" minutes to be set.
+ *      seconds         Pointer to the "count" seconds to be set.
+ *      resolutions     NULL or pointer to the "count" resolutions, in
+ *                      seconds, to be set.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"count" isn't zero and a pointer other than
+ *			"resolutions" is NULL.
+ */
+ut_status
+ut_decode_times(
+    const double* const	values,
+    const size_t	count,
+    int* const		years,
+    int* const		months,
+    int* const		days,
+    int* const		hours,
+    int* const		minutes,
+    double* const	seconds,
+    double* const	resolutions)
+{
+    ut_set_status(UT_SUCCESS);
+
+    if (count > 0 && (values == NULL || years == NULL || months == NULL ||
+	    days == NULL || hours == NULL || minutes == NULL ||
+	    seconds == NULL)) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message("ut_decode_times(): NULL argument");
+    }
+    else {
+	int	isFast = 1;
+	size_t	i;
+
+	/* The day offsets are temporarily stored in "days" */
+	for (i = 0; i < count; i++) {
+	    long	julday;
+
+	    days[i] = decodeClock(values[i], hours + i, minutes + i,
+		seconds + i);
+	    julday = JULDAY_ORIGIN + days[i];
+	    isFast &= julday >= FAST_JULDAY_MIN && julday <= FAST_JULDAY_MAX;
+	}
+
+	if (isFast) {
+	    for (i = 0; i < count; i++)
+		fastJulianDayToDate((int32_t)(JULDAY_ORIGIN + days[i]),
+		    years + i, months + i, days + i);
+	}
+	else {
+	    for (i = 0; i < count; i++)
+		julianDayToDate(JULDAY_ORIGIN + days[i], years + i, months + i,
+		    days + i);
+	}
+
+	if (resolutions != NULL)
+	    for (i = 0; i < count; i++)
+		resolutions[i] = ldexp(fabs(values[i]), -DBL_MANT_DIG);
+    }
+
+    return ut_get_status();
+}
+
+
+/*
+ * Encodes an array of times as double-precision values.  The result is the
+ * same as calling ut_encode_time() on each time, but the dates are computed
+ * with integer arithmetic in loops that can be vectorized.
+ *
+ * Arguments:
+ *	years		Pointer to the "count" years.
+ *	months		Pointer to the "count" months.
+ *	days		Pointer to the "count" days.
+ *	hours		Pointer to the "count" hours.
+ *	minutes		Pointer to the "count" minutes.
+ *	seconds		Pointer to the "count" seconds.
+ *	count		The number of times.
+ *	values		Pointer to the "count" values to be set.
+ * Returns:
+ *	UT_SUCCESS	Success.
+ *	UT_BAD_ARG	"count" isn't zero and a pointer is NULL.
+ *	UT_BAD_ARG	A clock-time is invalid.  Like ut_encode_time(), the
+ *			corresponding value is just that of the date.
+ */
+ut_status
+ut_encode_times(
+    const int* const	years,
+    const int* const	months,
+    const int* const	days,
+    const int* const	hours,
+    const int* const	minutes,
+    const double* const	seconds,
+    const size_t	count,
+    double* const	values)
+{
+    ut_set_status(UT_SUCCESS);
+
+    if (count > 0 && (years == NULL || months == NULL || days == NULL ||
+	    hours == NULL || minutes == NULL || seconds == NULL ||
+	    values == NULL)) {
+	ut_set_status(UT_BAD_ARG);
+	ut_handle_error_message("ut_encode_times(): NULL argument");
+    }
+    else {
+	int	isFast = 1;
+	int	isValid = 1;
+	size_t	i;
+
+	for (i = 0; i < count; i++) {
+	    const int	clockIsValid = abs(hours[i]) < 24 &&
+		abs(minutes[i]) < 60 && fabs(seconds[i]) <= 62;
+
+	    values[i] = clockIsValid
+		? (hours[i]*60 + minutes[i])*60 + seconds[i]
+		: 0;
+	    isValid &= clockIsValid;
+	    isFast &= isFastDate(years[i], months[i], days[i]);
+	}
+
+	if (isFast) {
+	    for (i = 0; i < count; i++)
+		values[i] += 86400.0 * (fastDateToJulianDay(years[i],
+		    months[i], days[i]) - (int32_t)JULDAY_ORIGIN);
+	}
+	else {
+	    for (i = 0; i < count; i++)
+		values[i] += 86400.0 *
+		    (dateToJulianDay(years[i], months[i], days[i]) -
+		     JULDAY_ORIGIN);
+	}
+
+	if (!isValid)
+	    ut_set_status(UT_BAD_ARG);
+    }
+
+    return ut_get_status();
 }
 
 
@@ -576,11 +897,86 @@ commonInit(
     common->type = type;
     common->toProduct = NULL;
     common->fromProduct = NULL;
+    common->formatCache = NULL;
 
     return 0;
 }
 
 
+/*
+ * Allocates memory for a unit or its parts.  The memory comes from the arena
+ * of the current thread if it's active and from the heap otherwise.  In
+ * either case, it should be released by arenaRelease().
+ *
+ * Arguments:
+ *	nbytes		The number of bytes to allocate.
+ *	finalize	Pointer to a function to be called on the memory if it
+ *			comes from the arena and the arena is released or
+ *			NULL.  See arenaAlloc().
+ * Returns:
+ *	NULL	Failure.
+ *	else	Pointer to the memory.
+ */
+static void*
+unitAlloc(
+    const size_t	nbytes,
+    void		(*finalize)(void*))
+{
+    void*	ptr = arenaAlloc(nbytes, finalize);
+
+    return ptr != NULL ? ptr : malloc(nbytes);
+}
+
+
+/*
+ * Frees the converters of a unit from the arena that might have been created
+ * lazily.  The unit might already have been freed by ut_free(), which sets the
+ * converters to NULL.
+ *
+ * Arguments:
+ *	unit		Pointer to the unit.
+ */
+static void
+finalizeConverters(
+    void* const	unit)
+{
+    Common* const	common = unit;
+
+    cv_free(common->toProduct);
+    common->toProduct = NULL;
+    cv_free(common->fromProduct);
+    common->fromProduct = NULL;
+}
+
+
+/*
+ * Gives the clone of a unit references to the converters of the unit to and
+ * from its product-unit if they're shared (see coreShareConverters()) so that
+ * the clone doesn't have to create them.
+ *
+ * Arguments:
+ *	clone		Pointer to the clone or NULL.
+ *	unit		Pointer to the unit that was cloned.
+ * Returns:
+ *	"clone".
+ */
+static ut_unit*
+commonShareConverters(
+    ut_unit* const		clone,
+    const ut_unit* const	unit)
+{
+    if (clone != NULL) {
+	if (clone->common.toProduct == NULL)
+	    clone->common.toProduct = cvGetReference(unit->common.toProduct);
+	if (clone->common.fromProduct == NULL)
+	    clone->common.fromProduct =
+		cvGetReference(unit->common.fromProduct);
+    }
+
+    return clone;
+}
+
+
 /******************************************************************************
  * Basic-Unit:
  ******************************************************************************/
@@ -608,42 +1004,34 @@ basicNew(
     const int		isDimensionless,
     const int		index)
 {
-    BasicUnit*		basicUnit = NULL;	/* failure */
-    int			error = 1;
+    BasicUnit*		basicUnit;
     short		power = 1;
     short		shortIndex = (short)index;
-    ProductUnit*	product;
 
     assert(system != NULL);
 
-    product = productNew(system, &shortIndex, &power, 1);
+    basicUnit = unitAlloc(sizeof(BasicUnit), NULL);
 
-    if (product == NULL) {
+    if (basicUnit == NULL) {
 	ut_set_status(UT_OS);
+	ut_handle_error_message(strerror(errno));
 	ut_handle_error_message(
-	    "basicNew(): Couldn't create new product-unit");
+	    "basicNew(): Couldn't allocate %lu-byte basic-unit",
+	    sizeof(BasicUnit));
     }
     else {
-	basicUnit = malloc(sizeof(BasicUnit));
-
-	if (basicUnit == NULL) {
-	    ut_set_status(UT_OS);
-	    ut_handle_error_message(strerror(errno));
-	    ut_handle_error_message(
-		"basicNew(): Couldn't allocate %lu-byte basic-unit",
-		sizeof(BasicUnit));
-	}
-	else if (commonInit(&basicUnit->common, &basicOps, system,
-		BASIC) == 0) {
-	    basicUnit->index = index;
-	    basicUnit->isDimensionless = isDimensionless;
-	    basicUnit->product = product;
-	    error = 0;                  // Success
-	}				/* "basicUnit" allocated */
-
-	if (error)
-	    productFree((ut_unit*)product);
-    }				/* "product" allocated */
+	/*
+	 * A one-element product fits in the inline storage of the
+	 * product-unit, so initializing it can't fail.
+	 */
+	(void)productInit(&basicUnit->product, system, &shortIndex, &power, 1);
+	productInitDimension(&basicUnit->product, isDimensionless);
+	(void)commonInit(&basicUnit->common, &basicOps, system, BASIC);
+	basicUnit->common.toProduct = cv_get_trivial();
+	basicUnit->common.fromProduct = cv_get_trivial();
+	basicUnit->index = index;
+	basicUnit->isDimensionless = isDimensionless;
+    }
 
     return basicUnit;
 }
@@ -655,7 +1043,7 @@ basicGetProduct(
 {
     assert(IS_BASIC(unit));
 
-    return unit->basic.product;
+    return (ProductUnit*)&unit->basic.product;
 }
 
 
@@ -676,9 +1064,9 @@ basicFree(
 {
     if (unit != NULL) {
 	assert(IS_BASIC(unit));
-	productFree((ut_unit*)unit->basic.product);
-	unit->basic.product = NULL;
-	free(unit);
+	productDestroy(&unit->basic.product);
+	fcFree(unit->common.formatCache);
+	arenaRelease(unit);
     }
 }
 
@@ -734,7 +1122,7 @@ basicMultiply(
     assert(unit2 != NULL);
     assert(IS_BASIC(unit1));
 
-    return productMultiply((const ut_unit*)unit1->basic.product, unit2);
+    return productMultiply((const ut_unit*)&unit1->basic.product, unit2);
 }
 
 
@@ -760,7 +1148,7 @@ basicRaise(
     assert(power != 0);
     assert(power != 1);
 
-    return productRaise((ut_unit*)unit->basic.product, power);
+    return productRaise((ut_unit*)&unit->basic.product, power);
 }
 
 
@@ -785,7 +1173,7 @@ basicRoot(
     assert(IS_BASIC(unit));
     assert(root > 1);
 
-    return productRoot((ut_unit*)unit->basic.product, root);
+    return productRoot((ut_unit*)&unit->basic.product, root);
 }
 
 
@@ -870,6 +1258,147 @@ static UnitOps	basicOps = {
 static UnitOps	productOps;
 
 
+/*
+ * Initializes a product-unit.  The index and power arrays are stored in the
+ * unit itself if they're small enough.
+ *
+ * Arguments:
+ *	productUnit	Pointer to the product-unit to be initialized.
+ *	system		The unit-system for the unit.
+ *	indexes		Pointer to array of indexes of basic-units.  May be
+ *			freed upon return.
+ *	powers		Pointer to array of powers.  Client may free upon
+ *			return.
+ *	count		The number of elements in "indexes" and "powers".  May
+ *			be zero.
+ * Returns:
+ *	 0	Success.
+ *	-1	Failure.  "ut_get_status()" will be:
+ *		    UT_OS	Operating-system error.  See "errno".  Can't
+ *				happen if "count <= PRODUCT_INLINE_COUNT".
+ */
+static int
+productInit(
+    ProductUnit* const	productUnit,
+    ut_system* const	system,
+    const short* const	indexes,
+    const short* const	powers,
+    const int		count)
+{
+    int		error = 0;
+    short*	pairs = productUnit->pairs;
+
+    assert(system != NULL);
+    assert(count >= 0);
+    assert(count == 0 || (indexes != NULL && powers != NULL));
+
+    (void)commonInit(&productUnit->common, &productOps, system, PRODUCT);
+
+    /*
+     * The converters are trivial, so they're set now rather than lazily.
+     * This keeps shared units (e.g., the dimensionless one) unmodified after
+     * creation.
+     */
+    productUnit->common.toProduct = cv_get_trivial();
+    productUnit->common.fromProduct = cv_get_trivial();
+
+    if (count > PRODUCT_INLINE_COUNT) {
+	pairs = unitAlloc(sizeof(short)*2*count, NULL);
+
+	if (pairs == NULL) {
+	    ut_set_status(UT_OS);
+	    ut_handle_error_message(strerror(errno));
+	    ut_handle_error_message("productInit(): "
+		"Couldn't allocate %d-element index array", count);
+	    error = -1;
+	}
+    }
+
+    if (!error) {
+	const size_t	nbytes = sizeof(short)*count;
+
+	productUnit->count = count;
+	productUnit->indexes = pairs;
+	productUnit->powers = pairs + count;
+
+	if (count > 0) {
+	    (void)memcpy(productUnit->indexes, indexes, nbytes);
+	    (void)memcpy(productUnit->powers, powers, nbytes);
+	}
+
+	productInitDimension(productUnit, 0);
+    }
+
+    return error;
+}
+
+
+/*
+ * Sets the dimension signatures of a product-unit, which allow
+ * productRelationship() to decide most cases without comparing the index and
+ * power arrays.  If every dimensionful basic-unit of the product has an index
+ * less than DIMENSION_PACKED_COUNT and a power that fits in a signed byte,
+ * then the powers are packed one byte per index and the signatures are
+ * exact; otherwise, they are hashes.  Dimensionless basic-units are ignored.
+ *
+ * Arguments:
+ *	productUnit		Pointer to the product-unit.  Its index and
+ *				power arrays must be set.
+ *	newIsDimensionless	Whether or not a basic-unit that's not yet in
+ *				the unit-system (i.e., one that's being
+ *				created) is dimensionless.
+ */
+static void
+productInitDimension(
+    ProductUnit* const	productUnit,
+    const int		newIsDimensionless)
+{
+    const ut_system* const	system = productUnit->common.system;
+    unsigned long		hash = FS_HASH_INIT;
+    unsigned long		inverseHash = FS_HASH_INIT;
+    int				i;
+
+    productUnit->dimension = 0;
+    productUnit->inverseDimension = 0;
+    productUnit->isPacked = 1;
+
+    for (i = 0; i < productUnit->count; i++) {
+	const int	index = productUnit->indexes[i];
+	const int	power = productUnit->powers[i];
+	const int	isDimensionless = index < system->basicCount
+	    ? system->basicUnits[index]->isDimensionless
+	    : newIsDimensionless;
+
+	if (!isDimensionless) {
+	    hash = FS_HASH_STEP(hash, index);
+	    hash = FS_HASH_STEP(hash, index >> 8);
+	    hash = FS_HASH_STEP(hash, power);
+	    hash = FS_HASH_STEP(hash, power >> 8);
+	    inverseHash = FS_HASH_STEP(inverseHash, index);
+	    inverseHash = FS_HASH_STEP(inverseHash, index >> 8);
+	    inverseHash = FS_HASH_STEP(inverseHash, -power);
+	    inverseHash = FS_HASH_STEP(inverseHash, -power >> 8);
+
+	    if (index < DIMENSION_PACKED_COUNT && power >= -127 &&
+		    power <= 127) {
+		productUnit->dimension |=
+		    (unsigned long long)(unsigned char)power << 8*index;
+		productUnit->inverseDimension |=
+		    (unsigned long long)(unsigned char)-power << 8*index;
+	    }
+	    else {
+		productUnit->isPacked = 0;
+	    }
+	}
+    }
+
+    if (!productUnit->isPacked) {
+	productUnit->dimension = hash;
+	productUnit->inverseDimension = inverseHash;
+    }
+}
+
+
 /*
  * Arguments:
  *	system	The unit-system for the new unit.
@@ -889,13 +1418,7 @@ productNew(
     const short* const	powers,
     const int		count)
 {
-    ProductUnit*	productUnit;
-
-    assert(system != NULL);
-    assert(count >= 0);
-    assert(count == 0 || (indexes != NULL && powers != NULL));
-
-    productUnit = malloc(sizeof(ProductUnit));
+    ProductUnit*	productUnit = unitAlloc(sizeof(ProductUnit), NULL);
 
     if (productUnit == NULL) {
 	ut_set_status(UT_OS);
@@ -904,43 +1427,10 @@ productNew(
 	    "productNew(): Couldn't allocate %d-byte product-unit",
 	    sizeof(ProductUnit));
     }
-    else {
-	int	error = 1;
-
-	if (commonInit(&productUnit->common, &productOps, system, PRODUCT)
-		== 0) {
-            if (count == 0) {
-                productUnit->count = count;
-                productUnit->indexes = NULL;
-                productUnit->powers = NULL;
-                error = 0;
-            }
-            else {
-                size_t	nbytes = sizeof(short)*count;
-                short*	newIndexes = malloc(nbytes*2);
-
-                if (count > 0 && newIndexes == NULL) {
-                    ut_set_status(UT_OS);
-                    ut_handle_error_message(strerror(errno));
-                    ut_handle_error_message("productNew(): "
-                        "Couldn't allocate %d-element index array", count);
-                }
-                else {
-                    short*	newPowers = newIndexes + count;
-
-                    productUnit->count = count;
-                    productUnit->indexes = memcpy(newIndexes, indexes, nbytes);
-                    productUnit->powers = memcpy(newPowers, powers, nbytes);
-                    error = 0;
-                }
-	    }                           /* "count > 0" */
-	}                               /* "productUnit->common" initialized */
-
-	if (error) {
-	    free(productUnit);
-	    productUnit = NULL;
-	}
-    }				        /* "productUnit" allocated */
+    else if (productInit(productUnit, system, indexes, powers, count) != 0) {
+	arenaRelease(productUnit);
+	productUnit = NULL;
+    }
 
     return productUnit;
 }
@@ -991,7 +1481,7 @@ productCompare(
     assert(unit2 != NULL);
 
     if (IS_BASIC(unit2)) {
-	cmp = productCompare(unit1, (ut_unit*)unit2->basic.product);
+	cmp = productCompare(unit1, (ut_unit*)&unit2->basic.product);
     }
     else if (!IS_PRODUCT(unit2)) {
 	int	diff = unit1->common.type - unit2->common.type;
@@ -1027,19 +1517,37 @@ productCompare(
 }
 
 
+/*
+ * Releases the resources of a product-unit but not the unit itself.
+ *
+ * Arguments:
+ *	productUnit	Pointer to the product-unit.
+ */
+static void
+productDestroy(
+    ProductUnit* const	productUnit)
+{
+    if (productUnit->indexes != productUnit->pairs)
+	arenaRelease(productUnit->indexes);
+    productUnit->indexes = NULL;
+    productUnit->powers = NULL;
+    fcFree(productUnit->common.formatCache);
+    productUnit->common.formatCache = NULL;
+    cv_free(productUnit->common.toProduct);
+    productUnit->common.toProduct = NULL;
+    cv_free(productUnit->common.fromProduct);
+    productUnit->common.fromProduct = NULL;
+}
+
+
 static void
 productReallyFree(
     ut_unit* const	unit)
 {
     if (unit != NULL) {
 	assert(IS_PRODUCT(unit));
-	free(unit->product.indexes);
-	unit->product.indexes = NULL;
-	cv_free(unit->common.toProduct);
-	unit->common.toProduct = NULL;
-	cv_free(unit->common.fromProduct);
-	unit->common.fromProduct = NULL;
-	free(unit);
+	productDestroy(&unit->product);
+	arenaRelease(unit);
     }
 }
 
@@ -1095,65 +1603,58 @@ productMultiply(
 	    result = unit1->common.system->one;
 	}
 	else {
-	    static short*		indexes = NULL;
-
-	    indexes = realloc(indexes, sizeof(short)*sumCount);
+	    short	buf[2*PRODUCT_LOCAL_COUNT] = {0}; /* avoids calloc() */
+	    short*	indexes = sumCount <= PRODUCT_LOCAL_COUNT
+		? buf
+		: calloc(2*sumCount, sizeof(short));
 
 	    if (indexes == NULL) {
 		ut_set_status(UT_OS);
 		ut_handle_error_message(strerror(errno));
 		ut_handle_error_message("productMultiply(): "
-		    "Couldn't allocate %d-element index array", sumCount);
+		    "Couldn't allocate %d-element index and power arrays",
+		    sumCount);
 	    }
 	    else {
-		static short*	powers = NULL;
-
-		powers = realloc(powers, sizeof(short)*sumCount);
-
-		if (powers == NULL) {
-		    ut_set_status(UT_OS);
-		    ut_handle_error_message(strerror(errno));
-		    ut_handle_error_message("productMultiply(): "
-			"Couldn't allocate %d-element power array",
-			sumCount);
-		}
-		else {
-		    int				count = 0;
-		    int				i1 = 0;
-		    int				i2 = 0;
-
-		    while (i1 < count1 || i2 < count2) {
-			if (i1 >= count1) {
-			    indexes[count] = indexes2[i2];
-			    powers[count++] = powers2[i2++];
-			}
-			else if (i2 >= count2) {
-			    indexes[count] = indexes1[i1];
-			    powers[count++] = powers1[i1++];
-			}
-			else if (indexes1[i1] > indexes2[i2]) {
-			    indexes[count] = indexes2[i2];
-			    powers[count++] = powers2[i2++];
-			}
-			else if (indexes1[i1] < indexes2[i2]) {
+		short*		powers = indexes + sumCount;
+		int		count = 0;
+		int		i1 = 0;
+		int		i2 = 0;
+
+		while (i1 < count1 || i2 < count2) {
+		    if (i1 >= count1) {
+			indexes[count] = indexes2[i2];
+			powers[count++] = powers2[i2++];
+		    }
+		    else if (i2 >= count2) {
+			indexes[count] = indexes1[i1];
+			powers[count++] = powers1[i1++];
+		    }
+		    else if (indexes1[i1] > indexes2[i2]) {
+			indexes[count] = indexes2[i2];
+			powers[count++] = powers2[i2++];
+		    }
+		    else if (indexes1[i1] < indexes2[i2]) {
+			indexes[count] = indexes1[i1];
+			powers[count++] = powers1[i1++];
+		    }
+		    else {
+			if (powers1[i1] != -powers2[i2]) {
 			    indexes[count] = indexes1[i1];
-			    powers[count++] = powers1[i1++];
-			}
-			else {
-			    if (powers1[i1] != -powers2[i2]) {
-				indexes[count] = indexes1[i1];
-				powers[count++] = powers1[i1] + powers2[i2];
-			    }
-
-			    i1++;
-			    i2++;
+			    powers[count++] = powers1[i1] + powers2[i2];
 			}
+
+			i1++;
+			i2++;
 		    }
+		}
 
-		    result = (ut_unit*)productNew(unit1->common.system,
-			indexes, powers, count);
-		}			/* "powers" re-allocated */
-	    }				/* "indexes" re-allocated */
+		result = (ut_unit*)productNew(unit1->common.system,
+		    indexes, powers, count);
+
+		if (indexes != buf)
+		    free(indexes);
+	    }				/* "indexes" allocated */
 	}				/* "sumCount > 0" */
     }					/* "unit2" is a product-unit */
 
@@ -1181,6 +1682,7 @@ productRaise(
     ut_unit*		result = NULL;	/* failure */
     const ProductUnit*	product;
     int			count;
+    short		buf[PRODUCT_LOCAL_COUNT] = {0};	/* avoids malloc() */
     short*		newPowers;
 
     assert(unit != NULL);
@@ -1196,7 +1698,9 @@ productRaise(
         result = unit->common.system->one;
     }
     else {
-        newPowers = malloc(sizeof(short)*count);
+        newPowers = count <= PRODUCT_LOCAL_COUNT
+            ? buf
+            : malloc(sizeof(short)*count);
 
         if (newPowers == NULL) {
             ut_set_status(UT_OS);
@@ -1214,7 +1718,8 @@ productRaise(
             result = (ut_unit*)productNew(unit->common.system,
                 product->indexes, newPowers, count);
 
-            free(newPowers);
+            if (newPowers != buf)
+                free(newPowers);
         }				/* "newPowers" allocated */
     }				        /* "count > 0" */
 
@@ -1242,6 +1747,7 @@ productRoot(
     ut_unit*		result = NULL;	/* failure */
     const ProductUnit*	product;
     int			count;
+    short		buf[PRODUCT_LOCAL_COUNT];	/* avoids malloc() */
     short*		newPowers;
 
     assert(unit != NULL);
@@ -1255,7 +1761,9 @@ productRoot(
         result = unit->common.system->one;
     }
     else {
-        newPowers = malloc(sizeof(short)*count);
+        newPowers = count <= PRODUCT_LOCAL_COUNT
+            ? buf
+            : malloc(sizeof(short)*count);
 
         if (newPowers == NULL) {
             ut_set_status(UT_OS);
@@ -1296,7 +1804,8 @@ productRoot(
                     product->indexes, newPowers, count);
             }
 
-            free(newPowers);
+            if (newPowers != buf)
+                free(newPowers);
         }				/* "newPowers" allocated */
     }				        /* "count > 0" */
 
@@ -1389,7 +1898,30 @@ productRelationship(
     assert(unit1 != NULL);
     assert(unit2 != NULL);
 
-    {
+    if (unit1->isPacked && unit2->isPacked) {
+	/*
+	 * The signatures are exact.  Both are zero if both units are
+	 * dimensionless, which are equal.
+	 */
+	relationship = unit1->dimension == unit2->dimension
+	    ? PRODUCT_EQUAL
+	    : unit1->dimension == unit2->inverseDimension
+		? PRODUCT_INVERSE
+		: PRODUCT_UNCONVERTIBLE;
+    }
+    else if (unit1->isPacked != unit2->isPacked ||
+	    (unit1->dimension != unit2->dimension &&
+	     unit1->dimension != unit2->inverseDimension)) {
+	/*
+	 * Equal or reciprocal units would have the same kind of signatures
+	 * and matching hashes.
+	 */
+	relationship = PRODUCT_UNCONVERTIBLE;
+    }
+    else {
+	/*
+	 * The hashes match: compare the arrays.
+	 */
 	const short* const	indexes1 = unit1->indexes;
 	const short* const	indexes2 = unit2->indexes;
 	const short* const	powers1 = unit1->powers;
@@ -1471,8 +2003,12 @@ productAcceptVisitor(
     const ut_visitor* const	visitor,
     void* const			arg)
 {
+    BasicUnit*	basicBuf[PRODUCT_LOCAL_COUNT] = {NULL};	/* avoids malloc() */
+    int		powerBuf[PRODUCT_LOCAL_COUNT] = {0};
     int		count = unit->product.count;
-    BasicUnit**	basicUnits = malloc(sizeof(BasicUnit*)*count);
+    BasicUnit**	basicUnits = count <= PRODUCT_LOCAL_COUNT
+	? basicBuf
+	: malloc(sizeof(BasicUnit*)*count);
 
     assert(unit != NULL);
     assert(IS_PRODUCT(unit));
@@ -1485,7 +2021,9 @@ productAcceptVisitor(
 	    "Couldn't allocate %d-element basic-unit array", count);
     }
     else {
-        int*	powers = (count > 0 ? malloc(sizeof(int)*count) : NULL);
+        int*	powers = count <= PRODUCT_LOCAL_COUNT
+	    ? powerBuf
+	    : malloc(sizeof(int)*count);
 
 	if (count != 0 && powers == NULL) {
 	    ut_set_status(UT_OS);
@@ -1506,11 +2044,12 @@ productAcceptVisitor(
 	    ut_set_status(visitor->visit_product(unit, count,
 		(const ut_unit**)basicUnits, powers, arg));
 
-            if (powers)
+            if (powers != powerBuf)
                 free(powers);
 	}				/* "powers" allocated */
 
-	free(basicUnits);
+	if (basicUnits != basicBuf)
+	    free(basicUnits);
     }					/* "basicUnits" allocated */
 
     return ut_get_status();
@@ -1611,7 +2150,8 @@ galileanNew(
             newUnit = CLONE(unit);
         }
         else {
-            GalileanUnit*	galileanUnit = malloc(sizeof(GalileanUnit));
+            GalileanUnit*	galileanUnit = unitAlloc(sizeof(GalileanUnit),
+                finalizeConverters);
 
             if (galileanUnit == NULL) {
                 ut_set_status(UT_OS);
@@ -1631,7 +2171,7 @@ galileanNew(
                 }
 
                 if (error) {
-                    free(galileanUnit);
+                    arenaRelease(galileanUnit);
                     galileanUnit = NULL;
                 }
             }				/* "galileanUnit" allocated */
@@ -1666,8 +2206,8 @@ galileanClone(
 
     galileanUnit = &unit->galilean;
 
-    return galileanNew(galileanUnit->scale, galileanUnit->unit,
-	galileanUnit->offset);
+    return commonShareConverters(galileanNew(galileanUnit->scale,
+	galileanUnit->unit, galileanUnit->offset), unit);
 }
 
 
@@ -1721,11 +2261,13 @@ galileanFree(
     if (unit != NULL) {
 	assert(IS_GALILEAN(unit));
 	FREE(unit->galilean.unit);
+	fcFree(unit->common.formatCache);
+	unit->common.formatCache = NULL;
 	cv_free(unit->common.toProduct);
 	unit->common.toProduct = NULL;
 	cv_free(unit->common.fromProduct);
 	unit->common.fromProduct = NULL;
-	free((void*)unit);
+	arenaRelease(unit);
     }
 }
 
@@ -2045,7 +2587,8 @@ timestampNewOrigin(
 	    "No \"second\" unit defined");
     }
     else if (ut_are_convertible(secondUnit, unit)) {
-	TimestampUnit*	timestampUnit = malloc(sizeof(TimestampUnit));
+	TimestampUnit*	timestampUnit = unitAlloc(sizeof(TimestampUnit),
+	    finalizeConverters);
 
 	if (timestampUnit == NULL) {
 	    ut_set_status(UT_OS);
@@ -2061,7 +2604,7 @@ timestampNewOrigin(
 		timestampUnit->unit = CLONE(unit);
 	    }
 	    else {
-		free(timestampUnit);
+		arenaRelease(timestampUnit);
 		timestampUnit = NULL;
 	    }
 	}			/* "timestampUnit" allocated */
@@ -2130,7 +2673,8 @@ timestampClone(
     assert(unit != NULL);
     assert(IS_TIMESTAMP(unit));
 
-    return timestampNewOrigin(unit->timestamp.unit, unit->timestamp.origin);
+    return commonShareConverters(timestampNewOrigin(unit->timestamp.unit,
+	unit->timestamp.origin), unit);
 }
 
 
@@ -2159,7 +2703,7 @@ timestampCompare(
 		? -1
 		: timestamp1->origin == timestamp2->origin
 		    ? 0
-		    : -1;
+		    : 1;
 
 	if (cmp == 0)
 	    cmp = COMPARE(timestamp1->unit, timestamp2->unit);
@@ -2177,11 +2721,13 @@ timestampFree(
 	assert(IS_TIMESTAMP(unit));
 	FREE(unit->timestamp.unit);
 	unit->timestamp.unit = NULL;
+	fcFree(unit->common.formatCache);
+	unit->common.formatCache = NULL;
 	cv_free(unit->common.toProduct);
 	unit->common.toProduct = NULL;
 	cv_free(unit->common.fromProduct);
 	unit->common.fromProduct = NULL;
-	free((void*)unit);
+	arenaRelease(unit);
     }
 }
 
@@ -2266,45 +2812,70 @@ timestampRoot(
 
 /*
  * Initializes the converter of numeric values from the given Timestamp unit to
- * the underlying product-unit.
+ * seconds since its origin.  Unlike other units, the converters of a Timestamp
+ * unit are to and from the "second" unit of the unit-system rather than the
+ * underlying product-unit because they're only used to convert between
+ * Timestamp units.
  *
  * Arguments:
  *	unit	The Timestamp unit.
  * Returns:
- *	-1	Failure.
+ *	-1	Failure.  "ut_get_status()" will be:
+ *		    UT_OS	Operating-system fault.  See "errno".
+ *	0	Success.
  */
 static int
 timestampInitConverterToProduct(
     ut_unit* const	unit)
 {
-    /*
-     * This function is never called.
-     */
-    assert(0);
+    assert(unit != NULL);
+    assert(IS_TIMESTAMP(unit));
+    assert(unit->common.toProduct == NULL);
+
+    unit->common.toProduct =
+	getConverter(unit->timestamp.unit, unit->common.system->second);
+
+    if (unit->common.toProduct == NULL) {
+	ut_set_status(UT_OS);
+	ut_handle_error_message(strerror(errno));
+	ut_handle_error_message("timestampInitConverterToProduct(): "
+	    "Couldn't get converter to seconds");
+    }
 
-    return -1;
+    return unit->common.toProduct == NULL ? -1 : 0;
 }
 
 
 /*
  * Initializes the converter of numeric values to the given Timestamp unit from
- * the underlying product-unit.
+ * seconds since its origin.  See timestampInitConverterToProduct().
  *
  * Arguments:
  *	unit	The Timestamp unit.
  * Returns:
- *	-1	Failure.
+ *	-1	Failure.  "ut_get_status()" will be:
+ *		    UT_OS	Operating-system fault.  See "errno".
+ *	0	Success.
  */
 static int
 timestampInitConverterFromProduct(
     ut_unit* const	unit)
 {
-    /*
-     * This function is never called.
-     */
-    assert(0);
+    assert(unit != NULL);
+    assert(IS_TIMESTAMP(unit));
+    assert(unit->common.fromProduct == NULL);
+
+    unit->common.fromProduct =
+	getConverter(unit->common.system->second, unit->timestamp.unit);
+
+    if (unit->common.fromProduct == NULL) {
+	ut_set_status(UT_OS);
+	ut_handle_error_message(strerror(errno));
+	ut_handle_error_message("timestampInitConverterFromProduct(): "
+	    "Couldn't get converter from seconds");
+    }
 
-    return -1;
+    return unit->common.fromProduct == NULL ? -1 : 0;
 }
 
 
@@ -2367,7 +2938,7 @@ logNew(
     assert(base > 1);
     assert(reference != NULL);
 
-    logUnit = malloc(sizeof(LogUnit));
+    logUnit = unitAlloc(sizeof(LogUnit), finalizeConverters);
 
     if (logUnit == NULL) {
 	ut_set_status(UT_OS);
@@ -2379,7 +2950,7 @@ logNew(
     else {
 	if (commonInit(&logUnit->common, &logOps, reference->common.system,
 		LOG) != 0) {
-	    free(logUnit);
+	    arenaRelease(logUnit);
 	}
 	else {
 	    logUnit->reference = CLONE(reference);
@@ -2388,7 +2959,7 @@ logNew(
 		logUnit->base = base;
 	    }
 	    else {
-		free(logUnit);
+		arenaRelease(logUnit);
 		logUnit = NULL;
 	    }
 	}
@@ -2416,7 +2987,8 @@ logClone(
     assert(unit != NULL);
     assert(IS_LOG(unit));
 
-    return logNew(unit->log.base, unit->log.reference);
+    return commonShareConverters(logNew(unit->log.base, unit->log.reference),
+	unit);
 }
 
 
@@ -2463,11 +3035,13 @@ logFree(
 	assert(IS_LOG(unit));
 	FREE(unit->log.reference);
 	unit->log.reference = NULL;
+	fcFree(unit->common.formatCache);
+	unit->common.formatCache = NULL;
 	cv_free(unit->common.toProduct);
 	unit->common.toProduct = NULL;
 	cv_free(unit->common.fromProduct);
 	unit->common.fromProduct = NULL;
-	free((void*)unit);
+	arenaRelease(unit);
     }
 }
 
@@ -2748,8 +3322,11 @@ ut_new_system(void)
 	system->second = NULL;
 	system->basicUnits = NULL;
 	system->basicCount = 0;
+	system->frozen = NULL;
 
+	arenaSuspend();
 	system->one = (ut_unit*)productNew(system, NULL, NULL, 0);
+	arenaResume();
 
 	if (ut_get_status() != UT_SUCCESS) {
 	    ut_handle_error_message(
@@ -2792,6 +3369,171 @@ coreFreeSystem(
 }
 
 
+/*
+ * Makes the converters of a unit to and from its product-unit reference-counted
+ * so that they're shared by the clones of the unit instead of being created by
+ * each clone.  Meant for the long-lived units of the identifier maps of a
+ * unit-system, whose clones are returned by lookups.  The converters of basic
+ * and product units are trivial and aren't changed.
+ *
+ * Arguments:
+ *	unit		Pointer to the unit.  Must not be in the arena.
+ * Returns:
+ *	0		Success.
+ *	-1		Failure.  "ut_get_status()" will be UT_OS.  The unit
+ *			is still valid.
+ */
+int
+coreShareConverters(
+    ut_unit* const	unit)
+{
+    int	status = 0;
+
+    if (!IS_BASIC(unit) && !IS_PRODUCT(unit)) {
+	if (!ENSURE_CONVERTER_TO_PRODUCT(unit) ||
+		!ENSURE_CONVERTER_FROM_PRODUCT(unit) ||
+		cvMakeShared(&unit->common.toProduct) != 0 ||
+		cvMakeShared(&unit->common.fromProduct) != 0) {
+	    ut_set_status(UT_OS);
+	    status = -1;
+	}
+    }
+
+    return status;
+}
+
+
+FrozenSystem*
+coreGetFrozen(
+    const ut_system* const	system)
+{
+    return system->frozen;
+}
+
+
+void
+coreSetFrozen(
+    ut_system* const		system,
+    FrozenSystem* const		frozen)
+{
+    system->frozen = frozen;
+}
+
+
+/*
+ * Adds a floating-point value to a hash-code.  Equal values (including zeros
+ * of different sign) have the same effect.
+ */
+static unsigned long
+hashDouble(
+    unsigned long	hash,
+    double		value)
+{
+    const unsigned char*	bytes = (const unsigned char*)&value;
+    size_t			i;
+
+    if (value == 0)
+	value = 0;			/* eliminates negative zero */
+
+    for (i = 0; i < sizeof(value); i++)
+	hash = FS_HASH_STEP(hash, bytes[i]);
+
+    return hash;
+}
+
+
+unsigned long
+coreHashUnit(
+    const ut_unit* const	unit)
+{
+    unsigned long	hash = FS_HASH_STEP(FS_HASH_INIT,
+	IS_BASIC(unit) ? PRODUCT : unit->common.type);
+
+    if (IS_BASIC(unit) || IS_PRODUCT(unit)) {
+	/*
+	 * A basic-unit compares equal to its product-unit.
+	 */
+	const ProductUnit* const	product = IS_BASIC(unit)
+	    ? &unit->basic.product
+	    : &unit->product;
+	int				i;
+
+	for (i = 0; i < product->count; i++) {
+	    hash = FS_HASH_STEP(hash, product->indexes[i]);
+	    hash = FS_HASH_STEP(hash, product->indexes[i] >> 8);
+	    hash = FS_HASH_STEP(hash, product->powers[i]);
+	    hash = FS_HASH_STEP(hash, product->powers[i] >> 8);
+	}
+    }
+    else if (IS_GALILEAN(unit)) {
+	hash = hashDouble(hash, unit->galilean.scale);
+	hash = hashDouble(hash, unit->galilean.offset);
+	hash ^= coreHashUnit(unit->galilean.unit);
+    }
+    else if (IS_TIMESTAMP(unit)) {
+	hash = hashDouble(hash, unit->timestamp.origin);
+	hash ^= coreHashUnit(unit->timestamp.unit);
+    }
+    else if (IS_LOG(unit)) {
+	hash = hashDouble(hash, unit->log.base);
+	hash ^= coreHashUnit(unit->log.reference);
+    }
+
+    return hash;
+}
+
+
+int
+coreGetBasicCount(
+    const ut_system* const	system)
+{
+    return system->basicCount;
+}
+
+
+const ut_unit*
+coreGetBasicUnit(
+    const ut_system* const	system,
+    const int			index)
+{
+    return (const ut_unit*)system->basicUnits[index];
+}
+
+
+int
+coreGetBasicIndex(
+    const ut_unit* const	unit)
+{
+    return IS_BASIC(unit) ? unit->basic.index : -1;
+}
+
+
+const ut_unit*
+coreGetSecond(
+    const ut_system* const	system)
+{
+    return system->second;
+}
+
+
+void**
+coreGetFormatCache(
+    const ut_unit* const	unit)
+{
+    return &((ut_unit*)unit)->common.formatCache;
+}
+
+
+ut_unit*
+coreNewGalilean(
+    const double		scale,
+    const ut_unit* const	unit,
+    const double		offset)
+{
+    return galileanNew(scale, unit, offset);
+}
+
+
 /*
  * Returns the dimensionless-unit one of a unit-system.
  *
@@ -2902,6 +3644,7 @@ ut_same_system(
  * Returns:
  *	NULL	Failure.  "ut_get_status()" will be
  *		    UT_BAD_ARG		"system" is NULL.
+ *		    UT_FROZEN		"system" is frozen.
  *		    UT_OS		Operating-system error.  See "errno".
  *	else	Pointer to the new base-unit.
  */
@@ -2916,12 +3659,20 @@ newBasicUnit(
 	ut_set_status(UT_BAD_ARG);
 	ut_handle_error_message("newBasicUnit(): NULL unit-system argument");
     }
+    else if (system->frozen != NULL) {
+	ut_set_status(UT_FROZEN);
+	ut_handle_error_message("newBasicUnit(): Unit-system is frozen");
+    }
     else {
 	basicUnit = basicNew(system, isDimensionless, system->basicCount);
 
 	if (basicUnit != NULL) {
 	    int		error = 1;
-	    BasicUnit*	save = (BasicUnit*)basicClone((ut_unit*)basicUnit);
+	    BasicUnit*	save;
+
+	    arenaSuspend();	/* "save" belongs to "system" */
+	    save = (BasicUnit*)basicClone((ut_unit*)basicUnit);
+	    arenaResume();
 
 	    if (save == NULL) {
 		ut_set_status(UT_OS);
@@ -2970,6 +3721,7 @@ newBasicUnit(
  * Returns:
  *	NULL	Failure.  "ut_get_status()" will be
  *		    UT_BAD_ARG		"system" or "name" is NULL.
+ *		    UT_FROZEN		"system" is frozen.
  *		    UT_OS		Operating-system error.  See "errno".
  *	else	Pointer to the new base-unit.  The pointer should be passed to
  *		ut_free() when the unit is no longer needed by the client (the
@@ -2996,6 +3748,7 @@ ut_new_base_unit(
  * Returns:
  *	NULL	Failure.  "ut_get_status()" will be
  *		    UT_BAD_ARG		"system" is NULL.
+ *		    UT_FROZEN		"system" is frozen.
  *		    UT_OS		Operating-system error.  See "errno".
  *	else	Pointer to the new dimensionless-unit.  The pointer should be
  *		passed to ut_free() when the unit is no longer needed by the
@@ -3020,6 +3773,8 @@ ut_new_dimensionless_unit(
  *	UT_BAD_ARG	"second" is NULL.
  *	UT_EXISTS	The second unit of the unit-system to which "second"
  *			belongs is set to a different unit.
+ *	UT_FROZEN	The unit-system to which "second" belongs is frozen
+ *			and its second unit isn't set.
  *	UT_SUCCESS	Success.
  */
 ut_status
@@ -3037,7 +3792,14 @@ ut_set_second(
 	ut_system*	system = second->common.system;
 
 	if (system->second == NULL) {
-	    system->second = CLONE(second);
+	    if (system->frozen != NULL) {
+		ut_set_status(UT_FROZEN);
+		ut_handle_error_message(
+		    "ut_set_second(): Unit-system is frozen");
+	    }
+	    else {
+		system->second = arenaCloneToHeap(second);
+	    }
 	}
 	else {
 	    if (ut_compare(system->second, second) != 0) {
@@ -3553,30 +4315,19 @@ ut_are_convertible(
 
 
 /*
- * Returns a converter of numeric values in one unit to numeric values in
- * another unit.  The returned converter should be passed to cv_free() when it
- * is no longer needed by the client.
- *
- * NOTE:  Leap seconds are not taken into account when converting between
- * timestamp units.
+ * Returns a new converter for converting numeric values between two units.
+ * This is the uncached implementation of ut_get_converter().
  *
  * Arguments:
  *	from		Pointer to the unit from which to convert values.
  *	to		Pointer to the unit to which to convert values.
  * Returns:
- *	NULL		Failure.  "ut_get_status()" will be:
- *			    UT_BAD_ARG		"from" or "to" is NULL.
- *			    UT_NOT_SAME_SYSTEM	"from" and "to" belong to
- *						different unit-systems.
- *			    UT_MEANINGLESS	Conversion between the units is
- *						not possible.  See
- *						"ut_are_convertible()".
+ *	NULL		Failure.  See ut_get_converter().
  *	else		Pointer to the appropriate converter.  The pointer
- *			should be passed to cv_free() when no longer needed by
- *			the client.
+ *			should be passed to cv_free() when no longer needed.
  */
-cv_converter*
-ut_get_converter(
+static cv_converter*
+getConverter(
     ut_unit* const	from,
     ut_unit* const	to)
 {
@@ -3639,70 +4390,48 @@ ut_get_converter(
 		}
 	    }				/* got necessary product converters */
 	}				/* neither unit is a timestamp */
-	else {
-	    cv_converter*	toSeconds =
-                ut_get_converter(from->timestamp.unit,
-                    from->common.system->second);
-
-	    if (toSeconds == NULL) {
-		ut_set_status(UT_OS);
-		ut_handle_error_message(strerror(errno));
-		ut_handle_error_message(
-		    "ut_get_converter(): Couldn't get converter to seconds");
+	else if (!IS_TIMESTAMP(from) || !IS_TIMESTAMP(to)) {
+	    ut_set_status(UT_MEANINGLESS);
+	    ut_handle_error_message(
+		"ut_get_converter(): Units not convertible");
+	}
+	else if (ENSURE_CONVERTER_TO_PRODUCT(from) &&
+		ENSURE_CONVERTER_FROM_PRODUCT(to)) {
+	    /*
+	     * The converters of the timestamp-units to and from seconds are
+	     * cached by the units, so only the shift of the origin needs to be
+	     * folded into the result.
+	     */
+	    const double	shift =
+		from->timestamp.origin - to->timestamp.origin;
+
+	    if (shift == 0) {
+		converter = cv_combine(from->common.toProduct,
+		    to->common.fromProduct);
 	    }
 	    else {
-		cv_converter*	shiftOrigin =
-		    cv_get_offset(
-			from->timestamp.origin - to->timestamp.origin);
+		cv_converter*	shiftOrigin = cv_get_offset(shift);
 
-		if (shiftOrigin == NULL) {
-		    ut_set_status(UT_OS);
-		    ut_handle_error_message(strerror(errno));
-		    ut_handle_error_message(
-			"ut_get_converter(): Couldn't get offset-converter");
-		}
-		else {
+		if (shiftOrigin != NULL) {
 		    cv_converter*	toToUnit =
-			cv_combine(toSeconds, shiftOrigin);
-
-		    if (toToUnit == NULL) {
-			ut_set_status(UT_OS);
-			ut_handle_error_message(strerror(errno));
-			ut_handle_error_message(
-			    "ut_get_converter(): Couldn't combine converters");
-		    }
-		    else {
-			cv_converter*	fromSeconds = ut_get_converter(
-			    to->common.system->second, to->timestamp.unit);
-
-			if (fromSeconds == NULL) {
-			    ut_set_status(UT_OS);
-			    ut_handle_error_message(strerror(errno));
-			    ut_handle_error_message(
-				"ut_get_converter(): Couldn't get converter "
-				"from seconds");
-			}
-			else {
-			    converter = cv_combine(toToUnit, fromSeconds);
-
-			    if (converter == NULL) {
-				ut_set_status(UT_OS);
-				ut_handle_error_message(strerror(errno));
-				ut_handle_error_message("ut_get_converter(): "
-				    "Couldn't combine converters");
-			    }
+			cv_combine(from->common.toProduct, shiftOrigin);
 
-			    cv_free(fromSeconds);
-			}		/* "fromSeconds" allocated */
+		    if (toToUnit != NULL) {
+			converter = cv_combine(toToUnit, to->common.fromProduct);
 
 			cv_free(toToUnit);
 		    }			/* "toToUnit" allocated */
 
 		    cv_free(shiftOrigin);
 		}			/* "shiftOrigin" allocated */
+	    }				/* different origins */
 
-		cv_free(toSeconds);
-	    }				/* "toSeconds" allocated */
+	    if (converter == NULL) {
+		ut_set_status(UT_OS);
+		ut_handle_error_message(strerror(errno));
+		ut_handle_error_message(
+		    "ut_get_converter(): Couldn't get converter");
+	    }
 	}				/* units are timestamps */
     }					/* valid arguments */
 
@@ -3710,6 +4439,62 @@ ut_get_converter(
 }
 
 
+/*
+ * Returns a converter of numeric values in one unit to numeric values in
+ * another unit.  The returned converter should be passed to cv_free() when it
+ * is no longer needed by the client.
+ *
+ * NOTE:  Leap seconds are not taken into account when converting between
+ * timestamp units.
+ *
+ * Arguments:
+ *	from		Pointer to the unit from which to convert values.
+ *	to		Pointer to the unit to which to convert values.
+ * Returns:
+ *	NULL		Failure.  "ut_get_status()" will be:
+ *			    UT_BAD_ARG		"from" or "to" is NULL.
+ *			    UT_NOT_SAME_SYSTEM	"from" and "to" belong to
+ *						different unit-systems.
+ *			    UT_MEANINGLESS	Conversion between the units is
+ *						not possible.  See
+ *						"ut_are_convertible()".
+ *	else		Pointer to the appropriate converter.  The pointer
+ *			should be passed to cv_free() when no longer needed by
+ *			the client.  If the converter-cache of the unit-system
+ *			is enabled, then the converter is shared with the
+ *			cache and other clients.  See
+ *			ut_set_converter_cache_capacity().
+ */
+cv_converter*
+ut_get_converter(
+    ut_unit* const	from,
+    ut_unit* const	to)
+{
+    cv_converter*	converter = NULL;	/* failure */
+
+    UT_STATS_ADD(converterRequests, 1);
+
+    if (from != NULL && to != NULL &&
+	    from->common.system == to->common.system &&
+	    (converter = ccFind(from, to)) != NULL) {
+	UT_STATS_ADD(converterCacheHits, 1);
+	ut_set_status(UT_SUCCESS);
+    }
+    else {
+	UT_STATS_START(start);
+
+	converter = getConverter(from, to);
+
+	if (converter != NULL)
+	    converter = ccAdd(from, to, converter);
+
+	UT_STATS_STOP(converterNanoseconds, start);
+    }
+
+    return converter;
+}
+
+
 /*
  * Indicates if a given unit is dimensionless or not.  Note that logarithmic
  * units are dimensionless by definition.
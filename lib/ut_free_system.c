@@ -11,7 +11,12 @@
 #include "config.h"
 
 #include "udunits2.h"
+#include "converterCache.h"
+#include "frozenSystem.h"
 #include "idToUnitMap.h"
+#include "lazyUnits.h"
+#include "parseCache.h"
+#include "prefix.h"
 #include "unitToIdMap.h"
 
 extern void coreFreeSystem(ut_system* system);
@@ -30,8 +35,13 @@ ut_free_system(
     ut_system*	system)
 {
     if (system != NULL) {
+	pcFreeSystem(system);
+	ccFreeSystem(system);
+	fsFreeSystem(system);
+	luFreeSystem(system);
 	itumFreeSystem(system);
 	utimFreeSystem(system);
+	ptvmFreeSystem(system);
 	coreFreeSystem(system);
     }
 }
@@ -15,6 +15,10 @@
 #include <config.h>
 
 #include "udunits2.h"
+#include "lazyUnits.h"
+#include "parseAhead.h"
+#include "threadPool.h"
+#include "xmlLog.h"
 
 #if defined(__linux__)
 #   ifndef _GNU_SOURCE
@@ -57,10 +61,16 @@
 #endif
 
 #define NAME_SIZE 128
-#define ACCUMULATE_TEXT \
-    XML_SetCharacterDataHandler(currFile->parser, accumulateText)
-#define IGNORE_TEXT \
-    XML_SetCharacterDataHandler(currFile->parser, NULL)
+#define ACCUMULATE_TEXT	setTextHandling(1)
+#define IGNORE_TEXT	setTextHandling(0)
+#define HAVE_UNIT(file) \
+    ((file)->unit != NULL || (file)->lazy != NULL)
+
+typedef enum {
+    EAGER_LOAD,		/* define units while reading the database */
+    LAZY_LOAD,		/* defer unit definitions */
+    PARALLEL_LOAD	/* read the files and parse ahead concurrently */
+} LoadMode;
 
 typedef enum {
     START,
@@ -78,8 +88,12 @@ typedef struct {
     char	plural[NAME_SIZE];
     char        symbol[NAME_SIZE];
     double      value;
-    XML_Parser  parser;
+    XML_Parser  parser;		/* NULL if the file's events are replayed */
+    const char*	base;		/* base for relative pathnames */
+    const XmlEvent* event;	/* current replayed event */
+    ParseAhead*	ahead;		/* results of parsing ahead or NULL */
     ut_unit*	unit;
+    LazyUnit*	lazy;		/* deferred definition of "unit" or NULL */
     ElementType context;
     ut_encoding xmlEncoding;
     ut_encoding textEncoding;
@@ -92,6 +106,8 @@ typedef struct {
     int         noPLural;
     int         nameSeen;
     int         symbolSeen;
+    int		accumulate;	/* accumulate text? */
+    int		stopped;	/* processing stopped? */
 } File;
 
 typedef struct {
@@ -104,11 +120,73 @@ typedef struct {
 
 static ut_status readXml(
     const char* const   path);
+static ut_status replayXml(
+    const XmlLog* const log);
 
 static File*            currFile = NULL;
 static ut_system*	unitSystem = NULL;
+static int		lazyLoad = 0;	/* defer unit definitions? */
 static char*            text = NULL;
 static size_t           nbytes = 0; /// Number of characters excluding NUL
+static XmlLog**		xmlLogs = NULL;	/* files read ahead by PARALLEL_LOAD */
+static size_t		xmlLogCount = 0;
+
+
+/*
+ * Stops processing the current file.
+ */
+static void
+stopParsing(void)
+{
+    if (currFile != NULL) {
+        currFile->stopped = 1;
+
+        if (currFile->parser != NULL)
+            XML_StopParser(currFile->parser, 0);
+    }
+}
+
+
+/*
+ * Returns the line number of the current location in the current file.
+ */
+static int
+currentLine(void)
+{
+    return currFile->parser != NULL
+        ? (int)XML_GetCurrentLineNumber(currFile->parser)
+        : (int)currFile->event->line;
+}
+
+
+/*
+ * Records that the unit-system was modified other than by mapping an
+ * identifier, so the results of parsing ahead can't be used any longer.
+ */
+static void
+invalidateParseAhead(void)
+{
+    if (currFile->ahead != NULL)
+        paInvalidate(currFile->ahead);
+}
+
+
+/*
+ * Parses a string in the unit-system like ut_parse() but uses the result of
+ * parsing it ahead if possible.
+ */
+static ut_unit*
+parseUnit(
+    const char* const   string,
+    const ut_encoding   encoding)
+{
+    ut_unit*    unit;
+
+    if (!paTake(currFile->ahead, string, encoding, &unit))
+        unit = ut_parse(unitSystem, string, encoding);
+
+    return unit;
+}
 
 
 /*
@@ -133,7 +211,7 @@ ut_form_plural(
 	if (length + 3 >= sizeof(buf)) {
             ut_set_status(UT_SYNTAX);
 	    ut_handle_error_message("Singular form is too long");
-	    XML_StopParser(currFile->parser, 0);
+	    stopParsing();
 	}
 	else if (length > 0) {
 	    (void)strcpy(buf, singular);
@@ -561,7 +639,10 @@ mapUnitToId(
         desc = "symbol";
     }
 
-    if (func(unit, id, encoding) != UT_SUCCESS) {
+    if (currFile->lazy != NULL) {
+        success = luAddMapping(currFile->lazy, id, encoding, isName, 0);
+    }
+    else if (func(unit, id, encoding) != UT_SUCCESS) {
         ut_set_status(UT_PARSE);
         ut_handle_error_message("Couldn't map unit to %s \"%s\"", desc, id);
     }
@@ -692,7 +773,7 @@ mapIdToUnit(
         ut_set_status(UT_PARSE);
 	ut_handle_error_message(
 	    "Duplicate definition for \"%s\" at \"%s\":%d", id,
-            currFile->path, XML_GetCurrentLineNumber(currFile->parser));
+            currFile->path, currentLine());
 
 	if (nchar < 0)
 	    nchar =
@@ -705,14 +786,24 @@ mapIdToUnit(
 	    ut_handle_error_message("Previous definition was \"%s\"", buf);
 	}
 
-        XML_StopParser(currFile->parser, 0);
+        stopParsing();
+    }
+    else if (currFile->lazy != NULL) {
+        /*
+         * Checking for an overridden prefixed-unit would materialize the
+         * units of the prefixed identifier, so it isn't done.
+         */
+        success = luAddMapping(currFile->lazy, id, encoding, isName, 1);
+
+        if (!success)
+            stopParsing();
     }
     else {
 	/*
 	 * Take prefixes into account for a prior definition by using
          * ut_parse().
 	 */
-	prev = ut_parse(unitSystem, id, encoding);
+	prev = parseUnit(id, encoding);
 
 	if ((isName
                     ? ut_map_name_to_unit(id, encoding, unit)
@@ -721,9 +812,12 @@ mapIdToUnit(
             ut_set_status(UT_PARSE);
 	    ut_handle_error_message("Couldn't map %s \"%s\" to unit",
 		isName ? "name" : "symbol", id);
-	    XML_StopParser(currFile->parser, 0);
+	    stopParsing();
 	}
 	else {
+	    if (currFile->ahead != NULL)
+		paMapped(currFile->ahead, id);
+
 	    if (prev != NULL) {
 		char	buf[128];
 		int	nchar = ut_format(prev, buf, sizeof(buf),
@@ -738,7 +832,7 @@ mapIdToUnit(
 		    ut_handle_error_message("Definition of \"%s\" in \"%s\", "
                         "line %d, overrides prefixed-unit", id,
                         currFile->path,
-			XML_GetCurrentLineNumber(currFile->parser));
+			currentLine());
 		}
 		else {
 		    buf[nchar] = 0;
@@ -747,7 +841,7 @@ mapIdToUnit(
 		    ut_handle_error_message("Definition of \"%s\" in \"%s\", "
                         "line %d, overrides prefixed-unit \"%s\"",
                         id, currFile->path,
-                        XML_GetCurrentLineNumber(currFile->parser), buf);
+                        currentLine(), buf);
 		}
 	    }
 
@@ -904,8 +998,14 @@ fileInit(
     file->xmlEncoding = UT_ASCII;
     file->textEncoding = UT_ASCII;
     file->unit = NULL;
+    file->lazy = NULL;
     file->fd = -1;
     file->parser = NULL;
+    file->base = NULL;
+    file->event = NULL;
+    file->ahead = NULL;
+    file->accumulate = 0;
+    file->stopped = 0;
     file->isBase = 0;
     file->isDimensionless = 0;
     file->haveValue = 0;
@@ -951,7 +1051,7 @@ accumulateText(
 	ut_handle_error_message(strerror(errno));
 	ut_handle_error_message("Couldn't reallocate %lu-byte text buffer",
 	    nbytes+len+1);
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
         int     i;
@@ -970,6 +1070,21 @@ accumulateText(
 }
 
 
+/*
+ * Sets whether or not the textual portion of elements is accumulated.
+ */
+static void
+setTextHandling(
+    const int   accumulate)
+{
+    currFile->accumulate = accumulate;
+
+    if (currFile->parser != NULL)
+        XML_SetCharacterDataHandler(currFile->parser,
+            accumulate ? accumulateText : NULL);
+}
+
+
 #if 0
 /*
  * Converts the accumulated text from UTF-8 to user-specified encoding.
@@ -992,7 +1107,7 @@ convertText(void)
         if (*cp) {
             ut_set_status(UT_SYNTAX);
             ut_handle_error_message("Character isn't US-ASCII: %#x", *cp);
-            XML_StopParser(currFile->parser, 0);
+            stopParsing();
 
             success = 0;
         }
@@ -1018,7 +1133,7 @@ convertText(void)
                     ut_handle_error_message(
                         "Character is not representable in ISO-8859-1 "
                         "(Latin-1): %d", 1+(int)((char*)out - text));
-                    XML_StopParser(currFile->parser, 0);
+                    stopParsing();
 
                     success = 0;
 
@@ -1048,7 +1163,7 @@ startUnitSystem(
     if (currFile->context != START) {
 	ut_set_status(UT_PARSE);
 	ut_handle_error_message("Wrong place for <unit-system> element");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
 
     currFile->context = UNIT_SYSTEM;
@@ -1095,7 +1210,7 @@ endPrefix(
     if (!currFile->haveValue || !currFile->prefixAdded) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Prefix incompletely specified");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
 	currFile->haveValue = 0;
@@ -1116,11 +1231,12 @@ startUnit(
     if (currFile->context != UNIT_SYSTEM) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Wrong place for <unit> element");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
 	ut_free(currFile->unit);
 	currFile->unit = NULL;
+	currFile->lazy = NULL;
 	currFile->isBase = 0;
 	currFile->isDimensionless = 0;
         currFile->singular[0] = 0;
@@ -1145,17 +1261,18 @@ endUnit(
         if (!currFile->nameSeen) {
             ut_set_status(UT_PARSE);
             ut_handle_error_message("Base unit needs a name");
-            XML_StopParser(currFile->parser, 0);
+            stopParsing();
         }
         if (!currFile->symbolSeen) {
             ut_set_status(UT_PARSE);
             ut_handle_error_message("Base unit needs a symbol");
-            XML_StopParser(currFile->parser, 0);
+            stopParsing();
         }
     }
 
     ut_free(currFile->unit);
     currFile->unit = NULL;
+    currFile->lazy = NULL;
     currFile->context = UNIT_SYSTEM;
 }
 
@@ -1171,24 +1288,24 @@ startBase(
     if (currFile->context != UNIT) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Wrong place for <base> element");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
 	if (currFile->isDimensionless) {
             ut_set_status(UT_PARSE);
 	    ut_handle_error_message(
 		"<dimensionless> and <base> are mutually exclusive");
-	    XML_StopParser(currFile->parser, 0);
+	    stopParsing();
 	}
-	else if (currFile->unit != NULL) {
+	else if (HAVE_UNIT(currFile)) {
             ut_set_status(UT_PARSE);
 	    ut_handle_error_message("<base> and <def> are mutually exclusive");
-	    XML_StopParser(currFile->parser, 0);
+	    stopParsing();
 	}
 	else if (currFile->isBase) {
             ut_set_status(UT_PARSE);
 	    ut_handle_error_message("<base> element already seen");
-	    XML_StopParser(currFile->parser, 0);
+	    stopParsing();
 	}
     }
 }
@@ -1206,7 +1323,7 @@ endBase(
     if (currFile->unit == NULL) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Couldn't create new base unit");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
 	currFile->isBase = 1;
@@ -1225,25 +1342,25 @@ startDimensionless(
     if (currFile->context != UNIT) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Wrong place for <dimensionless> element");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
 	if (currFile->isBase) {
             ut_set_status(UT_PARSE);
 	    ut_handle_error_message(
 		"<dimensionless> and <base> are mutually exclusive");
-	    XML_StopParser(currFile->parser, 0);
+	    stopParsing();
 	}
-	else if (currFile->unit != NULL) {
+	else if (HAVE_UNIT(currFile)) {
             ut_set_status(UT_PARSE);
 	    ut_handle_error_message(
 		"<dimensionless> and <def> are mutually exclusive");
-	    XML_StopParser(currFile->parser, 0);
+	    stopParsing();
 	}
 	else if (currFile->isDimensionless) {
             ut_set_status(UT_PARSE);
 	    ut_handle_error_message("<dimensionless> element already seen");
-	    XML_StopParser(currFile->parser, 0);
+	    stopParsing();
 	}
     }
 }
@@ -1261,7 +1378,7 @@ endDimensionless(
     if (currFile->unit == NULL) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Couldn't create new dimensionless unit");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
 	currFile->isDimensionless = 1;
@@ -1280,24 +1397,24 @@ startDef(
     if (currFile->context != UNIT) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Wrong place for <def> element");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else if (currFile->isBase) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message(
 	    "<base> and <def> are mutually exclusive");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else if (currFile->isDimensionless) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message(
 	    "<dimensionless> and <def> are mutually exclusive");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
-    else if (currFile->unit != NULL) {
+    else if (HAVE_UNIT(currFile)) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("<def> element already seen");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
 	clearText();
@@ -1316,16 +1433,22 @@ endDef(
     if (nbytes == 0) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Empty unit definition");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
+    }
+    else if (lazyLoad) {
+	currFile->lazy = luNew(unitSystem, text, currFile->textEncoding);
+
+	if (currFile->lazy == NULL)
+	    stopParsing();
     }
     else {
-	currFile->unit = ut_parse(unitSystem, text, currFile->textEncoding);
+	currFile->unit = parseUnit(text, currFile->textEncoding);
 
 	if (currFile->unit == NULL) {
             ut_set_status(UT_PARSE);
 	    ut_handle_error_message(
                 "Couldn't parse unit specification \"%s\"", text);
-	    XML_StopParser(currFile->parser, 0);
+	    stopParsing();
 	}
     }
 }
@@ -1343,7 +1466,7 @@ startName(
         if (!currFile->haveValue) {
             ut_set_status(UT_PARSE);
             ut_handle_error_message("No previous <value> element");
-            XML_StopParser(currFile->parser, 0);
+            stopParsing();
         }
         else {
             clearText();
@@ -1351,11 +1474,11 @@ startName(
         }
     }
     else if (currFile->context == UNIT || currFile->context == ALIASES) {
-        if (currFile->unit == NULL) {
+        if (!HAVE_UNIT(currFile)) {
             ut_set_status(UT_PARSE);
             ut_handle_error_message(
                 "No previous <base>, <dimensionless>, or <def> element");
-            XML_StopParser(currFile->parser, 0);
+            stopParsing();
         }
         else {
             currFile->noPLural = 0;
@@ -1368,7 +1491,7 @@ startName(
     else {
         ut_set_status(UT_PARSE);
         ut_handle_error_message("Wrong place for <name> element");
-        XML_StopParser(currFile->parser, 0);
+        stopParsing();
     }
 }
 
@@ -1384,7 +1507,7 @@ endName(
 	if (!currFile->haveValue) {
             ut_set_status(UT_PARSE);
 	    ut_handle_error_message("No previous <value> element");
-	    XML_StopParser(currFile->parser, 0);
+	    stopParsing();
 	}
 	else {
 	    if (ut_add_name_prefix(unitSystem, text, currFile->value) !=
@@ -1393,10 +1516,11 @@ endName(
 		ut_handle_error_message(
 		    "Couldn't map name-prefix \"%s\" to value %g", text,
                     currFile->value);
-		XML_StopParser(currFile->parser, 0);
+		stopParsing();
 	    }
 	    else {
 		currFile->prefixAdded = 1;
+		invalidateParseAhead();
 	    }
 	}
     }
@@ -1404,12 +1528,12 @@ endName(
         if (currFile->singular[0] == 0) {
             ut_set_status(UT_PARSE);
             ut_handle_error_message("<name> needs a <singular>");
-            XML_StopParser(currFile->parser, 0);
+            stopParsing();
         }
         else {
             if (!mapUnitAndName(currFile->unit, currFile->singular,
                     currFile->textEncoding)) {
-                XML_StopParser(currFile->parser, 0);
+                stopParsing();
             }
             else {
                 if (!currFile->noPLural) {
@@ -1425,7 +1549,7 @@ endName(
                             ut_set_status(UT_PARSE);
                             ut_handle_error_message("Couldn't form plural of "
                                 "\"%s\"", currFile->singular);
-                            XML_StopParser(currFile->parser, 0);
+                            stopParsing();
                         }
                     }
 
@@ -1436,16 +1560,28 @@ endName(
                          */
                         if (!mapNamesToUnit(plural, currFile->textEncoding,
                                 currFile->unit)) {
-                            XML_StopParser(currFile->parser, 0);
+                            stopParsing();
                         }
                     }
                 }                       /* <noplural/> not specified */
                 if (strcmp(currFile->singular, "second") == 0) {
-                    if (ut_set_second(currFile->unit) != UT_SUCCESS) {
+                    if (currFile->lazy != NULL) {
+                        /*
+                         * The "second" unit is needed now, so its definition
+                         * isn't deferred any longer.
+                         */
+                        currFile->unit = luMaterializeUnit(currFile->lazy);
+                        currFile->lazy = NULL;
+                    }
+
+                    if (currFile->unit == NULL ||
+                            ut_set_second(currFile->unit) != UT_SUCCESS) {
                         ut_handle_error_message(
                             "Couldn't set \"second\" unit in unit-system");
-                        XML_StopParser(currFile->parser, 0);
+                        stopParsing();
                     }
+
+                    invalidateParseAhead();
                 }                       /* unit was 'second' unit */
             }                           /* unit mapped to singular name */
         }                               /* singular name specified */
@@ -1457,12 +1593,12 @@ endName(
 	if (currFile->singular[0] == 0) {
             ut_set_status(UT_PARSE);
             ut_handle_error_message("<name> needs a <singular>");
-            XML_StopParser(currFile->parser, 0);
+            stopParsing();
         }
         else {
             if (!mapNamesToUnit(currFile->singular, currFile->textEncoding,
                     currFile->unit)) {
-                XML_StopParser(currFile->parser, 0);
+                stopParsing();
             }
 
             if (!currFile->noPLural) {
@@ -1478,14 +1614,14 @@ endName(
                         ut_set_status(UT_PARSE);
                         ut_handle_error_message("Couldn't form plural of "
                             "\"%s\"", currFile->singular);
-                        XML_StopParser(currFile->parser, 0);
+                        stopParsing();
                     }
                 }
 
                 if (plural != NULL) {
                     if (!mapNamesToUnit(plural, currFile->textEncoding,
                             currFile->unit))
-                        XML_StopParser(currFile->parser, 0);
+                        stopParsing();
                 }
             }                           /* <noplural> not specified */
         }                               /* singular name specified */
@@ -1509,12 +1645,12 @@ startSingular(
     if (currFile->context != UNIT_NAME && currFile->context != ALIAS_NAME) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Wrong place for <singular> element");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else if (currFile->singular[0] != 0) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("<singular> element already seen");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
 	clearText();
@@ -1533,7 +1669,7 @@ endSingular(
     if (nbytes >= NAME_SIZE) {
         ut_set_status(UT_PARSE);
         ut_handle_error_message("Name \"%s\" is too long", text);
-        XML_StopParser(currFile->parser, 0);
+        stopParsing();
     }
     else {
         (void)strncpy(currFile->singular, text, NAME_SIZE);
@@ -1552,12 +1688,12 @@ startPlural(
     if (currFile->context != UNIT_NAME && currFile->context != ALIAS_NAME ) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Wrong place for <plural> element");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else if (currFile->noPLural || currFile->plural[0] != 0) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("<plural> or <noplural> element already seen");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
 	clearText();
@@ -1576,12 +1712,12 @@ endPlural(
     if (nbytes == 0) {
         ut_set_status(UT_PARSE);
         ut_handle_error_message("Empty <plural> element");
-        XML_StopParser(currFile->parser, 0);
+        stopParsing();
     }
     else if (nbytes >= NAME_SIZE) {
         ut_set_status(UT_PARSE);
         ut_handle_error_message("Plural name \"%s\" is too long", text);
-        XML_StopParser(currFile->parser, 0);
+        stopParsing();
     }
     else {
         (void)strncpy(currFile->plural, text, NAME_SIZE);
@@ -1600,12 +1736,12 @@ startNoPlural(
     if (currFile->context != UNIT_NAME && currFile->context != ALIAS_NAME) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Wrong place for <noplural> element");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else if (currFile->plural[0] != 0) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("<plural> element already seen");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
 }
 
@@ -1633,7 +1769,7 @@ startSymbol(
         if (!currFile->haveValue) {
             ut_set_status(UT_PARSE);
             ut_handle_error_message("No previous <value> element");
-            XML_StopParser(currFile->parser, 0);
+            stopParsing();
         }
         else {
             clearText();
@@ -1641,11 +1777,11 @@ startSymbol(
         }
     }
     else if (currFile->context == UNIT || currFile->context == ALIASES) {
-        if (currFile->unit == NULL) {
+        if (!HAVE_UNIT(currFile)) {
             ut_set_status(UT_PARSE);
             ut_handle_error_message(
                 "No previous <base>, <dimensionless>, or <def> element");
-            XML_StopParser(currFile->parser, 0);
+            stopParsing();
         }
         else {
             clearText();
@@ -1655,7 +1791,7 @@ startSymbol(
     else {
         ut_set_status(UT_PARSE);
         ut_handle_error_message("Wrong place for <symbol> element");
-        XML_StopParser(currFile->parser, 0);
+        stopParsing();
     }
 }
 
@@ -1674,21 +1810,22 @@ endSymbol(
             ut_handle_error_message(
                 "Couldn't map symbol-prefix \"%s\" to value %g",
                 text, currFile->value);
-            XML_StopParser(currFile->parser, 0);
+            stopParsing();
         }
         else {
             currFile->prefixAdded = 1;
+            invalidateParseAhead();
         }
     }
     else if (currFile->context == UNIT) {
         if (!mapUnitAndSymbol(currFile->unit, text, currFile->textEncoding))
-            XML_StopParser(currFile->parser, 0);
+            stopParsing();
 
         currFile->symbolSeen = 1;
     }
     else if (currFile->context == ALIASES) {
         if (!mapSymbolsToUnit(text, currFile->textEncoding, currFile->unit))
-            XML_StopParser(currFile->parser, 0);
+            stopParsing();
     }
 }
 
@@ -1704,12 +1841,12 @@ startValue(
     if (currFile->context != PREFIX) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Wrong place for <value> element");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else if (currFile->haveValue) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("<value> element already seen");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
 	clearText();
@@ -1735,12 +1872,12 @@ endValue(
 	ut_handle_error_message(strerror(errno));
 	ut_handle_error_message("Couldn't decode numeric prefix value \"%s\"",
             text);
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else if (*endPtr != 0) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Invalid numeric prefix value \"%s\"", text);
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
 	currFile->haveValue = 1;
@@ -1759,7 +1896,7 @@ startAliases(
     if (currFile->context != UNIT) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Wrong place for <aliases> element");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
 
     currFile->context = ALIASES;
@@ -1788,7 +1925,7 @@ startImport(
     if (currFile->context != UNIT_SYSTEM) {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Wrong place for <import> element");
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
     else {
 	clearText();
@@ -1798,36 +1935,117 @@ startImport(
 
 
 /*
- * Handles the end of an <import> element.
+ * Returns the base for relative pathnames in an XML file (i.e., the pathname
+ * of its directory).
+ *
+ * Arguments:
+ *      path            Pointer to the pathname of the XML file.
+ *      base            Buffer for the base.  Must have PATH_MAX bytes.
  */
 static void
-endImport(
-    void*		data)
+getBase(
+    const char* const   path,
+    char* const         base)
+{
+#ifdef _MSC_VER
+    char drive[_MAX_DRIVE+1]; // Will have trailing colon
+    char directory[_MAX_DIR+1]; // Will have trailing backslash
+    _splitpath(path, drive, directory, NULL, NULL);
+    (void)snprintf(base, PATH_MAX, "%s%s", drive, directory);
+#else
+    // Temporary buffer used because `dirname()` modifies its argument
+    char tmp[strlen(path)+1];
+    (void)strcpy(tmp, path);
+    (void)snprintf(base, PATH_MAX, "%s", dirname(tmp));
+#endif
+}
+
+
+/*
+ * Returns the pathname of an imported XML file.
+ *
+ * Arguments:
+ *      base            Pointer to the base for relative pathnames.
+ *      name            Pointer to the pathname in the <import> element.
+ *      buf             Buffer for the pathname.  Must have PATH_MAX bytes.
+ * Returns:
+ *      "name" if it's absolute; otherwise, "buf".
+ */
+static const char*
+importPath(
+    const char* const   base,
+    const char* const   name,
+    char* const         buf)
 {
-    char        buf[PATH_MAX];
     const char* path;
 
-    if (text[0] == '/') {
-        path = text;
+    if (name[0] == '/') {
+        path = name;
     }
     else {
-        (void)snprintf(buf, sizeof(buf),
+        (void)snprintf(buf, PATH_MAX,
 #ifdef _MSC_VER
             // The directory pathname has a trailing backslash on Windows
             "%s%s",
 #else
             "%s/%s",
 #endif
-            XML_GetBase(currFile->parser), text);
+            base, name);
 
-        buf[sizeof(buf)-1] = 0;
+        buf[PATH_MAX-1] = 0;
         path = buf;
     }
 
-    ut_set_status(readXml(path));
+    return path;
+}
+
+
+/*
+ * Returns the complete log of an XML file that was read ahead.
+ *
+ * Arguments:
+ *      path            Pointer to the pathname of the XML file.
+ * Returns:
+ *      NULL            The file wasn't read ahead or couldn't be.
+ *      else            Pointer to the log of the file.
+ */
+static const XmlLog*
+findXmlLog(
+    const char* const   path)
+{
+    const XmlLog*       log = NULL;
+    size_t              i;
+
+    for (i = 0; log == NULL && i < xmlLogCount; i++) {
+        if (xmlLogs[i]->complete && strcmp(xmlLogs[i]->path, path) == 0)
+            log = xmlLogs[i];
+    }
+
+    return log;
+}
+
+
+/*
+ * Handles the end of an <import> element.
+ */
+static void
+endImport(
+    void*		data)
+{
+    char                buf[PATH_MAX];
+    const char* const   path = importPath(currFile->base, text, buf);
+    const XmlLog* const log = findXmlLog(path);
+
+    ut_set_status(log != NULL ? replayXml(log) : readXml(path));
+
+    /*
+     * The imported file modified the unit-system in ways that parsing ahead
+     * didn't take into account.
+     */
+    invalidateParseAhead();
 
     if (ut_get_status() != UT_SUCCESS)
-        XML_StopParser(currFile->parser, 0);
+        stopParsing();
 }
 
 
@@ -1900,7 +2118,13 @@ endElement(
     void*		data,
     const XML_Char*	name)
 {
-    if (currFile->skipDepth != 0) {
+    if (currFile->stopped) {
+        /*
+         * The XML parser still reports the end of an empty-element tag (e.g.,
+         * "<base/>") whose start stopped processing.
+         */
+    }
+    else if (currFile->skipDepth != 0) {
 	--currFile->skipDepth;
     }
     else {
@@ -1946,7 +2170,7 @@ endElement(
 	else {
             ut_set_status(UT_PARSE);
 	    ut_handle_error_message("Unknown element \"<%s>\"", name);
-	    XML_StopParser(currFile->parser, 0);
+	    stopParsing();
 	}
     }
 
@@ -1976,7 +2200,7 @@ declareXml(
     else {
         ut_set_status(UT_PARSE);
 	ut_handle_error_message("Unknown XML encoding \"%s\"", encoding);
-	XML_StopParser(currFile->parser, 0);
+	stopParsing();
     }
 }
 
@@ -2020,6 +2244,7 @@ readXmlWithParser(
 
         file.path = path;
         file.parser = parser;
+        file.base = XML_GetBase(parser);
         currFile = &file;
 
         do {
@@ -2052,6 +2277,7 @@ readXmlWithParser(
                 XML_GetCurrentColumnNumber(file.parser));
         }
 
+        ut_free(file.unit);             /* of an unterminated <unit> */
         currFile = prevFile;
 
         (void)close(file.fd);
@@ -2088,23 +2314,8 @@ readXml(
     }
     else {
         char base[PATH_MAX];
-#ifdef _MSC_VER
-        {
-            char drive[_MAX_DRIVE+1]; // Will have trailing colon
-            char directory[_MAX_DIR+1]; // Will have trailing backslash
-            _splitpath(path, drive, directory, NULL, NULL);
-            (void)snprintf(base, sizeof(base), "%s%s", drive, directory);
-            base[sizeof(base)-1] = 0;
-        }
-#else
-        {
-            // Temporary buffer used because `dirname()` modifies its argument
-            char tmp[strlen(path)+1];
-            (void)strcpy(tmp, path);
-            (void)strncpy(base, dirname(tmp), sizeof(base));
-            base[sizeof(base)-1] = 0;
-        }
-#endif
+
+        getBase(path, base);
 
         if (XML_SetBase(parser, base) != XML_STATUS_OK) {
             status = UT_OS;
@@ -2127,6 +2338,395 @@ readXml(
 }
 
 
+/*
+ * Returns the encoding of the text of an element like accumulateText() does.
+ */
+static ut_encoding
+encodingOf(
+    const char* const   string)
+{
+    const char* cp;
+
+    for (cp = string; *cp != 0 && IS_ASCII(*cp); cp++)
+        ;
+
+    return *cp == 0 ? UT_ASCII : UT_UTF8;
+}
+
+
+/*
+ * Adds to a set of strings to be parsed ahead the derivatives of an identifier
+ * that mapIdsToUnit() would check.
+ *
+ * Arguments:
+ *      pa              Pointer to the set.
+ *      id              Pointer to the identifier.
+ * Returns:
+ *      0               Failure.
+ *      else            Success.
+ */
+static int
+addIdsToParseAhead(
+    ParseAhead* const   pa,
+    const char* const   id)
+{
+    int         success = 1;
+    Identifiers ids;
+
+    if (strlen(id) < NAME_SIZE && makeDerivatives(id, encodingOf(id), &ids)) {
+        success =
+            (ids.ascii[0] == 0 || paAdd(pa, ids.ascii, UT_ASCII) == 0) &&
+            (ids.latin1[0] == 0 || paAdd(pa, ids.latin1, UT_LATIN1) == 0) &&
+            (ids.latin1Nbsp[0] == 0 ||
+                paAdd(pa, ids.latin1Nbsp, UT_LATIN1) == 0) &&
+            (ids.utf8[0] == 0 || paAdd(pa, ids.utf8, UT_UTF8) == 0) &&
+            (ids.utf8Nbsp[0] == 0 || paAdd(pa, ids.utf8Nbsp, UT_UTF8) == 0);
+    }
+
+    return success;
+}
+
+
+/*
+ * Parses ahead, concurrently, the unit definitions of a recorded XML file and
+ * the identifiers whose prior definitions mapIdToUnit() will check.  The
+ * results are used while the file is replayed as long as the unit-system
+ * hasn't changed in a way that affects them.  See parseAhead.c.
+ *
+ * Arguments:
+ *      log             Pointer to the log of the file.
+ * Returns:
+ *      NULL            Failure.  Nothing is parsed ahead.
+ *      else            Pointer to the results.  Should be passed to paFree().
+ */
+static ParseAhead*
+parseAhead(
+    const XmlLog* const log)
+{
+    ParseAhead* pa = paNew();
+
+    if (pa != NULL) {
+        /*
+         * Forming the plural of a name can report an error, which will be
+         * reported again when the file is replayed.
+         */
+        ut_error_message_handler    prevHandler =
+            ut_set_thread_error_message_handler(ut_ignore);
+        const char* string = NULL;      /* text of the current element */
+        int         inPrefix = 0;
+        int         success = 1;
+        size_t      i;
+
+        for (i = 0; success && i < log->count; i++) {
+            const XmlEvent* const       event = log->events + i;
+            const char* const           name = XL_STRING(log, event);
+
+            if (event->type == XE_TEXT) {
+                string = name;
+            }
+            else if (event->type == XE_START) {
+                if (strcasecmp(name, "prefix") == 0)
+                    inPrefix = 1;
+
+                string = NULL;
+            }
+            else if (event->type == XE_END) {
+                if (strcasecmp(name, "prefix") == 0) {
+                    inPrefix = 0;
+                }
+                else if (string != NULL && !inPrefix) {
+                    if (strcasecmp(name, "def") == 0) {
+                        success =
+                            paAdd(pa, string, encodingOf(string)) == 0;
+                    }
+                    else if (strcasecmp(name, "singular") == 0) {
+                        success = addIdsToParseAhead(pa, string);
+
+                        if (success && strlen(string) + 3 < NAME_SIZE) {
+                            const char* plural = ut_form_plural(string);
+
+                            if (plural != NULL)
+                                success = addIdsToParseAhead(pa, plural);
+                        }
+                    }
+                    else if (strcasecmp(name, "plural") == 0 ||
+                            strcasecmp(name, "symbol") == 0) {
+                        success = addIdsToParseAhead(pa, string);
+                    }
+                }
+
+                string = NULL;
+            }
+        }
+
+        (void)ut_set_thread_error_message_handler(prevHandler);
+
+        if (success) {
+            paRun(pa, unitSystem);
+        }
+        else {
+            paFree(pa);
+            pa = NULL;
+        }
+    }
+
+    return pa;
+}
+
+
+/*
+ * Reads an XML file into the unit-system by replaying its recorded events to
+ * the handlers of readXml().
+ *
+ * Arguments:
+ *      log             Pointer to the complete log of the XML file.
+ * Returns:
+ *      UT_SUCCESS      Success.
+ *      UT_OPEN_ARG     An imported file couldn't be opened.  See "errno".
+ *      UT_OS           Operating-system error.  See "errno".
+ *      UT_PARSE        Parse failure.
+ */
+static ut_status
+replayXml(
+    const XmlLog* const log)
+{
+    static const XML_Char*      noAttributes[] = {NULL};
+    ut_status                   status = UT_SUCCESS;
+    File                        file;
+    File* const                 prevFile = currFile;
+    size_t                      i;
+
+    fileInit(&file);
+
+    file.path = log->path;
+    file.base = log->base;
+    currFile = &file;
+    file.ahead = parseAhead(log);
+
+    for (i = 0; i < log->count && !file.stopped; i++) {
+        const XmlEvent* const   event = log->events + i;
+        const char* const       string = XL_STRING(log, event);
+
+        file.event = event;
+
+        switch (event->type) {
+        case XE_DECLARATION:
+            declareXml(NULL, NULL, string, event->standalone);
+            break;
+        case XE_START:
+            startElement(NULL, string, noAttributes);
+            break;
+        case XE_END:
+            endElement(NULL, string);
+            break;
+        case XE_TEXT:
+            if (file.accumulate)
+                accumulateText(NULL, string, (int)event->length);
+            break;
+        }
+    }
+
+    if (file.stopped) {
+        /*
+         * Processing of the XML file terminated prematurely.  The messages
+         * are those of readXmlWithParser().
+         */
+        status = UT_PARSE;
+        ut_set_status(status);
+        ut_handle_error_message(XML_ErrorString(XML_ERROR_ABORTED));
+        ut_handle_error_message("File \"%s\", line %d, column %d",
+            log->path, (int)file.event->endLine,
+            (int)file.event->endColumn);
+    }
+
+    ut_free(file.unit);                 /* of an unterminated <unit> */
+    paFree(file.ahead);
+    currFile = prevFile;
+
+    return status;
+}
+
+
+/*
+ * XML files to be read ahead concurrently.
+ */
+typedef struct {
+    char**      paths;          /* pathnames of the files */
+    XmlLog**    logs;           /* logs of the files */
+    size_t      count;          /* number of files */
+    size_t      capacity;       /* capacity of "paths" */
+} ReadAheadJob;
+
+
+/*
+ * Adds an XML file to be read ahead unless it's already been added or read
+ * ahead.
+ *
+ * Arguments:
+ *      job             Pointer to the files to be read ahead.
+ *      path            Pointer to the pathname of the file.
+ */
+static void
+addReadAhead(
+    ReadAheadJob* const job,
+    const char* const   path)
+{
+    int         found = 0;
+    size_t      i;
+
+    for (i = 0; !found && i < xmlLogCount; i++)
+        found = strcmp(xmlLogs[i]->path, path) == 0;
+
+    for (i = 0; !found && i < job->count; i++)
+        found = strcmp(job->paths[i], path) == 0;
+
+    if (!found) {
+        if (job->count == job->capacity) {
+            const size_t    capacity =
+                job->capacity == 0 ? 8 : 2*job->capacity;
+            char** const    paths =
+                realloc(job->paths, capacity*sizeof(char*));
+
+            if (paths != NULL) {
+                job->paths = paths;
+                job->capacity = capacity;
+            }
+        }
+
+        /*
+         * A file that can't be added is read when it's imported.
+         */
+        if (job->count < job->capacity) {
+            job->paths[job->count] = strdup(path);
+
+            if (job->paths[job->count] != NULL)
+                job->count++;
+        }
+    }
+}
+
+
+/*
+ * Reads ahead one XML file of a job.  Executed by the thread-pool.
+ *
+ * Arguments:
+ *      arg             Pointer to the ReadAheadJob.
+ *      index           Origin-0 index of the file.
+ */
+static void
+readAheadTask(
+    void* const         arg,
+    const size_t        index)
+{
+    const ReadAheadJob* const   job = (const ReadAheadJob*)arg;
+    char                        base[PATH_MAX];
+
+    getBase(job->paths[index], base);
+    job->logs[index] = xlRead(job->paths[index], base);
+}
+
+
+/*
+ * Indicates if an event of a log is the start or end of an <import> element.
+ */
+static int
+isImport(
+    const XmlLog* const         log,
+    const XmlEvent* const       event,
+    const XmlEventType          type)
+{
+    const char* const   name = XL_STRING(log, event);
+
+    return event->type == type && name != NULL &&
+        strcasecmp(name, "import") == 0;
+}
+
+
+/*
+ * Reads ahead an XML file and the files that it imports, recursively, by
+ * recording their events in "xmlLogs".  The files are read in waves: the files
+ * imported by the files of one wave are read concurrently in the next.  Any
+ * file that isn't read ahead is read when it's imported.
+ *
+ * Arguments:
+ *      path            Pointer to the pathname of the XML file.
+ */
+static void
+readAhead(
+    const char* const   path)
+{
+    ReadAheadJob        job;
+
+    job.paths = NULL;
+    job.logs = NULL;
+    job.count = 0;
+    job.capacity = 0;
+
+    addReadAhead(&job, path);
+
+    while (job.count > 0) {
+        const size_t    first = xmlLogCount;    /* index of the first new log */
+        XmlLog** const  logs =
+            realloc(xmlLogs, (xmlLogCount + job.count)*sizeof(XmlLog*));
+        size_t          i;
+
+        if (logs != NULL) {
+            xmlLogs = logs;
+            job.logs = xmlLogs + first;
+
+            tpRun(job.count, readAheadTask, &job);
+
+            for (i = 0; i < job.count; i++) {
+                if (job.logs[i] != NULL)
+                    xmlLogs[xmlLogCount++] = job.logs[i];
+            }
+        }
+
+        for (i = 0; i < job.count; i++)
+            free(job.paths[i]);
+
+        job.count = 0;
+
+        for (i = first; i < xmlLogCount; i++) {
+            const XmlLog* const log = xmlLogs[i];
+            size_t              j;
+
+            for (j = 1; log->complete && j + 1 < log->count; j++) {
+                const XmlEvent* const   event = log->events + j;
+
+                if (event->type == XE_TEXT &&
+                        isImport(log, event-1, XE_START) &&
+                        isImport(log, event+1, XE_END)) {
+                    char        buf[PATH_MAX];
+
+                    addReadAhead(&job,
+                        importPath(log->base, XL_STRING(log, event), buf));
+                }
+            }
+        }
+    }
+
+    free(job.paths);
+}
+
+
+/*
+ * Frees the files that were read ahead.
+ */
+static void
+freeReadAhead(void)
+{
+    size_t      i;
+
+    for (i = 0; i < xmlLogCount; i++)
+        xlFree(xmlLogs[i]);
+
+    free(xmlLogs);
+    xmlLogs = NULL;
+    xmlLogCount = 0;
+}
+
+
 /* A bit hacky but much better than modifying binaries. */
 static const char*
 default_udunits2_xml_path()
@@ -2225,6 +2825,61 @@ ut_get_path_xml(
 }
 
 
+/*
+ * Returns the unit-system corresponding to an XML file.
+ *
+ * Arguments:
+ *	path		The pathname of the XML file or NULL.  See
+ *			ut_read_xml().
+ *	mode		How to load the unit-system.
+ * Returns:
+ *	NULL		Failure.  See ut_read_xml().
+ *	else		Pointer to the unit-system defined by "path".
+ */
+static ut_system*
+readXmlSystem(
+    const char*		path,
+    const LoadMode	mode)
+{
+    ut_set_status(UT_SUCCESS);
+
+    unitSystem = ut_new_system();
+
+    if (unitSystem == NULL) {
+        ut_handle_error_message("Couldn't create new unit-system");
+    }
+    else {
+        ut_status       status;
+        ut_status       openError;
+        const XmlLog*   log;
+
+        path = ut_get_path_xml(path, &openError);
+        lazyLoad = mode == LAZY_LOAD;
+
+        if (mode == PARALLEL_LOAD)
+            readAhead(path);
+
+        log = findXmlLog(path);
+        status = log != NULL ? replayXml(log) : readXml(path);
+
+        freeReadAhead();
+        lazyLoad = 0;
+
+        if (status == UT_OPEN_ARG) {
+            status = openError;
+        }
+        if (status != UT_SUCCESS) {
+            ut_free_system(unitSystem);
+            unitSystem = NULL;
+        }
+
+        ut_set_status(status);
+    }				        /* unitSystem != NULL */
+
+    return unitSystem;
+}
+
+
 /**
  * Returns the unit-system corresponding to an XML file.  This is the usual way
  * that a client will obtain a unit-system.
@@ -2251,29 +2906,54 @@ ut_system*
 ut_read_xml(
     const char*	path)
 {
-    ut_set_status(UT_SUCCESS);
-
-    unitSystem = ut_new_system();
-
-    if (unitSystem == NULL) {
-        ut_handle_error_message("Couldn't create new unit-system");
-    }
-    else {
-        ut_status       status;
-        ut_status       openError;
+    return readXmlSystem(path, EAGER_LOAD);
+}
 
-        status = readXml(ut_get_path_xml(path, &openError));
 
-        if (status == UT_OPEN_ARG) {
-            status = openError;
-        }
-        if (status != UT_SUCCESS) {
-            ut_free_system(unitSystem);
-            unitSystem = NULL;
-        }
+/**
+ * Returns the unit-system corresponding to an XML file like ut_read_xml() but
+ * defers the definitions of units.  Prefixes, base-units, and dimensionless
+ * units are added immediately; other units are only indexed by their
+ * identifiers and each one is parsed and mapped when one of its identifiers
+ * is first looked up (e.g., by ut_get_unit_by_name(), ut_get_unit_by_symbol(),
+ * or ut_parse()).  This makes reading the database much faster and the
+ * unit-system much smaller for clients that use few units.
+ *
+ * Until a unit is materialized, it isn't mapped to its identifiers, so
+ * ut_get_name(), ut_get_symbol(), and ut_format() won't use them.  Because
+ * looking up a unit can modify the unit-system, the unit-system must not be
+ * used concurrently until it's frozen by ut_freeze_system(), which
+ * materializes all units.
+ *
+ * @param path	The pathname of the XML file or NULL.  See ut_read_xml().
+ * @retval NULL Failure.  See ut_read_xml().
+ * @return      Pointer to the unit-system defined by "path".
+ */
+ut_system*
+ut_read_xml_lazy(
+    const char*	path)
+{
+    return readXmlSystem(path, LAZY_LOAD);
+}
 
-        ut_set_status(status);
-    }				        /* unitSystem != NULL */
 
-    return unitSystem;
+/**
+ * Returns the unit-system corresponding to an XML file like ut_read_xml() but
+ * uses the thread-pool of the library.  The file and the files that it imports
+ * are read and tokenized concurrently; then, before each file is processed,
+ * its unit definitions and the identifiers whose prior definitions will be
+ * checked are parsed ahead, concurrently, in the unit-system as it is then.
+ * Each parse records the identifiers that it looked up and its result is used
+ * only if none of them has been mapped since, so the files are processed in
+ * the same order and with the same results as by ut_read_xml().
+ *
+ * @param path	The pathname of the XML file or NULL.  See ut_read_xml().
+ * @retval NULL Failure.  See ut_read_xml().
+ * @return      Pointer to the unit-system defined by "path".
+ */
+ut_system*
+ut_read_xml_parallel(
+    const char*	path)
+{
+    return readXmlSystem(path, PARALLEL_LOAD);
 }
@@ -0,0 +1,330 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Recorded parsing events of an XML file.
+ *
+ * Tokenizing the files of a unit-database doesn't depend on the unit-system,
+ * so the files can be read and their events recorded concurrently; the events
+ * are then replayed, in order, to the handlers that build the unit-system.
+ */
+
+/*LINTLIBRARY*/
+
+#include "config.h"
+
+#include "xmlLog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef DLL_UDUNITS2
+#   define XML_STATIC
+#endif
+#include <expat.h>
+
+/*
+ * Size of the buffer for reading a file in bytes.
+ */
+#define XL_BUFSIZE	65536
+
+typedef struct {
+    XmlLog*		log;
+    XML_Parser		parser;
+    size_t		capacity;	/* of "log->events" */
+    size_t		nbytes;		/* number of bytes in "log->strings" */
+    size_t		size;		/* size of "log->strings" in bytes */
+    int			failed;		/* memory couldn't be allocated */
+} Recorder;
+
+
+/*
+ * Appends bytes to the strings of a log being recorded.  The string is
+ * NUL-terminated.
+ *
+ * Returns:
+ *	0		Success.
+ *	-1		Failure.  The recorder is marked as failed.
+ */
+static int
+appendString(
+    Recorder* const	rec,
+    const char* const	string,
+    const size_t	len)
+{
+    if (rec->nbytes + len + 1 > rec->size) {
+	const size_t	size = 2*(rec->nbytes + len + 1);
+	char* const	strings = realloc(rec->log->strings, size);
+
+	if (strings == NULL) {
+	    rec->failed = 1;
+	}
+	else {
+	    rec->log->strings = strings;
+	    rec->size = size;
+	}
+    }
+
+    if (!rec->failed) {
+	(void)memcpy(rec->log->strings + rec->nbytes, string, len);
+	rec->nbytes += len;
+	rec->log->strings[rec->nbytes++] = 0;
+    }
+
+    return rec->failed ? -1 : 0;
+}
+
+
+/*
+ * Sets the location just after the current event of the parser, which is
+ * where the parser reports an error after being stopped by the event.
+ *
+ * Arguments:
+ *	rec		Pointer to the recorder.
+ *	event		Pointer to the event.  Its "endLine" and "endColumn"
+ *			must be the location of the start of the parser's
+ *			current event.
+ */
+static void
+setEnd(
+    Recorder* const	rec,
+    XmlEvent* const	event)
+{
+    int			offset;
+    int			size;
+    const char* const	context = XML_GetInputContext(rec->parser, &offset,
+	&size);
+
+    if (context != NULL) {
+	const char*		cp = context + offset;
+	const char* const	end = cp + XML_GetCurrentByteCount(rec->parser);
+
+	for (; cp < end && cp < context + size; cp++) {
+	    if (*cp == '\n' || *cp == '\r') {
+		event->endLine++;
+		event->endColumn = 0;
+
+		if (*cp == '\r' && cp + 1 < end && cp[1] == '\n')
+		    cp++;
+	    }
+	    else if ((*cp & 0xC0) != 0x80) {
+		event->endColumn++;	/* not a UTF-8 continuation byte */
+	    }
+	}
+    }
+}
+
+
+/*
+ * Appends an event to a log being recorded.
+ *
+ * Arguments:
+ *	rec		Pointer to the recorder.
+ *	type		The type of the event.
+ *	string		The string of the event or NULL.
+ *	len		The length of "string" in bytes.
+ * Returns:
+ *	NULL		Failure.  The recorder is marked as failed.
+ *	else		Pointer to the event.
+ */
+static XmlEvent*
+appendEvent(
+    Recorder* const		rec,
+    const XmlEventType		type,
+    const char* const		string,
+    const size_t		len)
+{
+    XmlEvent*	event = NULL;
+
+    if (rec->log->count == rec->capacity) {
+	const size_t	capacity = rec->capacity == 0 ? 1024 : 2*rec->capacity;
+	XmlEvent* const	events =
+	    realloc(rec->log->events, capacity*sizeof(XmlEvent));
+
+	if (events == NULL) {
+	    rec->failed = 1;
+	}
+	else {
+	    rec->log->events = events;
+	    rec->capacity = capacity;
+	}
+    }
+
+    if (!rec->failed) {
+	const size_t	offset = string == NULL ? XL_NONE : rec->nbytes;
+
+	if (string == NULL || appendString(rec, string, len) == 0) {
+	    event = rec->log->events + rec->log->count++;
+	    event->type = type;
+	    event->offset = offset;
+	    event->length = len;
+	    event->standalone = 0;
+	    event->line = XML_GetCurrentLineNumber(rec->parser);
+	    event->column = XML_GetCurrentColumnNumber(rec->parser);
+	    event->endLine = event->line;
+	    event->endColumn = event->column;
+
+	    setEnd(rec, event);
+	}
+    }
+
+    if (rec->failed)
+	XML_StopParser(rec->parser, 0);
+
+    return event;
+}
+
+
+static void
+recordDeclaration(
+    void*		data,
+    const char*		version,
+    const char*		encoding,
+    int			standalone)
+{
+    Recorder* const	rec = (Recorder*)data;
+    XmlEvent* const	event = appendEvent(rec, XE_DECLARATION, encoding,
+	encoding == NULL ? 0 : strlen(encoding));
+
+    if (event != NULL)
+	event->standalone = standalone;
+}
+
+
+static void
+recordStart(
+    void*		data,
+    const XML_Char*	name,
+    const XML_Char**	atts)
+{
+    (void)appendEvent((Recorder*)data, XE_START, name, strlen(name));
+}
+
+
+static void
+recordEnd(
+    void*		data,
+    const XML_Char*	name)
+{
+    (void)appendEvent((Recorder*)data, XE_END, name, strlen(name));
+}
+
+
+static void
+recordText(
+    void*		data,
+    const char*		string,
+    int			len)
+{
+    Recorder* const	rec = (Recorder*)data;
+    XmlEvent* const	last = rec->log->count == 0
+	? NULL
+	: rec->log->events + rec->log->count - 1;
+
+    if (last != NULL && last->type == XE_TEXT) {
+	/*
+	 * Extend the previous character data, which is the last string.
+	 */
+	rec->nbytes--;
+
+	if (appendString(rec, string, len) == 0) {
+	    last->length += len;
+	    last->endLine = XML_GetCurrentLineNumber(rec->parser);
+	    last->endColumn = XML_GetCurrentColumnNumber(rec->parser);
+
+	    setEnd(rec, last);
+	}
+	else {
+	    XML_StopParser(rec->parser, 0);
+	}
+    }
+    else {
+	(void)appendEvent(rec, XE_TEXT, string, len);
+    }
+}
+
+
+XmlLog*
+xlRead(
+    const char* const	path,
+    const char* const	base)
+{
+    XmlLog*	log = calloc(1, sizeof(XmlLog));
+
+    if (log != NULL) {
+	log->path = strdup(path);
+	log->base = strdup(base);
+
+	if (log->path == NULL || log->base == NULL) {
+	    xlFree(log);
+	    log = NULL;
+	}
+	else {
+	    Recorder	rec;
+	    FILE*	file = fopen(path, "rb");
+
+	    rec.log = log;
+	    rec.parser = file == NULL ? NULL : XML_ParserCreate(NULL);
+	    rec.capacity = 0;
+	    rec.nbytes = 0;
+	    rec.size = 0;
+	    rec.failed = 0;
+
+	    if (rec.parser != NULL) {
+		char*	buf = malloc(XL_BUFSIZE);
+		int	ok = buf != NULL;
+
+		XML_SetUserData(rec.parser, &rec);
+		XML_SetXmlDeclHandler(rec.parser, recordDeclaration);
+		XML_SetElementHandler(rec.parser, recordStart, recordEnd);
+		XML_SetCharacterDataHandler(rec.parser, recordText);
+
+		while (ok) {
+		    const size_t	nbytes = fread(buf, 1, XL_BUFSIZE, file);
+		    const int		isFinal = nbytes < XL_BUFSIZE;
+
+		    ok = !ferror(file) &&
+			XML_Parse(rec.parser, buf, (int)nbytes, isFinal) ==
+			    XML_STATUS_OK;
+
+		    if (ok && isFinal) {
+			log->complete = !rec.failed;
+			break;
+		    }
+		}
+
+		free(buf);
+		XML_ParserFree(rec.parser);
+	    }
+
+	    if (file != NULL)
+		(void)fclose(file);
+
+	    if (rec.failed) {
+		xlFree(log);
+		log = NULL;
+	    }
+	}
+    }
+
+    return log;
+}
+
+
+void
+xlFree(
+    XmlLog* const	log)
+{
+    if (log != NULL) {
+	free(log->strings);
+	free(log->events);
+	free(log->base);
+	free(log->path);
+	free(log);
+    }
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2020 University Corporation for Atmospheric Research
+ *
+ * This file is part of the UDUNITS-2 package.  See the file COPYRIGHT
+ * in the top-level source-directory of the package for copying and
+ * redistribution conditions.
+ */
+/*
+ * Recorded parsing events of an XML file.  See xmlLog.c.
+ */
+#ifndef UT_XML_LOG_H_INCLUDED
+#define UT_XML_LOG_H_INCLUDED
+
+#include <stddef.h>
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef enum {
+    XE_DECLARATION,			/* XML declaration */
+    XE_START,				/* start of an element */
+    XE_END,				/* end of an element */
+    XE_TEXT				/* character data */
+} XmlEventType;
+
+/*
+ * Offset of a missing string (e.g., the encoding of an XML declaration that
+ * doesn't have one).
+ */
+#define XL_NONE	((size_t)-1)
+
+typedef struct {
+    XmlEventType	type;
+    size_t		offset;		/* of the NUL-terminated element name,
+					 * character data, or encoding in
+					 * "strings" or XL_NONE */
+    size_t		length;		/* of the string in bytes */
+    int			standalone;	/* of an XML declaration */
+    unsigned long	line;		/* location of the start of the event */
+    unsigned long	column;
+    unsigned long	endLine;	/* location just after the event */
+    unsigned long	endColumn;
+} XmlEvent;
+
+typedef struct {
+    char*		path;		/* pathname of the file */
+    char*		base;		/* base for relative pathnames */
+    XmlEvent*		events;
+    size_t		count;		/* number of events */
+    char*		strings;
+    int			complete;	/* file entirely read and parsed? */
+} XmlLog;
+
+
+/*
+ * Returns the string of an event of a log.
+ *
+ * Arguments:
+ *	log		Pointer to the log.
+ *	event		Pointer to the event.
+ */
+#define XL_STRING(log, event) \
+    ((event)->offset == XL_NONE ? NULL : (log)->strings + (event)->offset)
+
+
+/*
+ * Reads an XML file and records its parsing events.  Adjacent character data
+ * are recorded as one event.  Attributes aren't recorded.  Thread-safe:
+ * nothing is reported and no global state is used, so different files may be
+ * read concurrently.
+ *
+ * Arguments:
+ *	path		The pathname of the file.
+ *	base		The base for relative pathnames (see XML_SetBase()).
+ * Returns:
+ *	NULL		Necessary memory couldn't be allocated.
+ *	else		Pointer to the log.  If the file couldn't be read or
+ *			parsed, then "complete" is zero and the log contains
+ *			the events up to the failure.  Should be passed to
+ *			xlFree().
+ */
+XmlLog*
+xlRead(
+    const char* const	path,
+    const char* const	base);
+
+
+/*
+ * Frees a log.
+ *
+ * Arguments:
+ *	log		Pointer to the log or NULL.
+ */
+void
+xlFree(
+    XmlLog* const	log);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -15,10 +15,13 @@
 
 #ifdef _MSC_VER
 #include "XGetOpt.h"
+#include <fcntl.h>
+#include <io.h>
 #endif
 
 #include <errno.h>
 #include <ctype.h>
+#include <float.h>
 #ifndef _MSC_VER
 #include <libgen.h>
 #endif
@@ -45,6 +48,13 @@ static int		_encodingSet; /* is the character encoding set? */
 static ut_encoding	_encoding; /* the character encoding to use */
 static char             _progname[1024];
 static const char*	_xmlPath = NULL; /* use default path */
+static const char*	_binPath = NULL; /* binary database to read or NULL */
+static const char*	_compilePath = NULL; /* binary database to write or
+                                                NULL */
+static const char*	_batchPath = NULL; /* file of records to convert or
+                                              NULL */
+static const char*	_arrayType = NULL; /* type of binary array values to
+                                              convert or NULL */
 static ut_system*	_unitSystem;
 static double           _haveUnitAmount; /* amount of "have" unit */
 static char		_haveUnitSpec[_POSIX_MAX_INPUT+1]; /* "have" unit minus
@@ -67,6 +77,12 @@ usage(void)
 "Usage:\n"
 "    %s -h\n"
 "    %s [-A|-L|-U] [-r] [-H <have>] [-W <want>] [<XML_file>]\n"
+"    %s [-A|-L|-U] [-H <have>] [-W <want>] -b <binary_file>\n"
+"    %s [-A|-L|-U] [-H <have>] [-W <want>] -i <records> [-b <binary_file>|\n"
+"        <XML_file>]\n"
+"    %s [-A|-L|-U] -B <type> -H <have> -W <want> [-b <binary_file>|\n"
+"        <XML_file>] <in >out\n"
+"    %s [-r] -c <binary_file> [<XML_file>]\n"
 "\n"
 "where:\n"
 "    -A          Use ASCII encoding (default).\n"
@@ -77,8 +93,26 @@ usage(void)
 "    -H <have>   Use <have> unit for conversion. Default is reply to prompt.\n"
 "    -W <want>   Use <want> unit for conversion. Empty string requests\n"
 "                definition of <have> unit. Default is reply to prompt.\n"
+"    -B <type>   Convert the binary array of values of type <type> on\n"
+"                standard input from <have> to <want> units and write it\n"
+"                to standard output. <type> is \"f32\" or \"f64\" with an\n"
+"                optional \"le\" or \"be\" suffix for little- or\n"
+"                big-endian values. Default is native byte-order.\n"
+"    -b <binary_file>\n"
+"                Use binary database file created by \"-c\" instead of\n"
+"                XML database file.\n"
+"    -c <binary_file>\n"
+"                Compile the XML database into binary database file and\n"
+"                exit.\n"
+"    -i <records>\n"
+"                Convert the \"value have want\" records of the file\n"
+"                <records> (\"-\" means standard input) and print one\n"
+"                converted value per record. Fields are separated by tabs\n"
+"                or, in a record without a tab, by commas. Missing <have>\n"
+"                and <want> fields default to the \"-H\" and \"-W\" units.\n"
 "    <XML_file>  XML database file. Default is \"%s\".\n",
-        _progname, _progname, default_xml);
+        _progname, _progname, _progname, _progname, _progname, _progname,
+        default_xml);
 }
 
 /**
@@ -138,7 +172,7 @@ decodeCommandLine(
     }
 #endif
 
-    while ((c = getopt(argc, argv, "ALUhrH:W:")) != -1) {
+    while ((c = getopt(argc, argv, "ALUhrB:H:W:b:c:i:")) != -1) {
 	switch (c) {
 	    case 'A':
 		_encoding = UT_ASCII;
@@ -161,6 +195,18 @@ decodeCommandLine(
 	    case 'r':
 		_reveal = 1;
 		continue;
+	    case 'b':
+		_binPath = optarg;
+		continue;
+	    case 'c':
+		_compilePath = optarg;
+		continue;
+	    case 'i':
+		_batchPath = optarg;
+		continue;
+	    case 'B':
+		_arrayType = optarg;
+		continue;
 	    case 'h':
 		_exitStatus = EXIT_SUCCESS;
 		/*FALLTHROUGH*/
@@ -179,7 +225,28 @@ decodeCommandLine(
         if (optind < argc)
             _xmlPath = argv[optind];
 
-        success = 1;
+        if (_binPath != NULL && (_compilePath != NULL || optind < argc)) {
+            errMsg("Option \"-b\" can't be used with option \"-c\" or an "
+                    "XML database file");
+            usage();
+        }
+        else if (_batchPath != NULL && _compilePath != NULL) {
+            errMsg("Option \"-i\" can't be used with option \"-c\"");
+            usage();
+        }
+        else if (_arrayType != NULL && (_batchPath != NULL ||
+                _compilePath != NULL)) {
+            errMsg("Option \"-B\" can't be used with option \"-i\" or "
+                    "\"-c\"");
+            usage();
+        }
+        else if (_arrayType != NULL && (_cmdHave == NULL || _cmdWant == NULL)) {
+            errMsg("Option \"-B\" requires options \"-H\" and \"-W\"");
+            usage();
+        }
+        else {
+            success = 1;
+        }
     }
 
     return success;
@@ -381,6 +448,49 @@ readXmlDatabase(void)
 }
 
 
+static int
+readBinaryDatabase(void)
+{
+    int		success = 0;
+
+    ut_set_error_message_handler(ut_ignore);
+
+    _unitSystem = ut_mmap_binary(_binPath);
+
+    ut_set_error_message_handler(ut_write_to_stderr);
+
+    if (_unitSystem != NULL) {
+        success = 1;
+    }
+    else {
+        errMsg("Couldn't initialize unit-system from binary database \"%s\": "
+                "%s", _binPath, ut_get_status() == UT_PARSE
+                    ? "Not a valid binary database"
+                    : strerror(errno));
+    }
+
+    return success;
+}
+
+
+static int
+compileDatabase(void)
+{
+    int		success = 0;
+
+    if (ut_write_binary(_unitSystem, _compilePath) == UT_SUCCESS) {
+        success = 1;
+        _exitStatus = EXIT_SUCCESS;
+    }
+    else {
+        errMsg("Couldn't write binary database \"%s\": %s", _compilePath,
+                strerror(errno));
+    }
+
+    return success;
+}
+
+
 /*
  * Prompt the user and get a specification.
  */
@@ -639,6 +749,521 @@ handleRequest(void)
 }
 
 
+/*
+ * Batch conversion of records (the "-i" option):
+ */
+
+#define CONV_CACHE_SIZE	256	/* number of cached converters; power of 2 */
+#define MAX_RECORD	4096	/* maximum record length including newline */
+#define IO_BUF_SIZE	65536	/* size of the stdio buffers */
+
+typedef struct {
+    char*               have;   /* "have" unit specification */
+    char*               want;   /* "want" unit specification */
+    cv_converter*       conv;   /* converter from "have" to "want" */
+} CachedConverter;
+
+/*
+ * Converters of recently-seen pairs of unit specifications.  A direct-mapped
+ * cache suffices because a file of records usually has few distinct pairs.
+ */
+static CachedConverter  _convCache[CONV_CACHE_SIZE];
+
+/**
+ * Returns the converter between two unit specifications, parsing the
+ * specifications and building the converter only if the pair isn't in the
+ * cache.
+ *
+ * @param have          The "have" unit specification.
+ * @param want          The "want" unit specification.
+ * @param recno         The origin-1 record number for error-messages.
+ * @retval NULL         The converter couldn't be obtained. An error-message
+ *                      is printed to the standard error stream.
+ * @return              The converter. It's owned by the cache.
+ */
+static cv_converter*
+getCachedConverter(
+    const char* const           have,
+    const char* const           want,
+    const unsigned long         recno)
+{
+    cv_converter*       conv = NULL;
+    unsigned long       hash = 2166136261u;
+    const char*         cp;
+    CachedConverter*    entry;
+
+    for (cp = have; *cp; cp++)
+        hash = (hash ^ (unsigned char)*cp) * 16777619u;
+    hash = (hash ^ '\t') * 16777619u;
+    for (cp = want; *cp; cp++)
+        hash = (hash ^ (unsigned char)*cp) * 16777619u;
+
+    entry = _convCache + (hash & (CONV_CACHE_SIZE-1));
+
+    if (entry->conv != NULL && strcmp(entry->have, have) == 0 &&
+            strcmp(entry->want, want) == 0) {
+        conv = entry->conv;
+    }
+    else {
+        ut_unit* const  haveUnit = ut_parse(_unitSystem, have, _encoding);
+        ut_unit*        wantUnit = NULL;
+
+        if (haveUnit == NULL) {
+            errMsg("Record %lu: Don't recognize \"%s\"", recno, have);
+        }
+        else if ((wantUnit = ut_parse(_unitSystem, want, _encoding)) == NULL) {
+            errMsg("Record %lu: Don't recognize \"%s\"", recno, want);
+        }
+        else if (!ut_are_convertible(wantUnit, haveUnit)) {
+            errMsg("Record %lu: Units \"%s\" and \"%s\" are not convertible",
+                    recno, have, want);
+        }
+        else if ((conv = ut_get_converter(haveUnit, wantUnit)) == NULL) {
+            errMsg("Record %lu: Couldn't get unit converter", recno);
+        }
+        else {
+            char* const haveCopy = strdup(have);
+            char* const wantCopy = strdup(want);
+
+            if (haveCopy == NULL || wantCopy == NULL) {
+                errMsg("Couldn't copy unit specifications: %s",
+                        strerror(errno));
+                free(haveCopy);
+                free(wantCopy);
+                cv_free(conv);
+                conv = NULL;
+            }
+            else {
+                free(entry->have);
+                free(entry->want);
+                cv_free(entry->conv);
+
+                entry->have = haveCopy;
+                entry->want = wantCopy;
+                entry->conv = conv;
+            }
+        }
+
+        ut_free(wantUnit);
+        ut_free(haveUnit);
+    }
+
+    return conv;
+}
+
+
+/**
+ * Frees the cache of converters.
+ */
+static void
+freeConverterCache(void)
+{
+    int         i;
+
+    for (i = 0; i < CONV_CACHE_SIZE; i++) {
+        free(_convCache[i].have);
+        free(_convCache[i].want);
+        cv_free(_convCache[i].conv);
+        _convCache[i].conv = NULL;
+    }
+}
+
+
+/**
+ * Splits a record into fields in place. Fields are separated by tabs or, if
+ * the record doesn't contain a tab, by commas. Leading and trailing
+ * whitespace is removed from every field.
+ *
+ * @param record        The NUL-terminated record. Modified.
+ * @param fields        The fields of the record. Set on return.
+ * @param max           The maximum number of fields.
+ * @retval -1           The record has more than "max" fields.
+ * @return              The number of fields.
+ */
+static int
+splitRecord(
+    char* const         record,
+    char**              fields,
+    const int           max)
+{
+    const int   sep = strchr(record, '\t') != NULL ? '\t' : ',';
+    char*       field = record;
+    int         n = 0;
+
+    for (;;) {
+        char* const     end = strchr(field, sep);
+
+        if (n == max)
+            return -1;
+
+        if (end != NULL)
+            *end = 0;
+
+        fields[n++] = ut_trim(field, _encoding);
+
+        if (end == NULL)
+            break;
+
+        field = end + 1;
+    }
+
+    return n;
+}
+
+
+/**
+ * Converts one record.
+ *
+ * @param record        The NUL-terminated record without a newline.
+ *                      Modified.
+ * @param recno         The origin-1 record number for error-messages.
+ * @param value         The converted value. Set on success.
+ * @return              Whether or not the record was converted. 0 means no,
+ *                      and an error-message is printed to the standard error
+ *                      stream; otherwise, yes.
+ */
+static int
+convertRecord(
+    char* const                 record,
+    const unsigned long         recno,
+    double* const               value)
+{
+    int         success = 0;
+    char*       fields[3];
+    const int   nfields = splitRecord(record, fields, 3);
+
+    if (nfields < 0) {
+        errMsg("Record %lu: Too many fields", recno);
+    }
+    else {
+        const char* const       have = nfields > 1 && *fields[1]
+                ? fields[1]
+                : _cmdHave;
+        const char* const       want = nfields > 2 && *fields[2]
+                ? fields[2]
+                : _cmdWant;
+        char*                   end;
+        double                  amount;
+
+        errno = 0;
+        amount = strtod(fields[0], &end);
+
+        if (end == fields[0] || *end != 0 || errno == ERANGE) {
+            errMsg("Record %lu: Invalid value \"%s\"", recno, fields[0]);
+        }
+        else if (have == NULL || want == NULL) {
+            errMsg("Record %lu: No %s unit and no \"%s\" option", recno,
+                    have == NULL ? "have" : "want", have == NULL ? "-H" : "-W");
+        }
+        else {
+            const cv_converter* const   conv =
+                    getCachedConverter(have, want, recno);
+
+            if (conv != NULL) {
+                *value = cv_convert_double(conv, amount);
+                success = 1;
+            }
+        }
+    }
+
+    return success;
+}
+
+
+/**
+ * Converts the records of the file specified by the "-i" option and prints the
+ * converted values, one per line, to the standard output stream. A record that
+ * can't be converted results in "nan". Empty records and records that start
+ * with "#" are skipped.
+ *
+ * @return              Whether or not all records were converted. 0 means no;
+ *                      otherwise, yes.
+ */
+static int
+convertRecords(void)
+{
+    int         success = 0;
+    const int   isStdin = strcmp(_batchPath, "-") == 0;
+    FILE* const file = isStdin ? stdin : fopen(_batchPath, "r");
+
+    if (file == NULL) {
+        errMsg("Couldn't open record file \"%s\": %s", _batchPath,
+                strerror(errno));
+    }
+    else {
+        static char     inBuf[IO_BUF_SIZE];
+        static char     outBuf[IO_BUF_SIZE];
+        char            record[MAX_RECORD];
+        unsigned long   recno = 0;
+        int             nfailed = 0;
+
+        (void)setvbuf(file, inBuf, _IOFBF, sizeof(inBuf));
+        (void)setvbuf(stdout, outBuf, _IOFBF, sizeof(outBuf));
+
+        while (fgets(record, sizeof(record), file) != NULL) {
+            const size_t        len = strlen(record);
+            int                 converted = 0;
+            double              value;
+            const char*         cp;
+
+            recno++;
+
+            if (len > 0 && record[len-1] == '\n') {
+                record[len-1] = 0;
+            }
+            else if (!feof(file)) {
+                int     c;
+
+                errMsg("Record %lu: Longer than %d bytes", recno,
+                        MAX_RECORD - 2);
+
+                while ((c = getc(file)) != EOF && c != '\n')
+                    ; /* EMPTY */
+
+                nfailed++;
+                (void)fputs("nan\n", stdout);
+                continue;
+            }
+
+            for (cp = record; isspace((unsigned char)*cp); cp++)
+                ; /* EMPTY */
+
+            if (*cp == 0 || *cp == '#')
+                continue;
+
+            converted = convertRecord(record, recno, &value);
+
+            if (converted) {
+                (void)printf("%.*g\n", DBL_DIG, value);
+            }
+            else {
+                nfailed++;
+                (void)fputs("nan\n", stdout);
+            }
+        }
+
+        if (ferror(file)) {
+            errMsg("Couldn't read record file \"%s\": %s", _batchPath,
+                    strerror(errno));
+        }
+        else if (fflush(stdout) == EOF || ferror(stdout)) {
+            errMsg("Couldn't write to standard output: %s", strerror(errno));
+        }
+        else if (nfailed > 0) {
+            errMsg("%d records couldn't be converted", nfailed);
+        }
+        else {
+            success = 1;
+            _exitStatus = EXIT_SUCCESS;
+        }
+
+        if (!isStdin)
+            (void)fclose(file);
+
+        freeConverterCache();
+    }
+
+    return success;
+}
+
+
+/*
+ * Conversion of binary arrays (the "-B" option):
+ */
+
+#define ARRAY_BLOCK_SIZE    (1 << 20)   /* bytes per block; multiple of 8 */
+
+/**
+ * Decodes the type of the values of a binary array.
+ *
+ * @param type          The type: "f32" or "f64" with an optional "le" or "be"
+ *                      suffix.
+ * @param size          The size of a value in bytes. Set on success.
+ * @param swap          Whether or not the bytes of a value must be swapped.
+ *                      Set on success.
+ * @return              Whether or not the type is valid. 0 means no;
+ *                      otherwise, yes.
+ */
+static int
+decodeArrayType(
+    const char* const   type,
+    size_t* const       size,
+    int* const          swap)
+{
+    static const union {
+        unsigned short  value;
+        unsigned char   bytes[2];
+    }                   probe = {1};
+    const int           littleEndian = probe.bytes[0] == 1;
+    int                 success = 0;
+
+    if (strncmp(type, "f32", 3) == 0 || strncmp(type, "f64", 3) == 0) {
+        const char* const       suffix = type + 3;
+
+        *size = type[1] == '3' ? sizeof(float) : sizeof(double);
+
+        if (*suffix == 0) {
+            *swap = 0;
+            success = 1;
+        }
+        else if (strcmp(suffix, "le") == 0 || strcmp(suffix, "be") == 0) {
+            *swap = (suffix[0] == 'l') != littleEndian;
+            success = 1;
+        }
+    }
+
+    return success;
+}
+
+
+/**
+ * Reverses the byte-order of the values of an array in place.
+ *
+ * @param buf           The array.
+ * @param count         The number of values.
+ * @param size          The size of a value in bytes.
+ */
+static void
+swapBytes(
+    unsigned char* const        buf,
+    const size_t                count,
+    const size_t                size)
+{
+    unsigned char*      value = buf;
+    size_t              i;
+
+    for (i = 0; i < count; i++, value += size) {
+        size_t  lo, hi;
+
+        for (lo = 0, hi = size - 1; lo < hi; lo++, hi--) {
+            const unsigned char tmp = value[lo];
+
+            value[lo] = value[hi];
+            value[hi] = tmp;
+        }
+    }
+}
+
+
+/**
+ * Converts the binary array of values of the type specified by the "-B" option
+ * on the standard input stream from the "-H" unit to the "-W" unit and writes
+ * the result to the standard output stream. The array is converted in large
+ * blocks.
+ *
+ * @return              Whether or not the array was converted. 0 means no;
+ *                      otherwise, yes.
+ */
+static int
+convertArray(void)
+{
+    int                 success = 0;
+    size_t              size;
+    int                 swap;
+    ut_unit*            haveUnit = NULL;
+    ut_unit*            wantUnit = NULL;
+    cv_converter*       conv = NULL;
+    void*               buf = NULL;
+
+    if (!decodeArrayType(_arrayType, &size, &swap)) {
+        errMsg("Invalid array type \"%s\"", _arrayType);
+    }
+    else if ((haveUnit = ut_parse(_unitSystem, _cmdHave, _encoding)) == NULL) {
+        errMsg("Don't recognize \"%s\"", _cmdHave);
+    }
+    else if ((wantUnit = ut_parse(_unitSystem, _cmdWant, _encoding)) == NULL) {
+        errMsg("Don't recognize \"%s\"", _cmdWant);
+    }
+    else if (!ut_are_convertible(wantUnit, haveUnit)) {
+        errMsg("Units are not convertible");
+    }
+    else if ((conv = ut_get_converter(haveUnit, wantUnit)) == NULL) {
+        errMsg("Couldn't get unit converter");
+    }
+    else if ((buf = malloc(ARRAY_BLOCK_SIZE)) == NULL) {
+        errMsg("Couldn't allocate %d-byte buffer: %s", ARRAY_BLOCK_SIZE,
+                strerror(errno));
+    }
+    else {
+        unsigned char* const    bytes = buf;
+        size_t                  nbytes = 0; /* bytes in "buf" */
+
+#ifdef _MSC_VER
+        (void)_setmode(_fileno(stdin), _O_BINARY);
+        (void)_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+        for (;;) {
+            const size_t        nread = fread(bytes + nbytes, 1,
+                    ARRAY_BLOCK_SIZE - nbytes, stdin);
+            size_t              count;
+            size_t              used;
+
+            nbytes += nread;
+            count = nbytes / size;
+            used = count * size;
+
+            if (count > 0) {
+                if (swap)
+                    swapBytes(bytes, count, size);
+
+                if (size == sizeof(float)) {
+                    (void)cv_convert_floats(conv, (float*)buf, count,
+                            (float*)buf);
+                }
+                else {
+                    (void)cv_convert_doubles(conv, (double*)buf, count,
+                            (double*)buf);
+                }
+
+                if (swap)
+                    swapBytes(bytes, count, size);
+
+                if (fwrite(buf, size, count, stdout) != count) {
+                    errMsg("Couldn't write to standard output: %s",
+                            strerror(errno));
+                    break;
+                }
+
+                /*
+                 * Keep any trailing partial value for the next block.
+                 */
+                (void)memmove(bytes, bytes + used, nbytes - used);
+                nbytes -= used;
+            }
+
+            if (nread == 0 || feof(stdin) || ferror(stdin)) {
+                if (ferror(stdin)) {
+                    errMsg("Couldn't read from standard input: %s",
+                            strerror(errno));
+                }
+                else if (nbytes != 0) {
+                    errMsg("Input ends with a partial %lu-byte value",
+                            (unsigned long)size);
+                }
+                else if (fflush(stdout) == EOF) {
+                    errMsg("Couldn't write to standard output: %s",
+                            strerror(errno));
+                }
+                else {
+                    success = 1;
+                    _exitStatus = EXIT_SUCCESS;
+                }
+
+                break;
+            }
+        }
+    }
+
+    free(buf);
+    cv_free(conv);
+    ut_free(wantUnit);
+    ut_free(haveUnit);
+
+    return success;
+}
+
+
 int
 main(
     const int		argc,
@@ -646,9 +1271,20 @@ main(
 {
     if (decodeCommandLine(argc, argv)) {
     	if (ensureEncodingSet()) {
-            if (readXmlDatabase()) {
-                while (handleRequest())
-                    ; /* EMPTY */
+            if (_binPath != NULL ? readBinaryDatabase() : readXmlDatabase()) {
+                if (_compilePath != NULL) {
+                    (void)compileDatabase();
+                }
+                else if (_batchPath != NULL) {
+                    (void)convertRecords();
+                }
+                else if (_arrayType != NULL) {
+                    (void)convertArray();
+                }
+                else {
+                    while (handleRequest())
+                        ; /* EMPTY */
+                }
             }
     	}
     }